@@ -72,6 +72,8 @@
 
 #include <avogadro/toolgroup.h>
 #include <avogadro/color.h>
+#include <avogadro/renderprofiler.h>
+#include <avogadro/moleculedelta.h>
 
 #include <openbabel/obconversion.h>
 #include <openbabel/mol.h>
@@ -259,7 +261,8 @@ protected:
       moleculeFile(0), currentIndex(0),
       progressDialog(0),
       allMoleculesTable(0),
-      allMoleculesDialog(0)
+      allMoleculesDialog(0),
+      undoMemoryLimit(256), undoLimitDeclined(false)
     {}
 
     Molecule  *molecule;
@@ -323,6 +326,9 @@ protected:
     QTableWidget  *allMoleculesTable;
     QDialog       *allMoleculesDialog;
 
+    int undoMemoryLimit;          // In megabytes
+    bool undoLimitDeclined;       // Keep the history until the limit changes
+
     QMap<Engine*, QWidget*> engineSettingsWindows;
   };
 
@@ -759,6 +765,34 @@ protected:
       d->glWidget->setRenderDebug(render);
   }
 
+  void MainWindow::exportRenderProfile()
+  {
+    RenderProfiler *profiler = d->glWidget->renderProfiler();
+    if (!profiler->frames()) {
+      QMessageBox::information(this, tr("Avogadro"),
+                               tr("No render times have been recorded. "
+                                  "Turn on Debug Information and interact "
+                                  "with the view to record them."));
+      return;
+    }
+
+    QFileInfo info(d->molecule->fileName());
+    QString selectedFilter = tr("CSV") + " (*.csv)";
+    QString fileName = SaveDialog::run(this,
+                                       tr("Export Render Profile"),
+                                       info.absolutePath(),
+                                       info.baseName() + "-render",
+                                       QStringList() << selectedFilter,
+                                       "csv",
+                                       selectedFilter);
+    if (fileName.isEmpty())
+      return;
+
+    QString error;
+    if (!profiler->writeCsv(fileName, &error))
+      QMessageBox::warning(this, tr("Avogadro"), error);
+  }
+
   bool MainWindow::quickRender() const
   {
     // Is the current widget using quick render?
@@ -1652,6 +1686,38 @@ protected:
     setWindowModified( !clean );
   }
 
+  void MainWindow::limitUndoMemory()
+  {
+    qint64 limit = static_cast<qint64>(d->undoMemoryLimit) * 1024 * 1024;
+    if (d->undoLimitDeclined
+        || MoleculeDeltaCommand::memoryUsage(d->undoStack) <= limit
+        || MoleculeDeltaCommand::isRunning(d->undoStack))
+      return;
+
+    QMessageBox::StandardButton answer =
+      QMessageBox::question(this, tr("Avogadro"),
+                            tr("The undo history uses more than %1 MB.\n"
+                               "Drop the oldest undo steps?")
+                            .arg(d->undoMemoryLimit),
+                            QMessageBox::Yes | QMessageBox::No,
+                            QMessageBox::Yes);
+    if (answer != QMessageBox::Yes) {
+      d->undoLimitDeclined = true;
+      return;
+    }
+
+    // Rebuilding the stack can mark it clean, but the molecule is still
+    // modified
+    bool modified = isWindowModified();
+    int dropped = MoleculeDeltaCommand::limitMemory(d->undoStack, limit);
+    if (dropped) {
+      if (modified)
+        undoStackClean(false);
+      statusBar()->showMessage(tr("Undo memory limit reached, %n undo step(s) dropped.",
+                                  "", dropped), 5000);
+    }
+  }
+
   void MainWindow::exportGraphics()
   {
     QSettings settings;
@@ -2582,6 +2648,18 @@ protected:
     return d->glWidget->fogLevel();
   }
 
+  void MainWindow::setUndoMemoryLimit(int megabytes)
+  {
+    d->undoMemoryLimit = megabytes;
+    d->undoLimitDeclined = false;
+    limitUndoMemory();
+  }
+
+  int MainWindow::undoMemoryLimit() const
+  {
+    return d->undoMemoryLimit;
+  }
+
   void MainWindow::newView()
   {
     QWidget *widget = new QWidget();
@@ -2999,6 +3077,9 @@ protected:
 
     connect( d->undoStack, SIGNAL( cleanChanged( bool ) ),
              this, SLOT( undoStackClean( bool ) ) );
+    // Queued, since the stack cannot be cleared from within push()
+    connect( d->undoStack, SIGNAL( indexChanged( int ) ),
+             this, SLOT( limitUndoMemory() ), Qt::QueuedConnection );
 
     connect( ui.actionCut, SIGNAL( triggered() ), this, SLOT( cut() ) );
     connect( ui.actionCopy, SIGNAL( triggered() ), this, SLOT( copy() ) );
@@ -3044,6 +3125,8 @@ protected:
             this, SLOT(setRenderAxes(bool)));
     connect(ui.actionDebugInformation, SIGNAL(triggered(bool)),
             this, SLOT(setRenderDebug(bool)));
+    connect(ui.actionExportRenderProfile, SIGNAL(triggered()),
+            this, SLOT(exportRenderProfile()));
     connect(ui.actionQuickRender, SIGNAL(triggered(bool)),
             this, SLOT(setQuickRender(bool)));
     connect(ui.actionAllMolecules, SIGNAL(triggered(bool)),
@@ -3092,6 +3175,7 @@ protected:
     }
 
     d->undoStack->clear();
+    d->undoLimitDeclined = false;
 
     d->molecule = molecule;
 
@@ -3259,6 +3343,7 @@ protected:
     resize( size );
 
     d->fileDialogPath = settings.value("openDialogPath").toString();
+    d->undoMemoryLimit = settings.value("undoMemoryLimit", 256).toInt();
 
     QByteArray ba = settings.value( "state" ).toByteArray();
     if(!ba.isEmpty())
@@ -3347,6 +3432,7 @@ protected:
     settings.setValue( "state", saveState() );
 
     settings.setValue("openDialogPath", d->fileDialogPath);
+    settings.setValue("undoMemoryLimit", d->undoMemoryLimit);
     settings.setValue( "enginesDock", ui.enginesDock->saveGeometry());
 
     // save the views
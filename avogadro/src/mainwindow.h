@@ -75,6 +75,11 @@ namespace Avogadro {
 
       int painterQuality() const;
       int fogLevel() const;
+      /**
+       * @return The memory the undo stack may use for the atoms and bonds
+       * changed by each command, in megabytes.
+       */
+      int undoMemoryLimit() const;
       bool renderAxes() const;
       bool renderDebug() const;
       bool quickRender() const;
@@ -159,6 +164,11 @@ namespace Avogadro {
       void setBackgroundColor();
       void setPainterQuality(int quality);
       void setFogLevel(int level);
+      /**
+       * Set the memory the undo stack may use in megabytes. Above the limit
+       * the undo history is cleared.
+       */
+      void setUndoMemoryLimit(int megabytes);
 
       /**
        * Slot to switch glWidget to the perspective projection mode
@@ -171,10 +181,15 @@ namespace Avogadro {
 
       void setRenderAxes(bool render);
       void setRenderDebug(bool render);
+      /**
+       * Save the render times of the current view as comma separated values
+       */
+      void exportRenderProfile();
       void setQuickRender(bool quick);
       void showAllMolecules(bool show);
 
       void undoStackClean(bool clean);
+      void limitUndoMemory();
 
       void updateWindowMenu();
       void bringAllToFront();
@@ -87,11 +87,13 @@ namespace Avogadro {
   {
     m_mainWindow->setPainterQuality(ui.qualitySlider->value());
     m_mainWindow->setFogLevel(ui.fogSlider->value());
+    m_mainWindow->setUndoMemoryLimit(ui.undoMemorySpinBox->value());
   }
 
   void SettingsDialog::loadValues()
   {
     ui.qualitySlider->setValue(m_mainWindow->painterQuality());
+    ui.undoMemorySpinBox->setValue(m_mainWindow->undoMemoryLimit());
     fogChanged(m_mainWindow->fogLevel());
     qualityChanged(m_mainWindow->painterQuality());
   }
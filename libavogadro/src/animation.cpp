@@ -25,28 +25,313 @@
 #include "animation.h"
 
 #include <avogadro/molecule.h>
+#include <avogadro/moleculefile.h>
 #include <avogadro/atom.h>
 #include <avogadro/bond.h>
 #include <openbabel/mol.h>
 #include <Eigen/Core>
 
 #include <QTimeLine>
+#include <QtConcurrentRun>
+#include <QFuture>
+#include <QAtomicInt>
+#include <QHash>
+
+#include <algorithm>
+#include <utility>
+#include <cmath>
 
 using namespace OpenBabel;
 using Eigen::Vector3d;
+using Eigen::Vector3i;
 
 namespace Avogadro {
 
+  // Added to the sum of the covalent radii when finding bonds, as used by
+  // OBMol::ConnectTheDots()
+  static const double BOND_TOLERANCE = 0.45;
+  // Atoms closer than this are never bonded
+  static const double MIN_BOND_LENGTH = 0.4;
+
+  // Largest cell coordinate used when finding bonds, 21 bits each
+  static const int MAX_CELL = 0x1FFFFF;
+
+  // Key for the cell with the given coordinates
+  static inline quint64 cellKey(const Vector3i &c)
+  {
+    return (quint64(c.x()) << 42) | (quint64(c.y()) << 21) | quint64(c.z());
+  }
+
+  // Key for the bond between the atoms with the two indices
+  static inline quint64 bondKey(unsigned int a, unsigned int b)
+  {
+    return a < b ? (quint64(a) << 32) | b : (quint64(b) << 32) | a;
+  }
+
   class AnimationPrivate
   {
     public:
-      AnimationPrivate() : fps(25), framesSet(false), dynamicBonds(false) {}
+      AnimationPrivate() : fps(25), framesSet(false), dynamicBonds(false),
+                           precomputeBonds(false), trajectory(0),
+                           abort(false) {}
 
       int fps;
       bool framesSet;
       bool dynamicBonds;
+      bool precomputeBonds;
+      MoleculeFile *trajectory;
+      std::vector<Eigen::Vector3d> frame; // reused for trajectory frames
+      // positions before the trajectory was attached, indexed by atom id
+      std::vector<Eigen::Vector3d> originalPositions;
+
+      // The atoms in index order, used to find the bonds
+      std::vector<unsigned long> ids;
+      std::vector<double> radii;
+      std::vector<int> maxBonds;
+
+      // Bonds for each frame found in the background, frames are done in order
+      std::vector< std::vector<Eigen::Vector3d> *> bondSources;
+      std::vector< std::vector<quint64> > bondFrames;
+      QAtomicInt bondFramesReady;
+      volatile bool abort;
+      QFuture<void> future;
+
+      /**
+       * Cache the atoms of the molecule used to find the bonds.
+       */
+      void setAtoms(const Molecule *molecule);
+
+      /**
+       * Find the bonds between atoms using their covalent radii. Atoms with
+       * too many bonds, or bonds that are too close together, lose their
+       * longest bonds. This follows OBMol::ConnectTheDots(), but sorts the
+       * atoms into cells rather than checking every pair.
+       * @param pos The atom positions in index order.
+       * @param bonds The sorted bond keys.
+       */
+      void findBonds(const std::vector<Vector3d> &pos,
+                     std::vector<quint64> &bonds) const;
+
+      /**
+       * Find the bonds for each frame in bondSources, run in the background.
+       */
+      void findAllBonds();
+
+      /**
+       * Stop finding bonds in the background and discard those found.
+       */
+      void stopFindingBonds();
+
+      /**
+       * Add and remove bonds so that the molecule has just those given.
+       */
+      void updateBonds(Molecule *molecule, const std::vector<quint64> &bonds);
+
+      /**
+       * Save the positions of the molecule, trajectory frames are copied
+       * over them.
+       */
+      void savePositions(const Molecule *molecule);
+
+      /**
+       * Restore the positions saved by savePositions().
+       */
+      void restorePositions(Molecule *molecule);
   };
 
+  void AnimationPrivate::setAtoms(const Molecule *molecule)
+  {
+    QList<Atom *> atoms = molecule->atoms();
+    ids.resize(atoms.size());
+    radii.resize(atoms.size());
+    maxBonds.resize(atoms.size());
+    for (int i = 0; i < atoms.size(); ++i) {
+      ids[i] = atoms[i]->id();
+      radii[i] = etab.GetCovalentRad(atoms[i]->atomicNumber());
+      maxBonds[i] = etab.GetMaxBonds(atoms[i]->atomicNumber());
+    }
+  }
+
+  void AnimationPrivate::findBonds(const std::vector<Vector3d> &pos,
+                                   std::vector<quint64> &bonds) const
+  {
+    bonds.clear();
+    const unsigned int n = pos.size();
+    if (!n || n != radii.size())
+      return;
+
+    // Bin the atoms into cells no smaller than the longest possible bond
+    double maxRadius = 0.0;
+    Vector3d min = pos[0];
+    for (unsigned int i = 0; i < n; ++i) {
+      maxRadius = std::max(maxRadius, radii[i]);
+      for (int j = 0; j < 3; ++j)
+        min[j] = std::min(min[j], pos[i][j]);
+    }
+    double cellSize = 2.0 * maxRadius + BOND_TOLERANCE;
+
+    // Sort the atoms by cell rather than allocating a grid, so that an atom
+    // far from the rest does not make the grid enormous. Atoms beyond the
+    // last cell share it, which only makes that cell larger.
+    std::vector<Vector3i> cells(n);
+    std::vector< std::pair<quint64, unsigned int> > cellAtoms(n);
+    for (unsigned int i = 0; i < n; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        double c = (pos[i][j] - min[j]) / cellSize;
+        cells[i][j] = c < MAX_CELL ? static_cast<int>(c) : MAX_CELL;
+      }
+      cellAtoms[i] = std::make_pair(cellKey(cells[i]), i);
+    }
+    std::sort(cellAtoms.begin(), cellAtoms.end());
+
+    // Find the pairs of atoms within bonding distance
+    std::vector<quint64> keys;
+    std::vector<double> lengths;
+    std::vector< std::vector<unsigned int> > atomBonds(n);
+    for (unsigned int i = 0; i < n; ++i) {
+      const Vector3i &c = cells[i];
+      for (int z = std::max(0, c.z() - 1); z <= std::min(MAX_CELL, c.z() + 1); ++z)
+        for (int y = std::max(0, c.y() - 1); y <= std::min(MAX_CELL, c.y() + 1); ++y)
+          for (int x = std::max(0, c.x() - 1); x <= std::min(MAX_CELL, c.x() + 1); ++x) {
+            quint64 cell = cellKey(Vector3i(x, y, z));
+            std::vector< std::pair<quint64, unsigned int> >::const_iterator it =
+                std::lower_bound(cellAtoms.begin(), cellAtoms.end(),
+                                 std::make_pair(cell, 0u));
+            for (; it != cellAtoms.end() && it->first == cell; ++it) {
+              unsigned int j = it->second;
+              if (j <= i)
+                continue;
+              double cutoff = radii[i] + radii[j] + BOND_TOLERANCE;
+              double d2 = (pos[i] - pos[j]).squaredNorm();
+              if (d2 > cutoff * cutoff || d2 < MIN_BOND_LENGTH * MIN_BOND_LENGTH)
+                continue;
+              atomBonds[i].push_back(keys.size());
+              atomBonds[j].push_back(keys.size());
+              keys.push_back(bondKey(i, j));
+              lengths.push_back(d2);
+            }
+          }
+    }
+
+    // Remove the longest bonds from atoms with too many bonds, or with two
+    // bonds less than 45 degrees apart
+    std::vector<char> removed(keys.size(), 0);
+    const double cos45 = cos(M_PI / 4.0);
+    for (unsigned int i = 0; i < n; ++i) {
+      for (;;) {
+        std::vector<unsigned int> live;
+        foreach (unsigned int b, atomBonds[i])
+          if (!removed[b])
+            live.push_back(b);
+        bool trim = static_cast<int>(live.size()) > maxBonds[i];
+        for (unsigned int a = 0; !trim && a < live.size(); ++a) {
+          Vector3d va = pos[(keys[live[a]] >> 32) == i
+                            ? keys[live[a]] & 0xFFFFFFFF : keys[live[a]] >> 32]
+              - pos[i];
+          for (unsigned int b = a + 1; !trim && b < live.size(); ++b) {
+            Vector3d vb = pos[(keys[live[b]] >> 32) == i
+                              ? keys[live[b]] & 0xFFFFFFFF : keys[live[b]] >> 32]
+                - pos[i];
+            trim = va.dot(vb) > cos45 * va.norm() * vb.norm();
+          }
+        }
+        if (!trim || live.empty())
+          break;
+        unsigned int longest = live[0];
+        foreach (unsigned int b, live)
+          if (lengths[b] > lengths[longest])
+            longest = b;
+        removed[longest] = 1;
+      }
+    }
+
+    for (unsigned int b = 0; b < keys.size(); ++b)
+      if (!removed[b])
+        bonds.push_back(keys[b]);
+    std::sort(bonds.begin(), bonds.end());
+  }
+
+  void AnimationPrivate::findAllBonds()
+  {
+    unsigned long maxId = 0;
+    for (unsigned int i = 0; i < ids.size(); ++i)
+      maxId = std::max(maxId, ids[i]);
+
+    std::vector<Vector3d> pos(ids.size());
+    for (unsigned int f = 0; f < bondSources.size() && !abort; ++f) {
+      const std::vector<Vector3d> &conformer = *bondSources[f];
+      if (conformer.size() <= maxId)
+        return;
+      for (unsigned int i = 0; i < ids.size(); ++i)
+        pos[i] = conformer[ids[i]];
+      findBonds(pos, bondFrames[f]);
+      bondFramesReady.fetchAndAddOrdered(1);
+    }
+  }
+
+  void AnimationPrivate::stopFindingBonds()
+  {
+    abort = true;
+    future.waitForFinished();
+    abort = false;
+    bondSources.clear();
+    bondFrames.clear();
+    bondFramesReady = 0;
+  }
+
+  void AnimationPrivate::updateBonds(Molecule *molecule,
+                                     const std::vector<quint64> &bonds)
+  {
+    QHash<quint64, Bond *> current;
+    QList<Bond *> unwanted;
+    foreach (Bond *bond, molecule->bonds()) {
+      Atom *begin = bond->beginAtom();
+      Atom *end = bond->endAtom();
+      if (!begin || !end) {
+        unwanted.append(bond);
+        continue;
+      }
+      quint64 key = bondKey(begin->index(), end->index());
+      if (current.contains(key))
+        unwanted.append(bond);
+      else
+        current.insert(key, bond);
+    }
+
+    // Keep the bonds that are still there, with their bond orders
+    foreach (quint64 key, bonds) {
+      if (current.remove(key))
+        continue;
+      molecule->addBond(molecule->atom(key >> 32),
+                        molecule->atom(key & 0xFFFFFFFF), 1);
+    }
+
+    unwanted += current.values();
+    foreach (Bond *bond, unwanted)
+      molecule->removeBond(bond);
+  }
+
+  void AnimationPrivate::savePositions(const Molecule *molecule)
+  {
+    molecule->lock()->lockForRead();
+    originalPositions = molecule->atomPositions();
+    molecule->lock()->unlock();
+  }
+
+  void AnimationPrivate::restorePositions(Molecule *molecule)
+  {
+    if (originalPositions.empty())
+      return;
+
+    molecule->lock()->lockForWrite();
+    foreach(Atom *atom, molecule->atoms())
+      if (atom->id() < originalPositions.size())
+        molecule->setAtomPos(atom->id(), originalPositions[atom->id()]);
+    molecule->lock()->unlock();
+    molecule->update();
+    originalPositions.clear();
+  }
+
   Animation::Animation(QObject *parent) : QObject(parent), d(new AnimationPrivate),
                                           m_molecule(0), m_timeLine(new QTimeLine)
   {
@@ -56,6 +341,7 @@ namespace Avogadro {
 
   Animation::~Animation()
   {
+    d->stopFindingBonds();
     if (m_timeLine) {
       delete m_timeLine;
       m_timeLine = 0;
@@ -66,6 +352,15 @@ namespace Avogadro {
 
   void Animation::setMolecule(Molecule *molecule)
   {
+    d->stopFindingBonds();
+    d->ids.clear();
+    if (d->trajectory && molecule != m_molecule) {
+      // the trajectory frames are moved from the old molecule to the new one
+      if (m_molecule)
+        d->restorePositions(m_molecule);
+      if (molecule)
+        d->savePositions(molecule);
+    }
     m_molecule = molecule;
     if (molecule == NULL)
       return; // we can't save the current conformers
@@ -76,12 +371,14 @@ namespace Avogadro {
         m_originalConformers.push_back(molecule->conformer(i));
       }
     } else {
-      m_timeLine->setFrameRange( 1, m_molecule->numConformers() );
+      m_timeLine->setFrameRange( 1, numFrames() );
     }
   }
 
   int Animation::numFrames() const
   {
+    if (d->trajectory)
+      return d->trajectory->numConformers();
     if (d->framesSet)
       return m_frames.size();
     if (m_molecule)
@@ -111,35 +408,40 @@ namespace Avogadro {
 
   void Animation::setFrame(int i)
   {
-    if (i <= 0 || !m_molecule || i > (int)m_molecule->numConformers())
+    if (d->trajectory) {
+      if (i <= 0 || !m_molecule || i > numFrames())
+        return; // nothing to do
+      // decode the frame before taking the lock
+      if (!d->trajectory->conformer(i-1, d->frame)
+          || d->frame.size() != m_molecule->numAtoms())
+        return;
+    } else if (i <= 0 || !m_molecule || i > (int)m_molecule->numConformers())
       return; // nothing to do
 
     m_molecule->lock()->lockForWrite();
-    m_molecule->setConformer(i-1); // Frame counting starts from 1
+    if (d->trajectory) {
+      // trajectory frames are in atom index order
+      foreach(Atom *atom, m_molecule->atoms())
+        m_molecule->setAtomPos(atom->id(), d->frame[atom->index()]);
+    }
+    else
+      m_molecule->setConformer(i-1); // Frame counting starts from 1
 
     if (d->dynamicBonds) {
-      // construct minimal OBMol
-      OpenBabel::OBMol obmol;
-      obmol.BeginModify();
-      foreach(Atom *atom, m_molecule->atoms()) {
-        OpenBabel::OBAtom *a = obmol.NewAtom();
-        OpenBabel::OBAtom obatom = atom->OBAtom();
-        *a = obatom;
+      if (d->ids.size() != m_molecule->numAtoms())
+        d->setAtoms(m_molecule);
+      // Use the bonds found in the background if this frame is ready
+      if (!d->trajectory && i <= int(d->bondFramesReady.fetchAndAddOrdered(0))) {
+        d->updateBonds(m_molecule, d->bondFrames[i-1]);
       }
-      obmol.EndModify();
-
-      // connect the dots
-      obmol.ConnectTheDots();
-
-      QList<Bond*> bonds(m_molecule->bonds());
-      foreach(Bond *bond, bonds)
-        m_molecule->removeBond(bond->id());
-
-      FOR_BONDS_OF_MOL (obbond, obmol) {
-        Bond *bond = m_molecule->addBond();
-        bond->setBegin(m_molecule->atom(obbond->GetBeginAtomIdx()-1));
-        bond->setEnd(m_molecule->atom(obbond->GetEndAtomIdx()-1));
-        bond->setOrder(obbond->GetBondOrder());
+      else {
+        std::vector<Vector3d> pos(d->ids.size());
+        const std::vector<Vector3d> &positions = m_molecule->atomPositions();
+        for (unsigned int j = 0; j < d->ids.size(); ++j)
+          pos[j] = positions[d->ids[j]];
+        std::vector<quint64> bonds;
+        d->findBonds(pos, bonds);
+        d->updateBonds(m_molecule, bonds);
       }
     }
     m_molecule->lock()->unlock();
@@ -154,14 +456,29 @@ namespace Avogadro {
  
   void Animation::setDynamicBonds(bool enable)
   {
+    if (!enable)
+      d->stopFindingBonds();
     d->dynamicBonds = enable;
   }
 
+  bool Animation::precomputeBonds() const
+  {
+    return d->precomputeBonds;
+  }
+
+  void Animation::setPrecomputeBonds(bool enable)
+  {
+    if (!enable)
+      d->stopFindingBonds();
+    d->precomputeBonds = enable;
+  }
+
   void Animation::setFrames(std::vector< std::vector< Eigen::Vector3d> *> frames)
   {
     if (frames.size() == 0)
       return; // nothing to do
 
+    d->stopFindingBonds();
     if (!m_originalConformers.empty())
       m_originalConformers.clear();
     if (m_molecule) {
@@ -175,6 +492,20 @@ namespace Avogadro {
     m_timeLine->setFrameRange(1, numFrames() );
   }
 
+  void Animation::setTrajectory(MoleculeFile *trajectory)
+  {
+    d->stopFindingBonds();
+    if (m_molecule && trajectory != d->trajectory) {
+      if (d->trajectory)
+        d->restorePositions(m_molecule);
+      if (trajectory)
+        d->savePositions(m_molecule);
+    }
+    d->trajectory = trajectory;
+    d->frame.clear();
+    m_timeLine->setFrameRange(1, numFrames());
+  }
+
   void Animation::stop()
   {
     if(!m_molecule)
@@ -185,13 +516,24 @@ namespace Avogadro {
     disconnect(m_timeLine, SIGNAL(frameChanged(int)),
             this, SLOT(setFrame(int)));
 
+    // the frames may be deleted when the original conformers are restored
+    d->stopFindingBonds();
+
     // restore original conformers
     if (d->framesSet) {
       m_molecule->lock()->lockForWrite();
       m_molecule->setAllConformers(m_originalConformers);
       m_molecule->lock()->unlock();
     }
-    setFrame(1);
+
+    // trajectory frames were copied over the positions, so restore those
+    if (d->trajectory) {
+      d->restorePositions(m_molecule);
+      d->savePositions(m_molecule);
+      emit frameChanged(1);
+    }
+    else
+      setFrame(1);
   }
 
   void Animation::start()
@@ -207,6 +549,17 @@ namespace Avogadro {
       m_molecule->lock()->unlock();
     }
 
+    // find the bonds for all of the frames in the background, streaming
+    // trajectories are decoded on demand and so they are found in setFrame
+    d->stopFindingBonds();
+    if (d->dynamicBonds && d->precomputeBonds && !d->trajectory) {
+      d->setAtoms(m_molecule);
+      for (unsigned int i = 0; i < m_molecule->numConformers(); ++i)
+        d->bondSources.push_back(m_molecule->conformer(i));
+      d->bondFrames.resize(d->bondSources.size());
+      d->future = QtConcurrent::run(d, &AnimationPrivate::findAllBonds);
+    }
+
     if (d->fps < 1.0)
       d->fps = 1.0;
     int interval = 1000 / d->fps;
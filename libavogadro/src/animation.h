@@ -39,6 +39,7 @@ class QTimeLine;
 namespace Avogadro {
 
   class Molecule;
+  class MoleculeFile;
 
   /**
    * @class Animation animation.h <avogadro/animation.h>
@@ -87,6 +88,16 @@ namespace Avogadro {
        * be used to call setFrames() later.
        */
       void setFrames(std::vector< std::vector< Eigen::Vector3d> *> frames);
+      /**
+       * Use the conformers in @p trajectory as animation frames. The frames
+       * are decoded on demand (see MoleculeFile::readTrajectory()) and copied
+       * into the current conformer of the molecule, so seeking to any frame
+       * takes constant time and no conformers are added to the molecule. The
+       * positions of the molecule are saved and restored by stop(),
+       * setTrajectory() and setMolecule(). The trajectory is not owned by the
+       * animation, call setTrajectory(0) before deleting it.
+       */
+      void setTrajectory(MoleculeFile *trajectory);
 
       /**
        * @return The number of frames per second.
@@ -104,6 +115,11 @@ namespace Avogadro {
        * @return True if dynamic bond detection is enabled.
        */
       bool dynamicBonds() const;
+      /**
+       * @return True if the bonds for every frame are found in a background
+       * thread when the animation is started.
+       */
+      bool precomputeBonds() const;
 
     Q_SIGNALS:
       /**
@@ -127,9 +143,19 @@ namespace Avogadro {
 
       /**
        * Enable/disable dynamic bond detection. For QM reactions for example.
+       * The bonds are found using the covalent radii of the atoms, only the
+       * bonds that differ from the previous frame are added or removed.
        */
       void setDynamicBonds(bool enable);
 
+      /**
+       * Enable/disable finding the bonds for every frame in a background
+       * thread when the animation is started, used with dynamic bonds. Frames
+       * that are not ready yet, and streaming trajectories, have their bonds
+       * found when they are shown.
+       */
+      void setPrecomputeBonds(bool enable);
+
       /**
        * Start the animation (at current frame).
        */
@@ -139,7 +165,8 @@ namespace Avogadro {
        */
       void pause();
       /**
-       * Stop the animation (and return to first frame).
+       * Stop the animation (and return to first frame, or to the original
+       * positions for a trajectory).
        */
       void stop();
 
@@ -86,6 +86,7 @@ namespace Avogadro {
    void Atom::setAtomicNumber(int num)
    {
      m_atomicNumber = num;
+     m_molecule->updateAtomArrays(this);
      update(); // signal that the element has changed, to update residues
    }
 
@@ -152,6 +153,8 @@ namespace Avogadro {
    {
      Q_D(const Atom);
      d->partialCharge = charge;
+     m_molecule->setAtomArrayCharge(m_id, charge);
+     m_molecule->invalidateOBMolAtom(m_id);
    }
 
    void Atom::setFormalCharge(int charge)
@@ -159,6 +162,7 @@ namespace Avogadro {
      Q_D(Atom);
      d->assignedFormalCharge = true;
      d->formalCharge = charge;
+     m_molecule->invalidateOBMolAtom(m_id);
    }
 
    int Atom::formalCharge() const
@@ -269,18 +273,22 @@ namespace Avogadro {
    {
      Q_D(Atom);
      d->customLabel = label;
+     m_molecule->invalidateOBMolAtom(m_id);
    }
 
    void Atom::setCustomColorName(const QString &name)
    {
      Q_D(Atom);
      d->customColorName = name;
+     m_molecule->invalidateOBMolAtom(m_id);
    }
 
    void Atom::setCustomRadius(const double radius)
    {
      Q_D(Atom);
      d->customRadius = radius;
+     m_molecule->updateAtomArrays(this);
+     m_molecule->invalidateOBMolAtom(m_id);
    }
 
    QString Atom::customLabel() const
@@ -440,6 +448,9 @@ namespace Avogadro {
        }
        setProperty(property->GetAttribute().c_str(), property->GetValue().c_str());
      }
+     m_molecule->updateAtomArrays(this);
+     m_molecule->setAtomArrayCharge(m_id, d->partialCharge);
+     m_molecule->invalidateOBMolAtom(m_id);
 
      return true;
    }
@@ -460,6 +471,8 @@ namespace Avogadro {
      d->customLabel = other.customLabel();
      d->customColorName = other.customColorName();
      d->customRadius = other.customRadius();
+     m_molecule->updateAtomArrays(this);
+     m_molecule->invalidateOBMolAtom(m_id);
      return *this;
    }
 
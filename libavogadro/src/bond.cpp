@@ -59,6 +59,7 @@
     }
     m_beginAtomId = atom->id();
     atom->addBond(this);
+    m_molecule->invalidateOBMol();
   }
 
   Atom * Bond::beginAtom() const
@@ -74,6 +75,7 @@
     }
     m_endAtomId = atom->id();
     atom->addBond(this);
+    m_molecule->invalidateOBMol();
   }
 
   Atom * Bond::endAtom() const
@@ -101,6 +103,19 @@
       qDebug() << "Non-existent atom:" << atom2;
     }
     m_order = order;
+    m_molecule->invalidateOBMol();
+  }
+
+  void Bond::setOrder(short order)
+  {
+    m_order = order;
+    m_molecule->invalidateOBMol();
+  }
+
+  void Bond::setCustomLabel(const QString &label)
+  {
+    m_customLabel = label;
+    m_molecule->invalidateOBMol();
   }
 
   const Eigen::Vector3d * Bond::beginPos() const
@@ -28,7 +28,10 @@
 #include <avogadro/molecule.h>
 
 #include <vector>
+#include <algorithm>
 
+#include <QtConcurrentMap>
+#include <QVector>
 #include <QDebug>
 
 namespace Avogadro {
@@ -37,7 +40,43 @@ namespace Avogadro {
   using Eigen::Vector3f;
   using Eigen::Vector3d;
 
+  // Number of values reduced by each task in Cube::updateMinMax
+  static const unsigned int MinMaxChunkSize = 65536;
+
+  struct MinMaxChunk
+  {
+    const double *data;  // Double precision data, or 0
+    const float *dataf;  // Single precision data, or 0
+    unsigned int count;  // Number of values in the chunk
+    double min;
+    double max;
+  };
+
+  template <typename T>
+  static void rangeMinMax(const T *data, unsigned int count,
+                          double &min, double &max)
+  {
+    T tMin = data[0], tMax = data[0];
+    for (unsigned int i = 1; i < count; ++i) {
+      if (data[i] < tMin)
+        tMin = data[i];
+      else if (data[i] > tMax)
+        tMax = data[i];
+    }
+    min = tMin;
+    max = tMax;
+  }
+
+  static void chunkMinMax(MinMaxChunk &chunk)
+  {
+    if (chunk.data)
+      rangeMinMax(chunk.data, chunk.count, chunk.min, chunk.max);
+    else
+      rangeMinMax(chunk.dataf, chunk.count, chunk.min, chunk.max);
+  }
+
   Cube::Cube(QObject *parent) : Primitive(CubeType, parent), m_data(0),
+    m_singlePrecision(false),
     m_min(0.0, 0.0, 0.0), m_max(0.0, 0.0, 0.0), m_spacing(0.0, 0.0, 0.0),
     m_points(0, 0, 0), m_minValue(0.0), m_maxValue(0.0),
     m_lock(new QReadWriteLock)
@@ -61,7 +100,7 @@ namespace Avogadro {
     m_min = min;
     m_max = max;
     m_points = points;
-    m_data.resize(m_points.x() * m_points.y() * m_points.z());
+    resizeData();
     return true;
   }
 
@@ -75,7 +114,7 @@ namespace Avogadro {
     m_spacing = Vector3d(spacing, spacing, spacing);
     m_points = Vector3i(ceil(delta.x()) + 1, ceil(delta.y()) + 1,
                         ceil(delta.z()) + 1);
-    m_data.resize(m_points.x() * m_points.y() * m_points.z());
+    resizeData();
 
     // Calculate the correct max for the spacing and number of points
     m_max = Vector3d(min.x() + m_spacing.x() * (m_points.x()-1),
@@ -95,7 +134,7 @@ namespace Avogadro {
     m_max = max;
     m_points = dim;
     m_spacing = Vector3d(spacing, spacing, spacing);
-    m_data.resize(m_points.x() * m_points.y() * m_points.z());
+    resizeData();
     return true;
   }
 
@@ -136,15 +175,45 @@ namespace Avogadro {
     m_max = cube.m_max;
     m_points = cube.m_points;
     m_spacing = cube.m_spacing;
-    m_data.resize(m_points.x() * m_points.y() * m_points.z());
+    resizeData();
     return true;
   }
 
+  void Cube::resizeData()
+  {
+    unsigned int size = m_points.x() * m_points.y() * m_points.z();
+    if (m_singlePrecision)
+      m_dataf.resize(size);
+    else
+      m_data.resize(size);
+  }
+
   std::vector<double> * Cube::data()
   {
+    setSinglePrecision(false);
     return &m_data;
   }
 
+  std::vector<float> * Cube::dataf()
+  {
+    return m_singlePrecision ? &m_dataf : 0;
+  }
+
+  void Cube::setSinglePrecision(bool single)
+  {
+    if (single == m_singlePrecision)
+      return;
+    if (single) {
+      m_dataf.assign(m_data.begin(), m_data.end());
+      std::vector<double>().swap(m_data);
+    }
+    else {
+      m_data.assign(m_dataf.begin(), m_dataf.end());
+      std::vector<float>().swap(m_dataf);
+    }
+    m_singlePrecision = single;
+  }
+
   bool Cube::setData(const std::vector<double> &values)
   {
     if (!values.size()) {
@@ -152,16 +221,13 @@ namespace Avogadro {
       return false;
     }
     if (static_cast<int>(values.size()) == m_points.x() * m_points.y() * m_points.z()) {
-      m_data = values;
-      qDebug() << "Loaded in cube data" << m_data.size();
+      if (m_singlePrecision)
+        m_dataf.assign(values.begin(), values.end());
+      else
+        m_data = values;
+      qDebug() << "Loaded in cube data" << values.size();
       // Now to update the minimum and maximum values
-      m_minValue = m_maxValue = m_data[0];
-      foreach(double val, m_data) {
-        if (val < m_minValue)
-          m_minValue = val;
-        else if (val > m_maxValue)
-          m_maxValue = val;
-      }
+      updateMinMax();
       return true;
     }
     else {
@@ -175,23 +241,70 @@ namespace Avogadro {
   bool Cube::addData(const std::vector<double> &values)
   {
     // Initialise the cube to zero if necessary
-    if (!m_data.size()) {
-      m_data.resize(m_points.x() * m_points.y() * m_points.z());
+    if (!dataSize()) {
+      resizeData();
     }
-    if (values.size() != m_data.size() || !values.size()) {
+    if (values.size() != dataSize() || !values.size()) {
       qDebug() << "Attempted to add values to cube - sizes do not match...";
       return false;
     }
-    for (unsigned int i = 0; i < m_data.size(); i++) {
-      m_data[i] += values[i];
-      if (m_data[i] < m_minValue)
-        m_minValue = m_data[i];
-      else if (m_data[i] > m_maxValue)
-        m_maxValue = m_data[i];
+    if (m_singlePrecision) {
+      for (unsigned int i = 0; i < m_dataf.size(); i++)
+        m_dataf[i] += static_cast<float>(values[i]);
     }
+    else {
+      for (unsigned int i = 0; i < m_data.size(); i++)
+        m_data[i] += values[i];
+    }
+    updateMinMax();
     return true;
   }
 
+  bool Cube::setValues(unsigned int start, unsigned int count,
+                       const double *values)
+  {
+    if (start + count > dataSize())
+      return false;
+    if (m_singlePrecision) {
+      for (unsigned int i = 0; i < count; ++i)
+        m_dataf[start + i] = static_cast<float>(values[i]);
+    }
+    else {
+      std::copy(values, values + count, m_data.begin() + start);
+    }
+    return true;
+  }
+
+  void Cube::updateMinMax()
+  {
+    unsigned int size = dataSize();
+    if (!size) {
+      m_minValue = m_maxValue = 0.0;
+      return;
+    }
+
+    QVector<MinMaxChunk> chunks((size + MinMaxChunkSize - 1) / MinMaxChunkSize);
+    for (int i = 0; i < chunks.size(); ++i) {
+      unsigned int start = i * MinMaxChunkSize;
+      chunks[i].data = m_singlePrecision ? 0 : &m_data[start];
+      chunks[i].dataf = m_singlePrecision ? &m_dataf[start] : 0;
+      chunks[i].count = qMin(MinMaxChunkSize, size - start);
+    }
+    if (chunks.size() > 1)
+      QtConcurrent::blockingMap(chunks, chunkMinMax);
+    else
+      chunkMinMax(chunks[0]);
+
+    m_minValue = chunks[0].min;
+    m_maxValue = chunks[0].max;
+    foreach (const MinMaxChunk &chunk, chunks) {
+      if (chunk.min < m_minValue)
+        m_minValue = chunk.min;
+      if (chunk.max > m_maxValue)
+        m_maxValue = chunk.max;
+    }
+  }
+
   unsigned int Cube::closestIndex(const Vector3d &pos) const
   {
     int i, j, k;
@@ -226,8 +339,8 @@ namespace Avogadro {
   double Cube::value(int i, int j, int k) const
   {
     unsigned int index = i*m_points.y()*m_points.z() + j*m_points.z() + k;
-    if (index < m_data.size())
-      return m_data.at(index);
+    if (index < dataSize())
+      return m_singlePrecision ? m_dataf[index] : m_data[index];
     else {
 //      qDebug() << "Attempt to identify out of range index" << index << m_data.size();
       return 0.0;
@@ -239,8 +352,8 @@ namespace Avogadro {
     unsigned int index = pos.x()*m_points.y()*m_points.z() +
                          pos.y()*m_points.z() +
                          pos.z();
-    if (index < m_data.size())
-      return m_data.at(index);
+    if (index < dataSize())
+      return m_singlePrecision ? m_dataf[index] : m_data[index];
     else {
       qDebug() << "Attempted to access an index out of range.";
       return 6969.0;
@@ -308,8 +421,11 @@ namespace Avogadro {
   bool Cube::setValue(int i, int j, int k, double value)
   {
     unsigned int index = i*m_points.y()*m_points.z() + j*m_points.z() + k;
-    if (index < m_data.size()) {
-      m_data[index] = value;
+    if (index < dataSize()) {
+      if (m_singlePrecision)
+        m_dataf[index] = static_cast<float>(value);
+      else
+        m_data[index] = value;
       return true;
     }
     else
@@ -131,10 +131,30 @@ namespace Avogadro {
     bool setLimits(const Molecule *mol, double spacing, double padding);
 
     /**
-     * @return Vector containing all the data in a one-dimensional array.
+     * @return Vector containing all the data in a one-dimensional array. A
+     * single precision cube is converted to double precision first.
+     * @sa dataf()
      */
     std::vector<double> * data();
 
+    /**
+     * @return Vector containing all the data in a one-dimensional array, or 0
+     * if the cube stores double precision values.
+     * @sa data()
+     */
+    std::vector<float> * dataf();
+
+    /**
+     * Store the values in single rather than double precision, halving the
+     * memory used by large cubes. Any existing values are converted.
+     */
+    void setSinglePrecision(bool single);
+
+    /**
+     * @return True if the values are stored in single precision.
+     */
+    bool isSinglePrecision() const { return m_singlePrecision; }
+
     /**
      * Set the values in the cube to those passed in the vector.
      */
@@ -205,11 +225,29 @@ namespace Avogadro {
     bool setValue(int i, int j, int k, double value);
 
     /**
-     * Sets the value at the specified index in the cube.
+     * Sets the value at the specified index in the cube. This does not
+     * update the minimum and maximum values, call updateMinMax() once all
+     * of the values have been written.
      * @param i 1-dimenional index of the point to set in the cube.
      */
     bool setValue(unsigned int i, double value);
 
+    /**
+     * Sets @p count consecutive values starting at index @p start. Unlike
+     * setValue this does not update the minimum and maximum values, so it
+     * may be called concurrently for ranges that do not overlap. Call
+     * updateMinMax() once all of the values have been written.
+     * @return False if the range does not lie within the cube.
+     */
+    bool setValues(unsigned int start, unsigned int count,
+                   const double *values);
+
+    /**
+     * Recalculate the minimum and maximum values from the cube data. The data
+     * is split into chunks that are reduced in parallel.
+     */
+    void updateMinMax();
+
     /**
      * @return The minimum  value at any point in the Cube.
      */
@@ -234,7 +272,22 @@ namespace Avogadro {
     friend class Molecule;
 
   protected:
+    /**
+     * Resize the active data storage to the dimensions of the cube.
+     */
+    void resizeData();
+
+    /**
+     * @return The number of values stored in the cube.
+     */
+    unsigned int dataSize() const
+    {
+      return m_singlePrecision ? m_dataf.size() : m_data.size();
+    }
+
     std::vector<double> m_data;
+    std::vector<float> m_dataf;
+    bool m_singlePrecision;
     Eigen::Vector3d m_min, m_max, m_spacing;
     Eigen::Vector3i m_points;
     double m_minValue, m_maxValue;
@@ -246,10 +299,11 @@ namespace Avogadro {
 
   inline bool Cube::setValue(unsigned int i, double value)
   {
-    if (i < m_data.size()) {
-      m_data[i] = value;
-      if (value > m_maxValue) m_maxValue = value;
-      if (value < m_minValue) m_minValue = value;
+    if (i < dataSize()) {
+      if (m_singlePrecision)
+        m_dataf[i] = static_cast<float>(value);
+      else
+        m_data[i] = value;
       return true;
     }
     else
@@ -157,6 +157,36 @@ namespace Avogadro {
     d->isValid = true;
   }
 
+  void Cylinder::triangles( std::vector<Vector3f> &vertices,
+      std::vector<Vector3f> &normals, std::vector<unsigned int> &indices ) const
+  {
+    vertices.clear();
+    normals.clear();
+    indices.clear();
+    int faces = d->faces < 3 ? 3 : d->faces;
+    float baseAngle = 2 * M_PI / faces;
+    for( int i = 0; i <= faces; i++ )
+    {
+      float angle = baseAngle * i;
+      Vector3f v( cosf(angle), sinf(angle), 0.0f );
+      normals.push_back( v );
+      normals.push_back( v );
+      vertices.push_back( Vector3f( v.x(), v.y(), 1.0f ) );
+      vertices.push_back( v );
+    }
+    // the quads of the quad strip, each split into two triangles
+    for( int i = 0; i < faces; i++ )
+    {
+      unsigned int q[4] = { 2 * i, 2 * i + 1, 2 * i + 3, 2 * i + 2 };
+      indices.push_back( q[0] );
+      indices.push_back( q[1] );
+      indices.push_back( q[2] );
+      indices.push_back( q[0] );
+      indices.push_back( q[2] );
+      indices.push_back( q[3] );
+    }
+  }
+
   void Cylinder::draw( const Eigen::Vector3d &end1, const Eigen::Vector3d &end2,
       double radius ) const
   {
@@ -31,6 +31,8 @@
 
 #include <Eigen/Core>
 
+#include <vector>
+
 namespace Avogadro {
 
   /**
@@ -93,6 +95,17 @@ namespace Avogadro {
           double radius, int order, double shift,
           const Eigen::Vector3d &planeNormalVector ) const;
 
+      /**
+       * gets the lateral faces of the cylinder of radius 1 from z=0
+       * to z=1 as a list of triangles, used to draw many cylinders at once.
+       @param vertices the vertices of the cylinder
+       @param normals the normal at each vertex
+       @param indices three indices into vertices for each triangle
+       */
+      void triangles( std::vector<Eigen::Vector3f> &vertices,
+          std::vector<Eigen::Vector3f> &normals,
+          std::vector<unsigned int> &indices ) const;
+
     private:
       CylinderPrivate * const d;
   };
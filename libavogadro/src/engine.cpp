@@ -39,7 +39,13 @@ namespace Avogadro {
   class EnginePrivate
   {
   public:
-    EnginePrivate() {}
+    EnginePrivate() : trackMoves(false), positionsChanged(false),
+      invalid(true), movedFirst(0), movedEnd(0) {}
+
+    bool trackMoves;       // trackMovedAtoms() was called
+    bool positionsChanged; // geometryChanged() received, updated() follows
+    bool invalid;          // something other than positions changed
+    int movedFirst, movedEnd;
   };
 
   Engine::Engine(QObject *parent) : Plugin(parent), d(new EnginePrivate),
@@ -83,6 +89,13 @@ namespace Avogadro {
     return 0.0;
   }
 
+  double Engine::pickRadius(const PainterDevice *pd, const Primitive *primitive) const
+  {
+    if (m_primitives.contains(primitive))
+      return radius(pd, primitive);
+    return 0.0;
+  }
+
   void Engine::clearPrimitives()
   {
     // Set custom primitives to false and clear the lists of primitives
@@ -309,6 +322,7 @@ namespace Avogadro {
 
   void Engine::setMolecule(const Molecule *mol)
   {
+    const Molecule *previous = m_molecule;
     if (m_customPrims) {
       m_primitives.clear();
       m_atoms.clear();
@@ -318,12 +332,15 @@ namespace Avogadro {
         disconnect(m_molecule, 0, this, 0);
     }
     m_molecule = mol;
+    if (d->trackMoves)
+      connectMovedAtoms(previous);
   }
 
   void Engine::setMolecule(Molecule *molecule)
   {
     // this was causing an infinite loop before
     //    setMolecule(molecule);
+    const Molecule *previous = m_molecule;
     if (m_customPrims) {
       m_primitives.clear();
       m_atoms.clear();
@@ -333,6 +350,84 @@ namespace Avogadro {
         disconnect(m_molecule, 0, this, 0);
     }
     m_molecule = molecule;
+    if (d->trackMoves)
+      connectMovedAtoms(previous);
+  }
+
+  void Engine::trackMovedAtoms()
+  {
+    if (d->trackMoves)
+      return;
+    d->trackMoves = true;
+    // Settings and color maps emit changed()
+    connect(this, SIGNAL(changed()), this, SLOT(invalidateMovedAtoms()));
+    connectMovedAtoms(m_molecule);
+  }
+
+  void Engine::connectMovedAtoms(const Molecule *previous)
+  {
+    if (previous) {
+      disconnect(previous, 0, this, SLOT(moveAtoms(int,int)));
+      disconnect(previous, 0, this, SLOT(moleculeUpdated()));
+      disconnect(previous, 0, this, SLOT(invalidateMovedAtoms()));
+    }
+    invalidateMovedAtoms();
+    if (!m_molecule)
+      return;
+
+    connect(m_molecule, SIGNAL(geometryChanged(int,int)),
+            this, SLOT(moveAtoms(int,int)));
+    connect(m_molecule, SIGNAL(updated()), this, SLOT(moleculeUpdated()));
+    connect(m_molecule, SIGNAL(atomAdded(Atom*)),
+            this, SLOT(invalidateMovedAtoms()));
+    connect(m_molecule, SIGNAL(atomUpdated(Atom*)),
+            this, SLOT(invalidateMovedAtoms()));
+    connect(m_molecule, SIGNAL(atomRemoved(Atom*)),
+            this, SLOT(invalidateMovedAtoms()));
+    connect(m_molecule, SIGNAL(bondAdded(Bond*)),
+            this, SLOT(invalidateMovedAtoms()));
+    connect(m_molecule, SIGNAL(bondUpdated(Bond*)),
+            this, SLOT(invalidateMovedAtoms()));
+    connect(m_molecule, SIGNAL(bondRemoved(Bond*)),
+            this, SLOT(invalidateMovedAtoms()));
+  }
+
+  bool Engine::takeMovedAtoms(int &first, int &count)
+  {
+    bool moved = !d->invalid && !m_customPrims && d->movedFirst < d->movedEnd;
+    first = d->movedFirst;
+    count = d->movedEnd - d->movedFirst;
+    d->invalid = false;
+    d->movedFirst = d->movedEnd = 0;
+    return moved;
+  }
+
+  void Engine::moveAtoms(int first, int count)
+  {
+    if (d->movedFirst < d->movedEnd) {
+      d->movedFirst = qMin(d->movedFirst, first);
+      d->movedEnd = qMax(d->movedEnd, first + count);
+    }
+    else {
+      d->movedFirst = first;
+      d->movedEnd = first + count;
+    }
+    d->positionsChanged = true;
+  }
+
+  void Engine::moleculeUpdated()
+  {
+    // The updated() following geometryChanged() changes nothing else
+    if (d->positionsChanged)
+      d->positionsChanged = false;
+    else
+      d->invalid = true;
+  }
+
+  void Engine::invalidateMovedAtoms()
+  {
+    d->invalid = true;
+    d->positionsChanged = false;
   }
 
   void Engine::useCustomPrimitives()
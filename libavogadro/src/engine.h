@@ -361,6 +361,17 @@ namespace Avogadro {
        */
       virtual double radius(const PainterDevice *pd, const Primitive *primitive = 0) const;
 
+      /** Get the radius of the primitive for picking. GLWidget::hits() finds
+       * the atoms and bonds under the mouse from these radii rather than by
+       * rendering, so an engine should return the size it draws the primitive
+       * at in renderPick(), or 0 if it cannot be picked.
+       * The default is radius() for the primitives of the engine.
+       * @param pd is the PainterDevice used by the engine.
+       * @param primitive is the Primitive to get the radius of.
+       * @return the radius of the Primitive for picking.
+       */
+      virtual double pickRadius(const PainterDevice *pd, const Primitive *primitive) const;
+
       /**
        * @return true if the engine is enabled or false if it is not.
        */
@@ -504,6 +515,33 @@ namespace Avogadro {
       QString m_description;
 
       virtual void useCustomPrimitives();
+
+      /**
+       * Keep track of the atoms moved through Molecule::geometryChanged(),
+       * see takeMovedAtoms(). Engines which keep their geometry between
+       * frames call this in their constructor.
+       */
+      void trackMovedAtoms();
+
+      /**
+       * Take the range of atoms moved since the last call. It is only
+       * returned if nothing else changed since then: the Molecule emitted
+       * geometryChanged() but no other change, the Engine did not emit
+       * changed() and does not use custom primitives.
+       * @param first Set to the index of the first Atom that moved.
+       * @param count Set to the number of atoms that moved.
+       * @return True if only the atoms in the range moved, false if the
+       * engine has to update everything.
+       */
+      bool takeMovedAtoms(int &first, int &count);
+
+    private Q_SLOTS:
+      void moveAtoms(int first, int count);
+      void moleculeUpdated();
+      void invalidateMovedAtoms();
+
+    private:
+      void connectMovedAtoms(const Molecule *previous);
   };
 
 } // end namespace Avogadro
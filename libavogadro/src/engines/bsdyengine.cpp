@@ -104,8 +104,11 @@ namespace Avogadro
   BSDYEngine::BSDYEngine(QObject *parent) : Engine(parent),
       m_settingsWidget(0), m_atomRadiusPercentage(0.3), m_atomRadiusScale(50.0),
       m_bondRadius(0.1), m_bondRadiusScale(40.0),
-      m_atomRadiusType(1), m_showMulti(2), m_alpha(1.), pRadius(radiusVdW)
-  {  }
+      m_atomRadiusType(1), m_showMulti(2), m_alpha(1.), pRadius(radiusVdW),
+      m_atomBatch(InstanceBatch::Spheres), m_bondBatch(InstanceBatch::Cylinders)
+  {
+    trackMovedAtoms();
+  }
 
   Engine *BSDYEngine::clone() const
   {
@@ -139,13 +142,27 @@ namespace Avogadro
     Color *map = colorMap(); // possible custom color map
     if (!map) map = pd->colorMap(); // fall back to global color map
 
-    // Render the bonds
-    foreach(const Bond *b, bonds()) {
+    // If only atoms moved since the last frame, only move their instances
+    int first, count;
+    bool moved = takeMovedAtoms(first, count)
+      && moveInstances(pd->molecule(), first, count);
+
+    // Render the bonds, each as two halves in one batch
+    Color custom;
+    QList<Bond *> bondList = moved ? QList<Bond *>() : bonds();
+    if (!moved)
+      m_bondBatch.resize(2 * bondList.size());
+    int i = 0;
+    foreach(const Bond *b, bondList) {
       Atom* atom1 = pd->molecule()->atomById(b->beginAtomId());
       Atom* atom2 = pd->molecule()->atomById(b->endAtomId());
       if (!atom1 || !atom2) {
         qDebug() << "Invalid bond atom IDs" << b->beginAtomId() << atom1
                  << b->endAtomId() << atom2 << "Bond" << b->id();
+        m_bondBatch.setCylinder(i++, Vector3d::Zero(), Vector3d::Zero(), 0.0,
+                                map);
+        m_bondBatch.setCylinder(i++, Vector3d::Zero(), Vector3d::Zero(), 0.0,
+                                map);
         continue;
       }
 
@@ -161,31 +178,42 @@ namespace Avogadro
 
       map->setFromPrimitive(atom1);
       if (atom1->customColorName().isEmpty())
-        pd->painter()->setColor( map );
-      else
-        pd->painter()->setColor(atom1->customColorName());
-      pd->painter()->drawMultiCylinder( v1, v3, m_bondRadius, order, shift );
+        m_bondBatch.setCylinder(i++, v1, v3, m_bondRadius, map, order, shift);
+      else {
+        custom.setFromQColor(QColor(atom1->customColorName()));
+        m_bondBatch.setCylinder(i++, v1, v3, m_bondRadius, &custom, order,
+                                shift);
+      }
 
       map->setFromPrimitive(atom2);
       if (atom2->customColorName().isEmpty())
-        pd->painter()->setColor( map );
-      else
-        pd->painter()->setColor(atom2->customColorName());
-      pd->painter()->drawMultiCylinder( v3, v2, m_bondRadius, order, shift );
+        m_bondBatch.setCylinder(i++, v3, v2, m_bondRadius, map, order, shift);
+      else {
+        custom.setFromQColor(QColor(atom2->customColorName()));
+        m_bondBatch.setCylinder(i++, v3, v2, m_bondRadius, &custom, order,
+                                shift);
+      }
     }
+    pd->painter()->drawBatch(&m_bondBatch);
 
     glDisable( GL_NORMALIZE );
     glEnable( GL_RESCALE_NORMAL );
 
     // Render the atoms
-    foreach(const Atom *a, atoms()) {
+    QList<Atom *> atomList = moved ? QList<Atom *>() : atoms();
+    if (!moved)
+      m_atomBatch.resize(atomList.size());
+    i = 0;
+    foreach(const Atom *a, atomList) {
       map->setFromPrimitive(a);
       if (a->customColorName().isEmpty())
-        pd->painter()->setColor( map );
-      else
-        pd->painter()->setColor(a->customColorName());
-      pd->painter()->drawSphere(a->pos(), radius(a));
+        m_atomBatch.setSphere(i++, *a->pos(), radius(a), map);
+      else {
+        custom.setFromQColor(QColor(a->customColorName()));
+        m_atomBatch.setSphere(i++, *a->pos(), radius(a), &custom);
+      }
     }
+    pd->painter()->drawBatch(&m_atomBatch);
 
     // normalize normal vectors of bonds
     glDisable( GL_RESCALE_NORMAL );
@@ -383,6 +411,50 @@ namespace Avogadro
     return m_atomRadiusPercentage;
   }
 
+  bool BSDYEngine::moveInstances(const Molecule *molecule, int first,
+                                 int count)
+  {
+    // The batches hold every atom and bond, in index order
+    QList<Atom *> atomList = molecule->atoms();
+    QList<Bond *> bondList = molecule->bonds();
+    if (m_atomBatch.size() != atomList.size()
+        || m_bondBatch.size() != 2 * bondList.size()
+        || first + count > atomList.size())
+      return false;
+
+    for (int i = first; i < first + count; ++i)
+      m_atomBatch.setEnds(i, *atomList[i]->pos(), *atomList[i]->pos());
+
+    if (count == atomList.size()) {
+      foreach(const Bond *b, bondList)
+        moveBond(molecule, b);
+    }
+    else {
+      for (int i = first; i < first + count; ++i)
+        foreach(unsigned long id, atomList[i]->bonds())
+          moveBond(molecule, molecule->bondById(id));
+    }
+    return true;
+  }
+
+  void BSDYEngine::moveBond(const Molecule *molecule, const Bond *b)
+  {
+    if (!b)
+      return;
+    Atom* atom1 = molecule->atomById(b->beginAtomId());
+    Atom* atom2 = molecule->atomById(b->endAtomId());
+    if (!atom1 || !atom2)
+      return;
+
+    Vector3d v1(*atom1->pos());
+    Vector3d v2(*atom2->pos());
+    Vector3d d = v2 - v1;
+    d.normalize();
+    Vector3d v3((v1 + v2 + d*(radius(atom1) - radius(atom2))) / 2);
+    m_bondBatch.setEnds(2 * b->index(), v1, v3);
+    m_bondBatch.setEnds(2 * b->index() + 1, v3, v2);
+  }
+
   void BSDYEngine::setAtomRadiusPercentage(int value)
   {
     m_atomRadiusPercentage = value / m_atomRadiusScale;
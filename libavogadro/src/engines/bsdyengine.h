@@ -27,6 +27,7 @@
 
 #include <avogadro/global.h>
 #include <avogadro/engine.h>
+#include <avogadro/instancebatch.h>
 
 #include "ui_bsdysettingswidget.h"
 
@@ -81,6 +82,13 @@ namespace Avogadro {
     private:
       double radius(const Atom *atom) const;
 
+      /**
+       * Move the instances of a range of atoms and of their bonds.
+       * @return False if the batches do not hold the whole molecule.
+       */
+      bool moveInstances(const Molecule *molecule, int first, int count);
+      void moveBond(const Molecule *molecule, const Bond *bond);
+
       BSDYSettingsWidget *m_settingsWidget;
 
       double m_atomRadiusPercentage;
@@ -97,6 +105,9 @@ namespace Avogadro {
        */
       double (*pRadius)(const Atom *atom);
 
+      InstanceBatch m_atomBatch; // opaque balls, kept between frames
+      InstanceBatch m_bondBatch; // opaque sticks, kept between frames
+
    private Q_SLOTS:
       void settingsWidgetDestroyed();
 
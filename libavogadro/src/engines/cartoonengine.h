@@ -63,6 +63,8 @@ namespace Avogadro {
       ColorTypes colorTypes() const;
 
       double radius(const PainterDevice *pd, const Primitive *p = 0) const;
+      //! The atoms are not drawn, so they cannot be picked
+      double pickRadius(const PainterDevice *, const Primitive *) const { return 0.0; }
 
       void setPrimitives(const PrimitiveList &primitives);
       
@@ -47,7 +47,9 @@ using namespace Eigen;
 namespace Avogadro {
 
   HBondEngine::HBondEngine(QObject *parent) : Engine(parent), m_settingsWidget(0),
-                                              m_width(2), m_radius(2.0), m_angle(120)
+                                              m_width(2), m_radius(2.0), m_angle(120),
+                                              m_dirty(true), m_cachedMolecule(0),
+                                              m_nbrList(0)
   {
   }
 
@@ -65,11 +67,7 @@ namespace Avogadro {
 
   HBondEngine::~HBondEngine()
   {
-  }
-
-  unsigned long createUniqueHbondId(Atom *donorH, Atom *acceptor)
-  {
-    return acceptor->index() * static_cast<Molecule*>(acceptor->parent())->numAtoms() + donorH->index();
+    delete m_nbrList;
   }
 
   bool HBondEngine::renderOpaque(PainterDevice *pd)
@@ -78,64 +76,174 @@ namespace Avogadro {
     if (!molecule->numAtoms())
       return false;
 
+    updateHbonds(molecule);
+
     pd->painter()->setColor(1.0, 1.0, 0.3);
     int stipple = 0xF0F0; // pattern for lines
 
-    QList<unsigned long> rendered;
-
-    NeighborList *nbrList = new NeighborList(molecule, m_radius);
-    //for (unsigned int i = 0; i < molecule->numAtoms(); ++i) {
-    foreach(Atom *atom, atoms()) {
-      bool atomIsH = atom->isHydrogen() ? true : false;
-
-      if (!atomIsH && !isHbondAcceptor(atom))
-          continue;
-
-      // get ALL possible pairs for atom (uniqueOnly = false)
-      QList<Atom*> nbrs = nbrList->nbrs(atom, false);
-      foreach(Atom *nbr, nbrs) {
-        double angle = 180.0;
-        Atom *hydrogen, *acceptor, *donor = 0;
-
-        if (atomIsH) {
-          if (!isHbondDonorH(atom) || !isHbondAcceptor(nbr))
-            continue;
-
-          hydrogen = atom;
-          acceptor = nbr;
-          foreach (unsigned long id, atom->neighbors())
-            donor = static_cast<Molecule*>(atom->parent())->atomById(id);
-        } else {
-           if (!isHbondDonorH(nbr) || !isHbondAcceptor(atom))
-            continue;
-
-          hydrogen = nbr;
-          acceptor = atom;
-          foreach (unsigned long id, nbr->neighbors())
-            donor = static_cast<Molecule*>(atom->parent())->atomById(id);
-        }
-
-        if (donor) {
-          Eigen::Vector3d ab = *donor->pos() - *hydrogen->pos();
-          Eigen::Vector3d bc = *acceptor->pos() - *hydrogen->pos();
-          angle = 180. * acos( ab.dot(bc) / (ab.norm() * bc.norm()) ) / M_PI;
-        }
-
-        if (angle < m_angle)
-          continue;
-
-        unsigned long HbondId = createUniqueHbondId(hydrogen, acceptor);
-        if (rendered.contains(HbondId))
-          continue;
-        rendered.append(HbondId);
-
-        pd->painter()->drawMultiLine(*atom->pos(), *nbr->pos(), m_width, 1, stipple);
-      } // for each nbr
-    } // for each atom
+    for (int i = 0; i < m_hbonds.size(); ++i)
+      pd->painter()->drawMultiLine(*m_hbonds[i].first->pos(),
+                                   *m_hbonds[i].second->pos(),
+                                   m_width, 1, stipple);
 
     return true;
   }
 
+  void HBondEngine::updateHbonds(Molecule *molecule)
+  {
+    const std::vector<Vector3d> &positions = molecule->atomPositions();
+    QList<Atom *> engineAtoms = atoms();
+
+    // Anything other than atoms moving means starting again
+    if (m_dirty || molecule != m_cachedMolecule || engineAtoms != m_atoms
+        || positions.size() != m_positions.size()
+        || molecule->atomicNumbers() != m_atomicNumbers) {
+      rebuildHbonds(molecule);
+      return;
+    }
+
+    QList<Atom *> moved;
+    for (unsigned int i = 0; i < positions.size(); ++i) {
+      if (positions[i] != m_positions[i]) {
+        Atom *atom = molecule->atomById(i);
+        if (atom)
+          moved.append(atom);
+      }
+    }
+    if (moved.isEmpty())
+      return;
+
+    // When most of the atoms moved it is quicker to start again
+    if (moved.size() > static_cast<int>(molecule->numAtoms()) / 4) {
+      rebuildHbonds(molecule);
+      return;
+    }
+
+    m_positions = positions;
+    m_nbrList->update(moved);
+    updateMovedHbonds(moved);
+  }
+
+  void HBondEngine::rebuildHbonds(Molecule *molecule)
+  {
+    const std::vector<Vector3d> &positions = molecule->atomPositions();
+    m_cachedMolecule = molecule;
+    m_atoms = atoms();
+    m_positions = positions;
+    m_atomicNumbers = molecule->atomicNumbers();
+
+    delete m_nbrList;
+    m_nbrList = new NeighborList(molecule, m_radius);
+
+    // Find the donors and acceptors once, they only change with the bonding
+    m_acceptor.assign(positions.size(), 0);
+    m_rendered.assign(positions.size(), 0);
+    m_donor.assign(positions.size(), 0);
+    m_donorHs.clear();
+    foreach (Atom *atom, molecule->atoms()) {
+      m_acceptor[atom->id()] = isHbondAcceptor(atom);
+      if (isHbondDonorH(atom)) {
+        m_donorHs.append(atom);
+        foreach (unsigned long id, atom->neighbors())
+          m_donor[atom->id()] = molecule->atomById(id);
+      }
+    }
+    foreach (Atom *atom, m_atoms)
+      m_rendered[atom->id()] = 1;
+
+    // Every hydrogen bond has a donor hydrogen, get ALL possible pairs for it
+    // (uniqueOnly = false) and keep those with at least one rendered atom
+    m_hbonds.clear();
+    foreach (Atom *hydrogen, m_donorHs) {
+      foreach (Atom *nbr, m_nbrList->nbrs(hydrogen, false)) {
+        if (m_acceptor[nbr->id()]
+            && (m_rendered[hydrogen->id()] || m_rendered[nbr->id()])
+            && isHbond(hydrogen, nbr))
+          m_hbonds.append(qMakePair(hydrogen, nbr));
+      }
+    }
+
+    m_dirty = false;
+  }
+
+  void HBondEngine::updateMovedHbonds(const QList<Atom *> &moved)
+  {
+    // The atoms that moved, and the hydrogens whose donor moved as the angle
+    // has changed
+    std::vector<char> affected(m_positions.size(), 0);
+    foreach (Atom *atom, moved)
+      affected[atom->id()] = 1;
+    foreach (Atom *hydrogen, m_donorHs)
+      if (affected[m_donor[hydrogen->id()]->id()])
+        affected[hydrogen->id()] = 1;
+
+    // Drop the hydrogen bonds that could have changed
+    QList<QPair<Atom *, Atom *> > hbonds;
+    for (int i = 0; i < m_hbonds.size(); ++i)
+      if (!affected[m_hbonds[i].first->id()]
+          && !affected[m_hbonds[i].second->id()])
+        hbonds.append(m_hbonds[i]);
+    m_hbonds = hbonds;
+
+    // Find them again, pairs where both atoms were affected are only found
+    // from the hydrogen
+    foreach (Atom *hydrogen, m_donorHs) {
+      if (!affected[hydrogen->id()])
+        continue;
+      foreach (Atom *nbr, m_nbrList->nbrs(hydrogen, false)) {
+        if (m_acceptor[nbr->id()]
+            && (m_rendered[hydrogen->id()] || m_rendered[nbr->id()])
+            && isHbond(hydrogen, nbr))
+          m_hbonds.append(qMakePair(hydrogen, nbr));
+      }
+    }
+    foreach (Atom *acceptor, moved) {
+      if (!m_acceptor[acceptor->id()])
+        continue;
+      foreach (Atom *nbr, m_nbrList->nbrs(acceptor, false)) {
+        if (m_donor[nbr->id()] && !affected[nbr->id()]
+            && (m_rendered[nbr->id()] || m_rendered[acceptor->id()])
+            && isHbond(nbr, acceptor))
+          m_hbonds.append(qMakePair(nbr, acceptor));
+      }
+    }
+  }
+
+  bool HBondEngine::isHbond(Atom *hydrogen, Atom *acceptor) const
+  {
+    double angle = 180.0;
+    Atom *donor = m_donor[hydrogen->id()];
+    if (donor) {
+      Eigen::Vector3d ab = *donor->pos() - *hydrogen->pos();
+      Eigen::Vector3d bc = *acceptor->pos() - *hydrogen->pos();
+      angle = 180. * acos( ab.dot(bc) / (ab.norm() * bc.norm()) ) / M_PI;
+    }
+    return angle >= m_angle;
+  }
+
+  void HBondEngine::invalidate()
+  {
+    m_dirty = true;
+  }
+
+  void HBondEngine::setMolecule(const Molecule *molecule)
+  {
+    Engine::setMolecule(molecule);
+    m_dirty = true;
+    if (m_molecule) {
+      connect(m_molecule, SIGNAL(moleculeChanged()), this, SLOT(invalidate()));
+      connect(m_molecule, SIGNAL(atomAdded(Atom*)), this, SLOT(invalidate()));
+      connect(m_molecule, SIGNAL(atomRemoved(Atom*)), this, SLOT(invalidate()));
+      connect(m_molecule, SIGNAL(bondAdded(Bond*)), this, SLOT(invalidate()));
+      connect(m_molecule, SIGNAL(bondRemoved(Bond*)), this, SLOT(invalidate()));
+    }
+  }
+
+  void HBondEngine::setMolecule(Molecule *molecule)
+  {
+    setMolecule(const_cast<const Molecule *>(molecule));
+  }
+
   double HBondEngine::radius(const PainterDevice *, const Primitive *) const
   {
     return 0.0;
@@ -166,12 +274,14 @@ namespace Avogadro {
   void HBondEngine::setRadius(double value)
   {
     m_radius = value;
+    m_dirty = true;
     emit changed();
   }
 
   void HBondEngine::setAngle(double value)
   {
     m_angle = value;
+    m_dirty = true;
     emit changed();
   }
 
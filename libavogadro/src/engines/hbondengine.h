@@ -29,12 +29,23 @@
 #include <avogadro/global.h>
 #include <avogadro/engine.h>
 
+#include <Eigen/Core>
+
+#include <QPair>
+
+#include <vector>
 
 #include "ui_hbondsettingswidget.h"
 
 namespace Avogadro {
 
   //! HBond Engine class.
+  /**
+   * The hydrogen bonds are cached along with the atom positions they were
+   * found for. When only positions change, the cached NeighborList is updated
+   * and just the hydrogen bonds involving atoms that moved are found again.
+   */
+  class NeighborList;
   class HBondSettingsWidget;
   class HBondEngine : public Engine
   {
@@ -72,20 +83,60 @@ namespace Avogadro {
        */
       void readSettings(QSettings &settings);
 
-
+    public Q_SLOTS:
+      void setMolecule(const Molecule *molecule);
+      void setMolecule(Molecule *molecule);
 
     private:
       HBondSettingsWidget *m_settingsWidget;
       int    m_width;
       double m_radius;
       double m_angle;
-  
+
+      // Cache of the hydrogen bonds and what they were found for
+      bool m_dirty;                    // The cache must be rebuilt
+      const Molecule *m_cachedMolecule;
+      NeighborList *m_nbrList;
+      QList<Atom *> m_atoms;           // The atoms rendered by the engine
+      std::vector<Eigen::Vector3d> m_positions; // Positions indexed by id
+      std::vector<int> m_atomicNumbers;
+      std::vector<char> m_acceptor;    // Whether each atom is an acceptor
+      std::vector<char> m_rendered;    // Whether each atom is in m_atoms
+      std::vector<Atom *> m_donor;     // Donor of each donor hydrogen, or 0
+      QList<Atom *> m_donorHs;         // All of the donor hydrogens
+      QList<QPair<Atom *, Atom *> > m_hbonds; // Hydrogen and acceptor pairs
+
       bool isHbondAcceptor(Atom *atom);
       bool isHbondDonor(Atom *atom);
       bool isHbondDonorH(Atom *atom);
-    
+
+      /**
+       * Bring the cached hydrogen bonds up to date with the molecule.
+       */
+      void updateHbonds(Molecule *molecule);
+
+      /**
+       * Rebuild the neighbor list, donors, acceptors and hydrogen bonds.
+       */
+      void rebuildHbonds(Molecule *molecule);
+
+      /**
+       * Find the hydrogen bonds involving any atom in @p moved again.
+       */
+      void updateMovedHbonds(const QList<Atom *> &moved);
+
+      /**
+       * @return True if the donor hydrogen and acceptor form a hydrogen bond.
+       */
+      bool isHbond(Atom *hydrogen, Atom *acceptor) const;
+
     private Q_SLOTS:
       void settingsWidgetDestroyed();
+
+      /**
+       * Mark the cache as invalid, e.g. when atoms or bonds are added.
+       */
+      void invalidate();
     
      /**
        * @param value width of the hydrogen bonds
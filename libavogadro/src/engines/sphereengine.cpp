@@ -36,14 +36,12 @@
 #include <QMessageBox>
 #include <QDebug>
 
-#include <openbabel/mol.h>
-
 using namespace Eigen;
 
 namespace Avogadro {
 
   SphereEngine::SphereEngine(QObject *parent) : Engine(parent), m_settingsWidget(0),
-  m_alpha(1.0)
+  m_alpha(1.0), m_atomBatch(InstanceBatch::Spheres)
   {
   }
 
@@ -69,11 +67,21 @@ namespace Avogadro {
     // Render the opaque spheres if m_alpha is 1
     if (m_alpha >= 0.999)
     {
-      // Render the atoms as VdW spheres
+      // Render the atoms as VdW spheres, in one batch
+      const std::vector<double> &radii = pd->molecule()->vdwRadii();
+      Color *map = colorMap(); // possible custom color map
+      if (!map) map = pd->colorMap(); // fall back to global color map
+      QList<Atom *> list = atoms();
+      m_atomBatch.resize(list.size());
+      int i = 0;
+      foreach(Atom *a, list) {
+        map->setFromPrimitive(a);
+        map->setAlpha(m_alpha);
+        m_atomBatch.setSphere(i++, *a->pos(), radii[a->id()], map);
+      }
       glDisable(GL_NORMALIZE);
       glEnable(GL_RESCALE_NORMAL);
-      foreach(Atom *a, atoms())
-        render(pd, a);
+      pd->painter()->drawBatch(&m_atomBatch);
       glDisable(GL_RESCALE_NORMAL);
       glEnable(GL_NORMALIZE);
     }
@@ -83,6 +91,7 @@ namespace Avogadro {
   bool SphereEngine::renderTransparent(PainterDevice *pd)
   {
     // If m_alpha is between 0 and 1 then render our transparent spheres
+    const std::vector<double> &radii = pd->molecule()->vdwRadii();
     if (m_alpha > 0.001 && m_alpha < 0.999)
     {
       // First pass using a colour mask - nothing is actually drawn
@@ -96,7 +105,7 @@ namespace Avogadro {
       // not pretty...
       pd->painter()->setColor(0.0, 0.0, 0.0, 1.0);
       foreach(Atom *a, atoms()) {
-        pd->painter()->drawSphere(a->pos(), radius(a)*0.9999);
+        pd->painter()->drawSphere(a->pos(), radii[a->id()]*0.9999);
       }
 
       glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
@@ -108,7 +117,7 @@ namespace Avogadro {
       glEnable(GL_RESCALE_NORMAL);
 
       foreach(Atom *a, atoms())
-        render(pd, a);
+        render(pd, a, radii[a->id()]);
 
       glDisable(GL_RESCALE_NORMAL);
       glEnable(GL_NORMALIZE);
@@ -122,7 +131,7 @@ namespace Avogadro {
         map->setToSelectionColor();
         pd->painter()->setColor(map);
         pd->painter()->setName(a);
-        pd->painter()->drawSphere(a->pos(), SEL_ATOM_EXTRA_RADIUS + radius(a));
+        pd->painter()->drawSphere(a->pos(), SEL_ATOM_EXTRA_RADIUS + radii[a->id()]);
       }
     }
 
@@ -137,11 +146,12 @@ namespace Avogadro {
     Color *map = colorMap();
     if (!map) map = pd->colorMap();
 
+    const std::vector<double> &radii = pd->molecule()->vdwRadii();
     foreach(Atom *a, atoms()) {
       map->setFromPrimitive(a);
       pd->painter()->setColor(map);
       pd->painter()->setName(a);
-      pd->painter()->drawSphere(a->pos(), radius(a));
+      pd->painter()->drawSphere(a->pos(), radii[a->id()]);
     }
 
     glDisable(GL_RESCALE_NORMAL);
@@ -149,7 +159,7 @@ namespace Avogadro {
     return true;
   }
 
-  bool SphereEngine::render(PainterDevice *pd, const Atom *a)
+  bool SphereEngine::render(PainterDevice *pd, const Atom *a, double radius)
   {
     // Render the atoms as Van der Waals spheres
     Color *map = colorMap(); // possible custom color map
@@ -159,14 +169,14 @@ namespace Avogadro {
     map->setAlpha(m_alpha);
     pd->painter()->setColor(map);
     pd->painter()->setName(a);
-    pd->painter()->drawSphere(a->pos(), radius(a));
+    pd->painter()->drawSphere(a->pos(), radius);
 
     return true;
   }
 
   inline double SphereEngine::radius(const Atom *a) const
   {
-    return OpenBabel::etab.GetVdwRad(a->atomicNumber());
+    return a->molecule()->vdwRadii()[a->id()];
   }
 
   double SphereEngine::radius(const PainterDevice *pd, const Primitive *p) const
@@ -29,6 +29,7 @@
 
 #include <avogadro/global.h>
 #include <avogadro/engine.h>
+#include <avogadro/instancebatch.h>
 
 
 #include "ui_spheresettingswidget.h"
@@ -82,12 +83,13 @@ namespace Avogadro {
 
     private:
       double radius(const Atom *a) const;
-      //! Render an Atom.
-      bool render(PainterDevice *pd, const Atom *a);
+      //! Render an Atom with the supplied radius.
+      bool render(PainterDevice *pd, const Atom *a, double radius);
 
       SphereSettingsWidget *m_settingsWidget;
 
       double m_alpha; // transparency of the VdW spheres
+      InstanceBatch m_atomBatch; // opaque spheres, kept between frames
 
     private Q_SLOTS:
       void settingsWidgetDestroyed();
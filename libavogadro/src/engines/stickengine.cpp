@@ -48,8 +48,10 @@ using namespace Eigen;
 namespace Avogadro {
 
   StickEngine::StickEngine(QObject *parent) : Engine(parent), m_settingsWidget(0),
-        m_radius(0.25)
+        m_radius(0.25), m_atomBatch(InstanceBatch::Spheres),
+        m_bondBatch(InstanceBatch::Cylinders)
   {
+    trackMovedAtoms();
   }
 
   StickEngine::~StickEngine()
@@ -75,21 +77,93 @@ namespace Avogadro {
     glDisable( GL_NORMALIZE );
     glEnable( GL_RESCALE_NORMAL );
 
-    // Render the atoms
-    foreach(Atom *a, atoms())
-      renderOpaque(pd, a);
+    Color *map = colorMap(); // possible custom color map
+    if (!map) map = pd->colorMap(); // fall back to global color map
 
-    // render bonds (sticks)
+    // If only atoms moved since the last frame, only move their instances
+    int first, count;
+    bool moved = takeMovedAtoms(first, count)
+      && moveInstances(pd->molecule(), first, count);
+
+    // Render the atoms, in one batch
+    QList<Atom *> atomList = moved ? QList<Atom *>() : atoms();
+    if (!moved)
+      m_atomBatch.resize(atomList.size());
+    int i = 0;
+    foreach(Atom *a, atomList) {
+      map->setFromPrimitive(a);
+      m_atomBatch.setSphere(i++, *a->pos(), radius(a), map);
+    }
+    pd->painter()->drawBatch(&m_atomBatch);
+
+    // render bonds (sticks), each as two halves in one batch
     glDisable( GL_RESCALE_NORMAL );
     glEnable( GL_NORMALIZE );
-    foreach(Bond *b, bonds())
-      renderOpaque(pd, b);
+    QList<Bond *> bondList = moved ? QList<Bond *>() : bonds();
+    if (!moved)
+      m_bondBatch.resize(2 * bondList.size());
+    i = 0;
+    foreach(Bond *b, bondList) {
+      Atom* atom1 = pd->molecule()->atomById(b->beginAtomId());
+      Atom* atom2 = pd->molecule()->atomById(b->endAtomId());
+      Vector3d v1 (*atom1->pos());
+      Vector3d v2 (*atom2->pos());
+      Vector3d v3 (( v1 + v2 ) / 2);
+
+      map->setFromPrimitive(atom1);
+      m_bondBatch.setCylinder(i++, v1, v3, radius(atom1), map);
+      map->setFromPrimitive(atom2);
+      m_bondBatch.setCylinder(i++, v3, v2, radius(atom1), map);
+    }
+    pd->painter()->drawBatch(&m_bondBatch);
 
 //    glPopAttrib();
 
     return true;
   }
 
+  bool StickEngine::moveInstances(const Molecule *molecule, int first,
+                                  int count)
+  {
+    // The batches hold every atom and bond, in index order
+    QList<Atom *> atomList = molecule->atoms();
+    QList<Bond *> bondList = molecule->bonds();
+    if (m_atomBatch.size() != atomList.size()
+        || m_bondBatch.size() != 2 * bondList.size()
+        || first + count > atomList.size())
+      return false;
+
+    for (int i = first; i < first + count; ++i)
+      m_atomBatch.setEnds(i, *atomList[i]->pos(), *atomList[i]->pos());
+
+    if (count == atomList.size()) {
+      foreach(const Bond *b, bondList)
+        moveBond(molecule, b);
+    }
+    else {
+      for (int i = first; i < first + count; ++i)
+        foreach(unsigned long id, atomList[i]->bonds())
+          moveBond(molecule, molecule->bondById(id));
+    }
+    return true;
+  }
+
+  void StickEngine::moveBond(const Molecule *molecule, const Bond *b)
+  {
+    if (!b)
+      return;
+    Atom* atom1 = molecule->atomById(b->beginAtomId());
+    Atom* atom2 = molecule->atomById(b->endAtomId());
+    if (!atom1 || !atom2)
+      return;
+
+    Vector3d v1 (*atom1->pos());
+    Vector3d v2 (*atom2->pos());
+    Vector3d v3 (( v1 + v2 ) / 2);
+    m_bondBatch.setEnds(2 * b->index(), v1, v3);
+    m_bondBatch.setEnds(2 * b->index() + 1, v3, v2);
+  }
+
   bool StickEngine::renderTransparent(PainterDevice *pd)
   {
     glDisable( GL_NORMALIZE );
@@ -144,19 +218,6 @@ namespace Avogadro {
     return true;
   }
 
-  inline bool StickEngine::renderOpaque(PainterDevice *pd, const Atom* a)
-  {
-    Color *map = colorMap(); // possible custom color map
-    if (!map) map = pd->colorMap(); // fall back to global color map
-
-    map->setFromPrimitive(a);
-    pd->painter()->setColor(map);
-    pd->painter()->setName(a);
-    pd->painter()->drawSphere( a->pos(), radius(a) );
-
-    return true;
-  }
-
   inline bool StickEngine::renderPick(PainterDevice *pd, const Atom* a)
   {
     Color *map = colorMap(); // possible custom color map
@@ -28,6 +28,7 @@
 
 #include <avogadro/global.h>
 #include <avogadro/engine.h>
+#include <avogadro/instancebatch.h>
 
 #include "ui_sticksettingswidget.h"
 
@@ -80,15 +81,20 @@ namespace Avogadro {
     private:
       inline double radius(const Atom *) const
       { return m_radius; }
-      //! Render an Atom.
-      bool renderOpaque(PainterDevice *pd, const Atom *a);
+      //! Render an Atom for picking.
       bool renderPick(PainterDevice *pd, const Atom *a);
       //! Render a Bond.
       bool renderOpaque(PainterDevice *pd, const Bond *b);
+      //! Move the instances of a range of atoms and of their bonds.
+      bool moveInstances(const Molecule *molecule, int first, int count);
+      //! Move the instances of a Bond.
+      void moveBond(const Molecule *molecule, const Bond *b);
 
       StickSettingsWidget *m_settingsWidget;
 
 			double m_radius; //!< The radius of the stick bonds
+      InstanceBatch m_atomBatch; //!< The atoms, kept between frames
+      InstanceBatch m_bondBatch; //!< The bonds, kept between frames
 
 		private Q_SLOTS:
 	    void settingsWidgetDestroyed();
@@ -103,6 +103,17 @@ namespace Avogadro {
     return true;
   }
 
+  double WireEngine::pickRadius(const PainterDevice *, const Primitive *p) const
+  {
+    if (!m_primitives.contains(p))
+      return 0.0;
+    if (p->type() == Primitive::AtomType)
+      return static_cast<const Atom *>(p)->isHydrogen() ? 0.05 : 0.15;
+    else if (p->type() == Primitive::BondType)
+      return 0.04;
+    return 0.0;
+  }
+
   bool WireEngine::renderOpaque(PainterDevice *pd, const Atom *a)
   {
     const Vector3d & v = *a->pos();
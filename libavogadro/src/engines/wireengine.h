@@ -67,6 +67,9 @@ namespace Avogadro {
       bool renderPick(PainterDevice *pd);
       //@}
 
+      //! The sizes drawn by renderPick()
+      double pickRadius(const PainterDevice *pd, const Primitive *p) const;
+
       //! Configuration options
       QWidget* settingsWidget();
 
@@ -46,6 +46,8 @@ namespace Avogadro {
     connect(ui.fpsSpin, SIGNAL(valueChanged(int)), this, SIGNAL(fpsChanged(int)));
     connect(ui.loopBox, SIGNAL(stateChanged(int)), this, SIGNAL(loopChanged(int)));
     connect(ui.dynBondsBox, SIGNAL(stateChanged(int)), this, SIGNAL(dynamicBondsChanged(int)));
+    connect(ui.dynBondsBox, SIGNAL(toggled(bool)), ui.precomputeBondsBox, SLOT(setEnabled(bool)));
+    connect(ui.precomputeBondsBox, SIGNAL(stateChanged(int)), this, SIGNAL(precomputeBondsChanged(int)));
     
     connect(ui.playButton, SIGNAL(clicked()), this, SIGNAL(play()));
     connect(ui.pauseButton, SIGNAL(clicked()), this, SIGNAL(pause()));
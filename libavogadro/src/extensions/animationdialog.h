@@ -58,6 +58,7 @@ namespace Avogadro
       void sliderChanged(int i);
       void fpsChanged(int i);
       void dynamicBondsChanged(int state);
+      void precomputeBondsChanged(int state);
       bool loopChanged(int state);
       void back();
       void play();
@@ -24,6 +24,7 @@
 #include "animationextension.h"
 #include "trajvideomaker.h"
 #include <avogadro/molecule.h>
+#include <avogadro/moleculefile.h>
 #include <avogadro/color.h>
 #include <avogadro/animation.h>
 #include <avogadro/glwidget.h>
@@ -34,7 +35,6 @@
 #include <Eigen/Core>
 
 #include <QMessageBox>
-#include <QDir>
 
 #include <fstream>
 
@@ -44,7 +44,8 @@ using Eigen::Vector3d;
 namespace Avogadro {
 
   AnimationExtension::AnimationExtension(QObject *parent) : Extension(parent),
-    m_molecule(0), m_animationDialog(0), m_animation(0), m_widget(0)
+    m_molecule(0), m_animationDialog(0), m_animation(0), m_trajectory(0),
+    m_widget(0)
   {
     QAction *action = new QAction(this);
     action->setText(tr("Animation..."));
@@ -62,6 +63,11 @@ namespace Avogadro {
       m_animation = 0;
     }
 
+    if (m_trajectory) {
+      delete m_trajectory;
+      m_trajectory = 0;
+    }
+
     if (m_animationDialog) {
       m_animationDialog->deleteLater();
     }
@@ -79,6 +85,9 @@ namespace Avogadro {
 
   void AnimationExtension::setMolecule(Molecule *molecule)
   {
+    // the old molecule is still around, so its positions can be restored
+    if (m_animation)
+      m_animation->setMolecule(molecule);
     m_molecule = molecule;
   }
 
@@ -100,6 +109,7 @@ namespace Avogadro {
       connect(m_animationDialog, SIGNAL(fpsChanged(int)), m_animation, SLOT(setFps(int)));
       connect(m_animationDialog, SIGNAL(loopChanged(int)), this, SLOT(setLoop(int)));
       connect(m_animationDialog, SIGNAL(dynamicBondsChanged(int)), this, SLOT(setDynamicBonds(int)));
+      connect(m_animationDialog, SIGNAL(precomputeBondsChanged(int)), this, SLOT(setPrecomputeBonds(int)));
 
       connect(m_animationDialog, SIGNAL(play()), m_animation, SLOT(start()));
       connect(m_animationDialog, SIGNAL(pause()), m_animation, SLOT(pause()));
@@ -146,8 +156,14 @@ namespace Avogadro {
                               .arg( file ) );
         return;
       }
-      else
+      else {
+        if (m_trajectory) {
+          m_animation->setTrajectory(0);
+          delete m_trajectory;
+          m_trajectory = 0;
+        }
         m_molecule->setOBMol(&obmol);
+      }
     }
 
     m_animationDialog->setFrameCount(m_animation->numFrames());
@@ -173,6 +189,15 @@ namespace Avogadro {
     }
   }
 
+  void AnimationExtension::setPrecomputeBonds(int state)
+  {
+    if (state == Qt::Checked) {
+      m_animation->setPrecomputeBonds(true);
+    } else {
+      m_animation->setPrecomputeBonds(false);
+    }
+  }
+
   void AnimationExtension::saveVideo(QString videoFileName)
   {
     if (videoFileName.isEmpty()) {
@@ -193,36 +218,22 @@ namespace Avogadro {
       return;
     }
 
-    //first, split out the directory and filenames
-    QString dir, fileName, prefix;
-
     int slashPos = videoFileName.lastIndexOf('/');
-
     if (slashPos < 0) {
       QMessageBox::warning( NULL, tr( "Avogadro" ),
                 tr( "Invalid video filename.  Must include full directory path" ));
       return;
     }
 
-    dir = videoFileName.left(slashPos) + '/';
-    fileName = videoFileName.right(videoFileName.length() - (slashPos+1));
-    if (fileName.isEmpty()) {
+    // a name is needed before the .avi extension
+    QString fileName = videoFileName.mid(slashPos + 1);
+    if (fileName.length() <= 4) {
       QMessageBox::warning( NULL, tr( "Avogadro" ),
                 tr( "Invalid video filename.  Must include full directory path and name, ending with .avi" ));
       return;
     }
 
-    //if (fileName.endsWith(".avi")) {
-    prefix = fileName.left(fileName.length() - 4);
-
-
-    //Make the directory where the snapshots will be saved
-    QString snapshotsDir = dir + prefix + '/';
-    QDir qdir;
-    if (!qdir.exists(snapshotsDir))
-      qdir.mkpath(snapshotsDir);
-
-    TrajVideoMaker::makeVideo(m_widget, m_animation, snapshotsDir, videoFileName);
+    TrajVideoMaker::makeVideo(m_widget, m_animation, videoFileName);
 
   }
 
@@ -248,35 +259,31 @@ namespace Avogadro {
       return;
     }
 
-    m_molecule->clearConformers();
-
-    std::ifstream file(QFile::encodeName(trajfile));
-
-    OpenBabel::OBMol tmpMol;
-    int i=0;
-    while (conv.Read(&tmpMol, &file)) {
-      double* tmpCoords = tmpMol.GetCoordinates();
-      if (!tmpCoords) {
-        QMessageBox::warning( NULL, tr( "Avogadro" ),
-                              tr( "Problem reading traj file %1").arg(trajfile));
-        return;
-      }
+    if (m_trajectory) {
+      m_animation->setTrajectory(0);
+      delete m_trajectory;
+      m_trajectory = 0;
+    }
 
-      if (tmpMol.NumAtoms() != m_molecule->numAtoms()) {
-        QMessageBox::warning( NULL, tr( "Avogadro" ),
-          tr( "Trajectory file %1 disagrees on the number of atoms in the present molecule").arg(trajfile));
-        return;
-      }
+    // only the frame offsets are read, frames are decoded when shown
+    MoleculeFile *trajectory = MoleculeFile::readTrajectory(trajfile, format);
+    std::vector<Eigen::Vector3d> coords;
+    if (!trajectory->numConformers() || !trajectory->conformer(0, coords)) {
+      QMessageBox::warning( NULL, tr( "Avogadro" ),
+                            tr( "Problem reading traj file %1").arg(trajfile));
+      delete trajectory;
+      return;
+    }
 
-      std::vector<Eigen::Vector3d> *coords = m_molecule->addConformer(i);
-      //copy coords read in to a new array that will not be deleted
-      for (uint j = 0; j < tmpMol.NumAtoms(); ++j) {
-        (*coords)[j] = Vector3d(tmpCoords[3*j], tmpCoords[3*j+1], tmpCoords[3*j+2]);
-      }
-      ++i;
+    if (coords.size() != m_molecule->numAtoms()) {
+      QMessageBox::warning( NULL, tr( "Avogadro" ),
+        tr( "Trajectory file %1 disagrees on the number of atoms in the present molecule").arg(trajfile));
+      delete trajectory;
+      return;
     }
 
-    file.close();
+    m_trajectory = trajectory;
+    m_animation->setTrajectory(m_trajectory);
   }
 
   bool AnimationExtension::writeXyzTraj(QString filename) {
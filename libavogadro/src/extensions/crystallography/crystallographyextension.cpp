@@ -47,7 +47,9 @@
 #include <avogadro/camera.h>
 #include <avogadro/glwidget.h>
 #include <avogadro/obeigenconv.h>
+#include <avogadro/periodichash.h>
 #include <avogadro/neighborlist.h>
+#include <avogadro/supercellbuilder.h>
 #include <avogadro/bond.h>
 
 #include <openbabel/generic.h>
@@ -67,6 +69,7 @@
 #include <QtCore/QDebug>
 #include <QtCore/QSettings>
 #include <QtCore/QTimer>
+#include <QtCore/QVector>
 
 namespace Avogadro
 {
@@ -1180,8 +1183,8 @@ namespace Avogadro
     QList<QString> origIds = currentAtomicSymbols();
     QList<QString> newIds;
 
-    // Duplicate tolerance squared
-    const double dupTolSquared = m_spgTolerance*m_spgTolerance;
+    // Coordinates added so far, for finding duplicates
+    PeriodicHash newHash(m_spgTolerance);
 
     // Non-fatal assert -- if the number of atoms has
     // changed, just tail-recurse and try again.
@@ -1196,7 +1199,6 @@ namespace Avogadro
     std::list<OpenBabel::vector3>::const_iterator obxit_end;
     QList<Eigen::Vector3d> xformed;
     QList<Eigen::Vector3d>::const_iterator xit, xit_end;
-    QList<Eigen::Vector3d>::const_iterator newit, newit_end;
     for (int i = 0; i < origIds.size(); ++i) {
       curId = &origIds[i];
       curVec = &origFCoords[i];
@@ -1233,22 +1235,10 @@ namespace Avogadro
 
       // Check all xformed vectors against the coords
       // already added. if they match, skip this atom.
-      bool duplicate;
       xit_end = xformed.constEnd();
       for (xit = xformed.constBegin();
            xit != xit_end; ++xit) {
-        newit_end = newFCoords.constEnd();
-        duplicate = false;
-        for (newit = newFCoords.constBegin();
-             newit != newit_end; ++newit) {
-          if (fabs((*newit - *xit).squaredNorm())
-              < dupTolSquared) {
-            duplicate = true;
-            break;
-          }
-        }
-
-        if (duplicate) {
+        if (!newHash.insertUnique(*xit)) {
           continue;
         }
 
@@ -1277,15 +1267,19 @@ namespace Avogadro
       currentFractionalCoords();
     QList<QString> Ids = currentAtomicSymbols();
 
-    // Duplicate tolerance squared
-    const double dupTolSquared = m_spgTolerance*m_spgTolerance;
-
     // Non-fatal assert -- if the number of atoms has
     // changed, just tail-recurse and try again.
     if (Ids.size() != FCoords.size()) {
       return reduceToAsymmetricUnit();
     }
 
+    // All of the coordinates, for finding the equivalent atoms
+    PeriodicHash hash(m_spgTolerance);
+    foreach (const Eigen::Vector3d &fcoord, FCoords) {
+      hash.insert(fcoord);
+    }
+    QVector<bool> removed(FCoords.size(), false);
+
     const Eigen::Vector3d *curVec;
     std::list<OpenBabel::vector3> obxformed;
     std::list<OpenBabel::vector3>::const_iterator obxit;
@@ -1293,9 +1287,12 @@ namespace Avogadro
     QList<Eigen::Vector3d> xformed;
     QList<Eigen::Vector3d>::const_iterator xit, xit_end;
 
-    // This loop modifies Ids and Fcoords, but only by removing
-    // atoms for j > i.
+    // This loop only removes atoms for j > i.
     for (int i = 0; i < Ids.size(); ++i) {
+      if (removed[i]) {
+        continue;
+      }
+
       // Get tranformed OB vectors
       curVec = &FCoords[i];
       obxformed = sg->Transform(Eigen2OB(*curVec));
@@ -1327,16 +1324,24 @@ namespace Avogadro
       xit_end = xformed.constEnd();
       for (xit = xformed.constBegin();
            xit != xit_end; ++xit) {
-        for (int j = i + 1; j < Ids.size(); j++) {
-          if ((FCoords[j] - *xit).squaredNorm() < dupTolSquared) {
-            FCoords.removeAt(j);
-            Ids.removeAt(j);
+        foreach (int j, hash.findAll(*xit)) {
+          if (j > i) {
+            removed[j] = true;
           }
         }
       }
     }
 
-    setCurrentFractionalCoords(Ids, FCoords);
+    QList<Eigen::Vector3d> newFCoords;
+    QList<QString> newIds;
+    for (int i = 0; i < Ids.size(); ++i) {
+      if (!removed[i]) {
+        newFCoords.append(FCoords[i]);
+        newIds.append(Ids[i]);
+      }
+    }
+
+    setCurrentFractionalCoords(newIds, newFCoords);
   }
 
   void CrystallographyExtension::wrapAtomsToCell()
@@ -1465,33 +1470,13 @@ namespace Avogadro
     const Eigen::Vector3d u1 (cellMatrix.col(0));
     const Eigen::Vector3d u2 (cellMatrix.col(1));
     const Eigen::Vector3d u3 (cellMatrix.col(2));
-    Eigen::Vector3d displacement;
-
-    m_molecule->blockSignals(true);
-    const QList<Atom*> orig = m_molecule->atoms();
-    for (unsigned int a = 0; a < v1; ++a) {
-      for (unsigned int b = 0; b < v2; ++b)  {
-        for (unsigned int c = 0; c < v3; ++c)  {
-          // Do not copy the unit cell onto itself
-          if (a == 0 && b == 0 && c == 0) continue;
-          // Find the displacement vector for this new replica
-          displacement = static_cast<double>(a) * u1 +
-            static_cast<double>(b) * u2 +
-            static_cast<double>(c) * u3;
-
-          foreach(const Atom *atom, orig) {
-            Atom *newAtom = m_molecule->addAtom();
-            *newAtom = *atom;
-            newAtom->setPos((*atom->pos())+displacement);
-          }
-        }
-        // Make sure to return to the event loop
-        // or a big build can make the user think we've crashed
-        QCoreApplication::processEvents();
-      }
-    } // end of for loops
-    m_molecule->blockSignals(false);
-    m_molecule->updateMolecule();
+
+    // Perceive the bonds of the unit cell, including those across its
+    // faces, then copy the atoms in one bulk insertion and the bonds into
+    // each replica
+    SuperCellBuilder builder(m_molecule, cellMatrix);
+    builder.perceiveBonds();
+    builder.build(v1, v2, v3);
 
     // Update the length of the unit cell
     cellMatrix.col(0) = Eigen::Vector3d(v1 * u1);
@@ -1504,10 +1489,13 @@ namespace Avogadro
 
   void CrystallographyExtension::rebuildBonds()
   {
-    m_molecule->blockSignals(true);
-    // Remove any bonds
-    foreach(Bond *b, m_molecule->bonds())
-      m_molecule->removeBond(b);
+    // Remove any bonds, the last first so the others are not reindexed
+    const QList<Bond*> bonds = m_molecule->bonds();
+    for (int i = bonds.size() - 1; i >= 0; --i)
+      m_molecule->removeBond(bonds[i]);
+
+    // Add the new bonds in one bulk insertion, which notifies once
+    m_molecule->beginBulkInsert(0, bonds.size());
 
     // Migrated from supercellextension
     // Add single bonds between all atoms closer than their combined atomic
@@ -1541,8 +1529,7 @@ namespace Avogadro
       }
     }
 
-    m_molecule->blockSignals(false);
-    m_molecule->updateMolecule();
+    m_molecule->endBulkInsert();
   }
 
   void CrystallographyExtension::orientStandard()
@@ -35,6 +35,7 @@
 #include <QWriteLocker>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QTime>
 #include <QAbstractTableModel>
 #include <QMessageBox>
 #include <QDebug>
@@ -175,7 +176,9 @@ namespace Avogadro
     int i = action->data().toInt();
     double energy = 0.0;
     QString msg;
-    OBMol mol;
+    // The force field copies the molecule, so it is set up from the cache
+    OBMol *mol;
+    bool setup;
     switch ( i ) {
     case SetupForceFieldIndex: // setup force field
       m_dialog->show();
@@ -186,8 +189,10 @@ namespace Avogadro
 
       m_forceField->SetLogLevel( OBFF_LOGLVL_HIGH );
 
-      mol = m_molecule->OBMol();
-      if ( !m_forceField->Setup( mol, m_constraints->constraints() ) ) {
+      mol = m_molecule->lockOBMol();
+      setup = m_forceField->Setup( *mol, m_constraints->constraints() );
+      m_molecule->unlockOBMol();
+      if ( !setup ) {
         QMessageBox::warning( widget, tr( "Avogadro" ),
           tr( "Cannot set up the currently selected force field for this molecule. Switching to UFF." ));
         m_forceField = OBForceField::FindForceField("UFF");
@@ -211,8 +216,10 @@ namespace Avogadro
 
       m_forceField->SetLogLevel( OBFF_LOGLVL_LOW );
 
-      mol = m_molecule->OBMol();
-      if ( !m_forceField->Setup( mol, m_constraints->constraints() ) ) {
+      mol = m_molecule->lockOBMol();
+      setup = m_forceField->Setup( *mol, m_constraints->constraints() );
+      m_molecule->unlockOBMol();
+      if ( !setup ) {
         QMessageBox::warning( widget, tr( "Avogadro" ),
           tr( "Cannot set up the currently selected force field for this molecule. Switching to UFF." ));
         m_forceField = OBForceField::FindForceField("UFF");
@@ -241,8 +248,10 @@ namespace Avogadro
 
       m_forceField->SetLogLevel( OBFF_LOGLVL_LOW );
 
-      mol = m_molecule->OBMol();
-      if ( !m_forceField->Setup( mol, m_constraints->constraints() ) ) {
+      mol = m_molecule->lockOBMol();
+      setup = m_forceField->Setup( *mol, m_constraints->constraints() );
+      m_molecule->unlockOBMol();
+      if ( !setup ) {
         QMessageBox::warning( widget, tr( "Avogadro" ),
           tr( "Cannot set up the currently selected force field for this molecule. Switching to UFF." ));
         m_forceField = OBForceField::FindForceField("UFF");
@@ -357,6 +366,9 @@ namespace Avogadro
     m_method = method;
   }
 
+  // Milliseconds between the geometries shown while optimizing
+  static const int PUBLISH_INTERVAL = 40;
+
   void ForceFieldThread::copyConformers()
   {
     OBMol obmol = m_molecule->OBMol();
@@ -392,6 +404,32 @@ namespace Avogadro
     }
   }
 
+  bool ForceFieldThread::publish(OBMol &mol, bool wait)
+  {
+    m_forceField->UpdateCoordinates( mol );
+    if (mol.NumAtoms() != m_ids.size())
+      return false;
+
+    // Fill the back buffers, the molecule is only touched by the swap
+    const double *coordPtr = mol.GetCoordinates();
+    for (unsigned int i = 0; i < m_ids.size(); ++i, coordPtr += 3)
+      m_positions[m_ids[i]] = Eigen::Vector3d(coordPtr);
+
+    if (mol.HasData(OBGenericDataType::ConformerData)) {
+      OBConformerData *cd = (OBConformerData*) mol.GetData(OBGenericDataType::ConformerData);
+      const vector<vector<vector3> > &allForces = cd->GetForces();
+      if (allForces.size() && allForces[0].size() == mol.NumAtoms()) {
+        const vector<vector3> &forces = allForces[0];
+        for (unsigned int i = 0; i < m_ids.size(); ++i)
+          m_forces[m_ids[i]] = Eigen::Vector3d(forces[i].AsArray());
+        // the positions and forces are set under the same write lock
+        return m_molecule->swapAtomPositions(m_positions, m_forces, wait);
+      }
+    }
+
+    return m_molecule->swapAtomPositions(m_positions, wait);
+  }
+
   void ForceFieldThread::run()
   {
     m_stop = false;
@@ -420,92 +458,45 @@ namespace Avogadro
       m_forceField->SetConstraints(m_constraints->constraints());
     }
 
-    if ( m_task == 0 ) {
-      if ( m_algorithm == 0 ) {
+    if ( m_task == 0 && ( m_algorithm == 0 || m_algorithm == 1 ) ) {
+      if ( m_algorithm == 0 )
         m_forceField->SteepestDescentInitialize( m_nSteps, pow( 10.0, -m_convergence )); // initialize sd
+      else
+        m_forceField->ConjugateGradientsInitialize( m_nSteps, pow( 10.0, -m_convergence )); // initialize cg
 
-        while ( m_forceField->SteepestDescentTakeNSteps( 5 ) ) { // take 5 steps until convergence or m_nSteps taken
-          m_forceField->UpdateCoordinates( mol );
-          assert( mol.NumAtoms() == m_molecule->numAtoms() );
-          double *coordPtr = mol.GetCoordinates();
-          // forces
-          if (mol.HasData(OBGenericDataType::ConformerData)) {
-            OBConformerData *cd = (OBConformerData*) mol.GetData(OBGenericDataType::ConformerData);
-            const vector<vector<vector3> > &allForces = cd->GetForces();
-            if (allForces.size()) {
-              const vector<vector3> &forces = allForces[0];
-              if (forces.size() == mol.NumAtoms()) {
-                foreach(Atom* atom, m_molecule->atoms()) {
-                  atom->setForceVector(Eigen::Vector3d(forces[atom->index()].AsArray()));
-                }
-              }
-            }
-          }
-
-          // Try to acquire a write lock on the molecule, and update geometry
-          if (m_molecule->lock()->tryLockForWrite()) {
-            foreach (Atom *atom, m_molecule->atoms()) {
-              atom->setPos(Eigen::Vector3d(coordPtr));
-              coordPtr += 3;
-            }
-            m_molecule->lock()->unlock();
-            m_molecule->update();
-          }
-
-          m_cycles++;
-          steps += 5;
-          m_mutex.lock();
-          if ( m_stop ) {
-            m_mutex.unlock();
-            break;
-          }
-          m_mutex.unlock();
+      // Size the buffers once, publish() does not read the molecule
+      m_molecule->lock()->lockForRead();
+      m_ids.clear();
+      foreach (const Atom *atom, m_molecule->atoms())
+        m_ids.push_back(atom->id());
+      m_positions = m_molecule->atomPositions();
+      m_molecule->lock()->unlock();
+      m_forces.assign(m_positions.size(), Eigen::Vector3d::Zero());
+
+      // Take 5 steps at a time until convergence or m_nSteps taken, and show
+      // the geometry at a fixed rate however fast the steps are
+      QTime timer;
+      timer.start();
+      while ( m_algorithm == 0 ? m_forceField->SteepestDescentTakeNSteps( 5 )
+              : m_forceField->ConjugateGradientsTakeNSteps( 5 ) ) {
+        m_cycles++;
+        steps += 5;
+        // Skip the update while the molecule is locked, e.g. rendering
+        if ( timer.elapsed() >= PUBLISH_INTERVAL && publish( mol, false ) ) {
+          timer.restart();
           emit stepsTaken( steps );
         }
-      } else if ( m_algorithm == 1 ) {
-        m_forceField->ConjugateGradientsInitialize( m_nSteps, pow( 10.0, -m_convergence )); // initialize cg
 
-        OBMol mol;
-        while ( m_forceField->ConjugateGradientsTakeNSteps( 5 ) ) { // take 5 steps until convergence or m_nSteps taken
-          mol = m_molecule->OBMol();
-          m_forceField->UpdateCoordinates( mol );
-          assert( mol.NumAtoms() == m_molecule->numAtoms() );
-          double *coordPtr = mol.GetCoordinates();
-          // forces
-          if (mol.HasData(OBGenericDataType::ConformerData)) {
-            OBConformerData *cd = (OBConformerData*) mol.GetData(OBGenericDataType::ConformerData);
-            const vector<vector<vector3> > &allForces = cd->GetForces();
-            if (allForces.size()) {
-              const vector<vector3> &forces = allForces[0];
-              if (forces.size() == mol.NumAtoms()) {
-                foreach(Atom* atom, m_molecule->atoms()) {
-                  atom->setForceVector(Eigen::Vector3d(forces[atom->index()].AsArray()));
-                }
-              }
-            }
-          }
-
-          // Try to acquire a write lock on the molecule, and update geometry
-          if (m_molecule->lock()->tryLockForWrite()) {
-            foreach (Atom *atom, m_molecule->atoms()) {
-              atom->setPos(Eigen::Vector3d(coordPtr));
-              coordPtr += 3;
-            }
-            m_molecule->lock()->unlock();
-            m_molecule->update();
-          }
-
-          m_cycles++;
-          steps += 5;
-          m_mutex.lock();
-          if ( m_stop ) {
-            m_mutex.unlock();
-            break;
-          }
+        m_mutex.lock();
+        if ( m_stop ) {
           m_mutex.unlock();
-          emit stepsTaken( steps );
+          break;
         }
+        m_mutex.unlock();
       }
+      // Always show the final geometry
+      publish( mol, true );
+      emit stepsTaken( steps );
     } else if ( m_task == 1 ) {
       int n = m_forceField->SystematicRotorSearchInitialize(m_nSteps);
       while (m_forceField->SystematicRotorSearchNextConformer(m_nSteps)) {
@@ -597,21 +588,22 @@ namespace Avogadro
                                         ConstraintsModel* constraints,
                                         int forceFieldID, int nSteps, int algorithm,
                                         int convergence, int task ) :
+    MoleculeDeltaCommand( molecule ),
     m_nSteps( nSteps ),
     m_task( task ),
     m_molecule( molecule ),
     m_constraints( constraints ),
     m_thread( 0 ),
     m_dialog( 0 ),
-    m_detached( false )
+    m_detached( false ),
+    m_undone( false )
   {
     m_thread = new ForceFieldThread( molecule, forceField, constraints,
                                      forceFieldID, nSteps, algorithm,
                                      convergence, task );
 
     connect(m_thread, SIGNAL(message(QString)), this, SIGNAL(message(QString)));
-
-    m_moleculeCopy = *molecule;
+    connect(m_thread, SIGNAL(finished()), this, SLOT(threadFinished()));
   }
 
   ForceFieldCommand::~ForceFieldCommand()
@@ -661,6 +653,13 @@ namespace Avogadro
 
   void ForceFieldCommand::redo()
   {
+    // Redo the recorded result instead of running the force field again
+    if (m_undone) {
+      m_undone = false;
+      MoleculeDeltaCommand::redo();
+      return;
+    }
+
     if(!m_dialog) {
       if ( m_task == 0 )
         m_dialog = new QProgressDialog( QObject::tr( "Forcefield Optimization" ),
@@ -692,6 +691,9 @@ namespace Avogadro
     m_thread->setMutability(m_mutability);
     m_thread->setConvergence(m_convergence);
     m_thread->setMethod(m_method);
+
+    // Searches replace the conformers, optimizations only move atoms
+    delta().begin(m_molecule, m_task != 0);
     m_thread->start();
   }
 
@@ -700,8 +702,14 @@ namespace Avogadro
     m_thread->stop();
     m_thread->wait();
 
-    *m_molecule = m_moleculeCopy;
-    m_molecule->update();
+    MoleculeDeltaCommand::undo();
+    m_undone = true;
+  }
+
+  void ForceFieldCommand::threadFinished()
+  {
+    // Keep only the atoms the force field moved
+    delta().end(m_molecule);
   }
 
   bool ForceFieldCommand::mergeWith( const QUndoCommand *command )
@@ -713,6 +721,11 @@ namespace Avogadro
       gc->detach();
       m_thread = gc->thread();
       m_dialog = gc->progressDialog();
+      connect(m_thread, SIGNAL(finished()), this, SLOT(threadFinished()));
+      // undo both runs, the merged one is recorded when its thread finishes
+      delta().merge(gc->delta());
+      if ( !m_thread->isRunning() )
+        threadFinished();
     }
     // received another of the same call
     return true;
@@ -31,6 +31,7 @@
 #include <openbabel/forcefield.h>
 
 #include <avogadro/molecule.h>
+#include <avogadro/moleculedelta.h>
 #include <avogadro/glwidget.h>
 #include <avogadro/extension.h>
 
@@ -109,10 +110,17 @@ namespace Avogadro {
 
     private:
       void copyConformers();
+      bool publish(OpenBabel::OBMol &mol, bool wait);
 
       Molecule *m_molecule;
       ConstraintsModel* m_constraints;
 
+      // Unique ids of the atoms in the order of the OBMol, and the back
+      // buffers of positions and forces handed to the molecule by publish()
+      std::vector<unsigned long> m_ids;
+      std::vector<Eigen::Vector3d> m_positions;
+      std::vector<Eigen::Vector3d> m_forces;
+
       QMutex m_mutex;
 
       int m_cycles;
@@ -134,7 +142,7 @@ namespace Avogadro {
       bool m_stop;
   };
 
- class ForceFieldCommand : public QObject, public QUndoCommand
+ class ForceFieldCommand : public QObject, public MoleculeDeltaCommand
  {
    Q_OBJECT
 
@@ -166,9 +174,10 @@ namespace Avogadro {
    Q_SIGNALS:
      void message(const QString &m);
 
-   private:
-     Molecule m_moleculeCopy;
+   private Q_SLOTS:
+     void threadFinished();
 
+   private:
      int m_nSteps;
      int m_task;
      int m_numConformers;
@@ -183,6 +192,7 @@ namespace Avogadro {
      QProgressDialog *m_dialog;
 
      mutable bool m_detached;
+     bool m_undone;
 
   };
 
@@ -226,11 +226,19 @@ namespace Avogadro
     if (t.size() == 0)
       return;
 
+    // Unindexed meshes store each triangle as three consecutive vertices
+    std::vector<unsigned int> idx = mesh.indices();
+    if (!mesh.isIndexed()) {
+      idx.resize(t.size());
+      for (unsigned int i = 0; i < t.size(); ++i)
+        idx[i] = i;
+    }
+
     QString vertsStr, ivertsStr, normsStr, inormsStr;
     QTextStream verts(&vertsStr);
     verts << "vertex_vectors{" << t.size() << ",\n";
     QTextStream iverts(&ivertsStr);
-    iverts << "face_indices{" << t.size() / 3 << ",\n";
+    iverts << "face_indices{" << idx.size() / 3 << ",\n";
     QTextStream norms(&normsStr);
     norms << "normal_vectors{" << n.size() << ",\n";
     for(unsigned int i = 0; i < t.size(); ++i) {
@@ -246,9 +254,9 @@ namespace Avogadro
       }
     }
     // Now to write out the indices
-    for (unsigned int i = 0; i < t.size(); i += 3) {
-      iverts << "<" << i << "," << i+1 << "," << i+2 << ">";
-      if (i != t.size()-3) {
+    for (unsigned int i = 0; i < idx.size(); i += 3) {
+      iverts << "<" << idx[i] << "," << idx[i+1] << "," << idx[i+2] << ">";
+      if (i != idx.size()-3) {
         iverts << ", ";
       }
       if (i != 0 && ((i+1)/3)%3 == 0) {
@@ -293,11 +301,19 @@ namespace Avogadro
     if (v.size() == 0 || v.size() != c.size())
       return;
 
+    // Unindexed meshes store each triangle as three consecutive vertices
+    std::vector<unsigned int> idx = mesh.indices();
+    if (!mesh.isIndexed()) {
+      idx.resize(v.size());
+      for (unsigned int i = 0; i < v.size(); ++i)
+        idx[i] = i;
+    }
+
     QString vertsStr, ivertsStr, normsStr, texturesStr;
     QTextStream verts(&vertsStr);
     verts << "vertex_vectors{" << v.size() << ",\n";
     QTextStream iverts(&ivertsStr);
-    iverts << "face_indices{" << v.size() / 3 << ",\n";
+    iverts << "face_indices{" << idx.size() / 3 << ",\n";
     QTextStream norms(&normsStr);
     norms << "normal_vectors{" << n.size() << ",\n";
     QTextStream textures(&texturesStr);
@@ -319,10 +335,10 @@ namespace Avogadro
       }
     }
     // Now to write out the indices
-    for (unsigned int i = 0; i < v.size(); i += 3) {
-      iverts << "<" << i << "," << i+1 << "," << i+2 << ">";
-      iverts << "," << i << "," << i+1 << "," << i+2;
-      if (i != v.size()-3)
+    for (unsigned int i = 0; i < idx.size(); i += 3) {
+      iverts << "<" << idx[i] << "," << idx[i+1] << "," << idx[i+2] << ">";
+      iverts << "," << idx[i] << "," << idx[i+1] << "," << idx[i+2];
+      if (i != idx.size()-3)
         iverts << ", ";
       if (i != 0 && ((i+1)/3)%3 == 0)
         iverts << '\n';
@@ -28,9 +28,10 @@
 
 #include <avogadro/molecule.h>
 #include <avogadro/atom.h>
-#include <avogadro/bond.h>
 #include <avogadro/glwidget.h>
-#include <avogadro/neighborlist.h>
+#include <avogadro/obeigenconv.h>
+#include <avogadro/periodichash.h>
+#include <avogadro/supercellbuilder.h>
 
 #include <openbabel/mol.h>
 #include <openbabel/generic.h>
@@ -169,13 +170,12 @@ namespace Avogadro {
       OBMol mol = m_molecule->OBMol();
       vector3 uniqueV, newV;
       list<vector3> transformedVectors; // list of symmetry-defined copies of the atom
-      list<vector3>::iterator transformIterator, duplicateIterator;
+      list<vector3>::iterator transformIterator;
       vector3 updatedCoordinate;
-      bool foundDuplicate;
 
       OBAtom *addAtom;
       QList<OBAtom*> atoms; // keep the current list of unique atoms -- don't double-create
-      list<vector3> coordinates; // all coordinates to prevent duplicates
+      PeriodicHash coordinates(1.0e-2); // all coordinates to prevent duplicates
       FOR_ATOMS_OF_MOL(atom, mol)
         atoms.push_back(&(*atom));
 
@@ -184,7 +184,7 @@ namespace Avogadro {
         // Assert: won't crash because we already ensure uc != NULL
         uniqueV = uc->CartesianToFractional(uniqueV);
         uniqueV = transformedFractionalCoordinate(uniqueV);
-        coordinates.push_back(uniqueV);
+        coordinates.insert(OB2Eigen(uniqueV));
 
         transformedVectors = sg->Transform(uniqueV);
         for (transformIterator = transformedVectors.begin();
@@ -192,20 +192,12 @@ namespace Avogadro {
           // coordinates are in reciprocal space -- check if it's in the unit cell
           // if not, transform it in place
           updatedCoordinate = transformedFractionalCoordinate(*transformIterator);
-          foundDuplicate = false;
-
-          // Check if the transformed coordinate is a duplicate of an atom
-          for (duplicateIterator = coordinates.begin();
-               duplicateIterator != coordinates.end(); ++duplicateIterator) {
-            if (duplicateIterator->distSq(updatedCoordinate) < 1.0e-4) {
-              foundDuplicate = true;
-              break;
-            }
-          }
-          if (foundDuplicate)
+
+          // Skip duplicates of an atom, and make sure to check the new atom
+          // for dupes
+          if (!coordinates.insertUnique(OB2Eigen(updatedCoordinate)))
             continue;
 
-          coordinates.push_back(updatedCoordinate); // make sure to check the new atom for dupes
           addAtom = mol.NewAtom();
           addAtom->Duplicate(atom);
           addAtom->SetVector(uc->FractionalToCartesian(updatedCoordinate));
@@ -229,85 +221,28 @@ namespace Avogadro {
     QCoreApplication::processEvents();
 
     m_molecule->blockSignals(true);
-    // Remove any bonds that may have snook in
-    foreach(Bond *b, m_molecule->bonds())
-      m_molecule->removeBond(b);
-
-    // Now duplicate the entire cell so that inter-cell bonding can be done
+    // Now duplicate the entire cell with its bonds, including the ones
+    // between neighbouring cells
     duplicateUnitCell();
     qDebug() << "Unit cell duplicated...";
-    m_molecule->update();
-
-    // Simpler version of connect the dots
-    connectTheDots();
-    qDebug() << "Dots connected...";
     m_molecule->blockSignals(false);
     m_molecule->updateMolecule();
   }
 
-  void SuperCellExtension::connectTheDots()
-  {
-    // Add single bonds between all atoms closer than their combined atomic
-    // covalent radii.
-    vector<double> rad;
-    NeighborList nbrs(m_molecule, 2.2);
-
-    rad.reserve(m_molecule->numAtoms());
-
-    foreach (Atom *atom, m_molecule->atoms())
-      rad.push_back(OpenBabel::etab.GetCovalentRad(atom->atomicNumber()));
-
-    foreach (Atom *atom1, m_molecule->atoms()) {
-      foreach (Atom *atom2, nbrs.nbrs(atom1)) {
-        if (m_molecule->bond(atom1, atom2))
-          continue;
-        if (atom1->isHydrogen() && atom2->isHydrogen())
-          continue;
-        // bonded if closer than elemental Rcov + tolerance
-        double cutoff = (rad[atom1->index()] + rad[atom2->index()] + 0.45)
-               * (rad[atom1->index()] + rad[atom2->index()] + 0.45);
-
-        double d2  = ((*atom1->pos()) - (*atom2->pos())).squaredNorm();
-
-        if (d2 > cutoff || d2 < 0.40)
-          continue;
-
-        Bond *bond = m_molecule->addBond();
-        bond->setAtoms(atom1->id(), atom2->id(), 1);
-      }
-      QCoreApplication::processEvents();
-    }
-  }
-
   void SuperCellExtension::duplicateUnitCell()
   {
     // Duplicates the entire unit cell the number of times specified
     std::vector<vector3> cellVectors = m_molecule->OBUnitCell()->GetCellVectors();
-    QList<Atom*> orig = m_molecule->atoms();
-    for (int a = 0; a < m_dialog->aCells(); ++a) {
-      for (int b = 0; b < m_dialog->bCells(); ++b)  {
-        for (int c = 0; c < m_dialog->cCells(); ++c)  {
-          // Do not copy the unit cell onto itself
-          if (a == 0 && b == 0 && c == 0) continue;
-          Eigen::Vector3d disp(
-                       cellVectors[0].x() * a
-                       + cellVectors[1].x() * b
-                       + cellVectors[2].x() * c,
-                       cellVectors[0].y() * a
-                       + cellVectors[1].y() * b
-                       + cellVectors[2].y() * c,
-                       cellVectors[0].z() * a
-                       + cellVectors[1].z() * b
-                       + cellVectors[2].z() * c );
-          foreach(Atom *atom, orig) {
-            Atom *newAtom = m_molecule->addAtom();
-            *newAtom = *atom;
-            newAtom->setPos((*atom->pos())+disp);
-          }
-        }
-        QCoreApplication::processEvents();
-      }
-    } // end of for loops
+    Eigen::Matrix3d cellMatrix;
+    for (int i = 0; i < 3; ++i)
+      cellMatrix.col(i) = OB2Eigen(cellVectors[i]);
+
+    // Simpler bonding routine for inorganics: bond the unit cell once, with
+    // its neighbouring cells, and copy the bonds into the supercell
+    SuperCellBuilder builder(m_molecule, cellMatrix);
+    builder.perceiveBonds(2.2);
+    builder.build(m_dialog->aCells(), m_dialog->bCells(), m_dialog->cCells());
+
     // Update the length of the unit cell
     cellParametersChanged(m_dialog->aCells(), m_dialog->bCells(),
                           m_dialog->cCells());
@@ -54,9 +54,7 @@ namespace Avogadro {
 
   private:
     void cellParametersChanged(double a, double b, double c);
-    //! Simpler bonding routine for inorganics
-    void connectTheDots();
-    //! Actually duplicate the unit cell to build a super cell
+    //! Actually duplicate the unit cell and its bonds to build a super cell
     void duplicateUnitCell();
 
     QList<QAction *> m_actions;
@@ -0,0 +1,259 @@
+/**********************************************************************
+  ESPMapper - Map the electrostatic potential onto the vertices of a mesh
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "espmapper.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/mesh.h>
+#include <avogadro/color3f.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <QtConcurrentMap>
+#include <QVector>
+#include <QDebug>
+
+using std::vector;
+using Eigen::Vector3f;
+using Eigen::Vector3i;
+
+namespace Avogadro
+{
+
+  struct ESPStruct
+  {
+    const ESPMapper *mapper;          // The atoms and the cells they are in
+    const vector<Vector3f> *vertices; // The vertices of the mesh
+    Color3f *colors;                  // The colors, one per vertex
+    unsigned int pos;                 // The index of the first vertex
+    unsigned int count;               // The number of vertices in the block
+  };
+
+  // Number of mesh vertices in each block
+  static const unsigned int BLOCK_SIZE = 1024;
+  // Atoms in each cell for the FullGrid summation, cells further away than
+  // their neighbors are replaced by their total charge
+  static const float ATOMS_PER_CELL = 32.0f;
+  // Smallest edge length of the cells atoms are binned into
+  static const float MIN_CELL_SIZE = 4.0f;
+
+  ESPMapper::ESPMapper() : m_summation(Truncated), m_cutoff(7.0),
+    m_cellSize(MIN_CELL_SIZE)
+  {
+  }
+
+  ESPMapper::~ESPMapper()
+  {
+  }
+
+  void ESPMapper::setAtoms(Molecule *mol)
+  {
+    const std::vector<int> &atomicNumbers = mol->atomicNumbers();
+    const std::vector<double> &partialCharges = mol->partialCharges();
+    const std::vector<Eigen::Vector3d> &positions = mol->atomPositions();
+
+    // Check to see if molecule has hydrogens
+    bool hasHydrogens = false;
+    foreach (Atom *atom, mol->atoms())
+      if (atomicNumbers[atom->id()] == 1) {
+        hasHydrogens = true;
+        break;
+      }
+
+    m_atomPos.resize(mol->numAtoms());
+    m_charges.resize(mol->numAtoms());
+    QList<Atom *> atoms = mol->atoms();
+    for (int i = 0; i < atoms.size(); ++i) {
+      const unsigned long id = atoms[i]->id();
+      m_atomPos[i] = positions[id].cast<float>();
+      m_charges[i] = partialCharges[id];
+      // Include formal charges when there are hydrogens
+      if (hasHydrogens)
+        m_charges[i] += atoms[i]->formalCharge();
+    }
+  }
+
+  void ESPMapper::binAtoms(float cellSize)
+  {
+    m_cellStart.clear();
+    m_cellAtoms.clear();
+    m_cellCharge.clear();
+    m_cellCenter.clear();
+    if (m_atomPos.empty())
+      return;
+
+    Vector3f min = m_atomPos[0], max = m_atomPos[0];
+    for (unsigned int i = 0; i < m_atomPos.size(); ++i) {
+      for (int j = 0; j < 3; ++j) {
+        min[j] = std::min(min[j], m_atomPos[i][j]);
+        max[j] = std::max(max[j], m_atomPos[i][j]);
+      }
+    }
+
+    // With no size given aim for a fixed number of atoms per cell, balancing
+    // the exact sum over the neighboring cells against the distant cells
+    Vector3f extent = max - min;
+    if (cellSize <= 0.0f) {
+      float volume = (extent.x() + 1.0f) * (extent.y() + 1.0f)
+          * (extent.z() + 1.0f);
+      cellSize = std::max(MIN_CELL_SIZE, static_cast<float>(
+                            pow(volume * ATOMS_PER_CELL / m_atomPos.size(),
+                                1.0 / 3.0)));
+    }
+    m_cellSize = cellSize;
+    m_cellMin = min;
+    for (int j = 0; j < 3; ++j)
+      m_cellDim[j] = static_cast<int>(extent[j] / m_cellSize) + 1;
+
+    // Counting sort of the atoms into their cells
+    unsigned int numCells = m_cellDim.x() * m_cellDim.y() * m_cellDim.z();
+    vector<unsigned int> cells(m_atomPos.size());
+    m_cellStart.resize(numCells + 1, 0);
+    for (unsigned int i = 0; i < m_atomPos.size(); ++i) {
+      Vector3i c;
+      for (int j = 0; j < 3; ++j)
+        c[j] = std::min(m_cellDim[j] - 1, static_cast<int>(
+                          (m_atomPos[i][j] - m_cellMin[j]) / m_cellSize));
+      cells[i] = c.x() + m_cellDim.x() * (c.y() + m_cellDim.y() * c.z());
+      ++m_cellStart[cells[i] + 1];
+    }
+    for (unsigned int i = 0; i < numCells; ++i)
+      m_cellStart[i + 1] += m_cellStart[i];
+    vector<unsigned int> next(m_cellStart.begin(), m_cellStart.end() - 1);
+    m_cellAtoms.resize(m_atomPos.size());
+    for (unsigned int i = 0; i < m_atomPos.size(); ++i)
+      m_cellAtoms[next[cells[i]]++] = i;
+
+    // The total charge and mean position of each cell
+    m_cellCharge.resize(numCells, 0.0f);
+    m_cellCenter.resize(numCells, Vector3f::Zero());
+    for (unsigned int i = 0; i < numCells; ++i) {
+      unsigned int count = m_cellStart[i + 1] - m_cellStart[i];
+      if (!count)
+        continue;
+      for (unsigned int j = m_cellStart[i]; j < m_cellStart[i + 1]; ++j) {
+        m_cellCharge[i] += m_charges[m_cellAtoms[j]];
+        m_cellCenter[i] += m_atomPos[m_cellAtoms[j]];
+      }
+      m_cellCenter[i] /= count;
+    }
+  }
+
+  void ESPMapper::calculate(Mesh *mesh)
+  {
+    // Cells the size of the cutoff only need the neighboring cells searched
+    if (m_summation == Truncated)
+      binAtoms(m_cutoff);
+    else if (m_summation == FullGrid)
+      binAtoms(0.0f);
+
+    const vector<Vector3f> &vertices = mesh->vertices();
+    Color3f *colors = mesh->resizeColors();
+    if (!colors)
+      return;
+
+    QVector<ESPStruct> blocks((vertices.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    for (int i = 0; i < blocks.size(); ++i) {
+      blocks[i].mapper = this;
+      blocks[i].vertices = &vertices;
+      blocks[i].colors = colors;
+      blocks[i].pos = i * BLOCK_SIZE;
+      blocks[i].count = std::min(BLOCK_SIZE,
+                                 static_cast<unsigned int>(vertices.size())
+                                 - i * BLOCK_SIZE);
+    }
+    QtConcurrent::blockingMap(blocks, ESPMapper::processBlock);
+  }
+
+  void ESPMapper::processBlock(ESPStruct &esp)
+  {
+    const ESPMapper *mapper = esp.mapper;
+    const vector<Vector3f> &atomPos = mapper->m_atomPos;
+    const vector<float> &charges = mapper->m_charges;
+    const Vector3i &dim = mapper->m_cellDim;
+    const float cutoffSquared = mapper->m_cutoff * mapper->m_cutoff;
+
+    for (unsigned int i = esp.pos; i < esp.pos + esp.count; ++i) {
+      const Vector3f &v = (*esp.vertices)[i];
+      float energy = 0.0f;
+
+      if (mapper->m_summation == Full) {
+        for (unsigned int a = 0; a < atomPos.size(); ++a)
+          energy += charges[a] / (atomPos[a] - v).squaredNorm();
+      }
+      else if (!atomPos.empty()) {
+        // The cells neighboring the vertex, which may lie outside the grid
+        Vector3i lo, hi;
+        for (int j = 0; j < 3; ++j) {
+          int c = static_cast<int>(floor((v[j] - mapper->m_cellMin[j])
+                                         / mapper->m_cellSize));
+          lo[j] = std::max(0, c - 1);
+          hi[j] = std::min(dim[j] - 1, c + 1);
+        }
+
+        // Atoms in the neighboring cells are summed exactly
+        for (int z = lo.z(); z <= hi.z(); ++z) {
+          for (int y = lo.y(); y <= hi.y(); ++y) {
+            for (int x = lo.x(); x <= hi.x(); ++x) {
+              unsigned int cell = x + dim.x() * (y + dim.y() * z);
+              for (unsigned int j = mapper->m_cellStart[cell];
+                   j < mapper->m_cellStart[cell + 1]; ++j) {
+                unsigned int a = mapper->m_cellAtoms[j];
+                float r2 = (atomPos[a] - v).squaredNorm();
+                if (mapper->m_summation == FullGrid || r2 < cutoffSquared)
+                  energy += charges[a] / r2;
+              }
+            }
+          }
+        }
+
+        // Any other cells are represented by their total charge
+        if (mapper->m_summation == FullGrid) {
+          for (int z = 0; z < dim.z(); ++z) {
+            for (int y = 0; y < dim.y(); ++y) {
+              for (int x = 0; x < dim.x(); ++x) {
+                if (x >= lo.x() && x <= hi.x() && y >= lo.y() && y <= hi.y()
+                    && z >= lo.z() && z <= hi.z())
+                  continue;
+                unsigned int cell = x + dim.x() * (y + dim.y() * z);
+                if (mapper->m_cellCharge[cell] != 0.0f)
+                  energy += mapper->m_cellCharge[cell]
+                      / (mapper->m_cellCenter[cell] - v).squaredNorm();
+              }
+            }
+          }
+        }
+      }
+
+      // Chemistry convention: red = negative, blue = positive, fading to
+      // white as the potential approaches zero
+      float saturation = std::min(1.0f, 5.0f * std::abs(energy));
+      if (energy < 0.0f)
+        esp.colors[i] = Color3f(1.0f, 1.0f - saturation, 1.0f - saturation);
+      else
+        esp.colors[i] = Color3f(1.0f - saturation, 1.0f - saturation, 1.0f);
+    }
+  }
+
+} // End namespace Avogadro
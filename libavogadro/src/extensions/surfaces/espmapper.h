@@ -0,0 +1,127 @@
+/**********************************************************************
+  ESPMapper - Map the electrostatic potential onto the vertices of a mesh
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef ESPMAPPER_H
+#define ESPMAPPER_H
+
+#include <Eigen/Core>
+#include <vector>
+
+/**
+ * @class ESPMapper espmapper.h
+ * @brief Color the vertices of a Mesh by the approximate ESP.
+ *
+ * The positions and charges of the atoms are copied into contiguous arrays
+ * and binned into a uniform grid of cells. The vertices of the Mesh are split
+ * into blocks that are colored in parallel using QtConcurrent::map, red for a
+ * negative potential and blue for a positive one.
+ */
+
+namespace Avogadro
+{
+
+  class Molecule;
+  class Mesh;
+  struct ESPStruct;
+
+  class ESPMapper
+  {
+  public:
+    /**
+     * The atoms included in the potential at each vertex.
+     */
+    enum Summation {
+      Truncated = 0, ///< Atoms within the cutoff distance of the vertex
+      Full,          ///< Every atom in the molecule
+      FullGrid       ///< Every atom, distant cells approximated by their charge
+    };
+
+    /**
+     * Constructor.
+     */
+    ESPMapper();
+
+    /**
+     * Destructor.
+     */
+    ~ESPMapper();
+
+    /**
+     * Copy the positions and charges of the atoms in the Molecule. Formal
+     * charges are included when the molecule has hydrogens.
+     */
+    void setAtoms(Molecule *mol);
+
+    /**
+     * Set the atoms included in the potential at each vertex, the default is
+     * Truncated.
+     */
+    void setSummation(Summation summation) { m_summation = summation; }
+
+    /**
+     * @return The atoms included in the potential at each vertex.
+     */
+    Summation summation() const { return m_summation; }
+
+    /**
+     * Set the cutoff distance used by the Truncated summation, the default is
+     * 7 Angstroms.
+     */
+    void setCutoff(double cutoff) { m_cutoff = cutoff; }
+
+    /**
+     * @return The cutoff distance used by the Truncated summation.
+     */
+    double cutoff() const { return m_cutoff; }
+
+    /**
+     * Calculate the ESP at each vertex of the Mesh and set its colors. This
+     * blocks until all of the vertices have been colored.
+     */
+    void calculate(Mesh *mesh);
+
+  private:
+    std::vector<Eigen::Vector3f> m_atomPos;
+    std::vector<float> m_charges;
+    Summation m_summation;
+    double m_cutoff;
+
+    // Atoms binned into a uniform grid of cells, x fastest
+    Eigen::Vector3f m_cellMin;
+    Eigen::Vector3i m_cellDim;
+    float m_cellSize;
+    std::vector<unsigned int> m_cellStart;      // Offsets into m_cellAtoms
+    std::vector<unsigned int> m_cellAtoms;      // Atom indices sorted by cell
+    std::vector<float> m_cellCharge;            // Total charge of each cell
+    std::vector<Eigen::Vector3f> m_cellCenter;  // Mean atom position of each cell
+
+    /// Bin the atoms into cells of the given size, or a size based on the
+    /// density of the atoms if it is zero
+    void binAtoms(float cellSize);
+
+    /// Re-entrant form of the calculation, colors a block of vertices
+    static void processBlock(ESPStruct &esp);
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -24,6 +24,7 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QFutureWatcher>
+#include <QtCore/QList>
 
 namespace OpenQube
 {
@@ -145,6 +146,30 @@ public:
    */
   virtual bool blockingCalculateCubeMO(Cube *cube, unsigned int mo = 1);
 
+  /**
+   * Calculate several MOs in a single pass over the supplied Cubes. The basis
+   * functions are evaluated once per point and shared by all of the MOs.
+   * @param cubes The cubes to write the values of the MOs into, these must
+   * all have the same limits and dimensions.
+   * @param mos The molecular orbital numbers to calculate, one per cube.
+   * @note This function starts a threaded calculation. Use watcher() to
+   * monitor progress.
+   * @sa blockingCalculateCubeMOs
+   * @return True if the calculation was successful.
+   */
+  virtual bool calculateCubeMOs(const QList<Cube *> &cubes,
+                                const QList<unsigned int> &mos) = 0;
+
+  /**
+   * Calculate several MOs in a single pass over the supplied Cubes.
+   * @param cubes The cubes to write the values of the MOs into.
+   * @param mos The molecular orbital numbers to calculate, one per cube.
+   * @sa calculateCubeMOs
+   * @return True if the calculation was successful.
+   */
+  virtual bool blockingCalculateCubeMOs(const QList<Cube *> &cubes,
+                                        const QList<unsigned int> &mos);
+
   /**
    * Calculate the electron density over the entire range of the supplied Cube.
    * @param cube The cube to write the values of the MO into.
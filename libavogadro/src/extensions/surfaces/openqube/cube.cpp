@@ -18,15 +18,41 @@
 
 #include "molecule.h"
 
+#include <QtCore/QtConcurrentMap>
 #include <QtCore/QReadWriteLock>
+#include <QtCore/QVector>
 #include <QtCore/QDebug>
 
+#include <algorithm>
+
 namespace OpenQube {
 
 using Eigen::Vector3i;
 using Eigen::Vector3f;
 using Eigen::Vector3d;
 
+// Number of values reduced by each task in Cube::updateMinMax
+static const unsigned int MIN_MAX_CHUNK_SIZE = 65536;
+
+struct MinMaxChunk
+{
+  const double *data;  // The first value of the chunk
+  unsigned int count;  // Number of values in the chunk
+  double min;
+  double max;
+};
+
+static void chunkMinMax(MinMaxChunk &chunk)
+{
+  chunk.min = chunk.max = chunk.data[0];
+  for (unsigned int i = 1; i < chunk.count; ++i) {
+    if (chunk.data[i] < chunk.min)
+      chunk.min = chunk.data[i];
+    else if (chunk.data[i] > chunk.max)
+      chunk.max = chunk.data[i];
+  }
+}
+
 Cube::Cube() : m_data(0),
   m_min(0.0, 0.0, 0.0), m_max(0.0, 0.0, 0.0), m_spacing(0.0, 0.0, 0.0),
   m_points(0, 0, 0), m_minValue(0.0), m_maxValue(0.0),
@@ -130,13 +156,7 @@ bool Cube::setData(const std::vector<double> &values)
     m_data = values;
     qDebug() << "Loaded in cube data" << m_data.size();
     // Now to update the minimum and maximum values
-    m_minValue = m_maxValue = m_data[0];
-    foreach(double val, m_data) {
-      if (val < m_minValue)
-        m_minValue = val;
-      else if (val > m_maxValue)
-        m_maxValue = val;
-    }
+    updateMinMax();
     return true;
   }
   else {
@@ -167,6 +187,45 @@ bool Cube::addData(const std::vector<double> &values)
   return true;
 }
 
+bool Cube::setValues(unsigned int start, unsigned int count,
+                     const double *values)
+{
+  if (start + count > m_data.size())
+    return false;
+  std::copy(values, values + count, m_data.begin() + start);
+  return true;
+}
+
+void Cube::updateMinMax()
+{
+  unsigned int size = m_data.size();
+  if (!size) {
+    m_minValue = m_maxValue = 0.0;
+    return;
+  }
+
+  QVector<MinMaxChunk> chunks((size + MIN_MAX_CHUNK_SIZE - 1)
+                              / MIN_MAX_CHUNK_SIZE);
+  for (int i = 0; i < chunks.size(); ++i) {
+    unsigned int start = i * MIN_MAX_CHUNK_SIZE;
+    chunks[i].data = &m_data[start];
+    chunks[i].count = qMin(MIN_MAX_CHUNK_SIZE, size - start);
+  }
+  if (chunks.size() > 1)
+    QtConcurrent::blockingMap(chunks, chunkMinMax);
+  else
+    chunkMinMax(chunks[0]);
+
+  m_minValue = chunks[0].min;
+  m_maxValue = chunks[0].max;
+  foreach (const MinMaxChunk &chunk, chunks) {
+    if (chunk.min < m_minValue)
+      m_minValue = chunk.min;
+    if (chunk.max > m_maxValue)
+      m_maxValue = chunk.max;
+  }
+}
+
 unsigned int Cube::closestIndex(const Vector3d &pos) const
 {
   int i, j, k;
@@ -184,11 +184,28 @@ public:
   bool setValue(int i, int j, int k, double value);
 
   /**
-   * Sets the value at the specified index in the cube.
+   * Sets the value at the specified index in the cube. This does not
+   * update the minimum and maximum values, call updateMinMax() once all
+   * of the values have been written.
    * @param i 1-dimenional index of the point to set in the cube.
    */
   bool setValue(unsigned int i, double value);
 
+  /**
+   * Sets @p count consecutive values starting at index @p start. Unlike
+   * setValue this does not update the minimum and maximum values, so it may
+   * be called concurrently for ranges that do not overlap. Call
+   * updateMinMax() once all of the values have been written.
+   * @return False if the range does not lie within the cube.
+   */
+  bool setValues(unsigned int start, unsigned int count, const double *values);
+
+  /**
+   * Recalculate the minimum and maximum values from the cube data. The data
+   * is split into chunks that are reduced in parallel.
+   */
+  void updateMinMax();
+
   /**
    * @return The minimum  value at any point in the Cube.
    */
@@ -227,10 +244,6 @@ inline bool Cube::setValue(unsigned int i, double value)
 {
   if (i < m_data.size()) {
     m_data[i] = value;
-    if (value > m_maxValue)
-      m_maxValue = value;
-    if (value < m_minValue)
-      m_minValue = value;
     return true;
   }
   else
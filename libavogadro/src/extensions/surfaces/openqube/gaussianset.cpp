@@ -26,6 +26,7 @@
 #include "cube.h"
 
 #include <cmath>
+#include <algorithm>
 
 #include <QtCore/QtConcurrentMap>
 #include <QtCore/QFuture>
@@ -44,13 +45,63 @@ struct GaussianShell
 {
   GaussianSet *set;  // A pointer to the GaussianSet, cannot write to member vars
   Cube *tCube;       // The target cube, used to initialise temp cubes too
-  unsigned int pos;  // The index ofposition of the point to calculate the MO for
-  unsigned int state;// The MO number to calculate
+  unsigned int pos;  // The index of the first point of the block to calculate
+  unsigned int count;// The number of points in the block
+  unsigned int state;// The MO number to calculate (0 for the density)
 };
 
 static const double BOHR_TO_ANGSTROM = 0.529177249;
 static const double ANGSTROM_TO_BOHR = 1.0 / BOHR_TO_ANGSTROM;
 
+// Number of grid points per task - small enough to keep a block in cache
+static const unsigned int BLOCK_SIZE = 512;
+// Shell contributions below this value are neglected
+static const double CUTOFF_THRESHOLD = 1.0e-10;
+
+// exp(-a r^2), skipping the exponential when it is negligible
+static inline double gtoExp(double ar2)
+{
+  return ar2 > 40.0 ? 0.0 : exp(-ar2);
+}
+
+// Number of independent components of the handled shell types
+static inline unsigned int numComponents(int type)
+{
+  switch (type) {
+  case S:
+    return 1;
+  case P:
+    return 3;
+  case D:
+    return 6;
+  case D5:
+    return 5;
+  case F:
+    return 10;
+  case F7:
+    return 7;
+  default:
+    return 0;
+  }
+}
+
+// Split the cube into blocks of BLOCK_SIZE points
+static QVector<GaussianShell> * cubeBlocks(GaussianSet *set, Cube *cube,
+                                           unsigned int state)
+{
+  unsigned int numPoints = cube->data()->size();
+  unsigned int numBlocks = (numPoints + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  QVector<GaussianShell> *blocks = new QVector<GaussianShell>(numBlocks);
+  for (unsigned int i = 0; i < numBlocks; ++i) {
+    (*blocks)[i].set = set;
+    (*blocks)[i].tCube = cube;
+    (*blocks)[i].pos = i * BLOCK_SIZE;
+    (*blocks)[i].count = qMin(BLOCK_SIZE, numPoints - i * BLOCK_SIZE);
+    (*blocks)[i].state = state;
+  }
+  return blocks;
+}
+
 GaussianSet::GaussianSet() : m_numMOs(0), m_numAtoms(0), m_init(false),
   m_cube(0), m_gaussianShells(0)
 {
@@ -175,15 +226,8 @@ bool GaussianSet::calculateCubeMO(Cube *cube, unsigned int state)
   // Must be called before calculations begin
   initCalculation();
 
-  // Set up the points we want to calculate the density at
-  m_gaussianShells = new QVector<GaussianShell>(cube->data()->size());
-
-  for (int i = 0; i < m_gaussianShells->size(); ++i) {
-    (*m_gaussianShells)[i].set = this;
-    (*m_gaussianShells)[i].tCube = cube;
-    (*m_gaussianShells)[i].pos = i;
-    (*m_gaussianShells)[i].state = state;
-  }
+  // Set up the blocks of points we want to calculate the MO at
+  m_gaussianShells = cubeBlocks(this, cube, state);
 
   // Lock the cube until we are done.
   cube->lock()->lockForWrite();
@@ -192,7 +236,52 @@ bool GaussianSet::calculateCubeMO(Cube *cube, unsigned int state)
   connect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
 
   // The main part of the mapped reduced function...
-  m_future = QtConcurrent::map(*m_gaussianShells, GaussianSet::processPoint);
+  m_future = QtConcurrent::map(*m_gaussianShells, GaussianSet::processPoints);
+  // Connect our watcher to our future
+  m_watcher.setFuture(m_future);
+
+  return true;
+}
+
+bool GaussianSet::calculateCubeMOs(const QList<Cube *> &cubes,
+                                   const QList<unsigned int> &states)
+{
+  if (cubes.isEmpty() || cubes.size() != states.size())
+    return false;
+
+  for (int i = 0; i < cubes.size(); ++i) {
+    if (states[i] < 1 || states[i] > static_cast<unsigned int>(m_moMatrix.rows()))
+      return false;
+    // All cubes share the grid of the first, and are only locked once
+    if (cubes[i]->dimensions() != cubes[0]->dimensions()
+        || cubes.count(cubes[i]) > 1) {
+      qDebug() << "Cubes for a multiple MO calculation must be distinct and"
+               << "share the same dimensions.";
+      return false;
+    }
+  }
+
+  // Must be called before calculations begin
+  initCalculation();
+
+  // Gather the coefficients of the requested MOs into one dense block
+  m_moBlock.resize(m_moMatrix.rows(), states.size());
+  for (int i = 0; i < states.size(); ++i)
+    m_moBlock.col(i) = m_moMatrix.col(states[i] - 1);
+  m_moCubes = cubes;
+
+  // The first cube provides the positions of the points
+  m_gaussianShells = cubeBlocks(this, cubes[0], 0);
+
+  // Lock the cubes until we are done.
+  foreach (Cube *cube, cubes)
+    cube->lock()->lockForWrite();
+
+  // Watch for the future
+  connect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
+
+  // The main part of the mapped reduced function...
+  m_future = QtConcurrent::map(*m_gaussianShells, GaussianSet::processMOs);
   // Connect our watcher to our future
   m_watcher.setFuture(m_future);
 
@@ -211,14 +300,8 @@ bool GaussianSet::calculateCubeDensity(Cube *cube)
   // Must be called before calculations begin
   initCalculation();
 
-  // Set up the points we want to calculate the density at
-  m_gaussianShells = new QVector<GaussianShell>(cube->data()->size());
-
-  for (int i = 0; i < m_gaussianShells->size(); ++i) {
-    (*m_gaussianShells)[i].set = this;
-    (*m_gaussianShells)[i].tCube = cube;
-    (*m_gaussianShells)[i].pos = i;
-  }
+  // Set up the blocks of points we want to calculate the density at
+  m_gaussianShells = cubeBlocks(this, cube, 0);
 
   // Lock the cube until we are done.
   cube->lock()->lockForWrite();
@@ -248,6 +331,7 @@ BasisSet * GaussianSet::clone()
   result->m_gtoCN = this->m_gtoCN;
   result->m_moMatrix = this->m_moMatrix;
   result->m_density = this->m_density;
+  result->m_cutoffDistances = this->m_cutoffDistances;
 
   result->m_numMOs = this->m_numMOs;
   result->m_numAtoms = this->m_numAtoms;
@@ -260,7 +344,17 @@ BasisSet * GaussianSet::clone()
 void GaussianSet::calculationComplete()
 {
   disconnect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
-  (*m_gaussianShells)[0].tCube->lock()->unlock();
+  if (m_moCubes.isEmpty()) {
+    (*m_gaussianShells)[0].tCube->updateMinMax();
+    (*m_gaussianShells)[0].tCube->lock()->unlock();
+  }
+  else {
+    foreach (Cube *cube, m_moCubes) {
+      cube->updateMinMax();
+      cube->lock()->unlock();
+    }
+    m_moCubes.clear();
+  }
   delete m_gaussianShells;
   m_gaussianShells = 0;
   emit finished();
@@ -435,135 +529,285 @@ void GaussianSet::initCalculation()
       qDebug() << "Basis set not handled - results may be incorrect.";
     }
   }
-  m_init = true;
-//  outputAll();
-}
-
-/// This is the stuff we actually use right now - porting to new data structure
-void GaussianSet::processPoint(GaussianShell &shell)
-{
-  GaussianSet *set = shell.set;
-  unsigned int atomsSize = set->m_numAtoms;
-  unsigned int basisSize = set->m_symmetry.size();
-  std::vector<int> &basis = set->m_symmetry;
-  vector<Vector3d> deltas;
-  vector<double> dr2;
-  deltas.reserve(atomsSize);
-  dr2.reserve(atomsSize);
-
-  unsigned int indexMO = shell.state-1;
 
-  // Calculate our position
-  Vector3d pos = shell.tCube->position(shell.pos) * ANGSTROM_TO_BOHR;
-
-  // Calculate the deltas for the position
-  for (unsigned int i = 0; i < atomsSize; ++i) {
-    deltas.push_back(pos - set->m_molecule.atomPos(i));
-    dr2.push_back(deltas[i].squaredNorm());
-  }
-
-  // Now calculate the value at this point in space
-  double tmp = 0.0;
-  for (unsigned int i = 0; i < basisSize; ++i) {
-    switch(basis[i]) {
+  // Radius beyond which the largest primitive of each shell, times r^l,
+  // drops below CUTOFF_THRESHOLD. Unhandled shells get a negative radius.
+  m_cutoffDistances.resize(m_symmetry.size());
+  for (unsigned int i = 0; i < m_symmetry.size(); ++i) {
+    int l;
+    switch (m_symmetry[i]) {
     case S:
-      tmp += pointS(shell.set, i,
-                    dr2[set->m_atomIndices[i]], indexMO);
+      l = 0;
       break;
     case P:
-      tmp += pointP(shell.set, i, deltas[set->m_atomIndices[i]],
-                    dr2[set->m_atomIndices[i]], indexMO);
+      l = 1;
       break;
     case D:
-      tmp += pointD(shell.set, i, deltas[set->m_atomIndices[i]],
-                    dr2[set->m_atomIndices[i]], indexMO);
-      break;
     case D5:
-      tmp += pointD5(shell.set, i, deltas[set->m_atomIndices[i]],
-                     dr2[set->m_atomIndices[i]], indexMO);
+      l = 2;
       break;
     case F:
-      tmp += pointF(shell.set, i, deltas[set->m_atomIndices[i]],
-                     dr2[set->m_atomIndices[i]], indexMO);
-      break;
     case F7:
-      tmp += pointF7(shell.set, i, deltas[set->m_atomIndices[i]],
-                     dr2[set->m_atomIndices[i]], indexMO);
+      l = 3;
       break;
     default:
-      // Not handled - return a zero contribution
-      ;
+      l = -1;
+    }
+    if (l < 0 || m_gtoIndices[i] == m_gtoIndices[i+1]) {
+      m_cutoffDistances[i] = -1.0;
+      continue;
     }
+
+    double maxC = 0.0;
+    double minA = m_gtoA[m_gtoIndices[i]];
+    unsigned int cIndex = m_cIndices[i];
+    unsigned int components = numComponents(m_symmetry[i]);
+    for (unsigned int j = m_gtoIndices[i]; j < m_gtoIndices[i+1]; ++j) {
+      minA = std::min(minA, m_gtoA[j]);
+      for (unsigned int k = 0; k < components; ++k)
+        maxC = std::max(maxC, fabs(m_gtoCN[cIndex++]));
+    }
+    double numGTOs = m_gtoIndices[i+1] - m_gtoIndices[i];
+
+    // Start at the maximum of r^l exp(-a r^2) and walk outwards
+    double r = sqrt(l / (2.0 * minA));
+    while (r < 100.0 && numGTOs * maxC * pow(r, l) * exp(-minA * r * r)
+           > CUTOFF_THRESHOLD)
+      r += 0.1;
+    m_cutoffDistances[i] = r * r;
   }
-  // Set the value
-  shell.tCube->setValue(shell.pos, tmp);
+
+  m_init = true;
+//  outputAll();
 }
 
-void GaussianSet::processDensity(GaussianShell &shell)
+void GaussianSet::screenBlock(const GaussianShell &shell,
+                              vector<Vector3d> &points,
+                              vector<unsigned int> &shells,
+                              vector<Vector3d> &centers)
 {
   GaussianSet *set = shell.set;
-  unsigned int atomsSize = set->m_numAtoms;
   unsigned int basisSize = set->m_symmetry.size();
-  unsigned int matrixSize = set->m_density.rows();
-  std::vector<int> &basis = set->m_symmetry;
-  vector<Vector3d> deltas;
-  vector<double> dr2;
-  deltas.reserve(atomsSize);
-  dr2.reserve(atomsSize);
-
-  // Calculate our position
-  Vector3d pos = shell.tCube->position(shell.pos) * ANGSTROM_TO_BOHR;
-  // Calculate the deltas for the position
-  for (unsigned int i = 0; i < atomsSize; ++i) {
-    deltas.push_back(pos - set->m_molecule.atomPos(i));
-    dr2.push_back(deltas[i].squaredNorm());
+
+  // Calculate the positions of the block and its bounding box
+  points.resize(shell.count);
+  Vector3d bMin, bMax;
+  for (unsigned int i = 0; i < shell.count; ++i) {
+    points[i] = shell.tCube->position(shell.pos + i) * ANGSTROM_TO_BOHR;
+    if (i == 0) {
+      bMin = bMax = points[i];
+      continue;
+    }
+    for (int j = 0; j < 3; ++j) {
+      bMin[j] = std::min(bMin[j], points[i][j]);
+      bMax[j] = std::max(bMax[j], points[i][j]);
+    }
   }
 
-  // Calculate the basis set values at this point
-  MatrixXd values(matrixSize, 1);
+  shells.clear();
+  centers.clear();
   for (unsigned int i = 0; i < basisSize; ++i) {
-    unsigned int cAtom = set->m_atomIndices[i];
-    switch(basis[i]) {
-    case S:
-      pointS(shell.set, dr2[cAtom], i, values);
-      break;
-    case P:
-      pointP(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-      break;
-    case D:
-      pointD(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-      break;
-    case D5:
-      pointD5(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-      break;
-    case F:
-      pointF(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-      break;
-    case F7:
-      pointF7(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-      break;
-    default:
-        qDebug() << " unhandled function !!!! ";
-      // Not handled - return a zero contribution
-      ;
+    if (set->m_cutoffDistances[i] < 0.0)
+      continue;
+
+    // For MOs, skip shells without significant coefficients
+    if (shell.state) {
+      unsigned int baseIndex = set->m_moIndices[i];
+      unsigned int components = numComponents(set->m_symmetry[i]);
+      bool small = true;
+      for (unsigned int j = 0; j < components && small; ++j)
+        small = isSmall(set->m_moMatrix.coeffRef(baseIndex + j, shell.state - 1));
+      if (small)
+        continue;
+    }
+
+    // Skip shells that are out of range for the whole block
+    Vector3d center = set->m_molecule.atomPos(set->m_atomIndices[i]);
+    double d2 = 0.0;
+    for (int j = 0; j < 3; ++j) {
+      double d = std::max(0.0, std::max(bMin[j] - center[j], center[j] - bMax[j]));
+      d2 += d * d;
     }
+    if (d2 > set->m_cutoffDistances[i])
+      continue;
+
+    shells.push_back(i);
+    centers.push_back(center);
   }
+}
+
+void GaussianSet::processPoints(GaussianShell &shell)
+{
+  GaussianSet *set = shell.set;
+  unsigned int indexMO = shell.state-1;
+
+  vector<Vector3d> points;
+  vector<unsigned int> shells;
+  vector<Vector3d> centers;
+  screenBlock(shell, points, shells, centers);
+  vector<double> block(shell.count);
+
+  for (unsigned int p = 0; p < shell.count; ++p) {
+    // Now calculate the value at this point in space
+    double tmp = 0.0;
+    for (unsigned int k = 0; k < shells.size(); ++k) {
+      unsigned int i = shells[k];
+      Vector3d delta = points[p] - centers[k];
+      double dr2 = delta.squaredNorm();
+      if (dr2 > set->m_cutoffDistances[i])
+        continue;
 
-  // Now calculate the value of the density at this point in space
-  double rho = 0.0;
-  for (unsigned int i = 0; i < matrixSize; ++i) {
-    // Calculate the off-diagonal parts of the matrix
-    for (unsigned int j = 0; j < i; ++j) {
-      rho += 2.0 * set->m_density.coeffRef(i, j)
-          * (values.coeffRef(i, 0) * values.coeffRef(j, 0));
+      switch(set->m_symmetry[i]) {
+      case S:
+        tmp += pointS(set, i, dr2, indexMO);
+        break;
+      case P:
+        tmp += pointP(set, i, delta, dr2, indexMO);
+        break;
+      case D:
+        tmp += pointD(set, i, delta, dr2, indexMO);
+        break;
+      case D5:
+        tmp += pointD5(set, i, delta, dr2, indexMO);
+        break;
+      case F:
+        tmp += pointF(set, i, delta, dr2, indexMO);
+        break;
+      case F7:
+        tmp += pointF7(set, i, delta, dr2, indexMO);
+        break;
+      default:
+        // Not handled - return a zero contribution
+        ;
+      }
     }
-    // Now calculate the matrix diagonal
-    rho += set->m_density.coeffRef(i, i)
-        * (values.coeffRef(i, 0) * values.coeffRef(i, 0));
+    block[p] = tmp;
   }
+  // Write the whole block at once, the limits are found when complete
+  shell.tCube->setValues(shell.pos, shell.count, &block[0]);
+}
+
+void GaussianSet::processDensity(GaussianShell &shell)
+{
+  GaussianSet *set = shell.set;
+  unsigned int matrixSize = set->m_density.rows();
+
+  vector<Vector3d> points;
+  vector<unsigned int> shells;
+  vector<Vector3d> centers;
+  screenBlock(shell, points, shells, centers);
+
+  // Basis function values, and the indices of the ones that were set
+  MatrixXd values(matrixSize, 1);
+  vector<unsigned int> indices;
+  indices.reserve(matrixSize);
+  vector<double> block(shell.count);
+
+  for (unsigned int p = 0; p < shell.count; ++p) {
+    // Calculate the basis set values at this point
+    indices.clear();
+    for (unsigned int k = 0; k < shells.size(); ++k) {
+      unsigned int i = shells[k];
+      Vector3d delta = points[p] - centers[k];
+      double dr2 = delta.squaredNorm();
+      if (dr2 > set->m_cutoffDistances[i])
+        continue;
 
-  // Set the value
-  shell.tCube->setValue(shell.pos, rho);
+      if (!pointBasis(set, delta, dr2, i, values))
+        continue;
+      unsigned int baseIndex = set->m_moIndices[i];
+      for (unsigned int j = 0; j < numComponents(set->m_symmetry[i]); ++j)
+        indices.push_back(baseIndex + j);
+    }
+
+    // Now calculate the value of the density at this point in space, only
+    // the basis functions in range contribute
+    double rho = 0.0;
+    for (unsigned int a = 0; a < indices.size(); ++a) {
+      unsigned int i = indices[a];
+      // Calculate the off-diagonal parts of the matrix
+      for (unsigned int b = 0; b < a; ++b) {
+        unsigned int j = indices[b];
+        rho += 2.0 * set->m_density.coeffRef(i, j)
+            * (values.coeffRef(i, 0) * values.coeffRef(j, 0));
+      }
+      // Now calculate the matrix diagonal
+      rho += set->m_density.coeffRef(i, i)
+          * (values.coeffRef(i, 0) * values.coeffRef(i, 0));
+    }
+
+    block[p] = rho;
+  }
+  // Write the whole block at once, the limits are found when complete
+  shell.tCube->setValues(shell.pos, shell.count, &block[0]);
+}
+
+void GaussianSet::processMOs(GaussianShell &shell)
+{
+  GaussianSet *set = shell.set;
+  unsigned int matrixSize = set->m_moBlock.rows();
+
+  vector<Vector3d> points;
+  vector<unsigned int> shells;
+  vector<Vector3d> centers;
+  screenBlock(shell, points, shells, centers);
+
+  // Basis function values for the whole block, one column per point
+  MatrixXd values(matrixSize, 1);
+  MatrixXd basis(matrixSize, shell.count);
+
+  for (unsigned int p = 0; p < shell.count; ++p) {
+    values.setZero();
+    for (unsigned int k = 0; k < shells.size(); ++k) {
+      unsigned int i = shells[k];
+      Vector3d delta = points[p] - centers[k];
+      double dr2 = delta.squaredNorm();
+      if (dr2 > set->m_cutoffDistances[i])
+        continue;
+      pointBasis(set, delta, dr2, i, values);
+    }
+    basis.col(p) = values;
+  }
+
+  // Apply the coefficients of all of the MOs in one matrix product
+  MatrixXd result = set->m_moBlock.transpose() * basis;
+
+  vector<double> block(shell.count);
+  for (int k = 0; k < set->m_moCubes.size(); ++k) {
+    for (unsigned int p = 0; p < shell.count; ++p)
+      block[p] = result.coeff(k, p);
+    set->m_moCubes[k]->setValues(shell.pos, shell.count, &block[0]);
+  }
+}
+
+inline bool GaussianSet::pointBasis(GaussianSet *set,
+                                    const Eigen::Vector3d &delta, double dr2,
+                                    unsigned int basis, Eigen::MatrixXd &out)
+{
+  switch(set->m_symmetry[basis]) {
+  case S:
+    pointS(set, dr2, basis, out);
+    break;
+  case P:
+    pointP(set, delta, dr2, basis, out);
+    break;
+  case D:
+    pointD(set, delta, dr2, basis, out);
+    break;
+  case D5:
+    pointD5(set, delta, dr2, basis, out);
+    break;
+  case F:
+    pointF(set, delta, dr2, basis, out);
+    break;
+  case F7:
+    pointF7(set, delta, dr2, basis, out);
+    break;
+  default:
+    // Not handled - return a zero contribution
+    return false;
+  }
+  return true;
 }
 
 inline double GaussianSet::pointS(GaussianSet *set, unsigned int moIndex,
@@ -579,7 +823,7 @@ inline double GaussianSet::pointS(GaussianSet *set, unsigned int moIndex,
   unsigned int cIndex = set->m_cIndices[moIndex];
   for (unsigned int i = set->m_gtoIndices[moIndex];
        i < set->m_gtoIndices[moIndex+1]; ++i) {
-    tmp += set->m_gtoCN[cIndex++] * exp(-set->m_gtoA[i] * dr2);
+    tmp += set->m_gtoCN[cIndex++] * gtoExp(set->m_gtoA[i] * dr2);
   }
   // There is one MO coefficient per S shell basis
   return tmp * set->m_moMatrix.coeffRef(set->m_moIndices[moIndex], indexMO);
@@ -598,7 +842,7 @@ inline double GaussianSet::pointP(GaussianSet *set, unsigned int moIndex,
   unsigned int cIndex = set->m_cIndices[moIndex];
   for (unsigned int i = set->m_gtoIndices[moIndex];
        i < set->m_gtoIndices[moIndex+1]; ++i) {
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
+    double tmpGTO = gtoExp(set->m_gtoA[i] * dr2);
     x += set->m_gtoCN[cIndex++] * delta.x() * tmpGTO;
     y += set->m_gtoCN[cIndex++] * delta.y() * tmpGTO;
     z += set->m_gtoCN[cIndex++] * delta.z() * tmpGTO;
@@ -626,7 +870,7 @@ inline double GaussianSet::pointD(GaussianSet *set, unsigned int moIndex,
   for (unsigned int i = set->m_gtoIndices[moIndex];
        i < set->m_gtoIndices[moIndex+1]; ++i) {
     // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
+    double tmpGTO = gtoExp(set->m_gtoA[i] * dr2);
     xx += set->m_gtoCN[cIndex++] * tmpGTO; // Dxx
     yy += set->m_gtoCN[cIndex++] * tmpGTO; // Dyy
     zz += set->m_gtoCN[cIndex++] * tmpGTO; // Dzz
@@ -674,7 +918,7 @@ inline double GaussianSet::pointF(GaussianSet *set, unsigned int moIndex,
   for (unsigned int i = set->m_gtoIndices[moIndex];
        i < set->m_gtoIndices[moIndex+1]; ++i) {
     // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
+    double tmpGTO = gtoExp(set->m_gtoA[i] * dr2);
     xxx += set->m_gtoCN[cIndex++] * tmpGTO;
     xxy += set->m_gtoCN[cIndex++] * tmpGTO;
     xxz += set->m_gtoCN[cIndex++] * tmpGTO;
@@ -727,7 +971,7 @@ inline double GaussianSet::pointD5(GaussianSet *set, unsigned int moIndex,
   for (unsigned int i = set->m_gtoIndices[moIndex];
        i < set->m_gtoIndices[moIndex+1]; ++i) {
     // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
+    double tmpGTO = gtoExp(set->m_gtoA[i] * dr2);
     d0  += set->m_gtoCN[cIndex++] * tmpGTO;
     d1p += set->m_gtoCN[cIndex++] * tmpGTO;
     d1n += set->m_gtoCN[cIndex++] * tmpGTO;
@@ -766,7 +1010,7 @@ inline double GaussianSet::pointF7(GaussianSet *set, unsigned int moIndex,
   for (unsigned int i = set->m_gtoIndices[moIndex];
        i < set->m_gtoIndices[moIndex+1]; ++i) {
     // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
+    double tmpGTO = gtoExp(set->m_gtoA[i] * dr2);
     f0  += set->m_gtoCN[cIndex++] * tmpGTO;
     f1p += set->m_gtoCN[cIndex++] * tmpGTO;
     f1n += set->m_gtoCN[cIndex++] * tmpGTO;
@@ -818,7 +1062,7 @@ inline void GaussianSet::pointS(GaussianSet *set, double dr2, int basis,
   unsigned int cIndex = set->m_cIndices[basis];
   for (unsigned int i = set->m_gtoIndices[basis];
        i < set->m_gtoIndices[basis+1]; ++i) {
-    tmp += set->m_gtoCN[cIndex++] * exp(-set->m_gtoA[i] * dr2);
+    tmp += set->m_gtoCN[cIndex++] * gtoExp(set->m_gtoA[i] * dr2);
   }
   out.coeffRef(set->m_moIndices[basis], 0) = tmp;
 }
@@ -833,7 +1077,7 @@ inline void GaussianSet::pointP(GaussianSet *set, const Vector3d &delta,
   unsigned int cIndex = set->m_cIndices[basis];
   for (unsigned int i = set->m_gtoIndices[basis];
        i < set->m_gtoIndices[basis+1]; ++i) {
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
+    double tmpGTO = gtoExp(set->m_gtoA[i] * dr2);
     x += set->m_gtoCN[cIndex++] * tmpGTO;
     y += set->m_gtoCN[cIndex++] * tmpGTO;
     z += set->m_gtoCN[cIndex++] * tmpGTO;
@@ -859,7 +1103,7 @@ inline void GaussianSet::pointD(GaussianSet *set, const Eigen::Vector3d &delta,
   for (unsigned int i = set->m_gtoIndices[basis];
        i < set->m_gtoIndices[basis+1]; ++i) {
     // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
+    double tmpGTO = gtoExp(set->m_gtoA[i] * dr2);
     xx += set->m_gtoCN[cIndex++] * tmpGTO; // Dxx
     yy += set->m_gtoCN[cIndex++] * tmpGTO; // Dyy
     zz += set->m_gtoCN[cIndex++] * tmpGTO; // Dzz
@@ -900,7 +1144,7 @@ inline void GaussianSet::pointF(GaussianSet *set, const Eigen::Vector3d &delta,
   for (unsigned int i = set->m_gtoIndices[basis];
        i < set->m_gtoIndices[basis+1]; ++i) {
     // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
+    double tmpGTO = gtoExp(set->m_gtoA[i] * dr2);
     xxx += set->m_gtoCN[cIndex++] * tmpGTO;
     xxy += set->m_gtoCN[cIndex++] * tmpGTO;
     xxz += set->m_gtoCN[cIndex++] * tmpGTO;
@@ -940,7 +1184,7 @@ inline void GaussianSet::pointD5(GaussianSet *set, const Eigen::Vector3d &delta,
   for (unsigned int i = set->m_gtoIndices[basis];
        i < set->m_gtoIndices[basis+1]; ++i) {
     // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
+    double tmpGTO = gtoExp(set->m_gtoA[i] * dr2);
     d0  += set->m_gtoCN[cIndex++] * tmpGTO;
     d1p += set->m_gtoCN[cIndex++] * tmpGTO;
     d1n += set->m_gtoCN[cIndex++] * tmpGTO;
@@ -978,7 +1222,7 @@ inline void GaussianSet::pointF7(GaussianSet *set, const Eigen::Vector3d &delta,
   for (unsigned int i = set->m_gtoIndices[basis];
        i < set->m_gtoIndices[basis+1]; ++i) {
     // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
+    double tmpGTO = gtoExp(set->m_gtoA[i] * dr2);
     f0  += set->m_gtoCN[cIndex++] * tmpGTO;
     f1p += set->m_gtoCN[cIndex++] * tmpGTO;
     f1n += set->m_gtoCN[cIndex++] * tmpGTO;
@@ -134,6 +134,20 @@ public:
    */
   bool calculateCubeMO(Cube *cube, unsigned int state = 1);
 
+  /**
+   * Calculate several MOs in one pass over the supplied Cubes. The basis
+   * functions are evaluated once for each block of points, and the block of
+   * MO coefficients is then applied as a single matrix product.
+   * @param cubes The cubes to write the MOs into, all of the same dimensions.
+   * @param states The MO numbers to calculate, one per cube.
+   * @note This function starts a threaded calculation. Use watcher()
+   * to monitor progress.
+   * @sa BasisSet::blockingCalculateCubeMOs
+   * @return True if the calculation was successful.
+   */
+  bool calculateCubeMOs(const QList<Cube *> &cubes,
+                        const QList<unsigned int> &states);
+
   /**
    * Calculate the electron density over the entire range of the supplied Cube.
    * @param cube The cube to write the values of the MO into.
@@ -179,6 +193,9 @@ private:
   std::vector<double> m_gtoCN;             //! The GTO contraction coefficient (normalized)
   Eigen::MatrixXd m_moMatrix;              //! MO coefficient matrix
   Eigen::MatrixXd m_density;               //! Density matrix
+  std::vector<double> m_cutoffDistances;   //! Squared radius where each shell becomes negligible
+  Eigen::MatrixXd m_moBlock;               //! MO coefficients for calculateCubeMOs
+  QList<Cube *> m_moCubes;                 //! Target cubes for calculateCubeMOs
 
   unsigned int m_numMOs;    //! The number of GTOs
   unsigned int m_numAtoms;  //! Total number of atoms in the basis set
@@ -192,9 +209,18 @@ private:
   static bool isSmall(double val);
 
   void initCalculation();  //! Perform initialisation before any calculations
-  /// Re-entrant single point forms of the calculations
-  static void processPoint(GaussianShell &shell);
+  /// Re-entrant forms of the calculations, each processes a block of points
+  static void processPoints(GaussianShell &shell);
   static void processDensity(GaussianShell &shell);
+  static void processMOs(GaussianShell &shell);
+  /// Calculate the density form basis values for one shell at one point
+  static bool pointBasis(GaussianSet *set, const Eigen::Vector3d &delta,
+                         double dr2, unsigned int basis, Eigen::MatrixXd &out);
+  /// Calculate the block positions and the shells that contribute to them
+  static void screenBlock(const GaussianShell &shell,
+                          std::vector<Eigen::Vector3d> &points,
+                          std::vector<unsigned int> &shells,
+                          std::vector<Eigen::Vector3d> &centers);
   static double pointS(GaussianSet *set, unsigned int moIndex,
                        double dr2, unsigned int indexMO);
   static double pointP(GaussianSet *set, unsigned int moIndex,
@@ -181,6 +181,60 @@ bool SlaterSet::calculateCubeMO(Cube *cube, unsigned int state)
   return true;
 }
 
+bool SlaterSet::calculateCubeMOs(const QList<Cube *> &cubes,
+                                 const QList<unsigned int> &states)
+{
+  if (cubes.isEmpty() || cubes.size() != states.size())
+    return false;
+
+  for (int i = 0; i < cubes.size(); ++i) {
+    if (states[i] < 1 || static_cast<int>(states[i]) > m_overlap.rows())
+      return false;
+    // All cubes share the grid of the first, and are only locked once
+    if (cubes[i]->dimensions() != cubes[0]->dimensions()
+        || cubes.count(cubes[i]) > 1) {
+      qDebug() << "Cubes for a multiple MO calculation must be distinct and"
+               << "share the same dimensions.";
+      return false;
+    }
+  }
+
+  if (!m_initialized)
+    initialize();
+
+  // Gather the coefficients of the requested MOs into one dense block
+  m_moBlock.resize(m_normalized.rows(), states.size());
+  for (int i = 0; i < states.size(); ++i)
+    m_moBlock.col(i) = m_normalized.col(states[i] - 1);
+  m_moCubes = cubes;
+
+  m_slaterShells.resize(cubes[0]->data()->size());
+
+  qDebug() << "Number of points:" << m_slaterShells.size()
+           << "MOs:" << states.size();
+
+  for (int i = 0; i < m_slaterShells.size(); ++i) {
+    m_slaterShells[i].set = this;
+    m_slaterShells[i].cube = cubes[0];
+    m_slaterShells[i].pos = i;
+    m_slaterShells[i].state = 0;
+  }
+
+  // Lock the cubes until we are done.
+  foreach (Cube *cube, cubes)
+    cube->lock()->lockForWrite();
+
+  // Watch for the future
+  connect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
+
+  // The main part of the mapped reduced function...
+  m_future = QtConcurrent::map(m_slaterShells, SlaterSet::processMOs);
+  // Connect our watcher to our future
+  m_watcher.setFuture(m_future);
+
+  return true;
+}
+
 bool SlaterSet::calculateCubeDensity(Cube *cube)
 {
   // Set up the calculation and ideally use the new QtConcurrent code to
@@ -241,7 +295,17 @@ void SlaterSet::calculationComplete()
   disconnect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
   qDebug() << m_slaterShells[0].cube->data()->at(0) << m_slaterShells[0].cube->data()->at(1);
   qDebug() << "Calculation complete - cube map...";
-  m_slaterShells[0].cube->lock()->unlock();
+  if (m_moCubes.isEmpty()) {
+    m_slaterShells[0].cube->updateMinMax();
+    m_slaterShells[0].cube->lock()->unlock();
+  }
+  else {
+    foreach (Cube *cube, m_moCubes) {
+      cube->updateMinMax();
+      cube->lock()->unlock();
+    }
+    m_moCubes.clear();
+  }
 }
 
 bool SlaterSet::initialize()
@@ -341,7 +405,7 @@ void SlaterSet::processPoint(SlaterShell &shell)
                        dr[set->m_slaterIndices[i]], i, indexMO);
   }
   // Set the value
-  shell.cube->setValue(shell.pos, tmp);
+  shell.cube->setValues(shell.pos, 1, &tmp);
 }
 
 void SlaterSet::processDensity(SlaterShell &shell)
@@ -391,7 +455,42 @@ void SlaterSet::processDensity(SlaterShell &shell)
     rho += set->m_density.coeffRef(i, i) * (tmp*tmp);
   }
   // Set the value
-  shell.cube->setValue(shell.pos, rho);
+  shell.cube->setValues(shell.pos, 1, &rho);
+}
+
+void SlaterSet::processMOs(SlaterShell &shell)
+{
+  SlaterSet *set = shell.set;
+  unsigned int atomsSize = set->m_atomPos.size();
+  unsigned int basisSize = set->m_zetas.size();
+
+  vector<Vector3d> deltas;
+  vector<double> dr;
+  deltas.reserve(atomsSize);
+  dr.reserve(atomsSize);
+
+  // Calculate our position
+  Vector3d pos = shell.cube->position(shell.pos);
+
+  // Calculate the deltas for the position
+  for (unsigned int i = 0; i < atomsSize; ++i) {
+    deltas.push_back(pos - set->m_atomPos[i]);
+    dr.push_back(deltas[i].norm());
+  }
+
+  // Evaluate each STO once, then apply all of the MO coefficients together
+  MatrixXd values(1, basisSize);
+  for (unsigned int i = 0; i < basisSize; ++i) {
+    values.coeffRef(0, i) = calcSlater(set, deltas[set->m_slaterIndices[i]],
+                                       dr[set->m_slaterIndices[i]], i);
+  }
+  MatrixXd result = values * set->m_moBlock;
+
+  // Set the values
+  for (int k = 0; k < set->m_moCubes.size(); ++k) {
+    double tmp = result.coeff(0, k);
+    set->m_moCubes[k]->setValues(shell.pos, 1, &tmp);
+  }
 }
 
 inline double SlaterSet::pointSlater(SlaterSet *set, const Eigen::Vector3d &delta,
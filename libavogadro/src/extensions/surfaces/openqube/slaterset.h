@@ -128,6 +128,15 @@ public:
 
   bool calculateCubeMO(Cube *cube, unsigned int state = 1);
 
+  /**
+   * Calculate several MOs in one pass over the supplied Cubes, evaluating
+   * the STOs once per point for all of the MOs.
+   * @param cubes The cubes to write the MOs into, all of the same dimensions.
+   * @param states The MO numbers to calculate, one per cube.
+   */
+  bool calculateCubeMOs(const QList<Cube *> &cubes,
+                        const QList<unsigned int> &states);
+
   bool calculateCubeDensity(Cube *cube);
 
   QFutureWatcher<void> & watcher() { return m_watcher; }
@@ -155,6 +164,8 @@ private:
   Eigen::MatrixXd m_eigenVectors;
   Eigen::MatrixXd m_density;
   Eigen::MatrixXd m_normalized;
+  Eigen::MatrixXd m_moBlock;   // MO coefficients for calculateCubeMOs
+  QList<Cube *> m_moCubes;     // Target cubes for calculateCubeMOs
   bool m_initialized;
 
   QFuture<void> m_future;
@@ -169,6 +180,7 @@ private:
 
   static void processPoint(SlaterShell &shell);
   static void processDensity(SlaterShell &shell);
+  static void processMOs(SlaterShell &shell);
   static double pointSlater(SlaterSet *set, const Eigen::Vector3d &delta,
                             double dr2, unsigned int slater,
                             unsigned int indexMO);
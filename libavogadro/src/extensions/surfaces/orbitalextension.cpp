@@ -43,6 +43,7 @@
 
 #include <QDir>
 #include <QFileInfo>
+#include <QMultiMap>
 #include <QMessageBox>
 
 using OpenQube::BasisSet;
@@ -53,6 +54,9 @@ using OpenQube::GAMESSUSOutput;
 namespace Avogadro
 {
 
+  // Maximum number of orbitals calculated in one pass over the grid
+  static const int MaxBatchSize = 8;
+
   OrbitalExtension::OrbitalExtension(QObject* parent) :
     DockExtension(parent),
     m_dock(0),
@@ -61,8 +65,7 @@ namespace Avogadro
     m_currentRunningCalculation(-1),
     m_meshGen(0),
     m_basis(0),
-    m_molecule(0),
-    m_qube(0)
+    m_molecule(0)
   {
     QAction* action = new QAction(this);
     action->setText(tr("Molecular Orbitals..."));
@@ -459,6 +462,7 @@ namespace Avogadro
     newCalc.isovalue = isovalue;
     newCalc.priority = priority;
     newCalc.state = NotStarted;
+    newCalc.cube = 0;
 
     // Add new calculation
     m_queue.append(newCalc);
@@ -501,6 +505,12 @@ namespace Avogadro
 
     info->state = Running;
 
+    // The cube may have been calculated alongside another orbital already
+    if (info->cube) {
+      calculatePosMesh();
+      return;
+    }
+
     // Check if the cube we want already exists
     for (int i = 0; i < m_queue.size(); i++) {
       calcInfo *cI = &m_queue[i];
@@ -516,20 +526,55 @@ namespace Avogadro
       }
     }
 
-    // Create new cube
-    Cube *cube = m_molecule->addCube();
-    info->cube = cube;
-    cube->setLimits(m_molecule, info->resolution, 2.5);
-
-    if (m_qube) {
-      delete m_qube;
-      m_qube = 0;
+    // Precalculated orbitals at the same resolution are calculated together,
+    // sharing the evaluation of the basis set over the grid. Those closest
+    // to the HOMO/LUMO (lowest priority values) are batched first.
+    m_qubeTargets.clear();
+    m_qubeTargets.append(m_currentRunningCalculation);
+    if (info->priority > 0) {
+      QList<unsigned int> orbitals;
+      orbitals.append(info->orbital);
+      QMultiMap<unsigned int, int> candidates;
+      for (int i = 0; i < m_queue.size(); ++i) {
+        const calcInfo &cI = m_queue.at(i);
+        if (cI.state == NotStarted && cI.priority > 0 && !cI.cube &&
+            cI.resolution == info->resolution)
+          candidates.insert(cI.priority, i);
+      }
+      QMultiMap<unsigned int, int>::const_iterator it = candidates.constBegin();
+      for (; it != candidates.constEnd() && m_qubeTargets.size() < MaxBatchSize;
+           ++it) {
+        if (orbitals.contains(m_queue.at(it.value()).orbital))
+          continue;
+        orbitals.append(m_queue.at(it.value()).orbital);
+        m_qubeTargets.append(it.value());
+      }
     }
 
-    m_qube = new OpenQube::Cube;
-    m_qube->setLimits(cube->min(), cube->max(), cube->dimensions());
+    qDeleteAll(m_qubes);
+    m_qubes.clear();
+
+    QList<unsigned int> mos;
+    foreach (int index, m_qubeTargets) {
+      // Create new cube
+      calcInfo *target = &m_queue[index];
+      Cube *cube = m_molecule->addCube();
+      target->cube = cube;
+      // Precalculated orbitals can pile up, store them in single precision
+      if (target->priority > 0)
+        cube->setSinglePrecision(true);
+      cube->setLimits(m_molecule, target->resolution, 2.5);
+
+      OpenQube::Cube *qube = new OpenQube::Cube;
+      qube->setLimits(cube->min(), cube->max(), cube->dimensions());
+      m_qubes.append(qube);
+      mos.append(target->orbital);
+    }
 
-    m_basis->calculateCubeMO(m_qube, info->orbital);
+    if (m_qubes.size() == 1)
+      m_basis->calculateCubeMO(m_qubes.first(), info->orbital);
+    else
+      m_basis->calculateCubeMOs(m_qubes, mos);
     connect(&m_basis->watcher(), SIGNAL(finished()),
             this, SLOT(calculateCubeDone()));
 
@@ -554,11 +599,11 @@ namespace Avogadro
                this, 0);
 
     // Convert the cube data
-    if (m_qube) {
-      info->cube->setData(*m_qube->data());
-      delete m_qube;
-      m_qube = 0;
-    }
+    for (int i = 0; i < m_qubes.size(); ++i)
+      m_queue[m_qubeTargets.at(i)].cube->setData(*m_qubes.at(i)->data());
+    qDeleteAll(m_qubes);
+    m_qubes.clear();
+    m_qubeTargets.clear();
 
     calculatePosMesh();
   }
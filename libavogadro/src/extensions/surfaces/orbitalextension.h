@@ -177,7 +177,8 @@ namespace Avogadro
     OpenQube::BasisSet *m_basis;
     QList<QAction *> m_actions;
     Molecule *m_molecule;
-    OpenQube::Cube *m_qube;
+    QList<OpenQube::Cube *> m_qubes;
+    QList<int> m_qubeTargets; // Queue indices the cubes in m_qubes belong to
     QTime m_time;
   };
 
@@ -141,6 +141,17 @@ namespace Avogadro {
       return -1;
   }
 
+  ESPMapper::Summation SurfaceDialog::espSummation()
+  {
+    // The combo items are in the order of the enum
+    return static_cast<ESPMapper::Summation>(ui.espCombo->currentIndex());
+  }
+
+  void SurfaceDialog::setESPSummation(ESPMapper::Summation summation)
+  {
+    ui.espCombo->setCurrentIndex(summation);
+  }
+
   unsigned long SurfaceDialog::cubeFromFile() {
     if (m_surfaceTypes.at(ui.surfaceCombo->currentIndex()) == Cube::FromFile) {
       // Iterate through the cubes to find the loaded cube that is current
@@ -354,8 +365,10 @@ namespace Avogadro {
 
   void SurfaceDialog::colorByComboChanged(int n)
   {
-    if (m_colorTypes.size() > 0 && n >= 0 && n < m_colorTypes.size())
+    if (m_colorTypes.size() > 0 && n >= 0 && n < m_colorTypes.size()) {
       ui.moColorCombo->setEnabled(m_colorTypes.at(n) == Cube::MO);
+      ui.espCombo->setEnabled(m_colorTypes.at(n) == Cube::ESP);
+    }
   }
 
   void SurfaceDialog::resolutionComboChanged(int n)
@@ -30,6 +30,7 @@
 #include <QDialog>
 
 #include "ui_surfacedialog.h"
+#include "espmapper.h"
 
 #include <avogadro/cube.h>
 
@@ -76,6 +77,16 @@ namespace Avogadro
      */
     int moColorNumber();
 
+    /**
+     * @return the atoms summed when coloring by the ESP.
+     */
+    ESPMapper::Summation espSummation();
+
+    /**
+     * Set the atoms summed when coloring by the ESP.
+     */
+    void setESPSummation(ESPMapper::Summation summation);
+
     /**
      * In the case of Cube objects that were loaded, return the cube id
      */
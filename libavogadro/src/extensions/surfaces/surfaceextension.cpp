@@ -31,6 +31,7 @@
 #include <openqube/cube.h>
 
 #include "vdwsurface.h"
+#include "espmapper.h"
 #include "surfacedialog.h"
 
 #include <vector>
@@ -42,7 +43,6 @@
 #include <avogadro/color3f.h>
 #include <avogadro/meshgenerator.h>
 #include <avogadro/engine.h>
-#include <avogadro/neighborlist.h>
 #include <avogadro/glwidget.h>
 
 #include <Eigen/Core>
@@ -66,7 +66,7 @@ namespace Avogadro
   SurfaceExtension::SurfaceExtension(QObject* parent) : Extension(parent),
     m_glwidget(0), m_surfaceDialog(0), m_molecule(0), m_basis(0), m_progress(0),
     m_mesh1(0), m_mesh2(0), m_meshGen1(0), m_meshGen2(0), m_VdWsurface(0),
-    m_cube(0), m_qube(0), m_cubeColor(0)
+    m_cube(0), m_qube(0), m_cubeColor(0), m_espSummation(ESPMapper::Truncated)
   {
     QAction* action = new QAction(this);
     action->setText(tr("Create Surfaces..."));
@@ -95,6 +95,20 @@ namespace Avogadro
     return tr("E&xtensions");
   }
 
+  void SurfaceExtension::writeSettings(QSettings &settings) const
+  {
+    Extension::writeSettings(settings);
+    settings.setValue("espSummation", static_cast<int>(m_espSummation));
+  }
+
+  void SurfaceExtension::readSettings(QSettings &settings)
+  {
+    Extension::readSettings(settings);
+    int summation = settings.value("espSummation", ESPMapper::Truncated).toInt();
+    if (summation >= ESPMapper::Truncated && summation <= ESPMapper::FullGrid)
+      m_espSummation = static_cast<ESPMapper::Summation>(summation);
+  }
+
   QUndoCommand* SurfaceExtension::performAction(QAction *, GLWidget *widget)
   {
     m_glwidget = widget;
@@ -102,6 +116,7 @@ namespace Avogadro
       m_surfaceDialog = new SurfaceDialog(qobject_cast<QWidget *>(parent()));
       m_surfaceDialog->setGLWidget(widget);
       m_surfaceDialog->setMolecule(m_molecule);
+      m_surfaceDialog->setESPSummation(m_espSummation);
       connect(m_surfaceDialog, SIGNAL(calculate()), this, SLOT(calculate()));
       loadBasis();
       m_surfaceDialog->show();
@@ -202,61 +217,12 @@ namespace Avogadro
     if (!m_molecule)
       return;
 
-    // Check to see if molecule has hydrogens
-    bool hasHydrogens = false;
-    foreach (Atom *atom, m_molecule->atoms())
-      if (atom->atomicNumber() == 1) {
-        hasHydrogens = true;
-        break;
-      }
-
-    NeighborList *nbrList = new NeighborList(m_molecule, 7.0, false, 2);
-
-    std::vector<Color3f> colors;
-    for(unsigned int i=0; i < mesh->vertices().size(); ++i) {
-      const Vector3f *v = mesh->vertex(i);
-
-      double energy = 0.0;
-
-      QList<Atom*> nbrAtoms = nbrList->nbrs(v);
-      // Include formal charges when there are hydrogens
-      if (hasHydrogens) {
-        foreach(Atom *a, nbrAtoms) {
-          Vector3f dist = a->pos()->cast<float>() - v->cast<float>();
-          energy += (a->formalCharge() + a->partialCharge()) / dist.squaredNorm();
-        }
-      } else {
-        foreach(Atom *a, nbrAtoms) {
-          Vector3f dist = a->pos()->cast<float>() - v->cast<float>();
-          energy += a->partialCharge() / dist.squaredNorm();
-        }
-      }
-
-      // Chemistry convention: red = negative, blue = positive
-      //
-      // Use HSV color model for smooth transitions
-      int red_hue = 0;
-      int blue_hue = 240;
-      int hue = 0; // meaningless if gray (i.e. low saturation)
-      int saturation = 0; // 0 = white, 0-40 = grayish, 40-255 colors from hue
-      int value = 255; // lightness or brightness (0 = black, 255 = white)
-
-      if (energy < 0.0) {
-        hue = red_hue;
-        saturation = -255 * 5 * energy;
-      } else if (energy > 0.0) {
-        hue = blue_hue;
-        saturation = 255 * 5 * energy;
-      }
-
-      if (saturation > 255)
-        saturation = 255;
-
-      QColor qcolor(QColor::fromHsv(hue, saturation, value));
-      Color3f color(qcolor.red(), qcolor.green(), qcolor.blue());
-      colors.push_back(color);
-    }
-    mesh->setColors(colors);
+    // Remember the choice for the next session
+    m_espSummation = m_surfaceDialog->espSummation();
+    ESPMapper mapper;
+    mapper.setSummation(m_espSummation);
+    mapper.setAtoms(m_molecule);
+    mapper.calculate(mesh);
   }
 
   Cube * SurfaceExtension::newCube()
@@ -26,6 +26,7 @@
 #define SURFACEEXTENSION_H
 
 #include "surfacedialog.h"
+#include "espmapper.h"
 
 #include <avogadro/extension.h>
 
@@ -66,6 +67,18 @@ namespace Avogadro
 
     void setMolecule(Molecule *molecule);
 
+    /**
+     * Save the settings for this extension.
+     * @param settings Settings variable to write settings to.
+     */
+    virtual void writeSettings(QSettings &settings) const;
+
+    /**
+     * Read the settings for this extension.
+     * @param settings Settings variable to read settings from.
+     */
+    virtual void readSettings(QSettings &settings);
+
   private:
     QList<unsigned long> m_cubes; // These are the standard cubes
     QVector<unsigned long> m_moCubes; // These are the MO cubes
@@ -88,11 +101,14 @@ namespace Avogadro
     OpenQube::Cube *m_qube;
     Cube *m_cubeColor;
 
+    // The atoms summed when mapping the ESP onto a mesh
+    ESPMapper::Summation m_espSummation;
+
     //! Load the appropriate basis set (if possible)
     bool loadBasis();
 
     //! Calculate the ESP from the partial charges of the atoms on the supplied
-    //! Mesh object.
+    //! Mesh object, the vertices are colored in parallel.
     void calculateESP(Mesh *mesh);
 
     //! Convenience function - creates a new cube with the correct dimensions.
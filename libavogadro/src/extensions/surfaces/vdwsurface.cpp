@@ -34,6 +34,7 @@
 #include <openbabel/mol.h>
 
 #include <cmath>
+#include <algorithm>
 
 #include <QtConcurrentMap>
 #include <QFuture>
@@ -49,13 +50,18 @@ namespace Avogadro
 {
   struct VdWStruct
   {
-    vector<Vector3d> *atomPos;
-    vector<double> *atomRadius;
-    Cube *cube;       // The target cube, used to initialise temp cubes too
-    unsigned int pos;  // The index ofposition of the point to calculate the MO for
+    const VdWSurface *surface; // The atoms and the cells they are binned in
+    Cube *cube;         // The target cube, used to initialise temp cubes too
+    unsigned int pos;   // The index of the first point of the block
+    unsigned int count; // The number of points in the block
   };
 
-  VdWSurface::VdWSurface()
+  // Number of cube points in each block
+  static const unsigned int BLOCK_SIZE = 512;
+  // Smallest edge length of the cells atoms are binned into
+  static const double MIN_CELL_SIZE = 4.0;
+
+  VdWSurface::VdWSurface() : m_cellSize(MIN_CELL_SIZE), m_maxRadius(0.0)
   {
   }
 
@@ -94,17 +100,65 @@ namespace Avogadro
     }
   }
 
+  void VdWSurface::binAtoms()
+  {
+    m_cellStart.clear();
+    m_cellAtoms.clear();
+    if (m_atomPos.empty())
+      return;
+
+    Vector3d min = m_atomPos[0], max = m_atomPos[0];
+    m_maxRadius = 0.0;
+    for (unsigned int i = 0; i < m_atomPos.size(); ++i) {
+      for (int j = 0; j < 3; ++j) {
+        min[j] = std::min(min[j], m_atomPos[i][j]);
+        max[j] = std::max(max[j], m_atomPos[i][j]);
+      }
+      m_maxRadius = std::max(m_maxRadius, m_atomRadius[i]);
+    }
+
+    // Aim for a few atoms per cell, without the cells getting too small
+    Vector3d extent = max - min;
+    double volume = (extent.x() + 1.0) * (extent.y() + 1.0) * (extent.z() + 1.0);
+    m_cellSize = std::max(MIN_CELL_SIZE, pow(volume / m_atomPos.size(), 1.0 / 3.0));
+    m_cellMin = min;
+    for (int j = 0; j < 3; ++j)
+      m_cellDim[j] = static_cast<int>(extent[j] / m_cellSize) + 1;
+
+    // Counting sort of the atoms into their cells
+    unsigned int numCells = m_cellDim.x() * m_cellDim.y() * m_cellDim.z();
+    vector<unsigned int> cells(m_atomPos.size());
+    m_cellStart.resize(numCells + 1, 0);
+    for (unsigned int i = 0; i < m_atomPos.size(); ++i) {
+      Vector3i c;
+      for (int j = 0; j < 3; ++j)
+        c[j] = std::min(m_cellDim[j] - 1, static_cast<int>(
+                          (m_atomPos[i][j] - m_cellMin[j]) / m_cellSize));
+      cells[i] = c.x() + m_cellDim.x() * (c.y() + m_cellDim.y() * c.z());
+      ++m_cellStart[cells[i] + 1];
+    }
+    for (unsigned int i = 0; i < numCells; ++i)
+      m_cellStart[i + 1] += m_cellStart[i];
+    vector<unsigned int> next(m_cellStart.begin(), m_cellStart.end() - 1);
+    m_cellAtoms.resize(m_atomPos.size());
+    for (unsigned int i = 0; i < m_atomPos.size(); ++i)
+      m_cellAtoms[next[cells[i]]++] = i;
+  }
+
   void VdWSurface::calculateCube(Cube *cube)
   {
+    binAtoms();
+
     // Set up the calculation and ideally use the new QtConcurrent code to
-    m_VdWvector.resize(cube->data()->size());
+    unsigned int numPoints = cube->data()->size();
+    m_VdWvector.resize((numPoints + BLOCK_SIZE - 1) / BLOCK_SIZE);
     m_cube = cube;
 
     for (int i = 0; i < m_VdWvector.size(); ++i) {
-      m_VdWvector[i].atomPos = &m_atomPos;
-      m_VdWvector[i].atomRadius = &m_atomRadius;
+      m_VdWvector[i].surface = this;
       m_VdWvector[i].cube = cube;
-      m_VdWvector[i].pos = i;
+      m_VdWvector[i].pos = i * BLOCK_SIZE;
+      m_VdWvector[i].count = std::min(BLOCK_SIZE, numPoints - i * BLOCK_SIZE);
     }
 
     // Lock the cube until we are done.
@@ -114,7 +168,7 @@ namespace Avogadro
     connect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
 
     // The main part of the mapped reduced function...
-    m_future = QtConcurrent::map(m_VdWvector, VdWSurface::processPoint);
+    m_future = QtConcurrent::map(m_VdWvector, VdWSurface::processBlock);
     // Connect our watcher to our future
     m_watcher.setFuture(m_future);
   }
@@ -122,25 +176,120 @@ namespace Avogadro
   void VdWSurface::calculationComplete()
   {
     disconnect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
+    m_cube->updateMinMax();
     m_cube->lock()->unlock();
     m_cube->update();
   }
 
-  void VdWSurface::processPoint(VdWStruct &vdw)
+  void VdWSurface::processBlock(VdWStruct &vdw)
   {
-    unsigned int size = vdw.atomPos->size();
-    // Calculate our position
-    Vector3d pos = vdw.cube->position(vdw.pos);
-
-    // Now calculate the value at this point in space
-    double tmp = -1.0E+10;
-    for (unsigned int i = 0; i < size; ++i) {
-      double distance = std::abs((pos - (*vdw.atomPos)[i]).norm()) - (*vdw.atomRadius)[i];
-      if ((tmp < -1.0E+9) || (distance < tmp))
-        tmp = distance;
+    const VdWSurface *surface = vdw.surface;
+    const vector<Vector3d> &atomPos = surface->m_atomPos;
+    const vector<double> &atomRadius = surface->m_atomRadius;
+    vector<double> values(vdw.count, -1.0E+10);
+
+    if (atomPos.empty()) {
+      vdw.cube->setValues(vdw.pos, vdw.count, &values[0]);
+      return;
+    }
+
+    // Calculate the positions and bounding box of the block
+    vector<Vector3d> points(vdw.count);
+    Vector3d bMin, bMax;
+    for (unsigned int i = 0; i < vdw.count; ++i) {
+      points[i] = vdw.cube->position(vdw.pos + i);
+      if (i == 0) {
+        bMin = bMax = points[i];
+        continue;
+      }
+      for (int j = 0; j < 3; ++j) {
+        bMin[j] = std::min(bMin[j], points[i][j]);
+        bMax[j] = std::max(bMax[j], points[i][j]);
+      }
+    }
+
+    // The cells overlapping the block, clamped to the grid
+    Vector3i lo, hi;
+    for (int j = 0; j < 3; ++j) {
+      double size = surface->m_cellSize;
+      int last = surface->m_cellDim[j] - 1;
+      lo[j] = static_cast<int>(floor((bMin[j] - surface->m_cellMin[j]) / size));
+      hi[j] = static_cast<int>(floor((bMax[j] - surface->m_cellMin[j]) / size));
+      lo[j] = std::max(0, std::min(last, lo[j]));
+      hi[j] = std::max(0, std::min(last, hi[j]));
+    }
+
+    // Visit shells of cells around the block. Each atom gives a lower and an
+    // upper bound on its distance to any point in the block. Stop once no
+    // unvisited atom can be closer than the best upper bound found so far,
+    // every atom outside ring n is at least n cells away from the block.
+    vector<unsigned int> atoms;
+    vector<double> lower;
+    double best = 1.0E+10;
+    for (int n = 0; ; ++n) {
+      Vector3i rLo, rHi;
+      bool whole = true;
+      for (int j = 0; j < 3; ++j) {
+        rLo[j] = std::max(0, lo[j] - n);
+        rHi[j] = std::min(surface->m_cellDim[j] - 1, hi[j] + n);
+        if (rLo[j] > 0 || rHi[j] < surface->m_cellDim[j] - 1)
+          whole = false;
+      }
+      for (int z = rLo.z(); z <= rHi.z(); ++z) {
+        for (int y = rLo.y(); y <= rHi.y(); ++y) {
+          for (int x = rLo.x(); x <= rHi.x(); ++x) {
+            // Skip the cells visited in previous rings
+            if (n && x > lo.x() - n && x < hi.x() + n
+                && y > lo.y() - n && y < hi.y() + n
+                && z > lo.z() - n && z < hi.z() + n)
+              continue;
+            unsigned int cell = x + surface->m_cellDim.x()
+                * (y + surface->m_cellDim.y() * z);
+            for (unsigned int k = surface->m_cellStart[cell];
+                 k < surface->m_cellStart[cell + 1]; ++k) {
+              unsigned int a = surface->m_cellAtoms[k];
+              const Vector3d &p = atomPos[a];
+              double near2 = 0.0, far2 = 0.0;
+              for (int j = 0; j < 3; ++j) {
+                double dLo = bMin[j] - p[j], dHi = p[j] - bMax[j];
+                double d = std::max(0.0, std::max(dLo, dHi));
+                double f = std::max(std::abs(dLo), std::abs(dHi));
+                near2 += d * d;
+                far2 += f * f;
+              }
+              double upper = sqrt(far2) - atomRadius[a];
+              if (upper < best)
+                best = upper;
+              atoms.push_back(a);
+              lower.push_back(sqrt(near2) - atomRadius[a]);
+            }
+          }
+        }
+      }
+      if (whole || n * surface->m_cellSize - surface->m_maxRadius > best)
+        break;
+    }
+
+    // Only atoms that may be the closest to some point in the block remain
+    unsigned int numCandidates = 0;
+    for (unsigned int i = 0; i < atoms.size(); ++i)
+      if (lower[i] <= best)
+        atoms[numCandidates++] = atoms[i];
+    atoms.resize(numCandidates);
+
+    // Now calculate the value at each point in the block
+    for (unsigned int i = 0; i < vdw.count; ++i) {
+      double tmp = -1.0E+10;
+      for (unsigned int k = 0; k < atoms.size(); ++k) {
+        unsigned int a = atoms[k];
+        double distance = (points[i] - atomPos[a]).norm() - atomRadius[a];
+        if ((tmp < -1.0E+9) || (distance < tmp))
+          tmp = distance;
+      }
+      values[i] = tmp;
     }
 
-    vdw.cube->setValue(vdw.pos, tmp);
+    vdw.cube->setValues(vdw.pos, vdw.count, &values[0]);
   }
 
 }
@@ -42,8 +42,8 @@
  *
  * This is a simple class that uses QtConcurrent::map to calculate a cube of the
  * given dimensions. It should use the number of cores available on the system.
- * Ideally some additional binning would be added to further increase speed
- * gains when calculating large cubes with large numbers of atoms.
+ * The atoms are binned into a uniform grid of cells, and each block of cube
+ * points only considers the atoms that can be closest to one of its points.
  */
 
 namespace Avogadro
@@ -99,13 +99,24 @@ namespace Avogadro
     std::vector<Eigen::Vector3d> m_atomPos;
     std::vector<double> m_atomRadius;
 
+    // Atoms binned into a uniform grid of cells, x fastest
+    Eigen::Vector3d m_cellMin;
+    Eigen::Vector3i m_cellDim;
+    double m_cellSize;
+    double m_maxRadius;
+    std::vector<unsigned int> m_cellStart; // Offsets into m_cellAtoms
+    std::vector<unsigned int> m_cellAtoms; // Atom indices sorted by cell
+
     QFuture<void> m_future;
     QFutureWatcher<void> m_watcher;
     Cube *m_cube; // Cube to put the results into
     QVector<VdWStruct> m_VdWvector;
 
-    /// Re-entrant single point forms of the calculations
-    static void processPoint(VdWStruct &vdw);
+    /// Bin the atoms into cells, must be called before processBlock
+    void binAtoms();
+
+    /// Re-entrant form of the calculation, processes a block of points
+    static void processBlock(VdWStruct &vdw);
   };
 
 } // End namespace Avogadro
@@ -20,32 +20,31 @@
  ***********************************************************************/
 
 #include "trajvideomaker.h"
-#include "povpainter.h"
 #include <avogadro/molecule.h>
 #include <avogadro/animation.h>
 
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QProgressDialog>
-#include <QFile>
-
-#include <fstream>
-#include <vector>
+#include <QProcess>
+#include <QImage>
+#include <QTime>
+#include <QFileInfo>
+#include <QFuture>
+#include <QtConcurrentRun>
 
 namespace Avogadro {
 
+  // Frames buffered for the encoder before waiting on it to catch up
+  static const int MAX_BUFFERED_FRAMES = 2;
+
   TrajVideoMaker::TrajVideoMaker(){}
 
   TrajVideoMaker::~TrajVideoMaker(){}
 
   void TrajVideoMaker::makeVideo(GLWidget *widget, Animation *animation,
-                                 const QString& workingDirectory,
                                  const QString& videoFileName)
   {
-    QString workDirectory = workingDirectory;
-    if (!workDirectory.endsWith('/'))
-      workDirectory += '/';
-
     // check widget is okay
     if (!widget) {
       QMessageBox::warning( NULL, QObject::tr( "Avogadro" ),
@@ -61,128 +60,169 @@ namespace Avogadro {
       return;
     }
 
-    double aspectRatio = getAspectRatio(widget);
+    int numFrames = animation->numFrames();
+    if (widget->width() < 2 || widget->height() < 2 || numFrames < 1)
+      return;
+
+    // The frames keep the aspect ratio of the view, MPEG-4 needs an even
+    // width and height
+    bool ok;
+    int width = QInputDialog::getInt(0, QObject::tr("Video Size"),
+                                     QObject::tr("Width of the video in pixels:"),
+                                     widget->width() & ~1, 16, 4096, 2, &ok);
+    if (!ok)
+      return;
+    width &= ~1;
+    int height = qRound(double(width) * widget->height() / widget->width()) & ~1;
+    if (height < 2)
+      return;
+
+    QProcess encoder;
+    // The output is never read, so pass it on rather than letting the pipe
+    // fill up and stall mencoder
+    encoder.setProcessChannelMode(QProcess::ForwardedChannels);
+    encoder.start("mencoder", encoderArguments(videoFileName, width, height,
+                                               animation->fps()));
+    if (!encoder.waitForStarted()) {
+      QMessageBox::warning( NULL, QObject::tr( "Avogadro" ),
+                            QObject::tr("Could not run mencoder."));
+      return;
+    }
+
     //start the progress dialog
     QProgressDialog progDialog(QObject::tr("Building video "),
-                               QObject::tr("Cancel"), 0,
-                               molecule->numConformers()*2);
+                               QObject::tr("Cancel"), 0, numFrames);
     progDialog.setMinimumDuration(1);
     progDialog.setValue(0);
 
-    //list of pngfiles for mencoder
-    std::vector<QString> pngFiles;
-
-    for (int i = 0; i < animation->numFrames(); ++i) {
-      QString povFileName = workDirectory + QString::number(i) + ".pov";
-      animation->setFrame(i);
-
-      // write the pov file
-      // must be in own scope so object is destroyed and file is closed after
-      // (a design flaw in POVPainterDevice?)
-      POVPainterDevice pd( povFileName, aspectRatio, widget );
-
-      progDialog.setValue(2*i);
-
-      //make the png
-      if ( ! runPovRay(workDirectory, povFileName ) ) {
-        QMessageBox::warning( NULL, QObject::tr( "Avogadro" ), QObject::tr("Could not run povray."));
-        return;
+    // Time spent rendering, converting and waiting on the encoder in ms
+    int renderTime = 0, convertTime = 0, encodeTime = 0;
+    QTime total, timer;
+    total.start();
+
+    const qint64 frameSize = qint64(width) * height * 3;
+    QFuture<QByteArray> frame;
+    bool canceled = false;
+    for (int i = 1; i <= numFrames + 1; ++i) {
+      // render the next frame offscreen while the previous one is converted
+      QImage image;
+      if (i <= numFrames) {
+        timer.start();
+        animation->setFrame(i);
+        image = widget->renderOffscreen(width, height);
+        renderTime += timer.elapsed();
+        if (image.isNull()) {
+          frame.waitForFinished();
+          encoder.kill();
+          encoder.waitForFinished();
+          QMessageBox::warning( NULL, QObject::tr( "Avogadro" ),
+                                QObject::tr("Could not render the frames offscreen, "
+                                            "framebuffer objects are not supported."));
+          return;
+        }
       }
-      progDialog.setValue(2*i+1);
 
-      QString pngFileName = workDirectory + QString::number(i) + ".png";
-      pngFiles.push_back(pngFileName);
+      // hand the previous frame to the encoder
+      if (i > 1) {
+        timer.start();
+        frame.waitForFinished();
+        convertTime += timer.elapsed();
+
+        timer.start();
+        encoder.write(frame.result());
+        while (encoder.bytesToWrite() > MAX_BUFFERED_FRAMES * frameSize)
+          if (!encoder.waitForBytesWritten(-1))
+            break;
+        encodeTime += timer.elapsed();
+        progDialog.setValue(i - 1);
+      }
 
-      if (progDialog.wasCanceled()) {
-        //stop making
-        return;
+      if (progDialog.wasCanceled() || encoder.state() != QProcess::Running) {
+        canceled = true;
+        break;
       }
+
+      if (i <= numFrames)
+        frame = QtConcurrent::run(TrajVideoMaker::rawFrame, image, width,
+                                  height);
     }
 
-    //now run mencoder
-    runMencoder(workDirectory, videoFileName, pngFiles.begin(), pngFiles.end());
+    frame.waitForFinished();
+    if (canceled && encoder.state() == QProcess::Running) {
+      // canceled by the user
+      encoder.kill();
+      encoder.waitForFinished();
+      return;
+    }
 
+    // let the encoder finish writing the video
+    if (!canceled) {
+      timer.start();
+      encoder.closeWriteChannel();
+      encoder.waitForFinished(-1);
+      encodeTime += timer.elapsed();
+    }
     progDialog.setValue(progDialog.maximum());
 
+    QString report = QObject::tr("%1 frames of %2x%3 in %4 s: "
+                                 "%5 ms/frame rendering, "
+                                 "%6 ms/frame waiting on conversion, "
+                                 "%7 ms/frame waiting on the encoder.")
+        .arg(numFrames).arg(width).arg(height)
+        .arg(total.elapsed() / 1000.0, 0, 'f', 1)
+        .arg(double(renderTime) / numFrames, 0, 'f', 1)
+        .arg(double(convertTime) / numFrames, 0, 'f', 1)
+        .arg(double(encodeTime) / numFrames, 0, 'f', 1);
+
     //tell user if successful
-    std::ifstream fin(QFile::encodeName(videoFileName));
-    if(!fin.fail()) {
-    fin.close();
-    QString successMessage = "Video file " + videoFileName + " written.";
-    QMessageBox::information( NULL, QObject::tr( "Avogadro" ),
-            successMessage);
+    if (!canceled && encoder.exitStatus() == QProcess::NormalExit
+        && !encoder.exitCode() && QFileInfo(videoFileName).exists()) {
+      QMessageBox::information( NULL, QObject::tr( "Avogadro" ),
+                                QObject::tr("Video file %1 written.\n%2")
+                                .arg(videoFileName).arg(report));
+    }
+    else if (encoder.exitStatus() == QProcess::CrashExit) {
+      QMessageBox::warning( NULL, QObject::tr( "Avogadro" ),
+                            QObject::tr("Video file not written, mencoder crashed."));
     }
     else {
-      QString failedMessage = QObject::tr("Video file not written.");
-      QMessageBox::warning( NULL, QObject::tr( "Avogadro" ), failedMessage);
+      QMessageBox::warning( NULL, QObject::tr( "Avogadro" ),
+                            QObject::tr("Video file not written, mencoder exited with code %1.")
+                            .arg(encoder.exitCode()));
     }
   }
 
-  bool TrajVideoMaker::runPovRay(QString directory, QString povFileName)
-  {
-    //executable for povray.  -D suppresses the popup image.
-    const QString povrayexe = "povray -D ";
-
-    QString povRayCommand = "cd " +  directory +
-      " && " + povrayexe + ' ' + povFileName;
-    //QMessageBox::warning( NULL, QObject::tr( "Avogadro" ), povRayCommand);
-    int ret = system(povRayCommand.toStdString().c_str());
-    if (ret)
-      return false;
-    else
-      return true;
-  }
-
-  template <class QStringIterator>
-  void TrajVideoMaker::runMencoder(QString pngFileDirectory, QString videoFileName,
-                                   QStringIterator startPngFiles, QStringIterator endPngFiles)
+  QByteArray TrajVideoMaker::rawFrame(const QImage &image, int width,
+                                      int height)
   {
-    //executable for mencoder
-    const QString mencoderexe = "mencoder -ovc lavc -lavcopts vcodec=mpeg4 -of avi -o ";
-
-    QString pngString;
-    for (QStringIterator pngIterator = startPngFiles;
-      pngIterator != endPngFiles; ++pngIterator) {
-      pngString += *pngIterator + ',';
+    QImage rgb = image.convertToFormat(QImage::Format_RGB32);
+    QByteArray raw;
+    raw.resize(width * height * 3);
+    char *out = raw.data();
+    for (int y = 0; y < height; ++y) {
+      // images smaller than the frame, e.g. from a failed grab, are black
+      const QRgb *line = y < rgb.height()
+          ? reinterpret_cast<const QRgb *>(rgb.scanLine(y)) : 0;
+      for (int x = 0; x < width; ++x) {
+        QRgb pixel = line && x < rgb.width() ? line[x] : 0;
+        *out++ = qRed(pixel);
+        *out++ = qGreen(pixel);
+        *out++ = qBlue(pixel);
+      }
     }
-
-    //strip off last comma
-    pngString = pngString.left(pngString.length()-1);
-
-    QString mencoderCommand = "cd " + pngFileDirectory + " && " + mencoderexe + ' ' + videoFileName + " mf://" + pngString ;
-    //QMessageBox::warning( NULL, QObject::tr( "Avogadro" ), mencoderCommand);
-    int ret = system(mencoderCommand.toStdString().c_str());
-    if (ret)
-      QMessageBox::warning( NULL, QObject::tr( "Avogadro" ), QObject::tr("Could not run mencoder."));
+    return raw;
   }
 
-  double TrajVideoMaker::getAspectRatio(GLWidget* widget)
+  QStringList TrajVideoMaker::encoderArguments(const QString &videoFileName,
+                                               int width, int height, int fps)
   {
-    bool ok;
-    int w = widget->width();
-    int h = widget->height();
-    double defaultAspectRatio = static_cast<double>(w)/h;
-    double aspectRatio =
-      QInputDialog::getDouble(0,
-			      QObject::tr("Set Aspect Ratio"),
-			      QObject::tr("The current Avogadro scene is %1x%2 pixels large, "
-					  "and therefore has aspect ratio %3.\n"
-					  "You may keep this value, for example if you intend to use POV-Ray\n"
-					  "to produce an image of %4x1000 pixels, or you may enter any other positive value,\n"
-					  "for example 1 if you intend to use POV-Ray to produce a square image, like 1000x1000 pixels.")
-			      .arg(w).arg(h).arg(defaultAspectRatio)
-			      .arg(static_cast<int>(1000*defaultAspectRatio)),
-			      defaultAspectRatio,
-			      0.1,
-			      10,
-			      6,
-			      &ok);
-    if (!ok) {
-      aspectRatio = defaultAspectRatio;
-    }
-    return aspectRatio;
+    QStringList arguments;
+    arguments << "-" << "-demuxer" << "rawvideo"
+              << "-rawvideo" << QString("w=%1:h=%2:fps=%3:format=rgb24")
+                 .arg(width).arg(height).arg(qMax(1, fps))
+              << "-ovc" << "lavc" << "-lavcopts" << "vcodec=mpeg4"
+              << "-of" << "avi" << "-o" << videoFileName;
+    return arguments;
   }
 
-
 }
-
@@ -24,10 +24,20 @@
 
 #include <avogadro/glwidget.h>
 
+#include <QStringList>
+
 namespace Avogadro {
 
 class Animation;
 
+  /**
+   * Render the frames of an animation and stream them to a video encoder.
+   *
+   * Frames are rendered offscreen by the GLWidget at the requested size and
+   * converted to raw RGB in the background while the next frame renders,
+   * then piped to the standard input of an encoder process. No intermediate
+   * image files are written.
+   */
   class TrajVideoMaker
   {
   public:
@@ -36,18 +46,22 @@ class Animation;
     //! Destructor
     virtual ~TrajVideoMaker();
 
+    /**
+     * Ask for the width of the video, then render each frame of the
+     * animation offscreen and encode them into the video file using
+     * mencoder. The time spent rendering, converting and waiting
+     * on the encoder is reported once the video has been written.
+     */
     static void makeVideo(GLWidget *widget, Animation *animation,
-                          const QString& workDirectory,
                           const QString& videoFileName);
 
   private:
-    static double getAspectRatio(GLWidget* widget);
-    static bool runPovRay(QString directory, QString povFileName);
-
-    template <class QStringIterator>
-    static void runMencoder(QString pngFileDirectory, QString videoFileName,
-               QStringIterator startPngFiles, QStringIterator endPngFiles);
+    //! Convert the frame to packed 24 bit RGB, cropped to width x height
+    static QByteArray rawFrame(const QImage &image, int width, int height);
 
+    //! Arguments for mencoder to read raw frames from its standard input
+    static QStringList encoderArguments(const QString &videoFileName,
+                                        int width, int height, int fps);
   };
 }
 #endif
@@ -33,6 +33,7 @@
 #include "camera.h"
 #include "sphere_p.h"
 #include "cylinder_p.h"
+#include "instancebatch_p.h"
 #include "textrenderer_p.h"
 
 #include <avogadro/atom.h>
@@ -415,6 +416,50 @@ namespace Avogadro
     popName();
   }
 
+  void GLPainter::drawBatch(InstanceBatch *batch)
+  {
+    if(!d->isValid() || !batch->size()) { return; }
+
+    // One detail level for the batch, so its display lists can be reused.
+    // It is chosen for an instance of average radius at the batch center.
+    int detailLevel = PAINTER_MAX_DETAIL_LEVEL / 3;
+    bool spheres = batch->shape() == InstanceBatch::Spheres;
+
+    if (d->widget->projection() != GLWidget::Orthographic &&
+        m_dynamicScaling) {
+      Eigen::Vector3d center = Eigen::Vector3d::Zero();
+      double radius = 0.0;
+      for (int i = 0; i < batch->size(); ++i) {
+        center += batch->end1(i) + batch->end2(i);
+        radius += batch->radius(i);
+      }
+      center /= 2.0 * batch->size();
+      radius /= batch->size();
+      double distance = d->widget->camera()->distance(center);
+      if (distance > radius) {
+        double apparentRadius = radius / distance;
+        if (spheres)
+          detailLevel = 1 + static_cast<int>(floor (PAINTER_SPHERES_DETAIL_COEFF
+                            * (sqrt(apparentRadius) - PAINTER_SPHERES_SQRT_LIMIT_MIN_LEVEL)));
+        else
+          detailLevel = 1 + static_cast<int>(floor (PAINTER_CYLINDERS_DETAIL_COEFF
+                            * (sqrt(apparentRadius) - PAINTER_CYLINDERS_SQRT_LIMIT_MIN_LEVEL)));
+      }
+      else
+        detailLevel = PAINTER_MAX_DETAIL_LEVEL;
+      if (detailLevel < 0)
+        detailLevel = 0;
+      if (detailLevel > PAINTER_MAX_DETAIL_LEVEL)
+        detailLevel = PAINTER_MAX_DETAIL_LEVEL;
+    }
+
+    int level = spheres
+      ? PAINTER_SPHERES_LEVELS_ARRAY[d->quality][detailLevel]
+      : PAINTER_CYLINDERS_LEVELS_ARRAY[d->quality][detailLevel];
+    batch->d->draw(d->spheres[detailLevel], d->cylinders[detailLevel], level,
+                   d->widget->normalVector(), d->widget);
+  }
+
   void GLPainter::drawCone(const Eigen::Vector3d &base,
                            const Eigen::Vector3d &cap,
                            double baseRadius,
@@ -1025,7 +1070,13 @@ namespace Avogadro
     glEnableClientState(GL_NORMAL_ARRAY);
     glVertexPointer(3, GL_FLOAT, 0, &(v[0]));
     glNormalPointer(GL_FLOAT, 0, &(n[0]));
-    glDrawArrays(GL_TRIANGLES, 0, v.size());
+    if (mesh.isIndexed()) {
+      const std::vector<unsigned int> &indices = mesh.indices();
+      glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT,
+                     &(indices[0]));
+    }
+    else
+      glDrawArrays(GL_TRIANGLES, 0, v.size());
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_NORMAL_ARRAY);
 
@@ -1083,10 +1134,21 @@ namespace Avogadro
     float alpha = d->color.alpha();
 
     glBegin(GL_TRIANGLES);
-    for(unsigned int i = 0; i < v.size(); ++i) {
-      applyAsMaterials(c[i], alpha);
-      glNormal3fv(n[i].data());
-      glVertex3fv(v[i].data());
+    if (mesh.isIndexed()) {
+      const std::vector<unsigned int> &indices = mesh.indices();
+      for(unsigned int i = 0; i < indices.size(); ++i) {
+        unsigned int j = indices[i];
+        applyAsMaterials(c[j], alpha);
+        glNormal3fv(n[j].data());
+        glVertex3fv(v[j].data());
+      }
+    }
+    else {
+      for(unsigned int i = 0; i < v.size(); ++i) {
+        applyAsMaterials(c[i], alpha);
+        glNormal3fv(n[i].data());
+        glVertex3fv(v[i].data());
+      }
     }
     glEnd();
 
@@ -161,6 +161,16 @@ namespace Avogadro
     void drawMultiCylinder(const Eigen::Vector3d &end1, const Eigen::Vector3d &end2,
                            double radius, int order, double shift);
 
+    /**
+     * Draws every sphere or cylinder of a batch from display lists that are
+     * kept between frames, only recompiling the parts of the batch that
+     * changed. The whole batch uses one detail level, chosen for an instance
+     * of average radius at the center of the batch, and the instances are
+     * not named for picking.
+     * @param batch The instances to draw.
+     */
+    void drawBatch(InstanceBatch *batch);
+
     /**
      * Draws a cone between the tip and the base with the base radius given.
      * @param base the position of the base of the cone.
@@ -33,6 +33,8 @@
 #include "glwidget.h"
 #include "glpainter_p.h"
 #include "glhit.h"
+#include "picktree.h"
+#include "renderprofiler.h"
 
 #include <QtGui/QMessageBox>
 #include <QtGui/QPen>
@@ -40,6 +42,8 @@
 #include <QtGui/QPaintEngine>
 #include <QtGui/QUndoStack>
 #include <QtGui/QLabel>
+#include <QtGui/QImage>
+#include <QtOpenGL/QGLFramebufferObject>
 
 #ifdef Q_WS_MAC
 # include <OpenGL/glu.h>
@@ -72,6 +76,7 @@
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QTime>
 #include <QtCore/QMutex>
+#include <QtCore/qmath.h>
 
 #ifdef ENABLE_THREADED_GL
   #include <QtCore/QWaitCondition>
@@ -164,8 +169,8 @@ namespace Avogadro {
                         camera( new Camera ),
                         tool( 0 ),
                         toolGroup( 0 ),
-                        selectBuf( 0 ),
-                        selectBufSize( -1 ),
+                        pickTreeDirty(true), pickTreeMoved(false),
+                        positionsChanged(false),
                         undoStack(0),
 #ifdef ENABLE_THREADED_GL
                         thread( 0 ),
@@ -190,7 +195,6 @@ namespace Avogadro {
 
     ~GLWidgetPrivate()
     {
-      if ( selectBuf ) delete[] selectBuf;
       delete camera;
 
       // free the display lists
@@ -204,6 +208,11 @@ namespace Avogadro {
 
     void updateListQuick();
 
+    /**
+     * Update the pick tree from the atoms and bonds the engines can pick.
+     */
+    void updatePickTree();
+
     QList<Engine *>        engines;
 
     QColor                 background;
@@ -232,8 +241,11 @@ namespace Avogadro {
     ToolGroup             *toolGroup;
     QList<Extension*>     extensions;
 
-    GLuint                *selectBuf;
-    int                    selectBufSize;
+    //! atoms and bonds for picking, dirty when they or the engines change
+    PickTree               pickTree;
+    bool                   pickTreeDirty;
+    bool                   pickTreeMoved;    // Only the atoms moved
+    bool                   positionsChanged; // geometryChanged() received
 
     QList<QPair<QString, QPair<QList<unsigned int>, QList<unsigned int> > > > namedSelections;
     PrimitiveList          selectedPrimitives;
@@ -260,6 +272,7 @@ namespace Avogadro {
     bool                   renderAxes;  // Should the x, y, z axes be rendered?
     bool                   renderDebug; // Should the debug information be shown?
     bool                   renderModelViewDebug; // Should the modelview matrix be shown?
+    RenderProfiler         profiler;    // Times the frames while debugging
 
     GLuint                 dlistQuick;
     GLuint                 dlistOpaque;
@@ -273,6 +286,37 @@ namespace Avogadro {
     GLPainterDevice *pd;
   };
 
+  void GLWidgetPrivate::updatePickTree()
+  {
+    QList<Engine *> enabled;
+    foreach(Engine *engine, engines)
+      if (engine->isEnabled())
+        enabled.append(engine);
+
+    pickTree.clear();
+    foreach(Atom *atom, molecule->atoms()) {
+      double radius = 0.0;
+      foreach(Engine *engine, enabled)
+        radius = std::max(radius, engine->pickRadius(pd, atom));
+      if (radius > 0.0)
+        pickTree.add(Primitive::AtomType, atom->index(), *atom->pos(),
+                     *atom->pos(), radius);
+    }
+    foreach(Bond *bond, molecule->bonds()) {
+      if (!bond->beginAtom() || !bond->endAtom())
+        continue;
+      double radius = 0.0;
+      foreach(Engine *engine, enabled)
+        radius = std::max(radius, engine->pickRadius(pd, bond));
+      if (radius > 0.0)
+        pickTree.add(Primitive::BondType, bond->index(), *bond->beginPos(),
+                     *bond->endPos(), radius);
+    }
+    // refits the boxes when the atoms have only moved
+    pickTree.update();
+    pickTreeDirty = false;
+  }
+
   void GLWidgetPrivate::updateListQuick()
   {
     // Create a display list cache
@@ -291,7 +335,10 @@ namespace Avogadro {
         if(engine->isEnabled())
         {
           molecule->lock()->lockForRead();
+          if (profiler.isEnabled())
+            profiler.begin(engine->alias() + " quick");
           engine->renderQuick(pd);
+          profiler.end();
           molecule->lock()->unlock();
         }
       }
@@ -475,6 +522,47 @@ namespace Avogadro {
     paintGL();
   }
 
+  QImage GLWidget::renderOffscreen(int width, int height)
+  {
+    if (!QGLFramebufferObject::hasOpenGLFramebufferObjects())
+      return QImage();
+
+#ifdef ENABLE_THREADED_GL
+    d->renderMutex.lock();
+#endif
+    makeCurrent();
+    if (!d->initialized) {
+      d->initialized = true;
+      initializeGL();
+    }
+
+    QImage image;
+    QGLFramebufferObject fbo(width, height, QGLFramebufferObject::Depth);
+    if (fbo.isValid() && fbo.bind()) {
+      glViewport(0, 0, width, height);
+      qglClearColor(d->background);
+      glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+
+      glMatrixMode( GL_PROJECTION );
+      glLoadIdentity();
+      d->camera->applyProjection();
+      glMatrixMode( GL_MODELVIEW );
+      glLoadIdentity();
+      d->camera->applyModelview();
+
+      render();
+      fbo.release();
+      image = fbo.toImage();
+      glViewport(0, 0, this->width(), this->height());
+    }
+
+#ifdef ENABLE_THREADED_GL
+    doneCurrent();
+    d->renderMutex.unlock();
+#endif
+    return image;
+  }
+
   void GLWidget::initializeGL()
   {
     qDebug() << "GLWidget initialisation...";
@@ -720,6 +808,7 @@ namespace Avogadro {
   void GLWidget::setRenderDebug(bool renderDebug)
   {
     d->renderDebug = renderDebug;
+    d->profiler.setEnabled(renderDebug);
     update();
   }
 
@@ -739,6 +828,11 @@ namespace Avogadro {
     return d->renderModelViewDebug;
   }
 
+  RenderProfiler * GLWidget::renderProfiler() const
+  {
+    return &d->profiler;
+  }
+
   void GLWidget::render()
   {
     if (!d->molecule) {
@@ -750,6 +844,7 @@ namespace Avogadro {
       return;
     }
 
+    d->profiler.beginFrame();
     d->painter->begin(this);
 
     if (d->painter->quality() >= 3) {
@@ -780,14 +875,17 @@ namespace Avogadro {
     // Use renderQuick if the view is being moved, otherwise full render
     if (d->quickRender) {
       d->updateListQuick();
+      d->profiler.begin("Quick display list");
       glCallList(d->dlistQuick);
       if (hasUnitCell) {
         renderCrystal(d->dlistQuick);
       }
       // Render the active tool
       if ( d->tool ) {
+        d->profiler.begin("Tools");
         d->tool->paint( this );
       }
+      d->profiler.end();
     }
     else {
       // we save a display list if we're doing a crystal
@@ -803,7 +901,10 @@ namespace Avogadro {
 #ifdef ENABLE_GLSL
           if (m_glslEnabled) glUseProgramObjectARB(engine->shader());
 #endif
+          if (d->profiler.isEnabled())
+            d->profiler.begin(engine->alias() + " opaque");
           engine->renderOpaque(d->pd);
+          d->profiler.end();
         }
 #ifdef ENABLE_GLSL
           if (m_glslEnabled) glUseProgramObjectARB(0);
@@ -815,7 +916,9 @@ namespace Avogadro {
 
       // Render the active tool
       if ( d->tool ) {
+        d->profiler.begin("Tools");
         d->tool->paint( this );
+        d->profiler.end();
       }
 
 #ifdef ENABLE_PYTHON
@@ -843,7 +946,10 @@ namespace Avogadro {
 #ifdef ENABLE_GLSL
           if (m_glslEnabled) glUseProgramObjectARB(engine->shader());
 #endif
+          if (d->profiler.isEnabled())
+            d->profiler.begin(engine->alias() + " transparent");
           engine->renderTransparent(d->pd);
+          d->profiler.end();
         }
       }
       glDisable(GL_BLEND);
@@ -858,21 +964,26 @@ namespace Avogadro {
     // Render all the inactive tools
     if ( d->toolGroup ) {
       QList<Tool *> tools = d->toolGroup->tools();
+      d->profiler.begin("Tools");
       foreach( Tool *tool, tools ) {
         if ( tool != d->tool ) {
           tool->paint( this );
         }
       }
+      d->profiler.end();
     }
 
     // If enabled draw the axes
     if (d->renderAxes) renderAxesOverlay();
 
     // Render text overlay
+    d->profiler.begin("Text overlay");
     renderTextOverlay();
+    d->profiler.end();
 
     d->painter->end();
     d->molecule->lock()->unlock();
+    d->profiler.endFrame();
   }
 
   void GLWidget::renderCrystal(GLuint displayList)
@@ -1751,6 +1862,34 @@ namespace Avogadro {
         y += d->pd->painter()->drawText
           (x, y, tr("Bonds: %L1").arg(d->molecule->numBonds()));
       }
+
+      // Render times over the last frames, slowest sections show the most
+      if (d->profiler.frames()) {
+        y += d->pd->painter()->drawText
+          (x, y, tr("Render times over %L1 frames (average / maximum):")
+           .arg(d->profiler.frames()));
+        foreach (const QString &section, d->profiler.sections()) {
+          y += d->pd->painter()->drawText
+            (x, y, tr("  %1: %L2 / %L3 ms").arg(section)
+             .arg(d->profiler.average(section), 0, 'f', 2)
+             .arg(d->profiler.maximum(section), 0, 'f', 2));
+        }
+
+        // Distribution of the frame times, one bar per whole millisecond bin
+        const int bins = 8;
+        const QString frame = RenderProfiler::frameSection();
+        int binWidth = qMax(1, qCeil(d->profiler.maximum(frame) / bins));
+        QVector<int> counts = d->profiler.histogram(frame, bins, binWidth);
+        y += d->pd->painter()->drawText(x, y, tr("Frame times:"));
+        for (int i = 0; i < bins; ++i) {
+          int bar = (40 * counts.at(i) + d->profiler.frames() - 1)
+            / d->profiler.frames();
+          y += d->pd->painter()->drawText
+            (x, y, tr("  %L1-%L2 ms: %3 %L4").arg(i * binWidth)
+             .arg((i + 1) * binWidth).arg(QString(bar, '|'))
+             .arg(counts.at(i)));
+        }
+      }
     } // end debug
 
     // textOverlay stuff
@@ -1978,12 +2117,20 @@ namespace Avogadro {
     // compute the molecule's geometric info
     updateGeometry();
     invalidateDLs();
+    d->positionsChanged = false;
 
     // When the molecule is updated, the display lists become invalid, we should
     // also render the updated molecule. This should be much simpler than before.
-    connect(d->molecule, SIGNAL(updated()), this, SLOT(invalidateDLs()));
+    connect(d->molecule, SIGNAL(geometryChanged(int,int)),
+            this, SLOT(invalidatePositions(int,int)));
+    connect(d->molecule, SIGNAL(updated()), this, SLOT(moleculeUpdated()));
     connect(d->molecule, SIGNAL(updated()), this, SLOT(updateGeometry()));
     connect(d->molecule, SIGNAL(updated()), this, SLOT(update()));
+    // Picking should find new or moved atoms before the next update()
+    connect(d->molecule, SIGNAL(atomAdded(Atom*)), this, SLOT(invalidatePickTree()));
+    connect(d->molecule, SIGNAL(atomUpdated(Atom*)), this, SLOT(invalidatePickTree()));
+    connect(d->molecule, SIGNAL(bondAdded(Bond*)), this, SLOT(invalidatePickTree()));
+    connect(d->molecule, SIGNAL(bondUpdated(Bond*)), this, SLOT(invalidatePickTree()));
 
     // If primitives, atoms, or bonds are removed, we need to delete them from the selected list
     connect(d->molecule, SIGNAL(primitiveRemoved(Primitive*)),
@@ -2004,6 +2151,7 @@ namespace Avogadro {
     d->selectedPrimitives.removeAll( p );
     // The engine caches must be invalidated
     d->updateCache = true;
+    d->pickTreeDirty = true;
 
     // TODO: remove also from named selections
   }
@@ -2121,6 +2269,7 @@ namespace Avogadro {
             engine, SLOT(setMolecule(Molecule *)));
     d->engines.append(engine);
     qSort(d->engines.begin(), d->engines.end(), engineLessThan);
+    d->pickTreeDirty = true;
     engine->setPainterDevice(d->pd);
     emit engineAdded(engine);
     update();
@@ -2131,6 +2280,7 @@ namespace Avogadro {
     disconnect(engine, 0, this, 0);
     disconnect(this, 0, engine, 0);
     d->engines.removeAll(engine);
+    d->pickTreeDirty = true;
     emit engineRemoved(engine);
     engine->deleteLater();
     update();
@@ -2223,115 +2373,48 @@ namespace Avogadro {
 
   QList<GLHit> GLWidget::hits( int x, int y, int w, int h )
   {
-    QList<GLHit> hits;
-
-    if ( !molecule() ) return hits;
-
-    GLint viewport[4];
-    unsigned int hit_count;
-
-    int cx = w/2 + x;
-    int cy = h/2 + y;
-
-    // setup the selection buffer
-    int requiredSelectBufSize = (d->molecule->numAtoms() + d->molecule->numBonds()) * 8;
-    if ( requiredSelectBufSize > d->selectBufSize ) {
-      //resize selection buffer
-      if ( d->selectBuf ) delete[] d->selectBuf;
-      // add some margin so that resizing doesn't occur every time an atom is added
-      d->selectBufSize = requiredSelectBufSize + SEL_BUF_MARGIN;
-      if ( d->selectBufSize > SEL_BUF_MAX_SIZE ) {
-        d->selectBufSize = SEL_BUF_MAX_SIZE;
-      }
-      d->selectBuf = new GLuint[d->selectBufSize];
-    }
-
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.lock();
-#endif
-    makeCurrent();
-    //X   hits.clear();
-
-    glSelectBuffer( d->selectBufSize, d->selectBuf );
-    glRenderMode( GL_SELECT );
-    glInitNames();
-
-    // Setup a projection matrix for picking in the zone delimited by (x,y,w,h).
-    glGetIntegerv( GL_VIEWPORT, viewport );
-    glMatrixMode( GL_PROJECTION );
-    glPushMatrix();
-    glLoadIdentity();
-    gluPickMatrix( cx,viewport[3]-cy, w, h,viewport );
-
-    // now multiply that projection matrix with the perspective of the camera
-    d->camera->applyProjection();
-
-    // now load the modelview matrix from the camera
-    glMatrixMode( GL_MODELVIEW );
-    glPushMatrix();
-    glLoadIdentity();
-    d->camera->applyModelview();
-
-    // now actually render using low quality, "pickrender"
-    d->painter->begin(this);
-#ifdef ENABLE_GLSL
-        if (m_glslEnabled) glUseProgramObjectARB(0);
-#endif
-    foreach(Engine *engine, d->engines) {
-      if(engine->isEnabled()) {
-        engine->renderPick(d->pd);
-      }
-    }
-    d->painter->end();
-
-    // returning to normal rendering mode
-    hit_count = glRenderMode( GL_RENDER );
-
-    glMatrixMode( GL_PROJECTION );
-    glPopMatrix();
-    glMatrixMode( GL_MODELVIEW );
-    glPopMatrix();
-
-#ifdef ENABLE_THREADED_GL
-    doneCurrent();
-    d->renderMutex.unlock();
-#endif
-
-    // if no error occurred and there are hits, process them
-    if ( hit_count > 0 ) {
-      unsigned int i, j;
-      GLuint names, type, *ptr;
-      GLuint minZ, maxZ;
-      long name;
-
-      //X   printf ("hits = %d\n", hits);
-      ptr = ( GLuint * ) d->selectBuf;
-      // for all hits and not past end of buffer
-      for (i = 0; i < hit_count && !(ptr > d->selectBuf + d->selectBufSize); ++i) {
-        names = *ptr++;
-        // make sure that we won't be passing the end of bufer
-        if ( ptr + names + 2 > d->selectBuf + d->selectBufSize ) {
-          break;
-        }
-        minZ = *ptr++;
-        maxZ = *ptr++;
-
-        // allow names of 0
-        name = -1;
-        for (j = 0; j < names/2; ++j) { /*  for each name */
-          type = *ptr++;
-          name = *ptr++;
-        }
-        if (name > -1) {
-          //            printf ("%ld(%d) ", name,type);
-          hits.append( GLHit( type,name,minZ,maxZ ) );
-        }
-      }
-      //      printf ("\n");
-      qSort( hits );
-    }
-
-    return( hits );
+    if ( !molecule() ) return QList<GLHit>();
+
+    if (d->pickTreeDirty)
+      d->updatePickTree();
+    else if (d->pickTreeMoved)
+      d->pickTree.move(d->molecule);
+    d->pickTreeMoved = false;
+
+    // The corners of the region on the near and far planes
+    w = qMax(w, 1);
+    h = qMax(h, 1);
+    const int cornerX[4] = { x, x + w, x + w, x };
+    const int cornerY[4] = { y, y, y + h, y + h };
+    Vector3d corners[8];
+    Vector3d center(0.0, 0.0, 0.0);
+    for (int i = 0; i < 4; ++i) {
+      corners[i] = d->camera->unProject(Vector3d(cornerX[i], cornerY[i], 0.0));
+      corners[i + 4] = d->camera->unProject(Vector3d(cornerX[i], cornerY[i], 1.0));
+      center += corners[i] + corners[i + 4];
+    }
+    center /= 8.0;
+
+    // The near and far planes, then the sides of the region, facing inwards
+    const int planeCorners[6][3] = { { 0, 1, 2 }, { 4, 6, 5 },
+                                     { 0, 4, 1 }, { 1, 5, 2 },
+                                     { 2, 6, 3 }, { 3, 7, 0 } };
+    std::vector<PickTree::Plane> planes(6);
+    for (int i = 0; i < 6; ++i) {
+      const Vector3d &p0 = corners[planeCorners[i][0]];
+      Vector3d normal = (corners[planeCorners[i][1]] - p0)
+          .cross(corners[planeCorners[i][2]] - p0);
+      if (normal.norm() < 1e-12)
+        return QList<GLHit>();
+      normal.normalize();
+      if (normal.dot(center - p0) < 0.0)
+        normal = -normal;
+      planes[i].normal = normal;
+      planes[i].distance = -normal.dot(p0);
+    }
+
+    double depthRange = planes[0].normal.dot(corners[4]) + planes[0].distance;
+    return d->pickTree.hits(planes, depthRange);
   }
 
   Primitive* GLWidget::computeClickedPrimitive(const QPoint& p)
@@ -2426,13 +2509,14 @@ namespace Avogadro {
         d->selectedPrimitives.removeAll( item );
       // The engine caches must be invalidated
       d->updateCache = true;
+      d->pickTreeDirty = true;
       //      item->update();
     }
   }
 
   PrimitiveList GLWidget::selectedPrimitives() const
   {
-    return d->selectedPrimitives.list();
+    return d->selectedPrimitives;
   }
 
   void GLWidget::toggleSelected( PrimitiveList primitives )
@@ -2446,6 +2530,7 @@ namespace Avogadro {
     }
     // The engine caches must be invalidated
     d->updateCache = true;
+    d->pickTreeDirty = true;
   }
 
   void GLWidget::toggleSelected()
@@ -2468,6 +2553,7 @@ namespace Avogadro {
     }
     // The engine caches must be invalidated
     d->updateCache = true;
+    d->pickTreeDirty = true;
   }
 
   void GLWidget::clearSelected()
@@ -2475,12 +2561,13 @@ namespace Avogadro {
     d->selectedPrimitives.clear();
     // The engine caches must be invalidated
     d->updateCache = true;
+    d->pickTreeDirty = true;
   }
 
   bool GLWidget::isSelected( const Primitive *p ) const
   {
     // Return true if the item is selected
-    return d->selectedPrimitives.contains(const_cast<Primitive *>(p));
+    return d->selectedPrimitives.contains(p);
   }
 
   bool GLWidget::addNamedSelection(const QString &name, PrimitiveList &primitives)
@@ -2708,6 +2795,7 @@ namespace Avogadro {
     d->background = settings.value("background", QColor(0,0,0,0)).value<QColor>();
     d->renderAxes = settings.value("renderAxes", 1).value<bool>();
     d->renderDebug = settings.value("renderDebug", 0).value<bool>();
+    d->profiler.setEnabled(d->renderDebug);
     d->renderModelViewDebug =
         settings.value("renderModelViewDebug", 0).value<bool>();
     d->allowQuickRender = settings.value("allowQuickRender", 1).value<bool>();
@@ -2838,6 +2926,28 @@ namespace Avogadro {
   {
     // Something changed and we need to invalidate the display lists
     d->updateCache = true;
+    d->pickTreeDirty = true;
+  }
+
+  void GLWidget::invalidatePickTree()
+  {
+    d->pickTreeDirty = true;
+  }
+
+  void GLWidget::invalidatePositions(int, int)
+  {
+    // The quick render list holds the positions, the pick tree is refitted
+    d->updateCache = true;
+    d->pickTreeMoved = true;
+    d->positionsChanged = true;
+  }
+
+  void GLWidget::moleculeUpdated()
+  {
+    if (d->positionsChanged)
+      d->positionsChanged = false;
+    else
+      invalidateDLs();
   }
 
 // Copied from current sources of Qt 4.7
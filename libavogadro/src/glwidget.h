@@ -40,6 +40,7 @@
 #include <QtOpenGL/QGLWidget>
 
 class QGLContext;
+class QImage;
 class QLabel;
 class QMouseEvent;
 class QSettings;
@@ -52,6 +53,7 @@ namespace Avogadro {
   class Bond;
   class Molecule;
   class Camera;
+  class RenderProfiler;
   class Painter;
   class Tool;
   class ToolGroup;
@@ -224,7 +226,9 @@ namespace Avogadro {
       QList<Engine *> engines() const;
 
       /**
-       * Get the hits for a region starting at (x, y) of size (w * h).
+       * Get the hits for a region starting at (x, y) of size (w * h). The
+       * atoms and bonds are found in a PickTree using the Engine::pickRadius()
+       * of the enabled engines, nearest first, without rendering.
        */
       QList<GLHit> hits(int x, int y, int w, int h);
 
@@ -317,6 +321,13 @@ namespace Avogadro {
        */
       bool renderModelViewDebug() const;
 
+      /**
+       * @return The profiler timing the engines, tools and text overlay of
+       * each frame. It records while the debug information is shown, and
+       * its times are summarized on the debug overlay.
+       */
+      RenderProfiler * renderProfiler() const;
+
       /**
        * Set the ToolGroup of the GLWidget.
        */
@@ -532,6 +543,15 @@ namespace Avogadro {
        */
       void renderNow();
 
+      /**
+       * Render the scene offscreen into a framebuffer object of the given
+       * size, e.g. for the frames of a video. The camera is not changed, so
+       * the size should have the aspect ratio of the widget.
+       * @return The rendered image, or a null image if framebuffer objects
+       * are not supported.
+       */
+      QImage renderOffscreen(int width, int height);
+
       /**
        * Write the settings of the GLWidget in order to save them to disk.
        */
@@ -779,6 +799,28 @@ namespace Avogadro {
        */
       void invalidateDLs();
 
+      /**
+       * Signal that atoms or bonds were added or moved, and the pick tree
+       * should be rebuilt before the next pick. The display lists are kept.
+       */
+      void invalidatePickTree();
+
+      /**
+       * Signal that a range of atoms moved, e.g. from
+       * Molecule::geometryChanged(). The pick tree is refitted rather than
+       * rebuilt, and the updated() signal that follows does not invalidate
+       * anything else.
+       * @param first The index of the first Atom that moved.
+       * @param count The number of atoms that moved.
+       */
+      void invalidatePositions(int first, int count);
+
+      /**
+       * The molecule was updated, invalidate the display lists unless only
+       * the positions changed.
+       */
+      void moleculeUpdated();
+
       /**
        * update the Molecule geometry.
        */
@@ -0,0 +1,359 @@
+/**********************************************************************
+  InstanceBatch - spheres or cylinders drawn together by a Painter
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "instancebatch_p.h"
+#include "sphere_p.h"
+#include "cylinder_p.h"
+
+#include <avogadro/color.h>
+
+#include <Eigen/Geometry>
+
+#include <QHash>
+#include <QByteArray>
+
+#include <cmath>
+#include <algorithm>
+
+#ifndef M_PI
+  #define M_PI 3.1415926535897932384626433832795
+#endif
+
+using Eigen::Vector3d;
+using Eigen::Vector3f;
+
+namespace Avogadro {
+
+  // Instances compiled into each display list
+  static const int BLOCK_SIZE = 4096;
+
+  InstanceBatchPrivate::InstanceBatchPrivate(InstanceBatch::Shape shape_)
+    : shape(shape_), regroup(true), detail(-1),
+      planeNormal(Vector3d::Zero())
+  {
+  }
+
+  InstanceBatchPrivate::~InstanceBatchPrivate()
+  {
+    // The lists can only be freed with the context they were compiled in
+    // current, they went with the context if the widget is already gone
+    if (groups.empty() || !widget)
+      return;
+    const QGLContext *current = QGLContext::currentContext();
+    if (current != widget->context())
+      widget->makeCurrent();
+    deleteLists();
+    if (current && current != widget->context())
+      const_cast<QGLContext *>(current)->makeCurrent();
+  }
+
+  void InstanceBatchPrivate::deleteLists()
+  {
+    for (unsigned int g = 0; g < groups.size(); ++g)
+      for (unsigned int b = 0; b < groups[g].lists.size(); ++b)
+        if (groups[g].lists[b])
+          glDeleteLists(groups[g].lists[b], 1);
+    groups.clear();
+  }
+
+  void InstanceBatchPrivate::group()
+  {
+    deleteLists();
+    groupOf.resize(instances.size());
+    indexInGroup.resize(instances.size());
+
+    QHash<QByteArray, int> groupOfColor;
+    for (unsigned int i = 0; i < instances.size(); ++i) {
+      bool multiple = instances[i].order > 1;
+      QByteArray key(reinterpret_cast<const char *>(instances[i].color),
+                     sizeof(instances[i].color));
+      key.append(multiple ? '\1' : '\0');
+      QHash<QByteArray, int>::const_iterator it = groupOfColor.constFind(key);
+      int g;
+      if (it == groupOfColor.constEnd()) {
+        g = groups.size();
+        groupOfColor.insert(key, g);
+        groups.push_back(Group());
+        std::copy(instances[i].color, instances[i].color + 4, groups[g].color);
+        groups[g].multiple = multiple;
+      }
+      else
+        g = it.value();
+      groupOf[i] = g;
+      indexInGroup[i] = groups[g].instances.size();
+      groups[g].instances.push_back(i);
+    }
+
+    for (unsigned int g = 0; g < groups.size(); ++g) {
+      int blocks = (groups[g].instances.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      groups[g].lists.assign(blocks, 0);
+      groups[g].dirty.assign(blocks, 1);
+    }
+  }
+
+  void InstanceBatchPrivate::draw(const Sphere *sphere,
+                                  const Cylinder *cylinder, int detail_,
+                                  const Vector3d &normal, QGLWidget *widget_)
+  {
+    widget = widget_;
+    if (regroup || detail_ != detail) {
+      group();
+      detail = detail_;
+      m_vertices.clear();
+    }
+    else {
+      for (unsigned int i = 0; i < changed.size(); ++i)
+        if (changed[i])
+          groups[groupOf[i]].dirty[indexInGroup[i] / BLOCK_SIZE] = 1;
+      // Only multiple cylinders are placed using the plane normal
+      if (shape == InstanceBatch::Cylinders && normal != planeNormal)
+        for (unsigned int g = 0; g < groups.size(); ++g)
+          if (groups[g].multiple)
+            std::fill(groups[g].dirty.begin(), groups[g].dirty.end(), 1);
+    }
+    planeNormal = normal;
+    std::fill(changed.begin(), changed.end(), 0);
+    regroup = false;
+
+    // A display list cannot be compiled while another one is
+    GLint compiling = 0;
+    glGetIntegerv(GL_LIST_INDEX, &compiling);
+
+    Color color;
+    for (unsigned int g = 0; g < groups.size(); ++g) {
+      Group &group = groups[g];
+      color.setFromRgba(group.color[0], group.color[1], group.color[2],
+                        group.color[3]);
+      color.applyAsMaterials();
+
+      for (unsigned int b = 0; b < group.lists.size(); ++b) {
+        if (!group.dirty[b]) {
+          glCallList(group.lists[b]);
+          continue;
+        }
+
+        if (m_vertices.empty()) {
+          if (shape == InstanceBatch::Spheres) {
+            sphere->triangles(m_vertices, m_indices);
+            m_normals = m_vertices;
+          }
+          else
+            cylinder->triangles(m_vertices, m_normals, m_indices);
+        }
+
+        if (compiling) {
+          drawBlock(group, b);
+          continue;
+        }
+        if (!group.lists[b])
+          group.lists[b] = glGenLists(1);
+        glNewList(group.lists[b], GL_COMPILE_AND_EXECUTE);
+        drawBlock(group, b);
+        glEndList();
+        group.dirty[b] = 0;
+      }
+    }
+  }
+
+  void InstanceBatchPrivate::drawBlock(const Group &group, int block) const
+  {
+    int first = block * BLOCK_SIZE;
+    int last = std::min<int>(first + BLOCK_SIZE, group.instances.size());
+
+    std::vector<Vector3f> vertices, normals;
+    std::vector<unsigned int> indices;
+    for (int n = first; n < last; ++n) {
+      const Instance &instance = instances[group.instances[n]];
+
+      if (shape == InstanceBatch::Spheres) {
+        unsigned int offset = vertices.size();
+        Vector3f center = instance.end1.cast<float>();
+        float radius = static_cast<float>(instance.radius);
+        for (unsigned int v = 0; v < m_vertices.size(); ++v) {
+          vertices.push_back(center + radius * m_vertices[v]);
+          normals.push_back(m_normals[v]);
+        }
+        for (unsigned int i = 0; i < m_indices.size(); ++i)
+          indices.push_back(offset + m_indices[i]);
+        continue;
+      }
+
+      // Place the cylinders as Cylinder::drawMulti() does
+      Vector3d axis = instance.end2 - instance.end1;
+      if (axis.norm() < 1e-9)
+        continue;
+      Vector3d axisNormalized = axis.normalized();
+      Vector3d ortho1 = axisNormalized.cross(planeNormal);
+      if (ortho1.norm() > 0.001)
+        ortho1.normalize();
+      else
+        ortho1 = axisNormalized.unitOrthogonal();
+      Vector3d ortho2 = axisNormalized.cross(ortho1);
+
+      double angleOffset = 0.0;
+      if (instance.order == 3)
+        angleOffset = 90.0;
+      else if (instance.order > 3)
+        angleOffset = 22.5;
+      double shift = instance.order > 1 ? instance.shift : 0.0;
+
+      for (int k = 0; k < instance.order; ++k) {
+        double angle = (angleOffset + 360.0 * k / instance.order) * M_PI / 180.0;
+        double c = cos(angle), s = sin(angle);
+        unsigned int offset = vertices.size();
+        for (unsigned int v = 0; v < m_vertices.size(); ++v) {
+          const Vector3f &p = m_vertices[v];
+          const Vector3f &q = m_normals[v];
+          double x = p.x() * instance.radius + shift;
+          double y = p.y() * instance.radius;
+          vertices.push_back((instance.end1 + ortho1 * (c * x - s * y)
+                              + ortho2 * (s * x + c * y)
+                              + axis * p.z()).cast<float>());
+          normals.push_back((ortho1 * (c * q.x() - s * q.y())
+                             + ortho2 * (s * q.x() + c * q.y())).cast<float>());
+        }
+        for (unsigned int i = 0; i < m_indices.size(); ++i)
+          indices.push_back(offset + m_indices[i]);
+      }
+    }
+
+    if (indices.empty())
+      return;
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, vertices[0].data());
+    glNormalPointer(GL_FLOAT, 0, normals[0].data());
+    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, &indices[0]);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+  }
+
+  InstanceBatch::InstanceBatch(Shape shape)
+    : d(new InstanceBatchPrivate(shape))
+  {
+  }
+
+  InstanceBatch::~InstanceBatch()
+  {
+    delete d;
+  }
+
+  InstanceBatch::Shape InstanceBatch::shape() const
+  {
+    return d->shape;
+  }
+
+  void InstanceBatch::resize(int size)
+  {
+    if (size == static_cast<int>(d->instances.size()))
+      return;
+
+    InstanceBatchPrivate::Instance instance;
+    instance.end1 = instance.end2 = Vector3d::Zero();
+    instance.radius = 0.0;
+    instance.shift = 0.0;
+    instance.order = 1;
+    std::fill(instance.color, instance.color + 4, 1.0f);
+    d->instances.resize(size, instance);
+    d->changed.resize(size, 0);
+    d->regroup = true;
+  }
+
+  int InstanceBatch::size() const
+  {
+    return d->instances.size();
+  }
+
+  void InstanceBatch::setSphere(int i, const Vector3d &center, double radius,
+                                const Color *color)
+  {
+    setCylinder(i, center, center, radius, color);
+  }
+
+  void InstanceBatch::setCylinder(int i, const Vector3d &end1,
+                                  const Vector3d &end2, double radius,
+                                  const Color *color, int order, double shift)
+  {
+    InstanceBatchPrivate::Instance &instance = d->instances[i];
+    const float rgba[4] = { color->red(), color->green(), color->blue(),
+                            color->alpha() };
+    if (!std::equal(rgba, rgba + 4, instance.color)) {
+      std::copy(rgba, rgba + 4, instance.color);
+      d->regroup = true;
+    }
+    // Multiple cylinders are grouped apart from single ones
+    if ((instance.order > 1) != (order > 1))
+      d->regroup = true;
+    if (instance.end1 != end1 || instance.end2 != end2
+        || instance.radius != radius || instance.order != order
+        || instance.shift != shift) {
+      instance.end1 = end1;
+      instance.end2 = end2;
+      instance.radius = radius;
+      instance.order = order;
+      instance.shift = shift;
+      d->changed[i] = 1;
+    }
+  }
+
+  void InstanceBatch::setEnds(int i, const Vector3d &end1,
+                              const Vector3d &end2)
+  {
+    InstanceBatchPrivate::Instance &instance = d->instances[i];
+    if (instance.end1 != end1 || instance.end2 != end2) {
+      instance.end1 = end1;
+      instance.end2 = end2;
+      d->changed[i] = 1;
+    }
+  }
+
+  const Vector3d & InstanceBatch::end1(int i) const
+  {
+    return d->instances[i].end1;
+  }
+
+  const Vector3d & InstanceBatch::end2(int i) const
+  {
+    return d->instances[i].end2;
+  }
+
+  double InstanceBatch::radius(int i) const
+  {
+    return d->instances[i].radius;
+  }
+
+  int InstanceBatch::order(int i) const
+  {
+    return d->instances[i].order;
+  }
+
+  double InstanceBatch::shift(int i) const
+  {
+    return d->instances[i].shift;
+  }
+
+  const float * InstanceBatch::color(int i) const
+  {
+    return d->instances[i].color;
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,167 @@
+/**********************************************************************
+  InstanceBatch - spheres or cylinders drawn together by a Painter
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef INSTANCEBATCH_H
+#define INSTANCEBATCH_H
+
+#include <avogadro/global.h>
+
+#include <Eigen/Core>
+
+namespace Avogadro {
+
+  class Color;
+  class GLPainter;
+  class InstanceBatchPrivate;
+
+  /**
+   * @class InstanceBatch instancebatch.h <avogadro/instancebatch.h>
+   * @brief Spheres or cylinders drawn together by Painter::drawBatch().
+   *
+   * Engines set the position, radius and color of every instance each time
+   * they render, then draw the whole batch at once. Setting an instance to
+   * the values it already has does not mark it as changed, so a painter that
+   * keeps the geometry on the graphics card only updates the instances that
+   * moved or changed size. GLPainter groups the instances by color into
+   * display lists of a few thousand instances each, so a static scene is
+   * drawn with a handful of glCallList() calls, and a moved atom only
+   * recompiles the list it is in. Rotating the view only recompiles the
+   * lists of multiple bonds, and zooming recompiles the batch when its
+   * detail level changes.
+   */
+  class A_EXPORT InstanceBatch
+  {
+    public:
+      /**
+       * The shape of every instance in the batch.
+       */
+      enum Shape {
+        Spheres = 0,
+        Cylinders
+      };
+
+      /**
+       * Constructor.
+       * @param shape The shape of the instances.
+       */
+      explicit InstanceBatch(Shape shape = Spheres);
+
+      /**
+       * Destructor, frees any display lists of the batch. The context of the
+       * widget that last drew the batch is made current to do so.
+       */
+      ~InstanceBatch();
+
+      /**
+       * @return The shape of the instances.
+       */
+      Shape shape() const;
+
+      /**
+       * Set the number of instances, new instances are spheres of radius 0
+       * at the origin.
+       */
+      void resize(int size);
+
+      /**
+       * @return The number of instances.
+       */
+      int size() const;
+
+      /**
+       * Set a sphere.
+       * @param i The index of the instance.
+       * @param center The center of the sphere.
+       * @param radius The radius of the sphere.
+       * @param color The color of the sphere.
+       */
+      void setSphere(int i, const Eigen::Vector3d &center, double radius,
+                     const Color *color);
+
+      /**
+       * Set a cylinder, or several parallel cylinders for a multiple bond as
+       * drawn by Painter::drawMultiCylinder().
+       * @param i The index of the instance.
+       * @param end1 The center of the first end of the cylinder.
+       * @param end2 The center of the second end of the cylinder.
+       * @param radius The radius of the cylinder.
+       * @param color The color of the cylinder.
+       * @param order The number of parallel cylinders.
+       * @param shift The distance of each cylinder from the axis.
+       */
+      void setCylinder(int i, const Eigen::Vector3d &end1,
+                       const Eigen::Vector3d &end2, double radius,
+                       const Color *color, int order = 1,
+                       double shift = 0.0);
+
+      /**
+       * Move an instance, keeping its radius, color and order. This lets an
+       * engine update only the instances of moved atoms.
+       * @param i The index of the instance.
+       * @param end1 The center of a sphere or the first end of a cylinder.
+       * @param end2 The center of a sphere or the second end of a cylinder.
+       */
+      void setEnds(int i, const Eigen::Vector3d &end1,
+                   const Eigen::Vector3d &end2);
+
+      /**
+       * @return The center of a sphere or the first end of a cylinder.
+       */
+      const Eigen::Vector3d & end1(int i) const;
+
+      /**
+       * @return The second end of a cylinder.
+       */
+      const Eigen::Vector3d & end2(int i) const;
+
+      /**
+       * @return The radius of the instance.
+       */
+      double radius(int i) const;
+
+      /**
+       * @return The number of parallel cylinders.
+       */
+      int order(int i) const;
+
+      /**
+       * @return The distance of each parallel cylinder from the axis.
+       */
+      double shift(int i) const;
+
+      /**
+       * @return The red, green, blue and alpha channels of the instance.
+       */
+      const float * color(int i) const;
+
+    private:
+      InstanceBatchPrivate * const d;
+      friend class GLPainter;
+
+      // Not copyable, the display lists belong to one batch
+      InstanceBatch(const InstanceBatch &);
+      InstanceBatch & operator=(const InstanceBatch &);
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -0,0 +1,116 @@
+/**********************************************************************
+  InstanceBatch - spheres or cylinders drawn together by a Painter
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef INSTANCEBATCH_P_H
+#define INSTANCEBATCH_P_H
+
+#include "config.h"
+
+#include "instancebatch.h"
+
+#ifdef ENABLE_GLSL
+  #include <GL/glew.h>
+#endif
+#include <QGLWidget>
+#include <QPointer>
+
+#include <vector>
+
+namespace Avogadro {
+
+  class Sphere;
+  class Cylinder;
+
+  /**
+   * @class InstanceBatchPrivate
+   * @internal
+   * The instances of an InstanceBatch and the display lists GLPainter draws
+   * them with. The instances are grouped by color, and each group is split
+   * into blocks with one display list each, so that changing an instance
+   * only recompiles its block. Multiple cylinders are kept in groups of
+   * their own, since only they are recompiled when the plane normal
+   * changes.
+   */
+  class InstanceBatchPrivate
+  {
+    public:
+      struct Instance
+      {
+        Eigen::Vector3d end1, end2;
+        double radius;
+        double shift;
+        int order;
+        float color[4];
+      };
+
+      struct Group
+      {
+        float color[4];
+        bool multiple;                // Instances of order > 1
+        std::vector<int> instances;   // Instances with this color
+        std::vector<GLuint> lists;    // One display list per block
+        std::vector<char> dirty;      // Blocks to be recompiled
+      };
+
+      InstanceBatchPrivate(InstanceBatch::Shape shape);
+      ~InstanceBatchPrivate();
+
+      InstanceBatch::Shape shape;
+      std::vector<Instance> instances;
+      std::vector<char> changed;      // Moved or resized since the last draw
+      bool regroup;                   // Added, removed or recolored
+
+      std::vector<Group> groups;
+      std::vector<int> groupOf;       // The group of each instance
+      std::vector<int> indexInGroup;  // The position of each in its group
+      int detail;                     // Detail of the compiled geometry
+      Eigen::Vector3d planeNormal;    // Used to place multiple cylinders
+      QPointer<QGLWidget> widget;     // Owns the context of the lists
+
+      /**
+       * Draw the instances, compiling the blocks that changed. When called
+       * while another display list is being compiled the changed blocks are
+       * drawn directly, and compiled on a later call.
+       * @param sphere The sphere drawn for each instance of a sphere batch.
+       * @param cylinder The cylinder drawn for each instance of a cylinder
+       * batch.
+       * @param detail The detail level of the sphere or cylinder.
+       * @param normal The normal of the plane multiple cylinders lie in.
+       * @param widget The widget whose context is current, its context is
+       * made current again to free the display lists.
+       */
+      void draw(const Sphere *sphere, const Cylinder *cylinder, int detail,
+                const Eigen::Vector3d &normal, QGLWidget *widget);
+
+    private:
+      // Geometry of one sphere or cylinder, fetched when a block is compiled
+      std::vector<Eigen::Vector3f> m_vertices, m_normals;
+      std::vector<unsigned int> m_indices;
+
+      void deleteLists();
+      void group();
+      void drawBlock(const Group &group, int block) const;
+  };
+
+} // End namespace Avogadro
+
+#endif
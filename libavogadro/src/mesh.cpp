@@ -145,6 +145,26 @@ namespace Avogadro {
     }
   }
 
+  const vector<unsigned int> & Mesh::indices() const
+  {
+    QReadLocker lock(m_lock);
+    return m_indices;
+  }
+
+  bool Mesh::setIndices(const vector<unsigned int> &values)
+  {
+    QWriteLocker lock(m_lock);
+    m_indices.clear();
+    m_indices = values;
+    return true;
+  }
+
+  bool Mesh::isIndexed() const
+  {
+    QReadLocker lock(m_lock);
+    return !m_indices.empty();
+  }
+
   const vector<Color3f> & Mesh::colors() const
   {
     QReadLocker lock(m_lock);
@@ -171,6 +191,13 @@ namespace Avogadro {
     return true;
   }
 
+  Color3f * Mesh::resizeColors()
+  {
+    QWriteLocker lock(m_lock);
+    m_colors.resize(m_vertices.size());
+    return m_colors.empty() ? 0 : &m_colors[0];
+  }
+
   bool Mesh::addColors(const vector<Color3f> &values)
   {
     QWriteLocker lock(m_lock);
@@ -192,7 +219,7 @@ namespace Avogadro {
   bool Mesh::valid() const
   {
     QWriteLocker lock(m_lock);
-    if (m_vertices.size() == m_normals.size()) {
+    if (m_vertices.size() == m_normals.size() && m_indices.size() % 3 == 0) {
       if (m_colors.size() == 1 || m_colors.size() == m_vertices.size()) {
         return true;
       }
@@ -211,6 +238,7 @@ namespace Avogadro {
     m_vertices.clear();
     m_normals.clear();
     m_colors.clear();
+    m_indices.clear();
     return true;
   }
 
@@ -219,8 +247,9 @@ namespace Avogadro {
     QWriteLocker lock(m_lock);
     QReadLocker oLock(other.m_lock);
     m_vertices = other.m_vertices;
-    m_normals = other.m_vertices;
+    m_normals = other.m_normals;
     m_colors = other.m_colors;
+    m_indices = other.m_indices;
     m_name = other.m_name;
     return *this;
   }
@@ -172,6 +172,30 @@ namespace Avogadro {
      */
     bool addNormals(const std::vector<Eigen::Vector3f> &values);
 
+    /**
+     * @return Vector containing the vertex indices of the triangles, three per
+     * triangle, where each index selects a vertex with its normal and color.
+     * This is empty unless the Mesh is indexed, otherwise each consecutive
+     * triplet of vertices, normals and colors forms a triangle.
+     */
+    const std::vector<unsigned int> & indices() const;
+
+    /**
+     * @return The number of indices.
+     */
+    unsigned int numIndices() const { return m_indices.size(); }
+
+    /**
+     * Clear the indices vector and assign new values. An indexed Mesh shares
+     * vertices, normals and colors between the triangles that use them.
+     */
+    bool setIndices(const std::vector<unsigned int> &values);
+
+    /**
+     * @return True if the triangles are described by indices().
+     */
+    bool isIndexed() const;
+
     /**
      * @return Vector containing all of the colors in a one-dimensional array.
      */
@@ -187,6 +211,13 @@ namespace Avogadro {
      */
     bool setColors(const std::vector<Color3f> &values);
 
+    /**
+     * Resize the colors vector to one color per vertex so that the colors
+     * can be written in place, e.g. by several threads at once.
+     * @return Pointer to the first color, or 0 if there are no vertices.
+     */
+    Color3f * resizeColors();
+
     /**
      * Add one or more normals, i.e., the vector is expected to be of length
      * 3 x n where n is an integer.
@@ -232,6 +263,7 @@ namespace Avogadro {
     std::vector<Eigen::Vector3f> m_vertices;
     std::vector<Eigen::Vector3f> m_normals;
     std::vector<Color3f> m_colors;
+    std::vector<unsigned int> m_indices;
     QString m_name;
     bool m_stable;
     float m_isoValue;
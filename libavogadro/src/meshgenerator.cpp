@@ -32,12 +32,33 @@
 
 #include <QReadWriteLock>
 #include <QDebug>
+#include <QtConcurrentMap>
+
+#include <algorithm>
 
 using Eigen::Vector3f;
 using Eigen::Vector3i;
 
 namespace Avogadro {
 
+  /**
+   * The range of x layers marched by one thread, along with the vertices and
+   * triangles found. The indices are local to the slab until they are merged.
+   */
+  class MeshSlab
+  {
+  public:
+    MeshGenerator *generator;
+    int begin, end;              /** The x layers of cubes in the slab        */
+    std::vector<Vector3f> vertices, normals;
+    std::vector<unsigned int> indices;
+    std::vector<int> xEdges;     /** Vertex on each x edge of the layer, or -1 */
+    std::vector<int> yEdges[2];  /** Vertex on each y edge of the two planes   */
+    std::vector<int> zEdges[2];  /** Vertex on each z edge of the two planes   */
+    std::vector<int> firstY;     /** y edge vertices on the first plane        */
+    std::vector<int> firstZ;     /** z edge vertices on the first plane        */
+  };
+
   MeshGenerator::MeshGenerator(QObject *parent) :
     QThread(parent),
     m_iso(0.0),
@@ -47,6 +68,7 @@ namespace Avogadro {
     m_spacing(0.0,0.0,0.0),
     m_min(0.0, 0.0, 0.0),
     m_dim(0,0,0),
+    m_parallel(true),
     m_progmin(0),
     m_progmax(0)
   {
@@ -55,7 +77,8 @@ namespace Avogadro {
   MeshGenerator::MeshGenerator(const Cube *cube, Mesh *mesh,
     float iso, bool reverse, QObject *parent) : QThread(parent), m_iso(0.0),
     m_reverseWinding(reverse), m_cube(0), m_mesh(0), m_spacing(0.0,0.0,0.0),
-    m_min(0.0, 0.0, 0.0), m_dim(0,0,0)
+    m_min(0.0, 0.0, 0.0), m_dim(0,0,0), m_parallel(true), m_progmin(0),
+    m_progmax(0)
   {
     initialize(cube, mesh, iso);
   }
@@ -95,37 +118,120 @@ namespace Avogadro {
     m_mesh->setStable(false);
     m_mesh->clear();
 
-    m_vertices.reserve(m_dim.x()*m_dim.y()*m_dim.z()*3);
-    m_normals.reserve(m_dim.x()*m_dim.y()*m_dim.z()*3);
-
     if (!m_cube->lock()->tryLockForRead()) {
       qDebug() << "Cannot get a read lock...";
     }
 
+    // Split the cube in to slabs of x layers, several per thread so that the
+    // load is balanced when the surface only passes through part of the cube
+    int layers = m_dim.x() - 1;
+    int numSlabs = 1;
+    if (m_parallel)
+      numSlabs = qBound(1, 4 * QThread::idealThreadCount(), layers);
+    QVector<MeshSlab> slabs(numSlabs);
+    for (int i = 0; i < numSlabs; ++i) {
+      slabs[i].generator = this;
+      slabs[i].begin = layers * i / numSlabs;
+      slabs[i].end = layers * (i + 1) / numSlabs;
+    }
+
     // Now to march the cube
-    for(int i = 0; i < m_dim.x()-1; ++i) {
-      for(int j = 0; j < m_dim.y()-1; ++j) {
-        for(int k = 0; k < m_dim.z()-1; ++k) {
-          marchingCube(Vector3i(i, j, k));
+    m_progress = 0;
+    if (numSlabs > 1)
+      QtConcurrent::blockingMap(slabs, MeshGenerator::marchSlab);
+    else
+      marchSlab(slabs[0]);
+
+    m_cube->lock()->unlock();
+
+    mergeSlabs(slabs);
+  }
+
+  void MeshGenerator::marchSlab(MeshSlab &slab)
+  {
+    const MeshGenerator *gen = slab.generator;
+    // The edge caches only ever cover the two planes of the current layer
+    unsigned int planeSize = gen->m_dim.y() * gen->m_dim.z();
+    slab.xEdges.assign(planeSize, -1);
+    for (int i = 0; i < 2; ++i) {
+      slab.yEdges[i].assign(planeSize, -1);
+      slab.zEdges[i].assign(planeSize, -1);
+    }
+
+    for(int i = slab.begin; i < slab.end; ++i) {
+      for(int j = 0; j < gen->m_dim.y()-1; ++j) {
+        for(int k = 0; k < gen->m_dim.z()-1; ++k) {
+          gen->marchingCube(slab, Vector3i(i, j, k));
         }
       }
-      if (m_vertices.capacity() < m_vertices.size() + m_dim.y()*m_dim.x()*3) {
-        m_vertices.reserve(m_vertices.capacity()*2);
-        m_normals.reserve(m_normals.capacity()*2);
+      // Keep the vertices on the first plane, they are shared with the
+      // previous slab and replaced by its vertices when merging
+      if (i == slab.begin) {
+        slab.firstY = slab.yEdges[0];
+        slab.firstZ = slab.zEdges[0];
       }
-      emit progressValueChanged(i);
+      // The far plane of this layer is the near plane of the next one
+      slab.yEdges[0].swap(slab.yEdges[1]);
+      slab.zEdges[0].swap(slab.zEdges[1]);
+      std::fill(slab.yEdges[1].begin(), slab.yEdges[1].end(), -1);
+      std::fill(slab.zEdges[1].begin(), slab.zEdges[1].end(), -1);
+      std::fill(slab.xEdges.begin(), slab.xEdges.end(), -1);
+      emit slab.generator->progressValueChanged(
+        slab.generator->m_progress.fetchAndAddOrdered(1) + 1);
     }
+    // Only the last plane is needed now, in yEdges[0] and zEdges[0]
+    std::vector<int>().swap(slab.xEdges);
+    std::vector<int>().swap(slab.yEdges[1]);
+    std::vector<int>().swap(slab.zEdges[1]);
+  }
 
-    m_cube->lock()->unlock();
+  void MeshGenerator::mergeSlabs(const QVector<MeshSlab> &slabs)
+  {
+    std::vector<Vector3f> vertices, normals;
+    std::vector<unsigned int> indices;
+    unsigned int numIndices = 0;
+    foreach (const MeshSlab &slab, slabs)
+      numIndices += slab.indices.size();
+    indices.reserve(numIndices);
+
+    // Global indices of the vertices on the last plane of the previous slab
+    std::vector<int> lastY, lastZ;
+    for (int s = 0; s < slabs.size(); ++s) {
+      const MeshSlab &slab = slabs[s];
+      std::vector<int> map(slab.vertices.size(), -1);
+      if (s > 0) {
+        for (unsigned int i = 0; i < slab.firstY.size(); ++i) {
+          if (slab.firstY[i] >= 0)
+            map[slab.firstY[i]] = lastY[i];
+          if (slab.firstZ[i] >= 0)
+            map[slab.firstZ[i]] = lastZ[i];
+        }
+      }
+      for (unsigned int i = 0; i < map.size(); ++i) {
+        if (map[i] < 0) {
+          map[i] = vertices.size();
+          vertices.push_back(slab.vertices[i]);
+          normals.push_back(slab.normals[i]);
+        }
+      }
+      for (unsigned int i = 0; i < slab.indices.size(); ++i)
+        indices.push_back(map[slab.indices[i]]);
+
+      lastY = slab.yEdges[0];
+      lastZ = slab.zEdges[0];
+      for (unsigned int i = 0; i < lastY.size(); ++i) {
+        if (lastY[i] >= 0)
+          lastY[i] = map[lastY[i]];
+        if (lastZ[i] >= 0)
+          lastZ[i] = map[lastZ[i]];
+      }
+    }
 
     // Copy the data across
-    m_mesh->setVertices(m_vertices);
-    m_mesh->setNormals(m_normals);
+    m_mesh->setVertices(vertices);
+    m_mesh->setNormals(normals);
+    m_mesh->setIndices(indices);
     m_mesh->setStable(true);
-
-    // Now we are done give all that memory back
-    m_vertices.resize(0);
-    m_normals.resize(0);
   }
 
   void MeshGenerator::clear()
@@ -140,41 +246,74 @@ namespace Avogadro {
     m_progmax = 0;
   }
 
-  Vector3f MeshGenerator::normal(const Vector3f &pos)
+  Vector3f MeshGenerator::gradient(const Vector3i &pos) const
   {
-    Vector3f normal(m_cube->valuef(pos - Vector3f(0.01, 0.00, 0.00))
-                  - m_cube->valuef(pos + Vector3f(0.01, 0.00, 0.00)),
-                    m_cube->valuef(pos - Vector3f(0.00, 0.01, 0.00))
-                  - m_cube->valuef(pos + Vector3f(0.00, 0.01, 0.00)),
-                    m_cube->valuef(pos - Vector3f(0.00, 0.00, 0.01))
-                  - m_cube->valuef(pos + Vector3f(0.00, 0.00, 0.01)));
-    normal.normalize();
-    return normal;
+    Vector3f grad;
+    for (int i = 0; i < 3; ++i) {
+      Vector3i lo = pos, hi = pos;
+      if (lo[i] > 0)
+        --lo[i];
+      if (hi[i] < m_dim[i] - 1)
+        ++hi[i];
+      if (hi[i] == lo[i])
+        grad[i] = 0.0;
+      else
+        grad[i] = (m_cube->value(hi) - m_cube->value(lo))
+            / ((hi[i] - lo[i]) * m_spacing[i]);
+    }
+    return grad;
   }
 
-  inline float MeshGenerator::offset(float val1, float val2)
+  inline float MeshGenerator::offset(float val1, float val2) const
   {
     if (val2 - val1 < 1.0e-9f && val1 - val2 < 1.0e-9f)
       return 0.5;
     return (m_iso - val1) / (val2 - val1);
   }
 
-  unsigned long MeshGenerator::duplicate(const Vector3i &, const Vector3f &)
+  unsigned int MeshGenerator::edgeVertex(MeshSlab &slab, const Vector3i &pos,
+                                         int edge, float val1, float val2) const
   {
-    // FIXME Not implemented yet.
-    return 0;
+    // Find the grid edge, the corner at its lower end and the cached vertex
+    const int *corner = a2iVertexOffset[a2iEdgeCornerAxis[edge][0]];
+    int axis = a2iEdgeCornerAxis[edge][1];
+    unsigned int index = (pos.y() + corner[1]) * m_dim.z() + pos.z() + corner[2];
+    int *cached;
+    if (axis == 0)
+      cached = &slab.xEdges[index];
+    else if (axis == 1)
+      cached = &slab.yEdges[corner[0]][index];
+    else
+      cached = &slab.zEdges[corner[0]][index];
+    if (*cached >= 0)
+      return *cached;
+
+    Vector3i lo(pos.x() + corner[0], pos.y() + corner[1], pos.z() + corner[2]);
+    Vector3i hi = lo;
+    ++hi[axis];
+
+    float fOffset = offset(val1, val2);
+    Vector3f vertex(lo.x() * m_spacing.x() + m_min.x(),
+                    lo.y() * m_spacing.y() + m_min.y(),
+                    lo.z() * m_spacing.z() + m_min.z());
+    vertex[axis] += fOffset * m_spacing[axis];
+
+    // The normal points down the gradient, unless the surface is reversed
+    Vector3f normal = (fOffset - 1.0f) * gradient(lo) - fOffset * gradient(hi);
+    if (normal.squaredNorm() > 0.0f)
+      normal.normalize();
+    if (m_reverseWinding)
+      normal = -normal;
+
+    *cached = slab.vertices.size();
+    slab.vertices.push_back(vertex);
+    slab.normals.push_back(normal);
+    return *cached;
   }
 
-  bool MeshGenerator::marchingCube(const Vector3i &pos)
+  bool MeshGenerator::marchingCube(MeshSlab &slab, const Vector3i &pos) const
   {
     float afCubeValue[8];
-    Vector3f asEdgeVertex[12];
-    Vector3f asEdgeNorm[12];
-
-    // Calculate the position in the Cube
-    Vector3f fPos(pos.x() * m_spacing.x() + m_min.x(),
-                  pos.y() * m_spacing.y() + m_min.y(),
-                  pos.z() * m_spacing.z() + m_min.z());
 
     //Make a local copy of the values at the cube's corners
     for(int i = 0; i < 8; ++i) {
@@ -197,24 +336,17 @@ namespace Avogadro {
       return false;
     }
 
-    //Find the point of intersection of the surface with each edge
-    //Then find the normal to the surface at those points
+    //Find the vertex where the surface intersects each edge, these are
+    //shared with the neighboring cubes
+    unsigned int aiEdgeVertex[12];
     for(int i = 0; i < 12; ++i) {
       //if there is an intersection on this edge
       if(iEdgeFlags & (1<<i)) {
-        float fOffset = offset(afCubeValue[a2iEdgeConnection[i][0]],
-                               afCubeValue[a2iEdgeConnection[i][1]]);
-
-        asEdgeVertex[i] = Vector3f(
-          fPos.x() + (a2fVertexOffset[a2iEdgeConnection[i][0]][0]
-                      + fOffset * a2fEdgeDirection[i][0]) * m_spacing.x(),
-          fPos.y() + (a2fVertexOffset[a2iEdgeConnection[i][0]][1]
-                      + fOffset * a2fEdgeDirection[i][1]) * m_spacing.y(),
-          fPos.z() + (a2fVertexOffset[a2iEdgeConnection[i][0]][2]
-                      + fOffset * a2fEdgeDirection[i][2]) * m_spacing.z());
-
-        /// FIXME Optimize this to only calculate normals when required
-        asEdgeNorm[i] = normal(asEdgeVertex[i]);
+        int lower = a2iEdgeCornerAxis[i][0];
+        int upper = a2iEdgeConnection[i][0] == lower ? a2iEdgeConnection[i][1]
+                                                     : a2iEdgeConnection[i][0];
+        aiEdgeVertex[i] = edgeVertex(slab, pos, i, afCubeValue[lower],
+                                     afCubeValue[upper]);
       }
     }
 
@@ -222,26 +354,17 @@ namespace Avogadro {
     for(int i = 0; i < 5; ++i) {
       if(a2iTriangleConnectionTable[iFlagIndex][3*i] < 0)
         break;
-      int iVertex = 0;
-      iEdgeFlags = a2iTriangleConnectionTable[iFlagIndex][3*i];
       // Make sure we get the triangle winding the right way around!
       if (!m_reverseWinding) {
-        for(int j = 0; j < 3; ++j) {
-          iVertex = a2iTriangleConnectionTable[iFlagIndex][3*i+j];
-          m_indices.push_back(m_vertices.size());
-          m_normals.push_back(asEdgeNorm[iVertex]);
-          m_vertices.push_back(asEdgeVertex[iVertex]);
-        }
+        for(int j = 0; j < 3; ++j)
+          slab.indices.push_back(
+            aiEdgeVertex[a2iTriangleConnectionTable[iFlagIndex][3*i+j]]);
       }
       else {
-        for(int j = 2; j >= 0; --j) {
-          iVertex = a2iTriangleConnectionTable[iFlagIndex][3*i+j];
-          m_indices.push_back(m_vertices.size());
-          m_normals.push_back(-asEdgeNorm[iVertex]);
-          m_vertices.push_back(asEdgeVertex[iVertex]);
-        }
+        for(int j = 2; j >= 0; --j)
+          slab.indices.push_back(
+            aiEdgeVertex[a2iTriangleConnectionTable[iFlagIndex][3*i+j]]);
       }
-
     }
     return true;
   }
@@ -276,6 +399,15 @@ namespace Avogadro {
     {0.0, 0.0, 1.0}, {0.0, 0.0, 1.0}, { 0.0, 0.0, 1.0}, {0.0,  0.0, 1.0}
   };
 
+  // Lists the vertex at the lower end of each edge of the cube, and the axis
+  // the edge runs along (0 = x, 1 = y, 2 = z)
+  const int MeshGenerator::a2iEdgeCornerAxis[12][2] =
+  {
+    {0, 0}, {1, 1}, {3, 0}, {0, 1},
+    {4, 0}, {5, 1}, {7, 0}, {4, 1},
+    {0, 2}, {1, 2}, {2, 2}, {3, 2}
+  };
+
   // Lists the index of the endpoint vertices for the 6 edges of the tetrahedron
   const int MeshGenerator::a2iTetrahedronEdgeConnection[6][2] =
   {
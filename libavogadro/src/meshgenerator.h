@@ -32,6 +32,8 @@
 #include <Eigen/Core>
 
 #include <QThread>
+#include <QAtomicInt>
+#include <QVector>
 
 #include <vector>
 
@@ -39,6 +41,7 @@
 
   class Cube;
   class Mesh;
+  class MeshSlab;
 
   /**
    * @class MeshGenerator meshgenerator.h <avogadro/meshgenerator.h>
@@ -55,6 +58,14 @@
    * You must first initialize the class and then call run() to actually
    * polygonize the isosurface. Connect to the classes finished() signal to
    * do something once the polygonization is complete.
+   *
+   * The Mesh produced is indexed, each vertex lies on an edge of the Cube grid
+   * and is shared by all of the triangles using that edge. Normals are
+   * interpolated from the gradient of the Cube at the grid points.
+   *
+   * The Cube is split into slabs along x that are marched in parallel, each
+   * with its own vertex buffers. The slabs are merged in order once they are
+   * complete, giving exactly the same Mesh as marching the Cube serially.
    */
 
   class A_EXPORT MeshGenerator : public QThread
@@ -97,6 +108,17 @@
      */
     void run();
 
+    /**
+     * Set whether the Cube is split into slabs that are marched in parallel,
+     * the default. The Mesh is identical in either case.
+     */
+    void setParallel(bool parallel) { m_parallel = parallel; }
+
+    /**
+     * @return True if the Cube is marched in parallel.
+     */
+    bool isParallel() const { return m_parallel; }
+
     /**
      * @return The Cube being used by the class.
      */
@@ -130,12 +152,23 @@
 
   protected:
     /**
-     * Get the normal to the supplied point. This operation is quite expensive
-     * and so should be avoided wherever possible.
-     * @param pos The position of the vertex whose normal is needed.
-     * @return The normal vector for the supplied point.
+     * Get the gradient of the Cube at a grid point using central differences,
+     * or one sided differences at the edges of the Cube.
+     * @param pos The integer position of the grid point.
+     * @return The gradient vector at the grid point.
      */
-    Eigen::Vector3f normal(const Eigen::Vector3f &pos);
+    Eigen::Vector3f gradient(const Eigen::Vector3i &pos) const;
+
+    /**
+     * March all of the cubes in a slab, this is called in parallel.
+     */
+    static void marchSlab(MeshSlab &slab);
+
+    /**
+     * Merge the slabs in to the Mesh, dropping the vertices each slab created
+     * on the plane it shares with the previous slab.
+     */
+    void mergeSlabs(const QVector<MeshSlab> &slabs);
 
     /**
      * Get the offset, i.e. the approximate point of intersection of the surface
@@ -143,15 +176,25 @@
      * @param val1 The position of the vertex whose normal is needed.
      * @return The normal vector for the supplied point.
      */
-    float offset(float val1, float val2);
+    float offset(float val1, float val2) const;
 
-    unsigned long duplicate(const Eigen::Vector3i &c,
-                            const Eigen::Vector3f &pos);
+    /**
+     * Get the index of the vertex on a grid edge, adding it if this is the
+     * first cube in the slab to use the edge.
+     * @param slab The slab being marched.
+     * @param pos The integer position of the cube being marched.
+     * @param edge The edge of the cube (0-11).
+     * @param val1 The value at the lower end of the grid edge.
+     * @param val2 The value at the upper end of the grid edge.
+     * @return The index of the vertex.
+     */
+    unsigned int edgeVertex(MeshSlab &slab, const Eigen::Vector3i &pos,
+                            int edge, float val1, float val2) const;
 
     /**
      * Perform a marching cubes step on a single cube.
      */
-    bool marchingCube(const Eigen::Vector3i &pos);
+    bool marchingCube(MeshSlab &slab, const Eigen::Vector3i &pos) const;
 
     float m_iso;               /** The value of the isosurface.                 */
     bool m_reverseWinding;     /** Whether the winding and normals are reversed */
@@ -160,8 +203,8 @@
     Eigen::Vector3f m_spacing; /** The spacing of the cube.                     */
     Eigen::Vector3f m_min;     /** The minimum point in the cube.               */
     Eigen::Vector3i m_dim;     /** The dimensions of the cube.                  */
-    std::vector<Eigen::Vector3f> m_vertices, m_normals;
-    std::vector<unsigned int> m_indices;
+    bool m_parallel;           /** Whether the Cube is marched in parallel.     */
+    QAtomicInt m_progress;     /** The number of x layers that are complete.    */
     int m_progmin;
     int m_progmax;
 
@@ -174,6 +217,7 @@
     static const int   a2iVertexOffset[8][3];
     static const int   a2iEdgeConnection[12][2];
     static const float a2fEdgeDirection[12][3];
+    static const int   a2iEdgeCornerAxis[12][2];
     static const int   a2iTetrahedronEdgeConnection[6][2];
     static const int   a2iTetrahedronsInACube[6][4];
     static const long  aiTetrahedronEdgeFlags[16];
@@ -52,6 +52,7 @@
 
 #include <QtCore/QDir>
 #include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
 #include <QtCore/QVariant>
 #include <QtCore/QVector>
 
@@ -64,10 +65,22 @@ namespace Avogadro{
     public:
       MoleculePrivate() : farthestAtom(0), invalidGeomInfo(true),
                           invalidRings(true), invalidGroupIndices(true),
-                          obmol(0), obunitcell(0),
-                          obvibdata(0), obdosdata(0),
-                          obelectronictransitiondata(0)
+                          obmol(0), obmolMutex(QMutex::Recursive),
+                          invalidOBMol(true), obmolAllMoved(false),
+                          obmolAllChanged(false), obmolRebuilds(0),
+                          obunitcell(0), obvibdata(0), obdosdata(0),
+                          obelectronictransitiondata(0), bulkInserts(0)
     {}
+      ~MoleculePrivate() { delete obmol; }
+
+      void resizeAtomArrays(std::vector<int>::size_type size) const
+      {
+        atomicNumbers.resize(size, 0);
+        vdwRadii.resize(size, 0.0);
+        covalentRadii.resize(size, 0.0);
+        customRadii.resize(size, 0.0);
+        partialCharges.resize(size, 0.0);
+      }
     // These are logically cached variables and thus are marked as mutable.
     // Const objects should be logically constant (and not mutable)
     // http://www.highprogrammer.com/alan/rants/mutable.html
@@ -80,6 +93,13 @@ namespace Avogadro{
       mutable bool                  invalidGroupIndices;
       mutable std::vector<double>   energies;
 
+      // Contiguous per-atom data, indexed by unique id like the conformers
+      mutable std::vector<int>      atomicNumbers;
+      mutable std::vector<double>   vdwRadii;
+      mutable std::vector<double>   covalentRadii;
+      mutable std::vector<double>   customRadii;
+      mutable std::vector<double>   partialCharges;
+
       // std::vector used over QVector due to index issues, QVector uses ints
       std::vector<Cube *>           cubes;
       std::vector<Mesh *>           meshes;
@@ -94,8 +114,17 @@ namespace Avogadro{
       QList<Fragment *>             ringList;
       QList<ZMatrix *>              zMatrixList;
 
-      // Our OpenBabel OBMol object
-      OpenBabel::OBMol *            obmol;
+      // Our cached OpenBabel OBMol object, kept in sync using the dirty
+      // flags below and protected by its own mutex as it is used by threads
+      mutable OpenBabel::OBMol *    obmol;
+      mutable QMutex                obmolMutex;
+      mutable bool                  invalidOBMol;
+      mutable bool                  obmolAllMoved;
+      mutable bool                  obmolAllChanged;
+      // Unique ids of atoms that moved or changed since the last sync
+      mutable std::vector<unsigned long> obmolMovedAtoms;
+      mutable std::vector<unsigned long> obmolChangedAtoms;
+      mutable unsigned long         obmolRebuilds;
       // Our OpenBabel OBUnitCell object (if any)
       OpenBabel::OBUnitCell *       obunitcell;
       // Our OpenBabel OBVibrationData object (if any)
@@ -105,6 +134,8 @@ namespace Avogadro{
       OpenBabel::OBDOSData *        obdosdata;
       OpenBabel::OBElectronicTransitionData *
                                     obelectronictransitiondata;
+      // Nesting depth of beginBulkInsert(), no added signals while > 0
+      int                           bulkInserts;
   };
 
   Molecule::Molecule(QObject *parent) : Primitive(MoleculeType, parent),
@@ -183,9 +214,14 @@ namespace Avogadro{
 
     atom->setId(id);
     atom->setIndex(m_atomList.size()-1);
+    updateAtomArrays(atom);
+    setAtomArrayCharge(id, 0.0);
     // now that the id is correct, emit the signal
     connect(atom, SIGNAL(updated()), this, SLOT(updateAtom()));
     d->invalidGroupIndices = true;
+    if (d->bulkInserts)
+      return atom;
+    invalidateOBMol();
     emit atomAdded(atom);
     return atom;
   }
@@ -198,6 +234,7 @@ namespace Avogadro{
 
     newAtom->m_atomicNumber = atomicNum;
     (*m_atomPos)[newId] = pos;
+    updateAtomArrays(newAtom);
 
     return newAtom;
   }
@@ -217,6 +254,7 @@ namespace Avogadro{
     if (id < m_atomPos->size()) {
       (*m_atomPos)[id] = vec;
       d->invalidGeomInfo = true;
+      invalidateOBMolAtomPos(id);
     }
   }
 
@@ -226,6 +264,70 @@ namespace Avogadro{
       setAtomPos(id, *vec);
   }
 
+  bool Molecule::setAtomPositions(const double *coordinates, int first,
+                                  int count, bool wait)
+  {
+    Q_D(Molecule);
+    const int numAtoms = m_atomList.size();
+    if (!coordinates || first < 0 || first > numAtoms)
+      return false;
+    if (count < 0 || count > numAtoms - first)
+      count = numAtoms - first;
+
+    if (wait)
+      m_lock->lockForWrite();
+    else if (!m_lock->tryLockForWrite())
+      return false;
+    for (int i = first; i < first + count; ++i) {
+      (*m_atomPos)[m_atomList[i]->id()] = Eigen::Vector3d(coordinates);
+      coordinates += 3;
+    }
+    d->invalidGeomInfo = true;
+    m_lock->unlock();
+
+    if (count == numAtoms)
+      invalidateOBMolAtomPos(FALSE_ID);
+    else
+      for (int i = first; i < first + count; ++i)
+        invalidateOBMolAtomPos(m_atomList[i]->id());
+
+    emit geometryChanged(first, count);
+    emit updated();
+    return true;
+  }
+
+  bool Molecule::swapAtomPositions(std::vector<Eigen::Vector3d> &positions,
+                                   bool wait)
+  {
+    return swapAtomPositions(positions, std::vector<Eigen::Vector3d>(), wait);
+  }
+
+  bool Molecule::swapAtomPositions(std::vector<Eigen::Vector3d> &positions,
+                                   const std::vector<Eigen::Vector3d> &forces,
+                                   bool wait)
+  {
+    Q_D(Molecule);
+    if (!m_atomPos || positions.size() != m_atomPos->size()
+        || (!forces.empty() && forces.size() != positions.size()))
+      return false;
+
+    if (wait)
+      m_lock->lockForWrite();
+    else if (!m_lock->tryLockForWrite())
+      return false;
+    m_atomPos->swap(positions);
+    if (!forces.empty())
+      foreach (Atom *atom, m_atomList)
+        atom->setForceVector(forces[atom->id()]);
+    d->invalidGeomInfo = true;
+    m_lock->unlock();
+
+    invalidateOBMolAtomPos(FALSE_ID);
+    emit geometryChanged(0, m_atomList.size());
+    emit updated();
+    return true;
+  }
+
   void Molecule::removeAtom(Atom *atom)
   {
     Q_D(const Molecule);
@@ -245,6 +347,7 @@ namespace Avogadro{
 
       disconnect(atom, SIGNAL(updated()), this, SLOT(updateAtom()));
       d->invalidGroupIndices = true;
+      invalidateOBMol();
       emit atomRemoved(atom);
     }
   }
@@ -267,6 +370,8 @@ namespace Avogadro{
     d->invalidRings = true;
     m_invalidPartialCharges = true;
     m_invalidAromaticity = true;
+    if (!d->bulkInserts)
+      invalidateOBMol();
     if(id >= m_bonds.size())
       m_bonds.resize(id+1,0);
     m_bonds[id] = bond;
@@ -276,7 +381,8 @@ namespace Avogadro{
     bond->setIndex(m_bondList.size()-1);
     // now that the id is correct, emit the signal
     connect(bond, SIGNAL(updated()), this, SLOT(updateBond()));
-    emit bondAdded(bond);
+    if (!d->bulkInserts)
+      emit bondAdded(bond);
     return(bond);
   }
 
@@ -314,6 +420,7 @@ namespace Avogadro{
       d->invalidRings = true;
       m_invalidPartialCharges = true;
       m_invalidAromaticity = true;
+      invalidateOBMol();
       Bond *bond = m_bonds[id];
       m_bonds[id] = 0;
       // Delete the bond from the list and reorder the remaining bonds
@@ -405,6 +512,7 @@ namespace Avogadro{
 
     cube->setId(id);
     cube->setIndex(d->cubeList.size()-1);
+    invalidateOBMol();
 
     // now that the id is correct, emit the signal
     connect(cube, SIGNAL(updated()), this, SLOT(updatePrimitive()));
@@ -424,6 +532,7 @@ namespace Avogadro{
         d->cubeList[i]->setIndex(i);
 
       cube->deleteLater();
+      invalidateOBMol();
       disconnect(cube, SIGNAL(updated()), this, SLOT(updatePrimitive()));
       emit primitiveRemoved(cube);
     }
@@ -523,6 +632,7 @@ namespace Avogadro{
 
     residue->setId(id);
     residue->setIndex(d->residueList.size()-1);
+    invalidateOBMol();
 
     // now that the id is correct, emit the signal
     connect(residue, SIGNAL(updated()), this, SLOT(updatePrimitive()));
@@ -543,6 +653,7 @@ namespace Avogadro{
       }
 
       residue->deleteLater();
+      invalidateOBMol();
       disconnect(residue, SIGNAL(updated()), this, SLOT(updatePrimitive()));
       emit primitiveRemoved(residue);
     }
@@ -800,11 +911,16 @@ namespace Avogadro{
     if (numAtoms() < 1 || !m_invalidPartialCharges) {
       return;
     }
-    OpenBabel::OBMol obmol = OBMol();
+    Q_D(const Molecule);
+    QMutexLocker locker(&d->obmolMutex);
+    OpenBabel::OBMol *obmol = cachedOBMol();
     for (unsigned int i = 0; i < numAtoms(); ++i) {
       // Warning: OB off-by-one index
-      atom(i)->setPartialCharge(obmol.GetAtom(i+1)->GetPartialCharge());
+      atom(i)->setPartialCharge(obmol->GetAtom(i+1)->GetPartialCharge());
     }
+    // The charges were just read from the cached OBMol, no need to sync them
+    d->obmolAllChanged = false;
+    d->obmolChangedAtoms.clear();
     m_invalidPartialCharges = false;
   }
 
@@ -813,9 +929,11 @@ namespace Avogadro{
     if (numBonds() < 1 || !m_invalidAromaticity)
       return;
 
-    OpenBabel::OBMol obmol = OBMol();
-    for (unsigned int i = 0; i < obmol.NumBonds(); ++i) {
-      bond(i)->setAromaticity(obmol.GetBond(i)->IsAromatic());
+    Q_D(const Molecule);
+    QMutexLocker locker(&d->obmolMutex);
+    OpenBabel::OBMol *obmol = cachedOBMol();
+    for (unsigned int i = 0; i < obmol->NumBonds(); ++i) {
+      bond(i)->setAromaticity(obmol->GetBond(i)->IsAromatic());
     }
     m_invalidAromaticity = false;
   }
@@ -872,6 +990,68 @@ namespace Avogadro{
     return m_atomList.size();
   }
 
+  const std::vector<Eigen::Vector3d> & Molecule::atomPositions() const
+  {
+    static const std::vector<Eigen::Vector3d> empty;
+    if (m_atomPos)
+      return *m_atomPos;
+    else
+      return empty;
+  }
+
+  const std::vector<int> & Molecule::atomicNumbers() const
+  {
+    Q_D(const Molecule);
+    return d->atomicNumbers;
+  }
+
+  const std::vector<double> & Molecule::vdwRadii() const
+  {
+    Q_D(const Molecule);
+    return d->vdwRadii;
+  }
+
+  const std::vector<double> & Molecule::covalentRadii() const
+  {
+    Q_D(const Molecule);
+    return d->covalentRadii;
+  }
+
+  const std::vector<double> & Molecule::customRadii() const
+  {
+    Q_D(const Molecule);
+    return d->customRadii;
+  }
+
+  const std::vector<double> & Molecule::partialCharges() const
+  {
+    Q_D(const Molecule);
+    calculatePartialCharges();
+    return d->partialCharges;
+  }
+
+  void Molecule::updateAtomArrays(const Atom *atom) const
+  {
+    Q_D(const Molecule);
+    const unsigned long id = atom->id();
+    if (id >= d->atomicNumbers.size())
+      d->resizeAtomArrays(m_atoms.size() > id ? m_atoms.size() : id + 1);
+
+    const int atomicNumber = atom->atomicNumber();
+    d->atomicNumbers[id] = atomicNumber;
+    d->vdwRadii[id] = OpenBabel::etab.GetVdwRad(atomicNumber);
+    d->covalentRadii[id] = OpenBabel::etab.GetCovalentRad(atomicNumber);
+    d->customRadii[id] = atom->customRadius();
+  }
+
+  void Molecule::setAtomArrayCharge(unsigned long id, double charge) const
+  {
+    Q_D(const Molecule);
+    if (id >= d->partialCharges.size())
+      d->resizeAtomArrays(m_atoms.size() > id ? m_atoms.size() : id + 1);
+    d->partialCharges[id] = charge;
+  }
+
   unsigned int Molecule::numBonds() const
   {
     return m_bondList.size();
@@ -914,6 +1094,10 @@ namespace Avogadro{
     Q_D(Molecule);
     Primitive *primitive = qobject_cast<Primitive *>(sender());
     d->invalidGeomInfo = true;
+    // Residues and cubes are mirrored in the cached OBMol
+    if (primitive && (primitive->type() == ResidueType ||
+                      primitive->type() == CubeType))
+      invalidateOBMol();
     emit primitiveUpdated(primitive);
   }
 
@@ -923,12 +1107,15 @@ namespace Avogadro{
     Atom *atom = qobject_cast<Atom *>(sender());
     d->invalidGeomInfo = true;
     d->invalidGroupIndices = true;
+    if (atom)
+      invalidateOBMolAtom(atom->id());
     emit atomUpdated(atom);
   }
 
   void Molecule::updateBond()
   {
     Bond *bond = qobject_cast<Bond *>(sender());
+    invalidateOBMol();
     emit bondUpdated(bond);
   }
 
@@ -977,6 +1164,8 @@ namespace Avogadro{
         m_atomConformers.push_back( new vector<Vector3d>(m_atomPos->size()) );
     }
     *m_atomConformers[index] = conformer;
+    if (m_atomConformers[index] == m_atomPos)
+      invalidateOBMolAtomPos(FALSE_ID);
     return true;
   }
 
@@ -1024,6 +1213,7 @@ namespace Avogadro{
         m_atomPos->push_back(Eigen::Vector3d::Zero());
       // set the current conformer index
       m_currentConformer = index;
+      invalidateOBMolAtomPos(FALSE_ID);
       return true;
     }
   }
@@ -1053,6 +1243,7 @@ namespace Avogadro{
 
     m_atomPos = m_atomConformers[0];
     m_currentConformer = 0;
+    invalidateOBMolAtomPos(FALSE_ID);
     return true;
   }
 
@@ -1063,6 +1254,7 @@ namespace Avogadro{
         delete m_atomConformers[i];
       m_atomConformers.resize(1);
       m_atomPos = m_atomConformers[0];
+      invalidateOBMolAtomPos(FALSE_ID);
     }
     m_currentConformer = 0;
   }
@@ -1161,9 +1353,9 @@ namespace Avogadro{
       foreach(Fragment *ring, d->ringList) {
         removeRing(ring);
       }
-      OpenBabel::OBMol obmol = OBMol();
+      QMutexLocker locker(&d->obmolMutex);
       std::vector<OpenBabel::OBRing *> rings;
-      rings = obmol.GetSSSR();
+      rings = cachedOBMol()->GetSSSR();
       foreach(OpenBabel::OBRing *r, rings) {
         Fragment *ring = addRing();
         foreach(int index, r->_path) {
@@ -1178,8 +1370,171 @@ namespace Avogadro{
   OpenBabel::OBMol Molecule::OBMol() const
   {
     Q_D(const Molecule);
-    // Right now we make an OBMol each time
-    OpenBabel::OBMol obmol;
+    QMutexLocker locker(&d->obmolMutex);
+    return *cachedOBMol();
+  }
+
+  OpenBabel::OBMol * Molecule::lockOBMol() const
+  {
+    Q_D(const Molecule);
+    d->obmolMutex.lock();
+    return cachedOBMol();
+  }
+
+  void Molecule::unlockOBMol() const
+  {
+    Q_D(const Molecule);
+    d->obmolMutex.unlock();
+  }
+
+  unsigned long Molecule::numOBMolRebuilds() const
+  {
+    Q_D(const Molecule);
+    return d->obmolRebuilds;
+  }
+
+  void Molecule::invalidateOBMol() const
+  {
+    Q_D(const Molecule);
+    QMutexLocker locker(&d->obmolMutex);
+    d->invalidOBMol = true;
+  }
+
+  void Molecule::invalidateOBMolAtomPos(unsigned long id) const
+  {
+    Q_D(const Molecule);
+    QMutexLocker locker(&d->obmolMutex);
+    if (d->invalidOBMol || d->obmolAllMoved)
+      return;
+    // Once more atoms have moved than there are atoms, sync them all
+    if (id == FALSE_ID || d->obmolMovedAtoms.size() > m_atoms.size()) {
+      d->obmolAllMoved = true;
+      d->obmolMovedAtoms.clear();
+    }
+    else
+      d->obmolMovedAtoms.push_back(id);
+  }
+
+  void Molecule::invalidateOBMolAtom(unsigned long id) const
+  {
+    Q_D(const Molecule);
+    QMutexLocker locker(&d->obmolMutex);
+    if (d->invalidOBMol || d->obmolAllChanged)
+      return;
+    if (id == FALSE_ID || d->obmolChangedAtoms.size() > m_atoms.size()) {
+      d->obmolAllChanged = true;
+      d->obmolChangedAtoms.clear();
+    }
+    else
+      d->obmolChangedAtoms.push_back(id);
+  }
+
+  // Copy the per-atom data of atom to its OBAtom in the cached OBMol. Returns
+  // false if the element changed, which requires perception to be redone.
+  static bool syncOBAtom(Atom *atom, OpenBabel::OBAtom *obatom)
+  {
+    if (!obatom)
+      return false;
+    OpenBabel::OBAtom source = atom->OBAtom();
+    if (source.GetAtomicNum() != obatom->GetAtomicNum())
+      return false;
+    obatom->SetVector(source.GetVector());
+    obatom->SetPartialCharge(source.GetPartialCharge());
+    obatom->SetFormalCharge(source.GetFormalCharge());
+    obatom->DeleteData(OpenBabel::OBGenericDataType::PairData);
+    std::vector<OpenBabel::OBGenericData*> data =
+      source.GetAllData(OpenBabel::OBGenericDataType::PairData);
+    for (OpenBabel::OBDataIterator j = data.begin(); j != data.end(); ++j)
+      obatom->SetData((*j)->Clone(obatom));
+    return true;
+  }
+
+  OpenBabel::OBMol * Molecule::cachedOBMol() const
+  {
+    Q_D(const Molecule);
+    if (!d->obmol || d->invalidOBMol) {
+      rebuildOBMol();
+    }
+    else {
+      // Only sync the atoms that changed since the last call
+      bool rebuild = false;
+      if (d->obmolAllChanged) {
+        foreach(Atom *atom, m_atomList) {
+          if (!syncOBAtom(atom, d->obmol->GetAtom(atom->index() + 1))) {
+            rebuild = true;
+            break;
+          }
+        }
+      }
+      else {
+        foreach(unsigned long id, d->obmolChangedAtoms) {
+          Atom *atom = atomById(id);
+          if (atom && !syncOBAtom(atom, d->obmol->GetAtom(atom->index() + 1))) {
+            rebuild = true;
+            break;
+          }
+        }
+        if (d->obmolAllMoved) {
+          foreach(Atom *atom, m_atomList) {
+            const Vector3d &pos = (*m_atomPos)[atom->id()];
+            d->obmol->GetAtom(atom->index() + 1)->SetVector(pos.x(), pos.y(),
+                                                            pos.z());
+          }
+        }
+        else {
+          foreach(unsigned long id, d->obmolMovedAtoms) {
+            Atom *atom = atomById(id);
+            if (!atom)
+              continue;
+            const Vector3d &pos = (*m_atomPos)[id];
+            d->obmol->GetAtom(atom->index() + 1)->SetVector(pos.x(), pos.y(),
+                                                            pos.z());
+          }
+        }
+      }
+      if (rebuild)
+        rebuildOBMol();
+    }
+    d->obmolAllMoved = false;
+    d->obmolAllChanged = false;
+    d->obmolMovedAtoms.clear();
+    d->obmolChangedAtoms.clear();
+
+    // The molecule level data is cheap to copy, so refresh it every time
+    d->obmol->SetEnergy(this->energy() / KCAL_TO_KJ);
+
+    // Copy unit cells
+    d->obmol->DeleteData(OpenBabel::OBGenericDataType::UnitCell);
+    if (d->obunitcell != NULL) {
+      OpenBabel::OBUnitCell *obunitcell = new OpenBabel::OBUnitCell;
+      *obunitcell = *d->obunitcell;
+      d->obmol->SetData(obunitcell);
+    }
+
+    // Copy OBPairData, if needed
+    d->obmol->DeleteData(OpenBabel::OBGenericDataType::PairData);
+    OpenBabel::OBPairData *obproperty;
+    foreach(const QByteArray &propertyName, dynamicPropertyNames()) {
+      obproperty = new OpenBabel::OBPairData;
+      obproperty->SetAttribute(propertyName.data());
+      obproperty->SetValue(property(propertyName).toByteArray().data());
+      d->obmol->SetData(obproperty);
+    }
+
+    return d->obmol;
+  }
+
+  void Molecule::rebuildOBMol() const
+  {
+    Q_D(const Molecule);
+    if (!d->obmol)
+      d->obmol = new OpenBabel::OBMol;
+    else
+      d->obmol->Clear();
+    ++d->obmolRebuilds;
+    d->invalidOBMol = false;
+
+    OpenBabel::OBMol &obmol = *d->obmol;
     obmol.BeginModify();
 
     foreach(Atom *atom, m_atomList) {
@@ -1248,31 +1603,16 @@ namespace Avogadro{
       OpenBabel::vector3 y(0.0, cube->spacing().y(), 0.0);
       OpenBabel::vector3 z(0.0, 0.0, cube->spacing().z());
       obgrid->SetLimits(origin, x, y, z);
-      obgrid->SetValues(cube->m_data);
+      if (cube->isSinglePrecision())
+        obgrid->SetValues(std::vector<double>(cube->m_dataf.begin(),
+                                              cube->m_dataf.end()));
+      else
+        obgrid->SetValues(cube->m_data);
       obmol.SetData(obgrid);
     }
 
     obmol.EndModify();
 
-    // Copy energy
-    obmol.SetEnergy(this->energy() / KCAL_TO_KJ);
-
-    // Copy unit cells
-    if (d->obunitcell != NULL) {
-      OpenBabel::OBUnitCell *obunitcell = new OpenBabel::OBUnitCell;
-      *obunitcell = *d->obunitcell;
-      obmol.SetData(obunitcell);
-    }
-
-    // Copy OBPairData, if needed
-    OpenBabel::OBPairData *obproperty;
-    foreach(const QByteArray &propertyName, dynamicPropertyNames()) {
-      obproperty = new OpenBabel::OBPairData;
-      obproperty->SetAttribute(propertyName.data());
-      obproperty->SetValue(property(propertyName).toByteArray().data());
-      obmol.SetData(obproperty);
-    }
-
     // Copy vibrations, if needed
     if (d->obvibdata != NULL) {
       obmol.SetData(d->obvibdata->Clone(&obmol));
@@ -1287,8 +1627,6 @@ namespace Avogadro{
     if (d->obelectronictransitiondata != NULL) {
       obmol.SetData(d->obelectronictransitiondata->Clone(&obmol));
     }
-
-    return obmol;
   }
 
   bool Molecule::setOBMol(OpenBabel::OBMol *obmol)
@@ -1539,12 +1877,8 @@ namespace Avogadro{
   bool Molecule::setOBUnitCell(OpenBabel::OBUnitCell *obunitcell)
   {
     Q_D(Molecule);
+    // The cached OBMol picks up the new unit cell on the next sync
     d->obunitcell = obunitcell;
-    if (obunitcell == NULL) {
-      // delete it from our private obmol
-      if (d->obmol)
-        d->obmol->DeleteData(OpenBabel::OBGenericDataType::UnitCell);
-    }
     return true;
   }
 
@@ -1583,6 +1917,7 @@ namespace Avogadro{
 
     Q_D(const Molecule);
     d->invalidGeomInfo = true;
+    invalidateOBMolAtomPos(FALSE_ID);
     foreach (Atom *atom, m_atomList) {
       (*m_atomPos)[atom->id()] += offset;
       emit atomUpdated(atom);
@@ -1592,12 +1927,14 @@ namespace Avogadro{
   void Molecule::clear()
   {
     Q_D(Molecule);
+    invalidateOBMol();
     m_atoms.clear();
     foreach (Atom *atom, m_atomList) {
       atom->deleteLater();
       emit primitiveRemoved(atom);
     }
     m_atomList.clear();
+    d->resizeAtomArrays(0);
     clearConformers();
     delete m_atomPos;
     m_atomPos = 0;
@@ -1833,6 +2170,42 @@ namespace Avogadro{
     return newPrimitives;
   }
 
+  void Molecule::beginBulkInsert(int atoms, int bonds)
+  {
+    Q_D(Molecule);
+    ++d->bulkInserts;
+    if (atoms > 0) {
+      // New atoms take the next unique ids
+      const vector<Atom *>::size_type ids = m_atoms.size() + atoms;
+      m_atoms.reserve(ids);
+      if (m_atomPos)
+        m_atomPos->reserve(ids);
+      d->atomicNumbers.reserve(ids);
+      d->vdwRadii.reserve(ids);
+      d->covalentRadii.reserve(ids);
+      d->customRadii.reserve(ids);
+      d->partialCharges.reserve(ids);
+#if QT_VERSION >= QT_VERSION_CHECK(4,7,0)
+      m_atomList.reserve(m_atomList.size() + atoms);
+#endif
+    }
+    if (bonds > 0) {
+      m_bonds.reserve(m_bonds.size() + bonds);
+#if QT_VERSION >= QT_VERSION_CHECK(4,7,0)
+      m_bondList.reserve(m_bondList.size() + bonds);
+#endif
+    }
+  }
+
+  void Molecule::endBulkInsert()
+  {
+    Q_D(Molecule);
+    if (d->bulkInserts == 0 || --d->bulkInserts)
+      return;
+    invalidateOBMol();
+    updateMolecule();
+  }
+
   PrimitiveList Molecule::copyAtomsAndBonds(const PrimitiveList &atomsAndBonds)
   {
     QList<Atom*> atoms;
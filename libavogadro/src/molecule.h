@@ -193,6 +193,56 @@ namespace Avogadro {
      */
     const Eigen::Vector3d * atomPos(unsigned long id) const;
 
+    /**
+     * Set the positions of a range of atoms in the current conformer from
+     * one contiguous buffer, e.g. the coordinates of an OpenBabel::OBMol.
+     * The write lock is taken once for the whole range, so it must not be
+     * held by the caller, and geometryChanged() and updated() are emitted
+     * once afterwards rather than a signal for each Atom.
+     * @param coordinates The x, y and z coordinates of each atom in the
+     * range, in the order of atoms().
+     * @param first The index of the first Atom to set.
+     * @param count The number of atoms to set, or -1 for all of the atoms
+     * from @p first on.
+     * @param wait If false and the lock is held elsewhere, return without
+     * changing anything rather than waiting for the lock.
+     * @return True if the positions were set.
+     */
+    bool setAtomPositions(const double *coordinates, int first = 0,
+                          int count = -1, bool wait = true);
+
+    /**
+     * Swap the positions of the current conformer with a buffer, so that a
+     * thread computing new geometries, e.g. a force field, can fill one
+     * buffer while the other is drawn. Only the buffers are exchanged under
+     * the write lock, nothing is copied. Like setAtomPositions() the lock
+     * must not be held by the caller, and geometryChanged() and updated()
+     * are emitted once afterwards.
+     * @param positions The new positions, indexed by unique id like
+     * atomPositions() and of the same size. It holds the old positions
+     * afterwards.
+     * @param wait If false and the lock is held elsewhere, return without
+     * changing anything rather than waiting for the lock.
+     * @return True if the positions were swapped.
+     */
+    bool swapAtomPositions(std::vector<Eigen::Vector3d> &positions,
+                           bool wait = true);
+
+    /**
+     * @overload
+     * Also set the force vector of each atom (Atom::forceVector()) under the
+     * same write lock, so that the forces are never drawn with the positions
+     * of another step.
+     * @param positions The new positions, indexed by unique id.
+     * @param forces The forces on the atoms, indexed by unique id like the
+     * positions and of the same size. If empty the forces are unchanged.
+     * @param wait If false and the lock is held elsewhere, return without
+     * changing anything rather than waiting for the lock.
+     */
+    bool swapAtomPositions(std::vector<Eigen::Vector3d> &positions,
+                           const std::vector<Eigen::Vector3d> &forces,
+                           bool wait = true);
+
     /**
      * @return The total number of Atom objects in the molecule.
      */
@@ -200,6 +250,48 @@ namespace Avogadro {
 
     /** @} */
 
+    /** @name Contiguous atom data
+     * These functions give direct, read only access to per-atom data stored
+     * in contiguous arrays. Like the conformers, the arrays are indexed by the
+     * unique id of the Atom (Atom::id()), and entries for ids without an Atom
+     * are left in an undefined state. They are intended for tight loops over
+     * large systems where iterating Atom objects is too expensive.
+     * @note The references are invalidated when atoms are added.
+     * @{
+     */
+
+    /**
+     * @return The positions of all atoms in the current conformer.
+     */
+    const std::vector<Eigen::Vector3d> & atomPositions() const;
+
+    /**
+     * @return The atomic numbers of all atoms.
+     */
+    const std::vector<int> & atomicNumbers() const;
+
+    /**
+     * @return The Van der Waals radii of all atoms, from their element.
+     */
+    const std::vector<double> & vdwRadii() const;
+
+    /**
+     * @return The covalent radii of all atoms, from their element.
+     */
+    const std::vector<double> & covalentRadii() const;
+
+    /**
+     * @return The custom radii of all atoms, 0.0 if no custom radius is set.
+     */
+    const std::vector<double> & customRadii() const;
+
+    /**
+     * @return The partial charges of all atoms. These are calculated first if
+     * they are not valid.
+     */
+    const std::vector<double> & partialCharges() const;
+    /** @} */
+
 
     /** @name Bond properties
      * These functions are used to change and retrieve the properties of the
@@ -731,9 +823,36 @@ namespace Avogadro {
      * Get access to an OpenBabel::OBMol, this is a copy of the internal data
      * structure in OpenBabel form, you must call setOBMol in order to save
      * any changes you make to this object.
+     *
+     * @note The Molecule keeps a cached OpenBabel::OBMol that is synced
+     * incrementally as atoms are moved or changed. Adding or removing atoms,
+     * bonds, residues or cubes causes a full rebuild on the next call.
      */
     OpenBabel::OBMol OBMol() const;
 
+    /**
+     * Lock the cached OpenBabel::OBMol and return it without copying it,
+     * synced with the Molecule like OBMol(). Use it to read large molecules,
+     * e.g. to write them to a file or set up a force field. The OBMol
+     * belongs to the Molecule and must not be changed or kept, and the
+     * Molecule must not be changed until unlockOBMol() is called.
+     * @note Open Babel takes non-const molecules even for reading, e.g. in
+     * OBConversion::Write() and OBForceField::Setup(), so the pointer is
+     * not const.
+     */
+    OpenBabel::OBMol * lockOBMol() const;
+
+    /**
+     * Release the OpenBabel::OBMol returned by lockOBMol().
+     */
+    void unlockOBMol() const;
+
+    /**
+     * @return The number of times the cached OpenBabel::OBMol has been
+     * rebuilt from scratch. Useful for profiling the OpenBabel translation.
+     */
+    unsigned long numOBMolRebuilds() const;
+
     /**
      * Copy as much data as possible from the supplied OpenBabel::OBMol to the
      * Avogadro Molecule object.
@@ -831,6 +950,21 @@ namespace Avogadro {
      * @note The QList overload of this function is faster.
      */
     PrimitiveList copyAtomsAndBonds(const PrimitiveList &atomsAndBonds);
+
+    /**
+     * Start adding many atoms and bonds at once, e.g. when building a
+     * supercell. Room is reserved for them, and addAtom() and addBond() do
+     * not emit atomAdded() and bondAdded() until endBulkInsert(), which emits
+     * moleculeChanged() and updated() once instead. Calls may be nested.
+     * @param atoms The number of atoms that will be added.
+     * @param bonds The number of bonds that will be added.
+     */
+    void beginBulkInsert(int atoms, int bonds = 0);
+
+    /**
+     * Finish adding the atoms and bonds started by beginBulkInsert().
+     */
+    void endBulkInsert();
     /** @} */
 
   protected:
@@ -861,7 +995,53 @@ namespace Avogadro {
      */
     void computeGeomInfo() const;
 
+    /**
+     * Mark the cached OpenBabel::OBMol as stale, it will be rebuilt from
+     * scratch on the next call to OBMol(). Used for topology changes.
+     */
+    void invalidateOBMol() const;
+
+    /**
+     * Mark the position of the Atom with the unique id supplied as changed
+     * in the cached OpenBabel::OBMol. Passing FALSE_ID marks all positions,
+     * e.g. when the current conformer changes.
+     */
+    void invalidateOBMolAtomPos(unsigned long id) const;
+
+    /**
+     * Mark the Atom with the unique id supplied as changed in the cached
+     * OpenBabel::OBMol, all of its data will be synced on the next call to
+     * OBMol().
+     */
+    void invalidateOBMolAtom(unsigned long id) const;
+
+    /**
+     * Update the contiguous atom data of the supplied Atom, called when the
+     * element or custom radius of the Atom changes.
+     */
+    void updateAtomArrays(const Atom *atom) const;
+
+    /**
+     * Update the partial charge of the Atom with the unique id supplied in the
+     * contiguous atom data.
+     */
+    void setAtomArrayCharge(unsigned long id, double charge) const;
+
+    friend class Atom;
+    friend class Bond;
+
   private:
+    /**
+     * Helper function returning the cached OpenBabel::OBMol, rebuilding or
+     * syncing it as required. The caller must hold the OBMol mutex.
+     */
+    OpenBabel::OBMol * cachedOBMol() const;
+
+    /**
+     * Helper function to rebuild the cached OpenBabel::OBMol from scratch.
+     */
+    void rebuildOBMol() const;
+
     /**
      * Helper function for setting cached geometry information from the unit
      * unit cell. This is called as needed by Molecule::computeGeomInfo.
@@ -941,6 +1121,14 @@ namespace Avogadro {
      */
     void atomUpdated(Atom *atom);
 
+    /**
+     * Emitted once when setAtomPositions() moves a range of atoms, instead
+     * of atomUpdated() for each of them. It is followed by updated().
+     * @param first The index of the first Atom that moved.
+     * @param count The number of atoms that moved.
+     */
+    void geometryChanged(int first, int count);
+
     /**
      * Emitted when an Atom is removed.
      * @param Atom pointer to the Atom that was removed.
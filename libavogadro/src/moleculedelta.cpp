@@ -0,0 +1,588 @@
+/**********************************************************************
+  MoleculeDelta - changes to a Molecule that can be undone and redone
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "moleculedelta.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include <QUndoStack>
+
+#include <vector>
+#include <algorithm>
+
+using Eigen::Vector3d;
+
+namespace Avogadro {
+
+  struct AtomState
+  {
+    unsigned long id;
+    bool exists;
+    int atomicNumber;
+    int formalCharge;
+    Vector3d pos;
+
+    bool operator==(const AtomState &other) const
+    {
+      if (exists != other.exists)
+        return false;
+      return !exists || (atomicNumber == other.atomicNumber
+                         && formalCharge == other.formalCharge
+                         && pos == other.pos);
+    }
+  };
+
+  struct BondState
+  {
+    unsigned long id;
+    bool exists;
+    unsigned long beginAtomId, endAtomId;
+    short order;
+
+    bool operator==(const BondState &other) const
+    {
+      if (exists != other.exists)
+        return false;
+      return !exists || (beginAtomId == other.beginAtomId
+                         && endAtomId == other.endAtomId
+                         && order == other.order);
+    }
+  };
+
+  template <typename State>
+  static bool lessId(const State &a, const State &b)
+  {
+    return a.id < b.id;
+  }
+
+  template <typename State>
+  static State removed(const State &state)
+  {
+    State result = state;
+    result.exists = false;
+    return result;
+  }
+
+  // Pair the states of two snapshots sorted by id, keeping the ids whose
+  // state differs
+  template <typename State>
+  static void diff(const std::vector<State> &first,
+                   const std::vector<State> &second,
+                   std::vector<State> &before, std::vector<State> &after)
+  {
+    std::vector<State> b, a;
+    unsigned int i = 0, j = 0;
+    while (i < first.size() || j < second.size()) {
+      if (j == second.size()
+          || (i < first.size() && first[i].id < second[j].id)) {
+        b.push_back(first[i]);
+        a.push_back(removed(first[i++]));
+      }
+      else if (i == first.size() || second[j].id < first[i].id) {
+        b.push_back(removed(second[j]));
+        a.push_back(second[j++]);
+      }
+      else {
+        if (!(first[i] == second[j])) {
+          b.push_back(first[i]);
+          a.push_back(second[j]);
+        }
+        ++i;
+        ++j;
+      }
+    }
+    before.swap(b);
+    after.swap(a);
+  }
+
+  // Compose two closed deltas, the second applied after the first
+  template <typename State>
+  static void compose(std::vector<State> &before, std::vector<State> &after,
+                      const std::vector<State> &laterBefore,
+                      const std::vector<State> &laterAfter)
+  {
+    std::vector<State> b, a;
+    unsigned int i = 0, j = 0;
+    while (i < before.size() || j < laterBefore.size()) {
+      const State *first, *last;
+      if (j == laterBefore.size()
+          || (i < before.size() && before[i].id < laterBefore[j].id)) {
+        first = &before[i];
+        last = &after[i++];
+      }
+      else if (i == before.size() || laterBefore[j].id < before[i].id) {
+        first = &laterBefore[j];
+        last = &laterAfter[j++];
+      }
+      else {
+        first = &before[i++];
+        last = &laterAfter[j++];
+      }
+      if (!(*first == *last)) {
+        b.push_back(*first);
+        a.push_back(*last);
+      }
+    }
+    before.swap(b);
+    after.swap(a);
+  }
+
+  // The snapshot before a closed delta and a later snapshot: the later one
+  // with the states the delta changed put back
+  template <typename State>
+  static void overlay(std::vector<State> &before,
+                      const std::vector<State> &laterSnapshot)
+  {
+    std::vector<State> result;
+    result.reserve(laterSnapshot.size());
+    unsigned int i = 0, j = 0;
+    while (i < before.size() || j < laterSnapshot.size()) {
+      if (j == laterSnapshot.size()
+          || (i < before.size() && before[i].id < laterSnapshot[j].id)) {
+        if (before[i].exists)
+          result.push_back(before[i]);
+        ++i;
+      }
+      else if (i == before.size() || laterSnapshot[j].id < before[i].id)
+        result.push_back(laterSnapshot[j++]);
+      else {
+        if (before[i].exists)
+          result.push_back(before[i]);
+        ++i;
+        ++j;
+      }
+    }
+    before.swap(result);
+  }
+
+  typedef std::vector<std::vector<Vector3d> > Conformers;
+
+  class MoleculeDeltaPrivate
+  {
+    public:
+      MoleculeDeltaPrivate() : open(false), conformers(false),
+        conformerBefore(0), conformerAfter(0) {}
+
+      void snapshot(const Molecule *molecule, std::vector<AtomState> &atoms,
+                    std::vector<BondState> &bonds, Conformers &conformerList,
+                    unsigned int &current) const;
+      void apply(Molecule *molecule, const std::vector<AtomState> &atoms,
+                 const std::vector<BondState> &bonds,
+                 const Conformers &conformerList, unsigned int current) const;
+
+      bool open;
+      // While open the states before hold a snapshot of the whole molecule,
+      // once closed the states of the changed atoms and bonds, paired by
+      // index with the states after
+      std::vector<AtomState> atomsBefore, atomsAfter;
+      std::vector<BondState> bondsBefore, bondsAfter;
+
+      bool conformers;
+      Conformers conformersBefore, conformersAfter;
+      unsigned int conformerBefore, conformerAfter;
+  };
+
+  void MoleculeDeltaPrivate::snapshot(const Molecule *molecule,
+                                      std::vector<AtomState> &atoms,
+                                      std::vector<BondState> &bonds,
+                                      Conformers &conformerList,
+                                      unsigned int &current) const
+  {
+    atoms.clear();
+    bonds.clear();
+    QList<Atom *> atomList = molecule->atoms();
+    atoms.reserve(atomList.size());
+    foreach (Atom *atom, atomList) {
+      AtomState state;
+      state.id = atom->id();
+      state.exists = true;
+      state.atomicNumber = atom->atomicNumber();
+      state.formalCharge = atom->formalCharge();
+      state.pos = *atom->pos();
+      atoms.push_back(state);
+    }
+    QList<Bond *> bondList = molecule->bonds();
+    bonds.reserve(bondList.size());
+    foreach (Bond *bond, bondList) {
+      BondState state;
+      state.id = bond->id();
+      state.exists = true;
+      state.beginAtomId = bond->beginAtomId();
+      state.endAtomId = bond->endAtomId();
+      state.order = bond->order();
+      bonds.push_back(state);
+    }
+    // The lists are in index order, which differs from the id order once
+    // atoms or bonds have been removed
+    std::sort(atoms.begin(), atoms.end(), lessId<AtomState>);
+    std::sort(bonds.begin(), bonds.end(), lessId<BondState>);
+
+    conformerList.clear();
+    if (conformers) {
+      const std::vector<std::vector<Vector3d> *> &all = molecule->conformers();
+      conformerList.resize(all.size());
+      for (unsigned int i = 0; i < all.size(); ++i)
+        conformerList[i] = *all[i];
+      current = molecule->currentConformer();
+    }
+  }
+
+  void MoleculeDeltaPrivate::apply(Molecule *molecule,
+                                   const std::vector<AtomState> &atoms,
+                                   const std::vector<BondState> &bonds,
+                                   const Conformers &conformerList,
+                                   unsigned int current) const
+  {
+    bool topology = false;
+
+    // Remove the bonds first, then the atoms, so that bonds are only added
+    // between atoms that exist
+    for (unsigned int i = 0; i < bonds.size(); ++i) {
+      const BondState &state = bonds[i];
+      Bond *bond = molecule->bondById(state.id);
+      if (bond && (!state.exists || bond->beginAtomId() != state.beginAtomId
+                   || bond->endAtomId() != state.endAtomId)) {
+        molecule->removeBond(bond);
+        topology = true;
+      }
+    }
+    for (unsigned int i = 0; i < atoms.size(); ++i) {
+      const AtomState &state = atoms[i];
+      if (!state.exists && molecule->atomById(state.id)) {
+        molecule->removeAtom(state.id);
+        topology = true;
+      }
+    }
+
+    for (unsigned int i = 0; i < atoms.size(); ++i) {
+      const AtomState &state = atoms[i];
+      if (!state.exists)
+        continue;
+      Atom *atom = molecule->atomById(state.id);
+      if (!atom) {
+        atom = molecule->addAtom(state.id);
+        topology = true;
+      }
+      if (atom->atomicNumber() != state.atomicNumber)
+        atom->setAtomicNumber(state.atomicNumber);
+      molecule->setAtomPos(state.id, state.pos);
+    }
+    for (unsigned int i = 0; i < bonds.size(); ++i) {
+      const BondState &state = bonds[i];
+      if (!state.exists)
+        continue;
+      Bond *bond = molecule->bondById(state.id);
+      if (!bond) {
+        bond = molecule->addBond(state.id);
+        bond->setAtoms(state.beginAtomId, state.endAtomId, state.order);
+        topology = true;
+      }
+      else if (bond->order() != state.order)
+        bond->setOrder(state.order);
+    }
+    // Unassigned formal charges are guessed from the bonds, so they are
+    // compared once the bonds are back
+    for (unsigned int i = 0; i < atoms.size(); ++i) {
+      const AtomState &state = atoms[i];
+      Atom *atom = state.exists ? molecule->atomById(state.id) : 0;
+      if (atom && atom->formalCharge() != state.formalCharge)
+        atom->setFormalCharge(state.formalCharge);
+    }
+
+    if (conformers && !conformerList.empty()) {
+      unsigned long size = molecule->conformerSize();
+      std::vector<std::vector<Vector3d> *> all(conformerList.size());
+      for (unsigned int i = 0; i < conformerList.size(); ++i) {
+        all[i] = new std::vector<Vector3d>(conformerList[i]);
+        all[i]->resize(size, Vector3d::Zero());
+      }
+      molecule->setAllConformers(all);
+      molecule->setConformer(current);
+    }
+
+    if (topology)
+      molecule->updateMolecule();
+    else
+      molecule->update();
+  }
+
+  MoleculeDelta::MoleculeDelta() : d(new MoleculeDeltaPrivate)
+  {
+  }
+
+  MoleculeDelta::MoleculeDelta(const MoleculeDelta &other)
+    : d(new MoleculeDeltaPrivate(*other.d))
+  {
+  }
+
+  MoleculeDelta::~MoleculeDelta()
+  {
+    delete d;
+  }
+
+  MoleculeDelta & MoleculeDelta::operator=(const MoleculeDelta &other)
+  {
+    if (this != &other)
+      *d = *other.d;
+    return *this;
+  }
+
+  void MoleculeDelta::begin(const Molecule *molecule, bool conformers)
+  {
+    clear();
+    if (!molecule)
+      return;
+    d->conformers = conformers;
+    d->snapshot(molecule, d->atomsBefore, d->bondsBefore,
+                d->conformersBefore, d->conformerBefore);
+    d->open = true;
+  }
+
+  void MoleculeDelta::end(const Molecule *molecule)
+  {
+    if (!d->open || !molecule)
+      return;
+    std::vector<AtomState> atoms;
+    std::vector<BondState> bonds;
+    d->snapshot(molecule, atoms, bonds, d->conformersAfter, d->conformerAfter);
+    diff(d->atomsBefore, atoms, d->atomsBefore, d->atomsAfter);
+    diff(d->bondsBefore, bonds, d->bondsBefore, d->bondsAfter);
+    d->open = false;
+  }
+
+  bool MoleculeDelta::isOpen() const
+  {
+    return d->open;
+  }
+
+  bool MoleculeDelta::isEmpty() const
+  {
+    return !d->open && d->atomsBefore.empty() && d->bondsBefore.empty()
+      && d->conformersBefore == d->conformersAfter
+      && d->conformerBefore == d->conformerAfter;
+  }
+
+  void MoleculeDelta::merge(const MoleculeDelta &later)
+  {
+    if (later.d->open) {
+      // The later snapshot is the state after this delta
+      if (d->open) {
+        diff(d->atomsBefore, later.d->atomsBefore, d->atomsBefore,
+             d->atomsAfter);
+        diff(d->bondsBefore, later.d->bondsBefore, d->bondsBefore,
+             d->bondsAfter);
+      }
+      overlay(d->atomsBefore, later.d->atomsBefore);
+      overlay(d->bondsBefore, later.d->bondsBefore);
+      d->atomsAfter.clear();
+      d->bondsAfter.clear();
+      d->open = true;
+    }
+    else if (!d->open) {
+      compose(d->atomsBefore, d->atomsAfter, later.d->atomsBefore,
+              later.d->atomsAfter);
+      compose(d->bondsBefore, d->bondsAfter, later.d->bondsBefore,
+              later.d->bondsAfter);
+    }
+    // else the later changes are recorded when this delta is ended
+
+    if (later.d->conformers) {
+      if (!d->conformers) {
+        d->conformersBefore = later.d->conformersBefore;
+        d->conformerBefore = later.d->conformerBefore;
+        d->conformers = true;
+      }
+      d->conformersAfter = later.d->conformersAfter;
+      d->conformerAfter = later.d->conformerAfter;
+    }
+  }
+
+  void MoleculeDelta::undo(Molecule *molecule)
+  {
+    if (!molecule)
+      return;
+    end(molecule);
+    d->apply(molecule, d->atomsBefore, d->bondsBefore, d->conformersBefore,
+             d->conformerBefore);
+  }
+
+  void MoleculeDelta::redo(Molecule *molecule)
+  {
+    if (!molecule || d->open)
+      return;
+    d->apply(molecule, d->atomsAfter, d->bondsAfter, d->conformersAfter,
+             d->conformerAfter);
+  }
+
+  void MoleculeDelta::clear()
+  {
+    *d = MoleculeDeltaPrivate();
+  }
+
+  int MoleculeDelta::numAtoms() const
+  {
+    return d->open ? 0 : d->atomsBefore.size();
+  }
+
+  int MoleculeDelta::numBonds() const
+  {
+    return d->open ? 0 : d->bondsBefore.size();
+  }
+
+  qint64 MoleculeDelta::memoryUsage() const
+  {
+    qint64 bytes = sizeof(MoleculeDeltaPrivate)
+      + sizeof(AtomState) * (d->atomsBefore.capacity()
+                             + d->atomsAfter.capacity())
+      + sizeof(BondState) * (d->bondsBefore.capacity()
+                             + d->bondsAfter.capacity());
+    for (unsigned int i = 0; i < d->conformersBefore.size(); ++i)
+      bytes += sizeof(Vector3d) * d->conformersBefore[i].capacity();
+    for (unsigned int i = 0; i < d->conformersAfter.size(); ++i)
+      bytes += sizeof(Vector3d) * d->conformersAfter[i].capacity();
+    return bytes;
+  }
+
+  class MoleculeDeltaCommandPrivate
+  {
+    public:
+      MoleculeDeltaCommandPrivate(Molecule *molecule_) : molecule(molecule_),
+        skipRedo(false) {}
+
+      Molecule *molecule;
+      MoleculeDelta delta;
+      // Set for the copies made by limitMemory(), which are pushed on the
+      // stack after their edit was already redone
+      bool skipRedo;
+  };
+
+  MoleculeDeltaCommand::MoleculeDeltaCommand(Molecule *molecule,
+                                             QUndoCommand *parent)
+    : QUndoCommand(parent), d(new MoleculeDeltaCommandPrivate(molecule))
+  {
+  }
+
+  MoleculeDeltaCommand::~MoleculeDeltaCommand()
+  {
+    delete d;
+  }
+
+  void MoleculeDeltaCommand::undo()
+  {
+    d->delta.undo(d->molecule);
+  }
+
+  void MoleculeDeltaCommand::redo()
+  {
+    if (d->skipRedo) {
+      d->skipRedo = false;
+      return;
+    }
+    d->delta.redo(d->molecule);
+  }
+
+  Molecule * MoleculeDeltaCommand::molecule() const
+  {
+    return d->molecule;
+  }
+
+  MoleculeDelta & MoleculeDeltaCommand::delta()
+  {
+    return d->delta;
+  }
+
+  const MoleculeDelta & MoleculeDeltaCommand::delta() const
+  {
+    return d->delta;
+  }
+
+  qint64 MoleculeDeltaCommand::memoryUsage() const
+  {
+    return d->delta.memoryUsage();
+  }
+
+  qint64 MoleculeDeltaCommand::memoryUsage(const QUndoStack *stack)
+  {
+    qint64 bytes = 0;
+    if (!stack)
+      return bytes;
+    for (int i = 0; i < stack->count(); ++i) {
+      const MoleculeDeltaCommand *command =
+        dynamic_cast<const MoleculeDeltaCommand *>(stack->command(i));
+      // An open delta belongs to an edit that is still running
+      if (command && !command->delta().isOpen())
+        bytes += command->memoryUsage();
+    }
+    return bytes;
+  }
+
+  bool MoleculeDeltaCommand::isRunning(const QUndoStack *stack)
+  {
+    if (!stack)
+      return false;
+    for (int i = 0; i < stack->count(); ++i) {
+      const MoleculeDeltaCommand *command =
+        dynamic_cast<const MoleculeDeltaCommand *>(stack->command(i));
+      if (command && command->delta().isOpen())
+        return true;
+    }
+    return false;
+  }
+
+  int MoleculeDeltaCommand::limitMemory(QUndoStack *stack, qint64 bytes)
+  {
+    if (!stack || memoryUsage(stack) <= bytes || isRunning(stack))
+      return 0;
+
+    // Copy the most recent steps that fit in half of the limit, so that it
+    // is not reached again at once. Only delta commands can be copied.
+    QList<MoleculeDeltaCommand *> kept;
+    qint64 total = 0;
+    for (int i = stack->index() - 1; i >= 0; --i) {
+      const MoleculeDeltaCommand *command =
+        dynamic_cast<const MoleculeDeltaCommand *>(stack->command(i));
+      if (!command || command->childCount())
+        break;
+      total += command->memoryUsage();
+      if (total > bytes / 2)
+        break;
+      MoleculeDeltaCommand *copy = new MoleculeDeltaCommand(command->molecule());
+      copy->setText(command->text());
+      copy->d->delta = command->d->delta;
+      copy->d->skipRedo = true;
+      kept.prepend(copy);
+    }
+
+    // QUndoStack cannot remove single commands, so it is rebuilt
+    bool clean = stack->isClean();
+    int dropped = stack->count() - kept.size();
+    stack->clear();
+    foreach (MoleculeDeltaCommand *command, kept)
+      stack->push(command);
+    if (clean)
+      stack->setClean();
+    return dropped;
+  }
+
+} // End namespace Avogadro
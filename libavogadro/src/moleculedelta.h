@@ -0,0 +1,208 @@
+/**********************************************************************
+  MoleculeDelta - changes to a Molecule that can be undone and redone
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef MOLECULEDELTA_H
+#define MOLECULEDELTA_H
+
+#include <avogadro/global.h>
+
+#include <QUndoCommand>
+
+class QUndoStack;
+
+namespace Avogadro {
+
+  class Molecule;
+  class MoleculeDeltaPrivate;
+  class MoleculeDeltaCommandPrivate;
+
+  /**
+   * @class MoleculeDelta moleculedelta.h <avogadro/moleculedelta.h>
+   * @brief The atoms and bonds changed by an edit of a Molecule.
+   *
+   * A delta is begun before a Molecule is edited, which records the element,
+   * formal charge and position of every atom and the atoms and order of every
+   * bond. When it is ended the state after the edit is compared with the
+   * recorded one, and only the atoms and bonds that were added, removed or
+   * changed are kept, with their state before and after the edit. Undo
+   * commands use a delta instead of a copy of the whole Molecule, so moving
+   * a few atoms of a large system costs a few bytes per moved atom.
+   *
+   * Atoms and bonds are recreated with their old unique ids, so later deltas
+   * of the same Molecule stay valid. Residues, custom labels and other
+   * properties of the atoms and bonds are not recorded, so edits that
+   * remove atoms carrying them should keep a copy of the Molecule instead.
+   */
+  class A_EXPORT MoleculeDelta
+  {
+    public:
+      MoleculeDelta();
+      MoleculeDelta(const MoleculeDelta &other);
+      ~MoleculeDelta();
+
+      MoleculeDelta & operator=(const MoleculeDelta &other);
+
+      /**
+       * Record the state of a Molecule before it is edited.
+       * @param molecule The Molecule.
+       * @param conformers Also record all of the conformers, for edits that
+       * replace them such as conformer searches.
+       */
+      void begin(const Molecule *molecule, bool conformers = false);
+
+      /**
+       * Compare the state of a Molecule with the one recorded by begin(),
+       * keeping the changes only. Does nothing unless the delta is open.
+       */
+      void end(const Molecule *molecule);
+
+      /**
+       * @return True between begin() and end(), while the delta holds the
+       * state of the whole Molecule.
+       */
+      bool isOpen() const;
+
+      /**
+       * @return True if the delta is closed and nothing changed.
+       */
+      bool isEmpty() const;
+
+      /**
+       * Add the changes of a later delta of the same Molecule to this one,
+       * so that undo() undoes both. If the later delta is open this one is
+       * open afterwards, and must be ended once the edit is finished.
+       */
+      void merge(const MoleculeDelta &later);
+
+      /**
+       * Restore the state before the edit, ending the delta first if it is
+       * open.
+       */
+      void undo(Molecule *molecule);
+
+      /**
+       * Restore the state after the edit.
+       */
+      void redo(Molecule *molecule);
+
+      /**
+       * Forget the recorded state.
+       */
+      void clear();
+
+      /**
+       * @return The number of atoms that were added, removed or changed.
+       */
+      int numAtoms() const;
+
+      /**
+       * @return The number of bonds that were added, removed or changed.
+       */
+      int numBonds() const;
+
+      /**
+       * @return The memory used by the delta in bytes.
+       */
+      qint64 memoryUsage() const;
+
+    private:
+      MoleculeDeltaPrivate * const d;
+  };
+
+  /**
+   * @class MoleculeDeltaCommand moleculedelta.h <avogadro/moleculedelta.h>
+   * @brief An undo command that undoes and redoes a MoleculeDelta.
+   *
+   * The memory held by the delta commands of a QUndoStack can be capped with
+   * limitMemory(). QUndoStack cannot remove single commands, so once the cap
+   * is reached the stack is rebuilt from copies of its most recent steps.
+   */
+  class A_EXPORT MoleculeDeltaCommand : public QUndoCommand
+  {
+    public:
+      /**
+       * Constructor.
+       * @param molecule The Molecule the command edits.
+       * @param parent The parent command.
+       */
+      explicit MoleculeDeltaCommand(Molecule *molecule, QUndoCommand *parent = 0);
+      virtual ~MoleculeDeltaCommand();
+
+      /**
+       * Undo the delta.
+       */
+      virtual void undo();
+
+      /**
+       * Redo the delta.
+       */
+      virtual void redo();
+
+      /**
+       * @return The Molecule the command edits.
+       */
+      Molecule * molecule() const;
+
+      /**
+       * @return The delta of the command.
+       */
+      MoleculeDelta & delta();
+      const MoleculeDelta & delta() const;
+
+      /**
+       * @return The memory used by the command in bytes.
+       */
+      virtual qint64 memoryUsage() const;
+
+      /**
+       * @return The memory used by the delta commands on a stack in bytes,
+       * not counting open deltas of edits that are still running.
+       */
+      static qint64 memoryUsage(const QUndoStack *stack);
+
+      /**
+       * @return True if a delta command on the stack is open, i.e. its edit
+       * is still running.
+       */
+      static bool isRunning(const QUndoStack *stack);
+
+      /**
+       * Drop the oldest steps of a stack whose delta commands use more
+       * memory than a limit. The stack is cleared and the most recent delta
+       * commands that fit in half of the limit are pushed back as plain
+       * MoleculeDeltaCommand copies, without redoing them again. Steps that
+       * were undone are dropped. Nothing is done while an edit is running.
+       * Call this outside of QUndoStack::push(), e.g. through a queued
+       * connection to QUndoStack::indexChanged().
+       * @param stack The stack.
+       * @param bytes The limit in bytes.
+       * @return The number of commands that were dropped.
+       */
+      static int limitMemory(QUndoStack *stack, qint64 bytes);
+
+    private:
+      MoleculeDeltaCommandPrivate * const d;
+  };
+
+} // End namespace Avogadro
+
+#endif
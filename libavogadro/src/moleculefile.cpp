@@ -27,8 +27,11 @@
 
 #include <avogadro/molecule.h>
 
+#include <QDataStream>
+#include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QStringList>
 #include <QThread>
 #include <QDebug>
@@ -40,6 +43,8 @@
 // Included in obconversion.h
 //#include <iostream>
 
+#include <algorithm>
+
 namespace Avogadro {
 
   using OpenBabel::OBConversion;
@@ -54,9 +59,36 @@ namespace Avogadro {
   class MoleculeFilePrivate
   {
     public:
-      MoleculeFilePrivate() : isConformerFile(false), ready(false), specialCaseOBMol(0) {}
+      MoleculeFilePrivate() : isConformerFile(false), ready(false),
+        specialCaseOBMol(0), streaming(false),
+        frameFormat(ReadFileThread::OBFrames),
+        mappedFile(0), mappedData(0), frameCacheSize(64) {}
+      ~MoleculeFilePrivate()
+      {
+        resetFrameSource();
+      }
+
+      // called when the frames are decoded from a different file/offset
+      void resetFrameSource()
+      {
+        clearFrameCache();
+        // closing the file also unmaps the data
+        delete mappedFile;
+        mappedFile = 0;
+        mappedData = 0;
+      }
+
+      void clearFrameCache()
+      {
+        foreach (std::vector<Eigen::Vector3d> *frame, frameCache)
+          delete frame;
+        frameCache.clear();
+        frameCacheOrder.clear();
+      }
+
       QStringList titles;
       std::vector<std::streampos> streampos;
+      std::vector<unsigned int> atomCounts;
       bool isConformerFile;
       bool ready;
 
@@ -64,8 +96,66 @@ namespace Avogadro {
       // OBMol in specialCaseOBMol. MoleculeFile::molecule will return this
       // OBMol object (if non 0) regardless of the index.
       OBMol *specialCaseOBMol;
+
+      // streaming (trajectory) files: only streampos is stored, frames are
+      // decoded on demand from the mapped file and kept in an LRU cache
+      bool streaming;
+      ReadFileThread::FrameFormat frameFormat;
+      QFile *mappedFile;
+      uchar *mappedData;
+      unsigned int frameCacheSize;
+      QHash<unsigned int, std::vector<Eigen::Vector3d>*> frameCache;
+      QList<unsigned int> frameCacheOrder; // most recently used first
   };
 
+  namespace {
+    // index file header, increase the version when the layout changes
+    const quint32 IndexMagic = 0x41564958; // "AVIX"
+    const quint32 IndexVersion = 2;
+
+    // modification time in milliseconds, toMSecsSinceEpoch needs Qt 4.7
+    qint64 modifiedMSecs(const QFileInfo &info)
+    {
+      QDateTime modified = info.lastModified().toUTC();
+      return qint64(modified.toTime_t()) * 1000 + modified.time().msec();
+    }
+
+    bool setOutFormat(OBConversion &conv, const QString &fileName,
+                      const QString &fileType, QString &error)
+    {
+      if (!fileType.isEmpty()) {
+        if (conv.SetOutFormat(fileType.toAscii()))
+          return true;
+        // Output format not supported
+        error.append(QObject::tr("File type '%1' is not supported for writing.").arg(fileType));
+        return false;
+      }
+
+      OBFormat *outFormat = conv.FormatFromExt(fileName.toAscii());
+      if (!outFormat || !conv.SetOutFormat(outFormat)) {
+        // Output format not supported
+        error.append(QObject::tr("File type for file '%1' is not supported for writing.").arg(fileName));
+        return false;
+      }
+      return true;
+    }
+
+    // Copy size bytes from in to out using large blocks
+    bool copyBlocks(std::istream &in, std::ostream &out, std::streamoff size)
+    {
+      const std::streamoff blockSize = 1 << 20;
+      std::vector<char> buffer(static_cast<size_t>(std::min(size, blockSize)));
+      while (size > 0) {
+        std::streamsize n = static_cast<std::streamsize>(std::min(size, blockSize));
+        if (!in.read(&buffer[0], n))
+          return false;
+        out.write(&buffer[0], n);
+        size -= n;
+      }
+      return out.good();
+    }
+  }
+
   MoleculeFile::MoleculeFile(const QString &fileName, const QString &fileType,
       const QString &fileOptions) : QObject(), d(new MoleculeFilePrivate),
       m_fileName(fileName), m_fileType(fileType), m_fileOptions(fileOptions)
@@ -105,6 +195,13 @@ namespace Avogadro {
     return d->titles;
   }
 
+  unsigned int MoleculeFile::numAtoms(unsigned int i) const
+  {
+    if (!d->ready || i >= d->atomCounts.size())
+      return 0;
+    return d->atomCounts[i];
+  }
+
   Molecule* MoleculeFile::molecule(unsigned int i)
   {
     OpenBabel::OBMol *obmol = OBMol(i);
@@ -135,10 +232,12 @@ namespace Avogadro {
     // Construct the OpenBabel objects, set the file type
     OBConversion conv;
     OBFormat *inFormat;
-    if (!m_fileType.isEmpty() && !conv.SetInFormat(m_fileType.toAscii())) {
-      // Input format not supported
-      m_error.append(tr("File type '%1' is not supported for reading.").arg(m_fileType));
-      return 0;
+    if (!m_fileType.isEmpty()) {
+      if (!conv.SetInFormat(m_fileType.toAscii())) {
+        // Input format not supported
+        m_error.append(tr("File type '%1' is not supported for reading.").arg(m_fileType));
+        return 0;
+      }
     } else {
       inFormat = conv.FormatFromExt(m_fileName.toAscii());
       if (!inFormat || !conv.SetInFormat(inFormat)) {
@@ -164,7 +263,9 @@ namespace Avogadro {
     if (!ifs) // Should not happen, already checked file could be opened
       return 0;
 
-    if (i && m_fileName.endsWith(QLatin1String("xyz"), Qt::CaseInsensitive)) {
+    // XYZ offsets recorded by Open Babel point one past the frame start
+    if (i && d->frameFormat == ReadFileThread::OBFrames &&
+        m_fileName.endsWith(QLatin1String("xyz"), Qt::CaseInsensitive)) {
       ifs.unget();
     }
 
@@ -187,91 +288,187 @@ namespace Avogadro {
       return false;
     }
 
-    // Construct the OpenBabel objects, set the file type
+    return spliceMolecule(i, molecule, true);
+  }
+
+  bool MoleculeFile::insertMolecule(unsigned int i, Molecule *molecule,
+                                    QString fileName)
+  {
+    if (!d->ready)
+      return false;
+    if (i > d->streampos.size()) {
+      m_error.append(tr("insertMolecule: index %1 out of reach.").arg(i));
+      return false;
+    }
+    if (i == d->streampos.size())
+      return appendMolecule(molecule, fileName);
+
+    return spliceMolecule(i, molecule, false);
+  }
+
+  bool MoleculeFile::appendMolecule(Molecule *molecule, QString)
+  {
+    if (!d->ready)
+      return false;
+
     OBConversion conv;
-    OBFormat *outFormat;
-    if (!m_fileType.isEmpty() && !conv.SetOutFormat(m_fileType.toAscii())) {
-      // Output format not supported
-      m_error.append(tr("File type '%1' is not supported for writing.").arg(m_fileType));
+    if (!setOutFormat(conv, m_fileName, m_fileType, m_error))
+      return false;
+
+    // only the new molecule is written, the existing data is not touched
+    ofstream ofs;
+    ofs.open(m_fileName.toLocal8Bit(), std::ios::out | std::ios::app);
+    if (!ofs) {
+      m_error.append(tr("Could not open file '%1' for writing.").arg(m_fileName));
       return false;
-    } else {
-      outFormat = conv.FormatFromExt(m_fileName.toAscii());
-      if (!outFormat || !conv.SetOutFormat(outFormat)) {
-        // Output format not supported
-        m_error.append(tr("File type for file '%1' is not supported for writing.").arg(m_fileName));
-        return false;
-      }
     }
+    ofs.seekp(0, std::ios::end);
+    std::streampos pos = ofs.tellp();
+
+    OpenBabel::OBMol *obmol = molecule->lockOBMol();
+    if (!conv.Write(obmol, &ofs)) {
+      molecule->unlockOBMol();
+      m_error.append(tr("Appending molecule to file '%1' failed.").arg(m_fileName));
+      return false;
+    }
+    ofs.close();
+
+    insertCachedMolecule(d->streampos.size(), pos, *obmol);
+    molecule->unlockOBMol();
+    return true;
+  }
+
+  bool MoleculeFile::spliceMolecule(unsigned int i, Molecule *molecule,
+                                    bool replace)
+  {
+    OBConversion conv;
+    if (!setOutFormat(conv, m_fileName, m_fileType, m_error))
+      return false;
 
     // Now attempt to open the file.new for writing
     ofstream ofs;
-    QString newFilename(m_fileName.toLocal8Bit() + QLatin1String(".new"));
-    ofs.open(newFilename.toAscii().data()); // This handles utf8 file names etc
+    QString newFilename(m_fileName + QLatin1String(".new"));
+    ofs.open(newFilename.toLocal8Bit(), std::ios::out | std::ios::binary);
     if (!ofs) {
-      m_error.append(tr("Could not open file '%1' for writing.").arg(m_fileName));
+      m_error.append(tr("Could not open file '%1' for writing.").arg(newFilename));
       return false;
     }
-    // Copy molecules 0 to i-1 to .new file
     ifstream ifs;
-    ifs.open(m_fileName.toLocal8Bit()); // This handles utf8 file names etc
+    ifs.open(m_fileName.toLocal8Bit(), std::ios::in | std::ios::binary);
     if (!ifs) {
       m_error.append(tr("Could not open file '%1' for reading.").arg(m_fileName));
+      ofs.close();
+      QFile::remove(newFilename);
       return false;
     }
-    for (std::streampos pos = 0; pos < d->streampos.at(i); pos+=1)
-      ofs.put(ifs.get()); // FIXME using istream_iterator or something
+    ifs.seekg(0, std::ios::end);
+    std::streampos endpos = ifs.tellg();
+    ifs.seekg(0);
+
+    // copy molecules 0 to i-1 to .new file
+    std::streampos pos = d->streampos.at(i);
+    bool success = copyBlocks(ifs, ofs, std::streamoff(pos));
 
     // write the molecule
-    OpenBabel::OBMol obmol = molecule->OBMol();
-    if (!conv.Write(&obmol, &ofs)) {
-      m_error.append(tr("Replacing molecule with index %1 in file '%2' failed.").arg(i).arg(m_fileName));
+    OpenBabel::OBMol *obmol = molecule->lockOBMol();
+    if (success && !conv.Write(obmol, &ofs)) {
+      molecule->unlockOBMol();
+      m_error.append(tr("Writing molecule with index %1 to file '%2' failed.").arg(i).arg(m_fileName));
+      ofs.close();
+      QFile::remove(newFilename);
       return false;
     }
-
-    std::streampos newSize = ofs.tellp() - d->streampos[i];
-    if (i+1 < d->streampos.size()) {
-      // copy remaining molecules
-      ifs.seekg(0, std::ios::end);
-      std::streampos endpos = ifs.tellg();
-      ifs.seekg(d->streampos.at(i+1));
-      while (ifs.tellg() < endpos)
-        ofs.put(ifs.get()); // FIXME using istream_iterator or something
-    }
-    /*
-    std::copy(std::istream_iterator<char>(ifs),
-              std::istream_iterator<char>(),
-              std::ostream_iterator<char>(ofs));
-    */
+    std::streamoff newSize = ofs.tellp() - pos;
+
+    // copy the remaining molecules, skipping the replaced one
+    std::streampos next = pos;
+    if (replace)
+      next = (i+1 < d->streampos.size()) ? d->streampos.at(i+1) : endpos;
+    ifs.seekg(next);
+    success = success && copyBlocks(ifs, ofs, endpos - next);
     ifs.close();
     ofs.close();
 
+    if (!success || !ofs) {
+      molecule->unlockOBMol();
+      m_error.append(tr("Could not copy the molecules from file '%1'.").arg(m_fileName));
+      QFile::remove(newFilename);
+      return false;
+    }
+
     QFile newFile(newFilename);
     QFile(m_fileName).remove();
     newFile.rename(m_fileName);
 
-
     // adjust the cached variables
-    if (i+1 < d->streampos.size()) {
-      // size of the molecule to be replaced (in chars)
-      std::streampos oldSize = d->streampos[i+1] - d->streampos[i];
-      std::streampos delta = newSize - oldSize;
-
-      for (unsigned int j = i+1; j < d->streampos.size(); ++j) {
-        d->streampos[j] += delta;
-      }
+    std::streamoff delta = replace ? newSize - std::streamoff(next - pos) : newSize;
+    for (unsigned int j = i+1; j < d->streampos.size(); ++j)
+      d->streampos[j] += delta;
+
+    if (replace) {
+      if (!d->isConformerFile && *obmol->GetTitle())
+        d->titles[i] = obmol->GetTitle();
+      if (i < d->atomCounts.size())
+        d->atomCounts[i] = obmol->NumAtoms();
+      updateCachedConformers(i, *obmol, true);
+      d->resetFrameSource();
+      saveIndex();
+    } else {
+      // the old molecule i now follows the inserted molecule
+      d->streampos[i] += delta;
+      insertCachedMolecule(i, pos, *obmol);
     }
+    molecule->unlockOBMol();
 
     return true;
   }
 
-  bool MoleculeFile::insertMolecule(unsigned int, Molecule *, QString)
+  void MoleculeFile::insertCachedMolecule(unsigned int i, std::streampos pos,
+                                          OpenBabel::OBMol &obmol)
   {
-    return false;
+    d->streampos.insert(d->streampos.begin() + i, pos);
+    d->atomCounts.insert(d->atomCounts.begin() + i, obmol.NumAtoms());
+    QString title(obmol.GetTitle());
+    if (title.isEmpty())
+      title = d->isConformerFile ? tr("Conformer %1").arg(i+1)
+                                 : tr("Molecule %1").arg(i+1);
+    d->titles.insert(i, title);
+
+    updateCachedConformers(i, obmol, false);
+    d->resetFrameSource();
+    saveIndex();
   }
 
-  bool MoleculeFile::appendMolecule(Molecule *, QString)
+  void MoleculeFile::updateCachedConformers(unsigned int i,
+                                            OpenBabel::OBMol &obmol,
+                                            bool replace)
   {
-    return false;
+    if (!d->isConformerFile)
+      return;
+
+    // a molecule with a different number of atoms is not a conformer
+    unsigned int other = i ? 0 : 1;
+    if (other < d->atomCounts.size() && d->atomCounts[other] != obmol.NumAtoms()) {
+      d->isConformerFile = false;
+      for (unsigned int j = 0; j < m_conformers.size(); ++j)
+        delete m_conformers[j];
+      m_conformers.clear();
+      return;
+    }
+
+    // streamed files decode the conformers on demand
+    if (d->streaming)
+      return;
+    std::vector<Eigen::Vector3d> *coords = new std::vector<Eigen::Vector3d>;
+    coords->reserve(obmol.NumAtoms());
+    FOR_ATOMS_OF_MOL (atom, obmol)
+      coords->push_back(Eigen::Vector3d(atom->GetVector().AsArray()));
+    if (replace && i < m_conformers.size()) {
+      delete m_conformers[i];
+      m_conformers[i] = coords;
+    } else {
+      m_conformers.insert(m_conformers.begin() + i, coords);
+    }
   }
 
   void MoleculeFile::threadFinished()
@@ -285,6 +482,11 @@ namespace Avogadro {
     return d->streampos;
   }
 
+  std::vector<unsigned int>& MoleculeFile::atomCountsRef()
+  {
+    return d->atomCounts;
+  }
+
   QStringList& MoleculeFile::titlesRef()
   {
     return d->titles;
@@ -295,6 +497,101 @@ namespace Avogadro {
     return m_conformers;
   }
 
+  bool MoleculeFile::isStreaming() const
+  {
+    return d->streaming;
+  }
+
+  unsigned int MoleculeFile::numConformers() const
+  {
+    if (!d->ready || !d->isConformerFile)
+      return 0;
+    if (d->streaming)
+      return d->streampos.size();
+    return m_conformers.size();
+  }
+
+  bool MoleculeFile::conformer(unsigned int i, std::vector<Eigen::Vector3d> &coords)
+  {
+    if (i >= numConformers()) {
+      m_error.append(tr("conformer: index %1 out of reach.").arg(i));
+      return false;
+    }
+
+    if (!d->streaming) {
+      coords = *m_conformers.at(i);
+      return true;
+    }
+
+    // cache hit: move the frame to the front of the LRU list
+    std::vector<Eigen::Vector3d> *frame = d->frameCache.value(i);
+    if (frame) {
+      if (d->frameCacheOrder.first() != i) {
+        d->frameCacheOrder.removeOne(i);
+        d->frameCacheOrder.prepend(i);
+      }
+      coords = *frame;
+      return true;
+    }
+
+    frame = new std::vector<Eigen::Vector3d>;
+    bool success = false;
+    if (d->frameFormat == ReadFileThread::OBFrames) {
+      OpenBabel::OBMol *obmol = OBMol(i);
+      if (obmol) {
+        frame->reserve(obmol->NumAtoms());
+        FOR_ATOMS_OF_MOL (atom, obmol)
+          frame->push_back(Eigen::Vector3d(atom->GetVector().AsArray()));
+        delete obmol;
+        success = true;
+      }
+    } else {
+      // map the file once, fall back to regular reads if mapping fails
+      if (!d->mappedFile) {
+        d->mappedFile = new QFile(m_fileName);
+        if (d->mappedFile->open(QIODevice::ReadOnly))
+          d->mappedData = d->mappedFile->map(0, d->mappedFile->size());
+      }
+
+      qint64 begin = d->streampos.at(i);
+      qint64 end = (i + 1 < d->streampos.size()) ? qint64(d->streampos.at(i + 1))
+                                                 : d->mappedFile->size();
+      QByteArray data;
+      if (d->mappedData)
+        data = QByteArray::fromRawData(reinterpret_cast<const char*>(d->mappedData) + begin,
+                                       end - begin);
+      else if (d->mappedFile->seek(begin))
+        data = d->mappedFile->read(end - begin);
+
+      success = ReadFileThread::decodeFrame(d->frameFormat, data, *frame);
+    }
+
+    if (!success) {
+      delete frame;
+      m_error.append(tr("Reading conformer with index %1 from file '%2' failed.").arg(i).arg(m_fileName));
+      return false;
+    }
+
+    coords = *frame;
+    d->frameCache.insert(i, frame);
+    d->frameCacheOrder.prepend(i);
+    while (static_cast<unsigned int>(d->frameCacheOrder.size()) > d->frameCacheSize)
+      delete d->frameCache.take(d->frameCacheOrder.takeLast());
+    return true;
+  }
+
+  void MoleculeFile::setConformerCacheSize(unsigned int frames)
+  {
+    d->frameCacheSize = frames;
+    while (static_cast<unsigned int>(d->frameCacheOrder.size()) > d->frameCacheSize)
+      delete d->frameCache.take(d->frameCacheOrder.takeLast());
+  }
+
+  unsigned int MoleculeFile::conformerCacheSize() const
+  {
+    return d->frameCacheSize;
+  }
+
   std::vector<std::vector<Eigen::Vector3d>*>& MoleculeFile::conformersRef()
   {
     return m_conformers;
@@ -305,6 +602,16 @@ namespace Avogadro {
     d->isConformerFile = value;
   }
 
+  void MoleculeFile::setFrameFormat(int format)
+  {
+    d->frameFormat = static_cast<ReadFileThread::FrameFormat>(format);
+  }
+
+  void MoleculeFile::setStreaming(bool value)
+  {
+    d->streaming = value;
+  }
+
   void MoleculeFile::setReady(bool value)
   {
     d->ready = value;
@@ -348,6 +655,99 @@ namespace Avogadro {
     return true;
   }
 
+  QString MoleculeFile::indexFileName(const QString &fileName)
+  {
+    return fileName + QLatin1String(".avoidx");
+  }
+
+  bool MoleculeFile::loadIndex()
+  {
+    QFile file(indexFileName(m_fileName));
+    if (!file.open(QIODevice::ReadOnly))
+      return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_4);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != IndexMagic || version != IndexVersion)
+      return false;
+
+    // fingerprint of the indexed file and how it was read
+    qint64 size, modified;
+    QString fileType, fileOptions;
+    bool streaming;
+    quint8 frameFormat;
+    in >> size >> modified >> fileType >> fileOptions >> streaming
+       >> frameFormat;
+    QFileInfo info(m_fileName);
+    if (size != info.size() || modified != modifiedMSecs(info)
+        || fileType != m_fileType || fileOptions != m_fileOptions
+        || streaming != d->streaming
+        || frameFormat > ReadFileThread::PDBFrames)
+      return false;
+
+    bool isConformerFile;
+    quint32 count;
+    in >> isConformerFile >> count;
+    // the conformers themselves are not in the index
+    if (isConformerFile && !d->streaming)
+      return false;
+
+    std::vector<std::streampos> streampos;
+    std::vector<unsigned int> atomCounts;
+    QStringList titles;
+    streampos.reserve(count);
+    atomCounts.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+      qint64 offset;
+      QString title;
+      quint32 numAtoms;
+      in >> offset >> title >> numAtoms;
+      streampos.push_back(std::streampos(std::streamoff(offset)));
+      titles.append(title);
+      atomCounts.push_back(numAtoms);
+    }
+    if (in.status() != QDataStream::Ok) // truncated index
+      return false;
+
+    d->streampos.swap(streampos);
+    d->atomCounts.swap(atomCounts);
+    d->titles = titles;
+    d->isConformerFile = isConformerFile;
+    // decode the frames the same way they were indexed
+    d->frameFormat = static_cast<ReadFileThread::FrameFormat>(frameFormat);
+    return true;
+  }
+
+  bool MoleculeFile::saveIndex()
+  {
+    // only files with multiple molecules are worth indexing
+    unsigned int count = d->streampos.size();
+    if (count < 2 || d->specialCaseOBMol || !m_error.isEmpty()
+        || static_cast<unsigned int>(d->titles.size()) != count
+        || d->atomCounts.size() != count)
+      return false;
+
+    QFile file(indexFileName(m_fileName));
+    if (!file.open(QIODevice::WriteOnly)) {
+      qDebug() << "Could not write index file" << file.fileName();
+      return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_4);
+    QFileInfo info(m_fileName);
+    out << IndexMagic << IndexVersion;
+    out << qint64(info.size()) << modifiedMSecs(info) << m_fileType
+        << m_fileOptions << d->streaming << static_cast<quint8>(d->frameFormat);
+    out << d->isConformerFile << quint32(count);
+    for (unsigned int i = 0; i < count; ++i)
+      out << qint64(d->streampos[i]) << d->titles.at(i) << quint32(d->atomCounts[i]);
+
+    return out.status() == QDataStream::Ok;
+  }
+
   Molecule * MoleculeFile::readMolecule(const QString &fileName,
       const QString &fileType, const QString &fileOptions, QString *error)
   {
@@ -471,15 +871,23 @@ namespace Avogadro {
       qDebug() << "ofs is bad";
       return false;
     }
-    OpenBabel::OBMol obmol = molecule->OBMol();
-
-    if (obmol.NumResidues() == 0) {
+    bool written;
+    OpenBabel::OBMol *cached = molecule->lockOBMol();
+    if (cached->NumResidues() == 0) {
+      // chain perception changes the molecule, so a copy is written
+      OpenBabel::OBMol obmol = *cached;
+      molecule->unlockOBMol();
       OpenBabel::OBChainsParser chainparser;
       obmol.UnsetFlag(OB_CHAINS_MOL);
       chainparser.PerceiveChains(obmol);
+      written = conv.Write(&obmol, &ofs);
+    }
+    else {
+      written = conv.Write(cached, &ofs);
+      molecule->unlockOBMol();
     }
 
-    if (conv.Write(&obmol, &ofs)) {
+    if (written) {
       ofs.close();
       if (replaceExistingFile) {
         QFile newFile(newFileName);
@@ -649,4 +1057,22 @@ namespace Avogadro {
     return moleculeFile;
   }
 
+  MoleculeFile* MoleculeFile::readTrajectory(const QString &fileName,
+      const QString &fileType, const QString &fileOptions, bool wait)
+  {
+    MoleculeFile *moleculeFile = new MoleculeFile(fileName, fileType, fileOptions);
+    moleculeFile->setStreaming(true);
+
+    ReadFileThread *thread = new ReadFileThread(moleculeFile);
+    QObject::connect(thread, SIGNAL(finished()), moleculeFile, SLOT(threadFinished()));
+    thread->start();
+
+    if (wait) {
+      thread->wait();
+      moleculeFile->setReady(true);
+    }
+
+    return moleculeFile;
+  }
+
 } // end namespace
@@ -68,6 +68,11 @@ namespace Avogadro {
      * Get the titles for the molecules.
      */
     QStringList titles() const;
+    /**
+     * Get the number of atoms in the @p {i}th molecule as recorded when the
+     * file was indexed, without reading the molecule.
+     */
+    unsigned int numAtoms(unsigned int i) const;
 
     //! @name Input (reading molecules)
     //@{
@@ -92,8 +97,40 @@ namespace Avogadro {
     /**
      * Get all the conformers from the file. This methods returns an empty 
      * vector if the opened file isn't a conformer file (see isConformerFile()).
+     * For streaming files (see isStreaming()) the conformers are not stored
+     * and this method also returns an empty vector, use conformer() instead.
      */
     const std::vector<std::vector<Eigen::Vector3d>*>& conformers() const;
+    /**
+     * @return True if the conformers are decoded on demand instead of being
+     * stored in memory (i.e. the file was opened using readTrajectory()).
+     */
+    bool isStreaming() const;
+    /**
+     * @return The number of conformers (frames) in the file or 0 if the file
+     * isn't a conformer file.
+     */
+    unsigned int numConformers() const;
+    /**
+     * Get the coordinates for the @p {i}th conformer. For streaming files, the
+     * frame is read from the (memory mapped) file the first time it is
+     * requested and kept in a small LRU cache (see setConformerCacheSize()).
+     *
+     * @param i The index for the conformer (indexed from 0).
+     * @param coords The vector to store the coordinates in, the coordinates
+     * are in the same order as the atoms in the file.
+     * @return True on success.
+     */
+    bool conformer(unsigned int i, std::vector<Eigen::Vector3d> &coords);
+    /**
+     * Set the maximum number of decoded frames kept in memory for streaming
+     * files. The default is 64 frames.
+     */
+    void setConformerCacheSize(unsigned int frames);
+    /**
+     * @return The maximum number of decoded frames kept in memory.
+     */
+    unsigned int conformerCacheSize() const;
     //@}
 
     //! @name Output (writing molecules)
@@ -109,18 +146,19 @@ namespace Avogadro {
      */
     bool replaceMolecule(unsigned int i, Molecule *molecule, QString fileName);
     /**
-     * Insert a molecule at index @p i.
-     * @param i The index for inserting the molecule
+     * Insert a molecule at index @p i. The molecules before and after
+     * index @p i are copied in large blocks to a new file, which replaces
+     * the original file.
+     * @param i The index for inserting the molecule (numMolecules() appends)
      * @param molecule The molecule to insert
      * @param fileName The name of the file for saving.
-     * @todo implement this method
      */
     bool insertMolecule(unsigned int i, Molecule *molecule, QString fileName);
     /**
-     * Append @p molecule to the end of the file.
+     * Append @p molecule to the end of the file. Only the new molecule is
+     * written, the existing contents of the file are not copied.
      * @param molecule The molecule to append.
      * @param fileName The name of the file for saving.
-     * @todo implement this method
      */
     bool appendMolecule(Molecule *molecule, QString fileName);
     //@}
@@ -171,6 +209,17 @@ namespace Avogadro {
      * @return True if the file can be opened in the specified @p mode.
      */
     static bool canOpen(const QString &fileName, QIODevice::OpenMode mode);
+
+    /**
+     * Static function to get the name of the index file for @p fileName.
+     * After a file containing multiple molecules is read using readFile()
+     * or readTrajectory(), the offsets, titles and atom counts are saved in
+     * this file. The next time the same file is opened, the index is loaded
+     * instead of reading the whole file again. The index is ignored when the
+     * size or modification time of the file changed, or when the file is
+     * read with different options.
+     */
+    static QString indexFileName(const QString &fileName);
       
     /**
      * Static function to load a file and return a Molecule pointer. You are
@@ -257,6 +306,22 @@ namespace Avogadro {
                                   const QString &fileType = QString(),
                                   const QString &fileOptions = QString(),
                                   bool wait = true);
+
+    /**
+     * Index a trajectory file, possibly containing thousands of frames, in a
+     * separate thread and return a streaming MoleculeFile object. Only the
+     * offsets for the frames are stored, the coordinates are read on demand
+     * using conformer(). This keeps the memory usage constant regardless of
+     * the trajectory length. XYZ and PDB files are indexed and decoded
+     * without Open Babel, other formats are decoded using OBMol().
+     *
+     * The parameters are the same as for readFile().
+     * @return MoleculeFile with (future) results.
+     */
+    static MoleculeFile* readTrajectory(const QString &fileName,
+                                        const QString &fileType = QString(),
+                                        const QString &fileOptions = QString(),
+                                        bool wait = true);
     //@}
 
   Q_SIGNALS:
@@ -278,11 +343,36 @@ namespace Avogadro {
 
     QStringList& titlesRef();
     std::vector<std::streampos>& streamposRef();
+    std::vector<unsigned int>& atomCountsRef();
+    bool loadIndex();
+    bool saveIndex();
     std::vector<std::vector<Eigen::Vector3d>*>& conformersRef();
     void setConformerFile(bool value);
+    void setStreaming(bool value);
+    void setFrameFormat(int format); // ReadFileThread::FrameFormat
     void setReady(bool value);
     void setFirstReady(bool value); // used by ReadFileThread
 
+    /**
+     * Write @p molecule at index @p i, replacing the molecule at that index
+     * when @p replace is true or inserting it otherwise.
+     */
+    bool spliceMolecule(unsigned int i, Molecule *molecule, bool replace);
+    /**
+     * Update the offsets, titles, atom counts and conformers after
+     * @p obmol was written at index @p i (starting at @p pos).
+     */
+    void insertCachedMolecule(unsigned int i, std::streampos pos,
+                              OpenBabel::OBMol &obmol);
+    /**
+     * Store the coordinates of @p obmol as conformer @p i, replacing the
+     * old conformer when @p replace is true. If its atom count differs from
+     * the other molecules the file is no longer a conformer file and the
+     * conformers are dropped.
+     */
+    void updateCachedConformers(unsigned int i, OpenBabel::OBMol &obmol,
+                                bool replace);
+
     MoleculeFilePrivate * const d; 
     QString m_fileName, m_fileType, m_fileOptions;
     QString m_error;
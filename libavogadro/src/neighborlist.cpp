@@ -27,6 +27,8 @@
 
 #include <QDebug>
 
+#include <algorithm>
+
 using namespace std;
 
 namespace Avogadro
@@ -35,12 +37,15 @@ namespace Avogadro
   NeighborList::NeighborList(Molecule* mol, double rcut, bool periodic, int boxSize)
   {
     m_atoms = mol->atoms();
+    m_molecule = mol;
     m_rcut = rcut;
     m_rcut2 = rcut*rcut;
     m_boxSize = boxSize;
     m_edgeLength = m_rcut / m_boxSize;
     m_updateCounter = 0;
+    m_periodic = periodic;
 
+    initAtoms();
     initOffsetMap();
     initOneTwo();
     initCells();
@@ -50,12 +55,15 @@ namespace Avogadro
   NeighborList::NeighborList(const QList<Atom*> &atoms, double rcut, bool periodic, int boxSize)
   {
     m_atoms = atoms;
+    m_molecule = atoms.isEmpty() ? 0 : atoms.first()->molecule();
     m_rcut = rcut;
     m_rcut2 = rcut*rcut;
     m_boxSize = boxSize;
     m_edgeLength = m_rcut / m_boxSize;
     m_updateCounter = 0;
+    m_periodic = periodic;
 
+    initAtoms();
     initOffsetMap();
     initOneTwo();
     initCells();
@@ -67,7 +75,13 @@ namespace Avogadro
     m_r2.clear();
     m_r2.reserve(m_atoms.size());
     QList<Atom*> atoms;
-    Eigen::Vector3i index(cellIndexes(atom->pos()));
+    if (!m_molecule)
+      return atoms;
+
+    const std::vector<Eigen::Vector3d> &positions = m_molecule->atomPositions();
+    const Eigen::Vector3d &pos = positions[atom->id()];
+    const unsigned int atomIndex = atom->index();
+    Eigen::Vector3i index(cellIndexes(&pos));
 
     std::vector<Eigen::Vector3i>::const_iterator i;
     // Use the offset map to find neighboring cells
@@ -79,23 +93,25 @@ namespace Avogadro
       // b) otherwise --> last empty cell
       unsigned int cell = cellIndex(m_ghostMap.at(ghostIndex(offset)));
 
-      for (atom_iter j = m_cells[cell].begin(); j != m_cells[cell].end(); ++j) {
+      for (cell_iter j = m_cells[cell].begin(); j != m_cells[cell].end(); ++j) {
+        const unsigned int otherIndex = m_indices[*j];
         if (uniqueOnly) {
           // make sure to only return unique pairs
-          if (atom->index() >= (*j)->index())
+          if (atomIndex >= otherIndex)
             continue;
         }
-        if (IsOneTwo(atom->index(), (*j)->index()))
-          continue;
-        if (IsOneThree(atom->index(), (*j)->index()))
-          continue;
 
-        const double R2 = ( *((*j)->pos()) - *(atom->pos()) ).squaredNorm();
+        const double R2 = (positions[m_ids[*j]] - pos).squaredNorm();
         if (R2 > m_rcut2)
           continue;
 
+        if (IsOneTwo(atomIndex, otherIndex))
+          continue;
+        if (IsOneThree(atomIndex, otherIndex))
+          continue;
+
         m_r2.push_back(R2);
-        atoms.append(*j);
+        atoms.append(m_atoms.at(*j));
       }
     }
 
@@ -107,6 +123,10 @@ namespace Avogadro
     m_r2.clear();
     m_r2.reserve(m_atoms.size());
     QList<Atom*> atoms;
+    if (!m_molecule)
+      return atoms;
+
+    const std::vector<Eigen::Vector3d> &positions = m_molecule->atomPositions();
     Eigen::Vector3d dpos(pos->cast<double>());
     Eigen::Vector3i index(cellIndexes(&dpos));
 
@@ -120,14 +140,14 @@ namespace Avogadro
       // b) otherwise --> last empty cell
       unsigned int cell = cellIndex(m_ghostMap.at(ghostIndex(offset)));
 
-      for (atom_iter j = m_cells[cell].begin(); j != m_cells[cell].end(); ++j) {
+      for (cell_iter j = m_cells[cell].begin(); j != m_cells[cell].end(); ++j) {
         
-        const double R2 = ( *((*j)->pos()) - dpos).squaredNorm();
+        const double R2 = (positions[m_ids[*j]] - dpos).squaredNorm();
         if (R2 > m_rcut2)
           continue;
 
         m_r2.push_back(R2);
-        atoms.append(*j);
+        atoms.append(m_atoms.at(*j));
       }
     }
 
@@ -140,11 +160,45 @@ namespace Avogadro
 
     if (m_updateCounter > 10) {
       initCells();
-      updateCells();
+      // The dimensions may have changed
+      initGhostMap(m_periodic);
       m_updateCounter = 0;
     }
   }
 
+  void NeighborList::update(const QList<Atom*> &moved)
+  {
+    if (!m_molecule)
+      return;
+
+    const std::vector<Eigen::Vector3d> &positions = m_molecule->atomPositions();
+    foreach (Atom *atom, moved) {
+      const unsigned long id = atom->id();
+      if (id >= m_idIndex.size() || m_idIndex[id] < 0)
+        continue;
+
+      Eigen::Vector3i index(cellIndexes(&positions[id]));
+      if (index.x() < 0 || index.y() < 0 || index.z() < 0 ||
+          index.x() >= m_dim.x() || index.y() >= m_dim.y() ||
+          index.z() >= m_dim.z()) {
+        // The atom has left the grid, start again with the new extents
+        initCells();
+        initGhostMap(m_periodic);
+        m_updateCounter = 0;
+        return;
+      }
+
+      const unsigned int i = m_idIndex[id];
+      const unsigned int cell = cellIndex(index);
+      if (cell == m_atomCells[i])
+        continue;
+      std::vector<unsigned int> &oldCell = m_cells[m_atomCells[i]];
+      oldCell.erase(std::find(oldCell.begin(), oldCell.end(), i));
+      m_cells[cell].push_back(i);
+      m_atomCells[i] = cell;
+    }
+  }
+
   void NeighborList::initOneTwo()
   {
     unsigned int numAtoms = m_atoms.size();
@@ -182,29 +236,47 @@ namespace Avogadro
 
   }
 
+  void NeighborList::initAtoms()
+  {
+    m_ids.resize(m_atoms.size());
+    m_indices.resize(m_atoms.size());
+    m_idIndex.clear();
+    for (int i = 0; i < m_atoms.size(); ++i) {
+      m_ids[i] = m_atoms.at(i)->id();
+      m_indices[i] = m_atoms.at(i)->index();
+      if (m_ids[i] >= m_idIndex.size())
+        m_idIndex.resize(m_ids[i] + 1, -1);
+      m_idIndex[m_ids[i]] = i;
+    }
+  }
+
   void NeighborList::initCells()
   {
     // find min & max
-    foreach (Atom *atom, m_atoms) {
-      Eigen::Vector3d pos = *(atom->pos());
-
-      if (!atom->index()) {
-        m_min = m_max = pos;
-      } else {
-        if (pos.x() > m_max.x())
-          m_max.x() = pos.x();
-        else if (pos.x() < m_min.x())
-          m_min.x() = pos.x();
-
-        if (pos.y() > m_max.y())
-          m_max.y() = pos.y();
-        else if (pos.y() < m_min.y())
-          m_min.y() = pos.y();
-
-        if (pos.z() > m_max.z())
-          m_max.z() = pos.z();
-        else if (pos.z() < m_min.z())
-          m_min.z() = pos.z();
+    m_min = m_max = Eigen::Vector3d::Zero();
+    if (m_molecule) {
+      const std::vector<Eigen::Vector3d> &positions = m_molecule->atomPositions();
+      for (unsigned int i = 0; i < m_ids.size(); ++i) {
+        const Eigen::Vector3d &pos = positions[m_ids[i]];
+
+        if (!i) {
+          m_min = m_max = pos;
+        } else {
+          if (pos.x() > m_max.x())
+            m_max.x() = pos.x();
+          else if (pos.x() < m_min.x())
+            m_min.x() = pos.x();
+
+          if (pos.y() > m_max.y())
+            m_max.y() = pos.y();
+          else if (pos.y() < m_min.y())
+            m_min.y() = pos.y();
+
+          if (pos.z() > m_max.z())
+            m_max.z() = pos.z();
+          else if (pos.z() < m_min.z())
+            m_min.z() = pos.z();
+        }
       }
     }
 
@@ -224,8 +296,13 @@ namespace Avogadro
     // the last cell is always empty and can be used for all ghost cells
     // in non-periodic boundary conditions.
     m_cells.resize(m_xyDim * m_dim.z() + 1);
-    foreach (Atom *atom, m_atoms) {
-      m_cells[cellIndex(*(atom->pos()))].push_back(&*atom);
+    m_atomCells.resize(m_ids.size());
+    if (!m_molecule)
+      return;
+    const std::vector<Eigen::Vector3d> &positions = m_molecule->atomPositions();
+    for (unsigned int i = 0; i < m_ids.size(); ++i) {
+      m_atomCells[i] = cellIndex(positions[m_ids[i]]);
+      m_cells[m_atomCells[i]].push_back(i);
     }
   }
 
@@ -54,7 +54,7 @@ namespace Avogadro
   class A_EXPORT NeighborList
   {
     private:
-      typedef std::vector<Atom*>::iterator atom_iter;
+      typedef std::vector<unsigned int>::const_iterator cell_iter;
 
     public:
       /**
@@ -80,6 +80,15 @@ namespace Avogadro
        * stay accurate.
        */
       void update();
+
+      /**
+       * Move the atoms in @p moved to their current cells, so that the
+       * neighbors found are exact. This is cheaper than building a new
+       * NeighborList when few atoms have moved. If an atom has left the grid
+       * of cells, then all of the cells are rebuilt.
+       * @param moved The atoms that have moved.
+       */
+      void update(const QList<Atom*> &moved);
       /**
        * Get the near-neighbor atoms for @p atom. The squared distance is
        * checked and is cached for later use (see r2() function).
@@ -185,6 +194,11 @@ namespace Avogadro
        * Initialize the 1-2 and 1-3 cache.
        */
       void initOneTwo();
+      /**
+       * Cache the unique ids and indices of the atoms, the positions are
+       * then read from the contiguous Molecule::atomPositions() array.
+       */
+      void initAtoms();
       void initCells();
       void updateCells();
       void initOffsetMap();
@@ -192,16 +206,25 @@ namespace Avogadro
       bool insideShpere(const Eigen::Vector3i &index);
 
       QList<Atom*>                        m_atoms;
+      Molecule                           *m_molecule;
+      std::vector<unsigned long>          m_ids;
+      std::vector<unsigned int>           m_indices;
       double                              m_rcut, m_rcut2;
       double                              m_edgeLength;
       int                                 m_boxSize;
       int                                 m_updateCounter;
+      bool                                m_periodic;
+      // Index in m_atoms/m_ids of each atom id, or -1
+      std::vector<int>                    m_idIndex;
+      // Cell of each atom in m_atoms/m_ids
+      std::vector<unsigned int>           m_atomCells;
 
 
       Eigen::Vector3d                     m_min, m_max;
       Eigen::Vector3i                     m_dim;
       int                                 m_xyDim;
-      std::vector<std::vector<Atom*> >    m_cells;
+      // Cells contain the position of the atoms in m_atoms/m_ids
+      std::vector<std::vector<unsigned int> > m_cells;
 
       std::vector<Eigen::Vector3i>        m_offsetMap;
       std::vector<Eigen::Vector3i>        m_ghostMap;
@@ -26,6 +26,7 @@
  **********************************************************************/
 
 #include "painter.h"
+#include "instancebatch.h"
 
 namespace Avogadro
 {
@@ -53,6 +54,19 @@ namespace Avogadro
     drawSphere(*center, radius);
   }
 
+  void Painter::drawBatch(InstanceBatch *batch)
+  {
+    for (int i = 0; i < batch->size(); ++i) {
+      const float *color = batch->color(i);
+      setColor(color[0], color[1], color[2], color[3]);
+      if (batch->shape() == InstanceBatch::Spheres)
+        drawSphere(batch->end1(i), batch->radius(i));
+      else
+        drawMultiCylinder(batch->end1(i), batch->end2(i), batch->radius(i),
+                          batch->order(i), batch->shift(i));
+    }
+  }
+
   void Painter::drawQuadrilateral(const Eigen::Vector3d & p1,
                                   const Eigen::Vector3d & p2,
                                   const Eigen::Vector3d & p3,
@@ -50,6 +50,7 @@ namespace Avogadro
    */
   class Color;
   class Mesh;
+  class InstanceBatch;
   class A_EXPORT Painter
   {
   public:
@@ -176,6 +177,15 @@ namespace Avogadro
                                    const Eigen::Vector3d &end2,
                                    double radius, int order, double shift) = 0;
 
+    /**
+     * Draws every sphere or cylinder of a batch, each with its own color.
+     * The default implementation draws the instances one at a time with
+     * drawSphere() and drawMultiCylinder(), painters that can keep the
+     * geometry between frames should reimplement it.
+     * @param batch The instances to draw.
+     */
+    virtual void drawBatch(InstanceBatch *batch);
+
     /**
      * Draws a cone between the tip and the base with the base radius given.
      * @param base the position of the base of the cone.
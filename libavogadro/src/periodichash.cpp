@@ -0,0 +1,164 @@
+/**********************************************************************
+  PeriodicHash - finds duplicate fractional coordinates in a unit cell
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "periodichash.h"
+
+#include <cmath>
+
+using Eigen::Vector3d;
+
+namespace Avogadro {
+
+  // Most grid cells along each axis, keeps the cell keys within an int
+  static const int MAX_DIVISIONS = 1000;
+
+  PeriodicHash::PeriodicHash(double tolerance)
+  {
+    clear(tolerance);
+  }
+
+  PeriodicHash::~PeriodicHash()
+  {
+  }
+
+  void PeriodicHash::clear(double tolerance)
+  {
+    m_tolerance = std::fabs(tolerance);
+    // Cells at least as wide as the tolerance, so duplicates are in
+    // neighbouring cells. With fewer than three cells the neighbours wrap
+    // onto each other, so use a single one.
+    m_divisions = MAX_DIVISIONS;
+    if (m_tolerance * MAX_DIVISIONS > 1.0)
+      m_divisions = static_cast<int>(1.0 / m_tolerance);
+    if (m_divisions < 3)
+      m_divisions = 1;
+    clear();
+  }
+
+  void PeriodicHash::clear()
+  {
+    m_coords.clear();
+    m_cells.clear();
+  }
+
+  int PeriodicHash::insert(const Vector3d &fcoord)
+  {
+    Vector3d wrapped = wrap(fcoord);
+    int i, j, k;
+    cellOf(wrapped, i, j, k);
+    int index = size();
+    m_coords.push_back(wrapped);
+    m_cells[cell(i, j, k)].append(index);
+    return index;
+  }
+
+  bool PeriodicHash::insertUnique(const Vector3d &fcoord)
+  {
+    if (find(fcoord) >= 0)
+      return false;
+    insert(fcoord);
+    return true;
+  }
+
+  int PeriodicHash::find(const Vector3d &fcoord) const
+  {
+    Vector3d wrapped = wrap(fcoord);
+    int i, j, k;
+    cellOf(wrapped, i, j, k);
+    int range = m_divisions > 1 ? 1 : 0;
+    for (int di = -range; di <= range; ++di)
+      for (int dj = -range; dj <= range; ++dj)
+        for (int dk = -range; dk <= range; ++dk) {
+          QHash<int, QList<int> >::const_iterator it =
+            m_cells.constFind(cell(i + di, j + dj, k + dk));
+          if (it == m_cells.constEnd())
+            continue;
+          foreach (int index, it.value())
+            if (near(m_coords[index], wrapped))
+              return index;
+        }
+    return -1;
+  }
+
+  QList<int> PeriodicHash::findAll(const Vector3d &fcoord) const
+  {
+    QList<int> indices;
+    Vector3d wrapped = wrap(fcoord);
+    int i, j, k;
+    cellOf(wrapped, i, j, k);
+    int range = m_divisions > 1 ? 1 : 0;
+    for (int di = -range; di <= range; ++di)
+      for (int dj = -range; dj <= range; ++dj)
+        for (int dk = -range; dk <= range; ++dk) {
+          QHash<int, QList<int> >::const_iterator it =
+            m_cells.constFind(cell(i + di, j + dj, k + dk));
+          if (it == m_cells.constEnd())
+            continue;
+          foreach (int index, it.value())
+            if (near(m_coords[index], wrapped))
+              indices.append(index);
+        }
+    return indices;
+  }
+
+  Vector3d PeriodicHash::wrap(const Vector3d &fcoord)
+  {
+    Vector3d wrapped;
+    for (int axis = 0; axis < 3; ++axis) {
+      wrapped[axis] = fcoord[axis] - std::floor(fcoord[axis]);
+      // Rounding can leave -1e-17 at 1.0
+      if (wrapped[axis] >= 1.0)
+        wrapped[axis] = 0.0;
+    }
+    return wrapped;
+  }
+
+  int PeriodicHash::cell(int i, int j, int k) const
+  {
+    // Wrap the indices of neighbours across the faces of the unit cell
+    i = (i + m_divisions) % m_divisions;
+    j = (j + m_divisions) % m_divisions;
+    k = (k + m_divisions) % m_divisions;
+    return (i * m_divisions + j) * m_divisions + k;
+  }
+
+  void PeriodicHash::cellOf(const Vector3d &fcoord, int &i, int &j,
+                            int &k) const
+  {
+    i = static_cast<int>(fcoord.x() * m_divisions);
+    j = static_cast<int>(fcoord.y() * m_divisions);
+    k = static_cast<int>(fcoord.z() * m_divisions);
+    if (i >= m_divisions) i = m_divisions - 1;
+    if (j >= m_divisions) j = m_divisions - 1;
+    if (k >= m_divisions) k = m_divisions - 1;
+  }
+
+  bool PeriodicHash::near(const Vector3d &a, const Vector3d &b) const
+  {
+    // Distance to the nearest periodic image of b
+    Vector3d d = a - b;
+    for (int axis = 0; axis < 3; ++axis)
+      d[axis] -= std::floor(d[axis] + 0.5);
+    return d.squaredNorm() < m_tolerance * m_tolerance;
+  }
+
+} // End namespace Avogadro
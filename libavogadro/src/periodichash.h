@@ -0,0 +1,130 @@
+/**********************************************************************
+  PeriodicHash - finds duplicate fractional coordinates in a unit cell
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef PERIODICHASH_H
+#define PERIODICHASH_H
+
+#include <avogadro/global.h>
+
+#include <Eigen/Core>
+
+#include <QHash>
+#include <QList>
+#include <vector>
+
+namespace Avogadro {
+
+  /**
+   * @class PeriodicHash periodichash.h <avogadro/periodichash.h>
+   * @brief A spatial hash of fractional coordinates in a unit cell.
+   *
+   * The unit cell is divided into a grid of cells at least as wide as the
+   * tolerance along each axis, and each coordinate is kept in the cell it
+   * falls in. Looking for the coordinates within the tolerance of a point
+   * only checks the 27 cells around it, wrapping around the faces of the
+   * unit cell, so filling a cell with symmetry equivalent atoms takes time
+   * proportional to the number of atoms rather than its square.
+   *
+   * Distances are measured between the nearest periodic images, so a point
+   * at 0.999 is close to one at 0.001. The tolerance is in fractional units.
+   */
+  class A_EXPORT PeriodicHash
+  {
+    public:
+      /**
+       * Constructor.
+       * @param tolerance Coordinates closer than this are duplicates.
+       */
+      explicit PeriodicHash(double tolerance = 1.0e-2);
+      ~PeriodicHash();
+
+      /**
+       * Remove all of the coordinates and set a new tolerance.
+       */
+      void clear(double tolerance);
+
+      /**
+       * Remove all of the coordinates.
+       */
+      void clear();
+
+      /**
+       * @return The tolerance in fractional units.
+       */
+      double tolerance() const { return m_tolerance; }
+
+      /**
+       * Add a coordinate, duplicates are kept.
+       * @return The index of the coordinate.
+       */
+      int insert(const Eigen::Vector3d &fcoord);
+
+      /**
+       * Add a coordinate unless it is a duplicate of one already added.
+       * @return True if the coordinate was added.
+       */
+      bool insertUnique(const Eigen::Vector3d &fcoord);
+
+      /**
+       * @return The index of a coordinate within the tolerance of
+       * @p fcoord, or -1 if there is none.
+       */
+      int find(const Eigen::Vector3d &fcoord) const;
+
+      /**
+       * @return The indices of all of the coordinates within the tolerance
+       * of @p fcoord, in no particular order.
+       */
+      QList<int> findAll(const Eigen::Vector3d &fcoord) const;
+
+      /**
+       * @return The number of coordinates added.
+       */
+      int size() const { return static_cast<int>(m_coords.size()); }
+
+      /**
+       * @return The coordinate with the given index, wrapped into [0, 1).
+       */
+      const Eigen::Vector3d & coordinate(int index) const
+      {
+        return m_coords[index];
+      }
+
+      /**
+       * @return A fractional coordinate wrapped into [0, 1).
+       */
+      static Eigen::Vector3d wrap(const Eigen::Vector3d &fcoord);
+
+    private:
+      double m_tolerance;
+      int m_divisions;                  // Grid cells along each axis
+      std::vector<Eigen::Vector3d> m_coords;
+      QHash<int, QList<int> > m_cells;  // Coordinate indices in each cell
+
+      int cell(int i, int j, int k) const;
+      void cellOf(const Eigen::Vector3d &fcoord, int &i, int &j, int &k) const;
+      bool near(const Eigen::Vector3d &a, const Eigen::Vector3d &b) const;
+  };
+
+} // End namespace Avogadro
+
+#endif
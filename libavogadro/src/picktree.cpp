@@ -0,0 +1,276 @@
+/**********************************************************************
+  PickTree - bounding volume hierarchy for picking atoms and bonds
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "picktree.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include <algorithm>
+
+using Eigen::Vector3d;
+
+namespace Avogadro {
+
+  // Largest number of shapes in a leaf
+  static const int LEAF_SIZE = 4;
+
+  PickTree::PickTree()
+  {
+  }
+
+  PickTree::~PickTree()
+  {
+  }
+
+  void PickTree::clear()
+  {
+    m_pending.clear();
+  }
+
+  void PickTree::add(Primitive::Type type, unsigned int index,
+                     const Vector3d &a, const Vector3d &b, double radius)
+  {
+    Shape shape;
+    shape.a = a;
+    shape.b = b;
+    shape.radius = radius;
+    shape.type = type;
+    shape.index = index;
+    m_pending.push_back(shape);
+  }
+
+  void PickTree::update()
+  {
+    bool same = m_pending.size() == m_shapes.size();
+    for (unsigned int i = 0; same && i < m_shapes.size(); ++i)
+      same = m_pending[i].type == m_shapes[i].type
+          && m_pending[i].index == m_shapes[i].index;
+
+    m_shapes.swap(m_pending);
+    m_pending.clear();
+    if (same) {
+      refit();
+      return;
+    }
+
+    build();
+  }
+
+  void PickTree::move(const Molecule *molecule)
+  {
+    for (unsigned int i = 0; i < m_shapes.size(); ++i) {
+      Shape &shape = m_shapes[i];
+      if (shape.type == Primitive::AtomType) {
+        const Atom *atom = molecule->atom(shape.index);
+        if (atom)
+          shape.a = shape.b = *atom->pos();
+      }
+      else if (shape.type == Primitive::BondType) {
+        const Bond *bond = molecule->bond(shape.index);
+        if (bond && bond->beginAtom() && bond->endAtom()) {
+          shape.a = *bond->beginPos();
+          shape.b = *bond->endPos();
+        }
+      }
+    }
+    refit();
+  }
+
+  // Orders shape indices by the center of the shapes along one axis
+  class CenterLess
+  {
+    public:
+      CenterLess(const std::vector<Vector3d> &centers, int axis)
+        : m_centers(centers), m_axis(axis) {}
+      bool operator()(int a, int b) const
+      {
+        return m_centers[a][m_axis] < m_centers[b][m_axis];
+      }
+    private:
+      const std::vector<Vector3d> &m_centers;
+      int m_axis;
+  };
+
+  void PickTree::build()
+  {
+    m_order.resize(m_shapes.size());
+    for (unsigned int i = 0; i < m_order.size(); ++i)
+      m_order[i] = i;
+    m_nodes.clear();
+    if (m_shapes.empty())
+      return;
+
+    std::vector<Vector3d> centers(m_shapes.size());
+    for (unsigned int i = 0; i < m_shapes.size(); ++i)
+      centers[i] = 0.5 * (m_shapes[i].a + m_shapes[i].b);
+
+    // Split the nodes breadth first, so parents come before their children
+    m_nodes.resize(1);
+    std::vector<int> firsts(1, 0), counts(1, m_shapes.size());
+    for (unsigned int n = 0; n < m_nodes.size(); ++n) {
+      Node &node = m_nodes[n];
+      node.first = firsts[n];
+      node.count = counts[n];
+      node.left = -1;
+      if (node.count <= LEAF_SIZE)
+        continue;
+
+      // Split at the median along the longest axis of the centers
+      Vector3d min = centers[m_order[node.first]], max = min;
+      for (int i = node.first; i < node.first + node.count; ++i) {
+        const Vector3d &c = centers[m_order[i]];
+        for (int j = 0; j < 3; ++j) {
+          min[j] = std::min(min[j], c[j]);
+          max[j] = std::max(max[j], c[j]);
+        }
+      }
+      Vector3d extent = max - min;
+      int axis = 0;
+      for (int j = 1; j < 3; ++j)
+        if (extent[j] > extent[axis])
+          axis = j;
+      int mid = node.first + node.count / 2;
+      std::nth_element(m_order.begin() + node.first, m_order.begin() + mid,
+                       m_order.begin() + node.first + node.count,
+                       CenterLess(centers, axis));
+
+      node.left = m_nodes.size();
+      firsts.push_back(node.first);
+      counts.push_back(mid - node.first);
+      firsts.push_back(mid);
+      counts.push_back(node.first + node.count - mid);
+      node.count = 0;
+      // node is invalidated by the resize
+      m_nodes.resize(m_nodes.size() + 2);
+    }
+
+    refit();
+  }
+
+  void PickTree::refit()
+  {
+    for (int i = m_nodes.size() - 1; i >= 0; --i)
+      fit(m_nodes[i]);
+  }
+
+  void PickTree::fit(Node &node) const
+  {
+    if (node.count) {
+      const Shape &first = m_shapes[m_order[node.first]];
+      node.min = first.a;
+      node.max = first.a;
+      for (int i = node.first; i < node.first + node.count; ++i) {
+        const Shape &s = m_shapes[m_order[i]];
+        for (int j = 0; j < 3; ++j) {
+          node.min[j] = std::min(node.min[j],
+                                 std::min(s.a[j], s.b[j]) - s.radius);
+          node.max[j] = std::max(node.max[j],
+                                 std::max(s.a[j], s.b[j]) + s.radius);
+        }
+      }
+    }
+    else {
+      const Node &left = m_nodes[node.left];
+      const Node &right = m_nodes[node.left + 1];
+      for (int j = 0; j < 3; ++j) {
+        node.min[j] = std::min(left.min[j], right.min[j]);
+        node.max[j] = std::max(left.max[j], right.max[j]);
+      }
+    }
+  }
+
+  QList<GLHit> PickTree::hits(const std::vector<Plane> &planes,
+                              double depthRange) const
+  {
+    QList<GLHit> hits;
+    if (m_nodes.empty() || planes.empty())
+      return hits;
+
+    const Plane &nearPlane = planes[0];
+    const double scale = depthRange > 0.0 ? 4294967295.0 / depthRange : 0.0;
+
+    std::vector<int> stack(1, 0);
+    while (!stack.empty()) {
+      const Node &node = m_nodes[stack.back()];
+      stack.pop_back();
+
+      // Skip the node if its box is entirely outside any of the planes
+      bool outside = false;
+      foreach (const Plane &plane, planes) {
+        Vector3d corner;
+        for (int j = 0; j < 3; ++j)
+          corner[j] = plane.normal[j] >= 0.0 ? node.max[j] : node.min[j];
+        if (plane.normal.dot(corner) + plane.distance < 0.0) {
+          outside = true;
+          break;
+        }
+      }
+      if (outside)
+        continue;
+
+      if (!node.count) {
+        stack.push_back(node.left);
+        stack.push_back(node.left + 1);
+        continue;
+      }
+
+      for (int i = node.first; i < node.first + node.count; ++i) {
+        const Shape &s = m_shapes[m_order[i]];
+
+        // Clip the segment against the planes, each pushed out by the radius
+        double t0 = 0.0, t1 = 1.0;
+        foreach (const Plane &plane, planes) {
+          double da = plane.normal.dot(s.a) + plane.distance + s.radius;
+          double db = plane.normal.dot(s.b) + plane.distance + s.radius;
+          if (da < 0.0 && db < 0.0) {
+            t0 = 1.0;
+            t1 = 0.0;
+            break;
+          }
+          if (da < 0.0)
+            t0 = std::max(t0, da / (da - db));
+          else if (db < 0.0)
+            t1 = std::min(t1, da / (da - db));
+        }
+        if (t0 > t1)
+          continue;
+
+        // The depth of the clipped segment from the near plane
+        double d0 = nearPlane.normal.dot(s.a + t0 * (s.b - s.a))
+            + nearPlane.distance;
+        double d1 = nearPlane.normal.dot(s.a + t1 * (s.b - s.a))
+            + nearPlane.distance;
+        double minZ = std::max(0.0, std::min(d0, d1) - s.radius) * scale;
+        double maxZ = std::max(0.0, std::max(d0, d1) + s.radius) * scale;
+        hits.append(GLHit(s.type, s.index,
+                          static_cast<GLuint>(std::min(minZ, 4294967295.0)),
+                          static_cast<GLuint>(std::min(maxZ, 4294967295.0))));
+      }
+    }
+
+    qSort(hits);
+    return hits;
+  }
+
+} // End namespace Avogadro
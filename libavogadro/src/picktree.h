@@ -0,0 +1,146 @@
+/**********************************************************************
+  PickTree - bounding volume hierarchy for picking atoms and bonds
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef PICKTREE_H
+#define PICKTREE_H
+
+#include <avogadro/global.h>
+#include <avogadro/glhit.h>
+#include <avogadro/primitive.h>
+
+#include <Eigen/Core>
+
+#include <QList>
+#include <vector>
+
+namespace Avogadro {
+
+  class Molecule;
+
+  /**
+   * @class PickTree picktree.h <avogadro/picktree.h>
+   * @brief A bounding volume hierarchy for picking atoms and bonds.
+   *
+   * Each primitive is a capsule, the points within a radius of a line
+   * segment, so atoms are spheres and bonds are cylinders with rounded ends.
+   * The capsules are kept in a binary tree of axis aligned bounding boxes,
+   * split at the median of the longest axis. Picking finds the capsules
+   * inside a convex volume, such as the part of the view frustum under the
+   * mouse, without rendering anything.
+   *
+   * When the capsules move but the primitives stay the same the bounding
+   * boxes are refitted rather than the tree being rebuilt.
+   */
+  class A_EXPORT PickTree
+  {
+    public:
+      /**
+       * A plane, points with normal.dot(point) + distance >= 0 are inside.
+       */
+      struct Plane
+      {
+        Eigen::Vector3d normal;
+        double distance;
+      };
+
+      PickTree();
+      ~PickTree();
+
+      /**
+       * Start a new set of capsules, the tree is unchanged until update().
+       */
+      void clear();
+
+      /**
+       * Add a capsule for the primitive with the given index.
+       * @param type The type of the primitive, e.g. Primitive::AtomType.
+       * @param index The index of the primitive.
+       * @param a One end of the capsule.
+       * @param b The other end, the same as @p a for a sphere.
+       * @param radius The radius of the capsule.
+       */
+      void add(Primitive::Type type, unsigned int index,
+               const Eigen::Vector3d &a, const Eigen::Vector3d &b,
+               double radius);
+
+      /**
+       * Update the tree with the capsules added since clear(). If they are
+       * for the same primitives as the last update the bounding boxes are
+       * refitted, otherwise the tree is rebuilt.
+       */
+      void update();
+
+      /**
+       * Move the capsules of the atoms and bonds in the tree to their
+       * current positions in @p molecule, keeping their radii, and refit the
+       * bounding boxes. This is cheaper than adding the capsules again when
+       * only the atom positions changed, e.g. after
+       * Molecule::geometryChanged().
+       */
+      void move(const Molecule *molecule);
+
+      /**
+       * @return The number of capsules in the tree.
+       */
+      int size() const { return m_shapes.size(); }
+
+      /**
+       * Find the capsules that are inside all of the planes.
+       * @param planes The planes bounding the volume. The first is the near
+       * plane, the depth of each hit is measured from it.
+       * @param depthRange The depth scaled to the full range of the GLHit
+       * minZ and maxZ, usually the distance between the near and far planes.
+       * @return The hits, nearest first.
+       */
+      QList<GLHit> hits(const std::vector<Plane> &planes,
+                        double depthRange) const;
+
+    private:
+      struct Shape
+      {
+        Eigen::Vector3d a, b;
+        double radius;
+        unsigned int type;
+        unsigned int index;
+      };
+
+      struct Node
+      {
+        Eigen::Vector3d min, max;
+        int left;        // Index of the left child, the right follows it
+        int first;       // First shape of a leaf in m_order
+        int count;       // Number of shapes in a leaf, 0 for inner nodes
+      };
+
+      std::vector<Shape> m_shapes;    // Shapes in the tree
+      std::vector<Shape> m_pending;   // Shapes added since clear()
+      std::vector<int> m_order;       // Shape indices, leaves are ranges
+      std::vector<Node> m_nodes;      // Nodes, parents before children
+
+      void build();
+      void refit();
+      void fit(Node &node) const;
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -24,6 +24,8 @@
 
 #include "primitivelist.h"
 
+#include <QHash>
+#include <QSet>
 #include <QDebug>
 
 namespace Avogadro {
@@ -35,22 +37,62 @@ namespace Avogadro {
       int size;
 
       QVector< QList<Primitive *> > vector;
+
+      // The number of times each primitive is in the lists, for constant time
+      // lookups. Removed primitives are only taken out of the lists when the
+      // lists are next read, keeping removal constant time too.
+      QHash<const Primitive *, int> counts;
+      QVector< QSet<const Primitive *> > removed;
+
+      void resize()
+      {
+        vector.resize(Primitive::LastType);
+        removed.resize(Primitive::LastType);
+      }
+
+      void copy(const PrimitiveListPrivate *other)
+      {
+        size = other->size;
+        vector = other->vector;
+        counts = other->counts;
+        removed = other->removed;
+      }
+
+      // Take any removed primitives out of the list for type
+      void compact(int type)
+      {
+        if (removed[type].isEmpty())
+          return;
+        const QSet<const Primitive *> &r = removed[type];
+        QList<Primitive *> &l = vector[type];
+        QList<Primitive *> kept;
+        kept.reserve(l.size());
+        foreach (Primitive *p, l)
+          if (!r.contains(p))
+            kept.append(p);
+        l = kept;
+        removed[type].clear();
+      }
+
+      void compactAll()
+      {
+        for (int i = 0; i < vector.size(); ++i)
+          compact(i);
+      }
   };
 
   PrimitiveList::PrimitiveList() : d(new PrimitiveListPrivate) {
-    d->vector.resize(Primitive::LastType);
+    d->resize();
   }
 
   PrimitiveList::PrimitiveList(const PrimitiveList &other) : d(new PrimitiveListPrivate)
   {
-    PrimitiveListPrivate *e = other.d;
-    d->size = e->size;
-    d->vector = e->vector;
+    d->copy(other.d);
   }
 
   PrimitiveList::PrimitiveList(const QList<Primitive *> &other) : d(new PrimitiveListPrivate)
   {
-    d->vector.resize(Primitive::LastType);
+    d->resize();
     foreach(Primitive *primitive, other)
     {
       append(primitive);
@@ -59,9 +101,7 @@ namespace Avogadro {
 
   PrimitiveList &PrimitiveList::operator=(const PrimitiveList &other)
   {
-    PrimitiveListPrivate *e = other.d;
-    d->size = e->size;
-    d->vector = e->vector;
+    d->copy(other.d);
 
     return *this;
   }
@@ -84,17 +124,19 @@ namespace Avogadro {
 
   QList<Primitive *> PrimitiveList::subList(Primitive::Type type) const {
 
-    if(type > Primitive::LastType)
+    if(type >= Primitive::LastType)
     {
       return QList<Primitive *>();
     }
 
+    d->compact(type);
     return(d->vector[type]);
   }
 
   QList<Primitive *> PrimitiveList::list() const {
     QList<Primitive*> returnList;
 
+    d->compactAll();
     foreach(QList<Primitive*> typeList, d->vector) {
       returnList += typeList;
     }
@@ -103,21 +145,26 @@ namespace Avogadro {
   }
 
   bool PrimitiveList::contains(const Primitive *p) const {
-    // this is really bad, but it's a compiler workaround
-    Primitive *cp = const_cast<Primitive *>(p);
-    return d->vector[p->type()].contains(cp);
+    return d->counts.contains(p);
   }
 
   void PrimitiveList::append(Primitive *p) {
     if (!p || p->type() < Primitive::FirstType || p->type() >= Primitive::LastType)
       return;
+    // A primitive that was removed must be taken out before it is added back
+    if (d->removed[p->type()].contains(p))
+      d->compact(p->type());
     d->vector[p->type()].append(p);
+    ++d->counts[p];
     d->size++;
   }
 
   void PrimitiveList::removeAll(Primitive *p) {
-    d->vector[p->type()].removeAll(p);
-    d->size--;
+    int count = d->counts.take(p);
+    if (!count)
+      return;
+    d->removed[p->type()].insert(p);
+    d->size -= count;
   }
 
   int PrimitiveList::size() const {
@@ -135,23 +182,27 @@ namespace Avogadro {
 
   int PrimitiveList::count(Primitive::Type type) const
   {
-    if(type > Primitive::LastType)
+    if(type >= Primitive::LastType)
     {
       return 0;
     }
 
+    d->compact(type);
     return d->vector[type].size();
   }
 
   void PrimitiveList::clear() {
     for( int i=0; i<d->vector.size(); i++ ) {
       d->vector[i].clear();
+      d->removed[i].clear();
     }
+    d->counts.clear();
     d->size = 0;
   }
 
   PrimitiveList::const_iterator PrimitiveList::begin() const
   {
+    d->compactAll();
     return &(d->vector);
   }
 
@@ -41,7 +41,8 @@ namespace Avogadro
    *
    * The PrimitiveList class is designed to hold a set of Primitive objects
    * and keep them organized by type allowing groups of them to be
-   * retrieved in constant time.
+   * retrieved in constant time. Primitives keep the order they were added in,
+   * and contains() and removeAll() also take constant time.
    */
   class PrimitiveListPrivate;
   class A_EXPORT PrimitiveList
@@ -78,7 +79,8 @@ namespace Avogadro
       QList<Primitive *> list() const;
 
       /**
-       * @param p the primitive to check if it is in any list
+       * @param p the primitive to check if it is in any list, this is a
+       * constant time lookup
        * @return true or false depending on whether p is in this list
        */
       bool contains( const Primitive *p ) const;
@@ -9,6 +9,15 @@
 using namespace boost::python;
 using namespace Avogadro;
 
+// copy single precision cubes without converting the stored values
+std::vector<double> data(Cube &self)
+{
+  if (!self.isSinglePrecision())
+    return *self.data();
+  std::vector<float> *values = self.dataf();
+  return std::vector<double>(values->begin(), values->end());
+}
+
 void export_Cube()
 {
 
@@ -32,10 +41,15 @@ void export_Cube()
         &Cube::setName)
 
     .add_property("data", 
-        make_function(&Cube::data, return_value_policy<return_by_value>()), 
+        &data, 
         &Cube::setData, 
         "List containing all the data in a one-dimensional array.")
 
+    .add_property("singlePrecision", 
+        &Cube::isSinglePrecision, 
+        &Cube::setSinglePrecision, 
+        "True if the values are stored in single precision.")
+
     //
     // read-only properties
     //
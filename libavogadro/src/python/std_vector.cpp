@@ -191,6 +191,7 @@ class QListTest
 void export_std_vector()
 {
   export_std_vector< std::vector<double> >(); // for Cube
+  export_std_vector< std::vector<unsigned int> >(); // for Mesh
   export_std_vector< std::vector<Eigen::Vector3f> >(); // for Mesh
   export_std_vector< std::vector<Eigen::Vector3d> >(); // for Mesh
   export_std_vector< std::vector<QColor> >(); // for Mesh
@@ -139,6 +139,12 @@ class TestCube(unittest.TestCase):
 
     cube.data = data
     self.assertEqual(len(cube.data), 125)
+
+    # single precision values are still returned
+    cube.singlePrecision = True
+    self.assertEqual(cube.singlePrecision, True)
+    self.assertEqual(len(cube.data), 125)
+    self.assertEqual(cube.data[124], 124)
   
   def test_index(self):
     cube = self.molecule.addCube()
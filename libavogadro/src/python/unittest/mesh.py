@@ -72,6 +72,13 @@ class TestMesh(unittest.TestCase):
     self.mesh.addColors(colors)
     self.assertEqual(len(self.mesh.colors), 6)
   
+  def test_indices(self):
+    self.assertEqual(len(self.mesh.indices), 0)
+    self.mesh.indices = [0, 1, 2, 2, 1, 0]
+    self.assertEqual(len(self.mesh.indices), 6)
+    self.assertEqual(self.mesh.numIndices, 6)
+    self.assertEqual(self.mesh.indices[3], 2)
+
   def test_valid(self):
     # just test it's there...
     self.assertEqual(self.mesh.valid, True)
@@ -25,7 +25,9 @@
 #include "moleculefile.h"
 
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QStringList>
+#include <QtCore/QtConcurrentMap>
 
 #include <openbabel/mol.h>
 #include <openbabel/obconversion.h>
@@ -37,13 +39,46 @@ namespace Avogadro {
 using OpenBabel::OBConversion;
 using std::ifstream;
 
+// number of frames decoded per batch
+static const int FrameBatchSize = 256;
+
+// element of an atom line, compared between frames to detect conformers
+static QByteArray frameElement(ReadFileThread::FrameFormat format,
+                               const QByteArray &line)
+{
+  if (format == ReadFileThread::XYZFrames) {
+    QByteArray fields = line.simplified();
+    int end = fields.indexOf(' ');
+    return end < 0 ? fields : fields.left(end);
+  }
+  // PDB element columns, or the atom name if they are missing
+  QByteArray element = line.mid(76, 2).trimmed();
+  return element.isEmpty() ? line.mid(12, 4).trimmed() : element;
+}
+
 ReadFileThread::ReadFileThread(MoleculeFile *moleculeFile)
-  : m_moleculeFile(moleculeFile)
+  : m_moleculeFile(moleculeFile), m_decodeFailed(false)
 {
 }
 
+ReadFileThread::FrameFormat ReadFileThread::frameFormat(const QString &fileName,
+                                                        const QString &fileType)
+{
+  QString format = fileType.isEmpty() ? QFileInfo(fileName).suffix().toLower()
+                                      : fileType.toLower();
+  if (format == QLatin1String("xyz"))
+    return XYZFrames;
+  if (format == QLatin1String("pdb") || format == QLatin1String("ent"))
+    return PDBFrames;
+  return OBFrames;
+}
+
 void ReadFileThread::addConformer(const OpenBabel::OBMol &conformer)
 {
+  // streaming files decode the conformers on demand
+  if (m_moleculeFile->isStreaming())
+    return;
+
   unsigned int numAtoms = conformer.NumAtoms();
   std::vector<Eigen::Vector3d> *coords = new std::vector<Eigen::Vector3d>;
   coords->reserve(numAtoms); // pre-allocate room for all atoms.
@@ -108,6 +143,231 @@ void ReadFileThread::detectConformers(unsigned int c,
   }
 }
 
+bool ReadFileThread::decodeFrame(FrameFormat format, const QByteArray &data,
+                                 std::vector<Eigen::Vector3d> &coords)
+{
+  if (format == XYZFrames) {
+    // atom count, title and one line per atom
+    QList<QByteArray> lines = data.split('\n');
+    if (lines.size() < 2)
+      return false;
+    bool ok;
+    unsigned int numAtoms = lines.at(0).trimmed().toUInt(&ok);
+    if (!ok || static_cast<unsigned int>(lines.size()) < numAtoms + 2)
+      return false;
+
+    coords.resize(numAtoms);
+    for (unsigned int i = 0; i < numAtoms; ++i) {
+      QList<QByteArray> fields = lines.at(i + 2).simplified().split(' ');
+      if (fields.size() < 4)
+        return false;
+      bool okX, okY, okZ;
+      coords[i] = Eigen::Vector3d(fields.at(1).toDouble(&okX),
+                                  fields.at(2).toDouble(&okY),
+                                  fields.at(3).toDouble(&okZ));
+      if (!okX || !okY || !okZ)
+        return false;
+    }
+    return true;
+  }
+
+  if (format == PDBFrames) {
+    // ATOM/HETATM records with fixed columns
+    coords.clear();
+    foreach (const QByteArray &line, data.split('\n')) {
+      if (!line.startsWith("ATOM  ") && !line.startsWith("HETATM"))
+        continue;
+      if (line.size() < 54)
+        return false;
+      coords.push_back(Eigen::Vector3d(line.mid(30, 8).trimmed().toDouble(),
+                                       line.mid(38, 8).trimmed().toDouble(),
+                                       line.mid(46, 8).trimmed().toDouble()));
+    }
+    return !coords.empty();
+  }
+
+  return false;
+}
+
+void ReadFileThread::decodeJob(FrameJob &job)
+{
+  job.success = decodeFrame(job.format, job.data, *job.coords);
+  job.data = QByteArray(); // release the raw frame as soon as possible
+}
+
+void ReadFileThread::queueFrame(FrameFormat format, const QByteArray &data)
+{
+  FrameJob job;
+  job.format = format;
+  job.data = data;
+  job.coords = new std::vector<Eigen::Vector3d>;
+  job.success = false;
+
+  // decode the first frame right away so it can be shown
+  if (m_moleculeFile->streamposRef().size() == 1) {
+    decodeJob(job);
+    m_runningFrames.append(job);
+    commitFrames();
+    m_moleculeFile->setFirstReady(true);
+    return;
+  }
+
+  m_pendingFrames.append(job);
+  if (m_pendingFrames.size() >= FrameBatchSize)
+    dispatchFrames();
+}
+
+void ReadFileThread::dispatchFrames()
+{
+  commitFrames();
+  if (m_pendingFrames.isEmpty())
+    return;
+
+  m_runningFrames = m_pendingFrames;
+  m_pendingFrames.clear();
+  m_future = QtConcurrent::map(m_runningFrames, ReadFileThread::decodeJob);
+}
+
+void ReadFileThread::commitFrames()
+{
+  m_future.waitForFinished();
+  std::vector<std::vector<Eigen::Vector3d>*> &conformers = m_moleculeFile->m_conformers;
+  for (int i = 0; i < m_runningFrames.size(); ++i) {
+    const FrameJob &job = m_runningFrames.at(i);
+    if (job.success && !m_decodeFailed) {
+      conformers.push_back(job.coords);
+    } else {
+      m_decodeFailed = true;
+      delete job.coords;
+    }
+  }
+  m_runningFrames.clear();
+}
+
+bool ReadFileThread::indexFrames(FrameFormat format)
+{
+  QFile file(m_moleculeFile->m_fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  std::vector<std::streampos> &streampos = m_moleculeFile->streamposRef();
+  QStringList &titles = m_moleculeFile->titlesRef();
+  std::vector<unsigned int> &atomCounts = m_moleculeFile->atomCountsRef();
+  // conformers are decoded while indexing unless the file is streamed
+  bool decode = !m_moleculeFile->isStreaming();
+  m_decodeFailed = false;
+  int firstNumAtoms = -1;
+  // the elements of the first frame, all frames must match them
+  QList<QByteArray> firstElements;
+  bool sameAtoms = true;
+  bool complete = true;
+
+  if (format == XYZFrames) {
+    // atom count, title and one line per atom
+    while (!file.atEnd()) {
+      qint64 start = file.pos();
+      QByteArray frame = file.readLine();
+      QByteArray line = frame.trimmed();
+      if (line.isEmpty())
+        continue; // blank lines between frames
+
+      bool ok;
+      int numAtoms = line.toInt(&ok);
+      if (!ok || numAtoms <= 0) {
+        complete = false;
+        break;
+      }
+      QByteArray titleLine = file.readLine();
+      if (decode)
+        frame += titleLine;
+      bool firstFrame = streampos.empty();
+      int i = 0;
+      for (; i < numAtoms && !file.atEnd(); ++i) {
+        QByteArray atomLine = file.readLine();
+        if (decode)
+          frame += atomLine;
+        if (firstFrame)
+          firstElements.append(frameElement(format, atomLine));
+        else if (sameAtoms && (i >= firstElements.size() ||
+                 firstElements.at(i) != frameElement(format, atomLine)))
+          sameAtoms = false;
+      }
+      if (i < numAtoms)
+        break; // truncated last frame (e.g. a running simulation)
+
+      streampos.push_back(start);
+      titles.append(QString::fromLocal8Bit(titleLine.trimmed()));
+      atomCounts.push_back(numAtoms);
+      if (firstNumAtoms < 0)
+        firstNumAtoms = numAtoms;
+      else if (numAtoms != firstNumAtoms)
+        sameAtoms = false;
+
+      if (decode && sameAtoms)
+        queueFrame(format, frame);
+    }
+  } else {
+    // models are terminated by ENDMDL (or END for concatenated files)
+    qint64 start = 0;
+    int numAtoms = 0;
+    QByteArray frame;
+    forever {
+      bool atEnd = file.atEnd();
+      QByteArray line = atEnd ? QByteArray("END") : file.readLine();
+      if (decode)
+        frame += line;
+      if (line.startsWith("ATOM  ") || line.startsWith("HETATM")) {
+        if (streampos.empty())
+          firstElements.append(frameElement(format, line));
+        else if (sameAtoms && (numAtoms >= firstElements.size() ||
+                 firstElements.at(numAtoms) != frameElement(format, line)))
+          sameAtoms = false;
+        ++numAtoms;
+      } else if (line.startsWith("END")) {
+        if (numAtoms) {
+          streampos.push_back(start);
+          titles.append(QString());
+          atomCounts.push_back(numAtoms);
+          if (firstNumAtoms < 0)
+            firstNumAtoms = numAtoms;
+          else if (numAtoms != firstNumAtoms)
+            sameAtoms = false;
+
+          if (decode && sameAtoms)
+            queueFrame(format, frame);
+        }
+        numAtoms = 0;
+        start = file.pos();
+        frame.clear();
+      }
+      if (atEnd)
+        break;
+    }
+  }
+
+  if (decode) {
+    dispatchFrames();
+    commitFrames();
+  }
+
+  bool isConformerFile = sameAtoms && !m_decodeFailed;
+  if (!isConformerFile || !complete) {
+    for (unsigned int i = 0; i < m_moleculeFile->m_conformers.size(); ++i)
+      delete m_moleculeFile->m_conformers[i];
+    m_moleculeFile->m_conformers.clear();
+  }
+
+  if (!complete || streampos.empty()) {
+    streampos.clear();
+    titles.clear();
+    atomCounts.clear();
+    return false;
+  }
+
+  m_moleculeFile->setConformerFile(isConformerFile);
+  return true;
+}
+
 void ReadFileThread::run()
 {
   // Check that the file can be read from disk
@@ -118,16 +378,34 @@ void ReadFileThread::run()
     return;
   }
 
+  // a valid index file makes reading the whole file unnecessary
+  if (m_moleculeFile->loadIndex())
+    return;
+
+  // XYZ and PDB files are split into frames here and decoded in parallel
+  FrameFormat format = frameFormat(m_moleculeFile->m_fileName,
+                                   m_moleculeFile->m_fileType);
+  if (format != OBFrames) {
+    m_moleculeFile->setFrameFormat(format);
+    if (indexFrames(format)) {
+      finishReading(m_moleculeFile->streamposRef().size());
+      return;
+    }
+    // not a plain XYZ/PDB file, let Open Babel try
+    m_moleculeFile->setFrameFormat(OBFrames);
+  }
+
   // Construct the OpenBabel objects, set the file type
   OpenBabel::OBConversion conv;
   OpenBabel::OBFormat *inFormat;
-  if (!m_moleculeFile->m_fileType.isEmpty() &&
-      !conv.SetInFormat(m_moleculeFile->m_fileType.toAscii().data())) {
-    // Input format not supported
-    m_moleculeFile->m_error.append(
-          QObject::tr("File type '%1' is not supported for reading.")
-          .arg(m_moleculeFile->m_fileType));
-    return;
+  if (!m_moleculeFile->m_fileType.isEmpty()) {
+    if (!conv.SetInFormat(m_moleculeFile->m_fileType.toAscii().data())) {
+      // Input format not supported
+      m_moleculeFile->m_error.append(
+            QObject::tr("File type '%1' is not supported for reading.")
+            .arg(m_moleculeFile->m_fileType));
+      return;
+    }
   }
   else {
     inFormat = conv.FormatFromExt(m_moleculeFile->m_fileName.toAscii().data());
@@ -171,14 +449,22 @@ void ReadFileThread::run()
     // store information about molecule
     m_moleculeFile->streamposRef().push_back(ifs.tellg());
     m_moleculeFile->titlesRef().append(currentOBMol.GetTitle());
+    m_moleculeFile->atomCountsRef().push_back(currentOBMol.NumAtoms());
     // increment count
     ++c;
   }
   m_moleculeFile->streamposRef().pop_back();
 
+  finishReading(c);
+}
+
+void ReadFileThread::finishReading(unsigned int c)
+{
   // single molecule files are not conformer files
   if (c == 1) {
     m_moleculeFile->setConformerFile(false);
+    for (unsigned int i = 0; i < m_moleculeFile->m_conformers.size(); ++i)
+      delete m_moleculeFile->m_conformers[i];
     m_moleculeFile->m_conformers.clear();
   }
 
@@ -195,6 +481,8 @@ void ReadFileThread::run()
 
     m_moleculeFile->titlesRef()[i] = title;
   }
+
+  m_moleculeFile->saveIndex();
 }
 
 }
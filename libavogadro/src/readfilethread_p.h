@@ -24,6 +24,14 @@
 #define READFILETHREAD_P_H
 
 #include <QtCore/QThread>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+#include <QtCore/QFuture>
+
+#include <Eigen/Core>
+
+#include <vector>
 
 namespace OpenBabel {
 class OBMol;
@@ -39,16 +47,76 @@ class ReadFileThread : public QThread
   Q_OBJECT
 
 public:
+  /**
+   * Frame formats which can be indexed and decoded without Open Babel.
+   */
+  enum FrameFormat { OBFrames, XYZFrames, PDBFrames };
+
   ReadFileThread(MoleculeFile *moleculeFile);
 
+  static FrameFormat frameFormat(const QString &fileName, const QString &fileType);
+
+  /**
+   * Decode the coordinates of a single XYZ or PDB frame. This function only
+   * uses its arguments and can be called from multiple threads.
+   */
+  static bool decodeFrame(FrameFormat format, const QByteArray &data,
+                          std::vector<Eigen::Vector3d> &coords);
+
   void addConformer(const OpenBabel::OBMol &conformer);
 
   void detectConformers(unsigned int c, const OpenBabel::OBMol &first,
                         const OpenBabel::OBMol &current);
 
+  /**
+   * Index the frames of an XYZ or PDB file. Only the frame offsets, titles
+   * and atom counts are stored. For files which are not streamed, the frames
+   * are also passed to queueFrame() to decode the conformers.
+   * @return False if the file could not be indexed completely, the file
+   * should then be read using Open Babel.
+   */
+  bool indexFrames(FrameFormat format);
+
+  /**
+   * Queue a frame for decoding. Frame 0 is decoded immediately (and
+   * firstMolReady() emitted), the others are decoded in batches by
+   * the global thread pool while the next batch is being indexed.
+   */
+  void queueFrame(FrameFormat format, const QByteArray &data);
+
+  /**
+   * Start decoding the queued frames after committing the running batch.
+   */
+  void dispatchFrames();
+
+  /**
+   * Wait for the running batch and append the conformers in order.
+   */
+  void commitFrames();
+
+  /**
+   * Common post processing after @p count molecules have been read/indexed.
+   */
+  void finishReading(unsigned int count);
+
   void run();
 
   MoleculeFile *m_moleculeFile;
+
+private:
+  struct FrameJob
+  {
+    FrameFormat format;
+    QByteArray data;
+    std::vector<Eigen::Vector3d> *coords;
+    bool success;
+  };
+  static void decodeJob(FrameJob &job);
+
+  QVector<FrameJob> m_pendingFrames; // queued, not decoding yet
+  QVector<FrameJob> m_runningFrames; // decoding in m_future
+  QFuture<void> m_future;
+  bool m_decodeFailed;
 };
 
 } // End of namespace
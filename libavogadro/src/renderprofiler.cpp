@@ -0,0 +1,285 @@
+/**********************************************************************
+  RenderProfiler - times the parts of each frame drawn by a GLWidget
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "renderprofiler.h"
+
+#include <QHash>
+#include <QObject>
+#include <QFile>
+#include <QTextStream>
+
+#if QT_VERSION >= 0x040800
+  #include <QElapsedTimer>
+#else
+  #include <QTime>
+#endif
+
+namespace Avogadro {
+
+  // Milliseconds since start(), with sub-millisecond resolution where the
+  // Qt version allows it
+  class ProfileTimer
+  {
+    public:
+      void start() { m_timer.start(); }
+#if QT_VERSION >= 0x040800
+      double elapsed() const { return m_timer.nsecsElapsed() * 1.0e-6; }
+    private:
+      QElapsedTimer m_timer;
+#else
+      double elapsed() const { return m_timer.elapsed(); }
+    private:
+      QTime m_timer;
+#endif
+  };
+
+  class RenderProfilerPrivate
+  {
+    public:
+      RenderProfilerPrivate(int frames_) : enabled(false),
+        capacity(frames_ > 0 ? frames_ : 1), frames(0), next(0),
+        inFrame(false), section(-1) {}
+
+      int sectionIndex(const QString &name);
+
+      bool enabled;
+      int capacity;             // Frames kept
+      int frames;               // Frames recorded, at most capacity
+      int next;                 // Slot of the next frame in each ring
+
+      QStringList sections;
+      QHash<QString, int> indices;
+      QVector<QVector<double> > times;  // A ring of times for each section
+      QVector<double> current;          // Times of the current frame
+
+      bool inFrame;
+      int section;              // Section being timed, or -1
+      ProfileTimer frameTimer, sectionTimer;
+  };
+
+  int RenderProfilerPrivate::sectionIndex(const QString &name)
+  {
+    QHash<QString, int>::const_iterator it = indices.constFind(name);
+    if (it != indices.constEnd())
+      return it.value();
+
+    int index = sections.size();
+    sections.append(name);
+    indices.insert(name, index);
+    times.append(QVector<double>(capacity, 0.0));
+    current.append(0.0);
+    return index;
+  }
+
+  RenderProfiler::RenderProfiler(int frames)
+    : d(new RenderProfilerPrivate(frames))
+  {
+    d->sectionIndex(frameSection());
+  }
+
+  RenderProfiler::~RenderProfiler()
+  {
+    delete d;
+  }
+
+  void RenderProfiler::setEnabled(bool enabled)
+  {
+    d->enabled = enabled;
+    d->inFrame = false;
+    d->section = -1;
+  }
+
+  bool RenderProfiler::isEnabled() const
+  {
+    return d->enabled;
+  }
+
+  void RenderProfiler::beginFrame()
+  {
+    if (!d->enabled)
+      return;
+    d->current.fill(0.0);
+    d->inFrame = true;
+    d->section = -1;
+    d->frameTimer.start();
+  }
+
+  void RenderProfiler::endFrame()
+  {
+    if (!d->enabled || !d->inFrame)
+      return;
+    end();
+    d->current[0] = d->frameTimer.elapsed();
+    for (int i = 0; i < d->times.size(); ++i)
+      d->times[i][d->next] = d->current[i];
+    d->next = (d->next + 1) % d->capacity;
+    if (d->frames < d->capacity)
+      ++d->frames;
+    d->inFrame = false;
+  }
+
+  void RenderProfiler::begin(const QString &section)
+  {
+    if (!d->enabled || !d->inFrame)
+      return;
+    end();
+    d->section = d->sectionIndex(section);
+    d->sectionTimer.start();
+  }
+
+  void RenderProfiler::end()
+  {
+    if (d->section < 0)
+      return;
+    d->current[d->section] += d->sectionTimer.elapsed();
+    d->section = -1;
+  }
+
+  void RenderProfiler::addTime(const QString &section, double milliseconds)
+  {
+    if (!d->enabled || !d->inFrame)
+      return;
+    d->current[d->sectionIndex(section)] += milliseconds;
+  }
+
+  void RenderProfiler::clear()
+  {
+    d->sections.clear();
+    d->indices.clear();
+    d->times.clear();
+    d->current.clear();
+    d->frames = 0;
+    d->next = 0;
+    d->inFrame = false;
+    d->section = -1;
+    d->sectionIndex(frameSection());
+  }
+
+  QString RenderProfiler::frameSection()
+  {
+    return QLatin1String("Frame");
+  }
+
+  QStringList RenderProfiler::sections() const
+  {
+    return d->sections;
+  }
+
+  int RenderProfiler::frames() const
+  {
+    return d->frames;
+  }
+
+  QVector<double> RenderProfiler::times(const QString &section) const
+  {
+    QVector<double> result;
+    QHash<QString, int>::const_iterator it = d->indices.constFind(section);
+    if (it == d->indices.constEnd())
+      return result;
+
+    const QVector<double> &ring = d->times.at(it.value());
+    int first = d->frames < d->capacity ? 0 : d->next;
+    result.reserve(d->frames);
+    for (int i = 0; i < d->frames; ++i)
+      result.append(ring.at((first + i) % d->capacity));
+    return result;
+  }
+
+  double RenderProfiler::average(const QString &section) const
+  {
+    QVector<double> t = times(section);
+    if (t.isEmpty())
+      return 0.0;
+    double sum = 0.0;
+    foreach (double time, t)
+      sum += time;
+    return sum / t.size();
+  }
+
+  double RenderProfiler::maximum(const QString &section) const
+  {
+    double max = 0.0;
+    foreach (double time, times(section))
+      if (time > max)
+        max = time;
+    return max;
+  }
+
+  QVector<int> RenderProfiler::histogram(const QString &section, int bins,
+                                         double binWidth) const
+  {
+    QVector<int> counts(bins > 0 ? bins : 0, 0);
+    if (counts.isEmpty() || binWidth <= 0.0)
+      return counts;
+    foreach (double time, times(section)) {
+      int bin = static_cast<int>(time / binWidth);
+      counts[bin < bins ? bin : bins - 1]++;
+    }
+    return counts;
+  }
+
+  QString RenderProfiler::toCsv() const
+  {
+    QString csv;
+    QTextStream out(&csv);
+
+    // Quote the names, engine aliases may contain commas
+    out << "\"Frame number\"";
+    foreach (QString section, d->sections)
+      out << ",\"" << section.replace('"', "\"\"") << "\"";
+    out << "\n";
+
+    QVector<QVector<double> > columns;
+    foreach (const QString &section, d->sections)
+      columns.append(times(section));
+    for (int frame = 0; frame < d->frames; ++frame) {
+      out << frame;
+      for (int i = 0; i < columns.size(); ++i)
+        out << "," << QString::number(columns.at(i).at(frame), 'f', 3);
+      out << "\n";
+    }
+    out.flush();
+    return csv;
+  }
+
+  bool RenderProfiler::writeCsv(const QString &fileName, QString *error) const
+  {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+      if (error)
+        error->append(QObject::tr("File %1 cannot be opened for writing: %2")
+                      .arg(fileName).arg(file.errorString()));
+      return false;
+    }
+    QTextStream out(&file);
+    out << toCsv();
+    out.flush();
+    if (out.status() != QTextStream::Ok || file.error() != QFile::NoError) {
+      if (error)
+        error->append(QObject::tr("Writing to the file %1 failed: %2")
+                      .arg(fileName).arg(file.errorString()));
+      return false;
+    }
+    return true;
+  }
+
+} // End namespace Avogadro
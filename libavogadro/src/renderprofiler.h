@@ -0,0 +1,174 @@
+/**********************************************************************
+  RenderProfiler - times the parts of each frame drawn by a GLWidget
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef RENDERPROFILER_H
+#define RENDERPROFILER_H
+
+#include <avogadro/global.h>
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace Avogadro {
+
+  class RenderProfilerPrivate;
+
+  /**
+   * @class RenderProfiler renderprofiler.h <avogadro/renderprofiler.h>
+   * @brief Times the parts of each frame drawn by a GLWidget.
+   *
+   * The GLWidget times each call to the render methods of its engines, the
+   * painting of the tools and the text overlay, and the whole frame. The
+   * times of the last frames() frames are kept for each section, so the
+   * average, the maximum and the distribution of each can be shown in the
+   * debug overlay or exported for analysis.
+   *
+   * The times are CPU times, OpenGL may finish drawing a section after it
+   * has returned. Timing is off unless the profiler is enabled, which
+   * GLWidget does while debug information is shown.
+   */
+  class A_EXPORT RenderProfiler
+  {
+    public:
+      /**
+       * Constructor.
+       * @param frames The number of frames the times are kept for.
+       */
+      explicit RenderProfiler(int frames = 120);
+      ~RenderProfiler();
+
+      /**
+       * Turn timing on or off, the recorded times are kept.
+       */
+      void setEnabled(bool enabled);
+
+      /**
+       * @return True if the profiler records times.
+       */
+      bool isEnabled() const;
+
+      /**
+       * Start timing a frame.
+       */
+      void beginFrame();
+
+      /**
+       * Stop timing the frame, recording its time and the time of each
+       * section in it. Sections that were not drawn take 0 ms.
+       */
+      void endFrame();
+
+      /**
+       * Start timing a section of the current frame, sections are not
+       * nested.
+       * @param section The name of the section, e.g. "Ball and Stick opaque".
+       */
+      void begin(const QString &section);
+
+      /**
+       * Stop timing the section started by begin().
+       */
+      void end();
+
+      /**
+       * Add time to a section of the current frame, for parts of the frame
+       * that are timed elsewhere. Times added to the same section in one
+       * frame are summed.
+       * @param section The name of the section.
+       * @param milliseconds The time taken.
+       */
+      void addTime(const QString &section, double milliseconds);
+
+      /**
+       * Forget all of the recorded times and sections.
+       */
+      void clear();
+
+      /**
+       * @return The name of the whole frame section.
+       */
+      static QString frameSection();
+
+      /**
+       * @return The sections in the order they were first timed, starting
+       * with frameSection().
+       */
+      QStringList sections() const;
+
+      /**
+       * @return The number of frames recorded, at most the number the
+       * profiler was constructed with.
+       */
+      int frames() const;
+
+      /**
+       * @return The times of a section in milliseconds, oldest first.
+       */
+      QVector<double> times(const QString &section) const;
+
+      /**
+       * @return The average time of a section in milliseconds.
+       */
+      double average(const QString &section) const;
+
+      /**
+       * @return The longest time of a section in milliseconds.
+       */
+      double maximum(const QString &section) const;
+
+      /**
+       * @return The number of recorded times of a section in each bin of
+       * a histogram. Bin i counts times from i * binWidth up to
+       * (i + 1) * binWidth, and the last bin also counts longer times.
+       * @param section The name of the section.
+       * @param bins The number of bins.
+       * @param binWidth The width of each bin in milliseconds.
+       */
+      QVector<int> histogram(const QString &section, int bins,
+                             double binWidth) const;
+
+      /**
+       * @return The recorded times as comma separated values, with one row
+       * per frame and one column per section.
+       */
+      QString toCsv() const;
+
+      /**
+       * Write toCsv() to a file.
+       * @param fileName The file to write.
+       * @param error If not 0, the reason the file could not be written is
+       * appended to it.
+       * @return True on success.
+       */
+      bool writeCsv(const QString &fileName, QString *error = 0) const;
+
+    private:
+      RenderProfilerPrivate * const d;
+
+      RenderProfiler(const RenderProfiler &);
+      RenderProfiler & operator=(const RenderProfiler &);
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -30,6 +30,8 @@
 
 #include <QGLWidget>
 
+#include <algorithm>
+
 using namespace Eigen;
 
 namespace Avogadro {
@@ -37,12 +39,15 @@ namespace Avogadro {
   class SpherePrivate
   {
     public:
-      SpherePrivate() : vertexBuffer(0), indexBuffer(0), displayList(0), isValid(false) {}
+      SpherePrivate() : vertexBuffer(0), indexBuffer(0), vertexCount(0),
+                        indexCount(0), displayList(0), isValid(false) {}
 
       /** Pointer to the buffer storing the vertex array */
       Eigen::Vector3f *vertexBuffer;
       /** Pointer to the buffer storing the indices */
       unsigned short *indexBuffer;
+      /** The number of vertices and indices in the buffers */
+      int vertexCount, indexCount;
       /** The id of the OpenGL display list */
       GLuint displayList;
       /** the detail-level of the sphere. Must be at least 0.
@@ -82,6 +87,8 @@ namespace Avogadro {
       delete [] d->vertexBuffer;
       d->vertexBuffer = 0;
     }
+    d->vertexCount = 0;
+    d->indexCount = 0;
   }
 
   void Sphere::draw(const Eigen::Vector3d &center, double radius) const
@@ -203,10 +210,50 @@ namespace Avogadro {
     glEndList();
     glDisableClientState( GL_VERTEX_ARRAY );
     glDisableClientState( GL_NORMAL_ARRAY );
-    freeBuffers();
+    // keep the buffers for triangles()
+    d->vertexCount = vertexCount;
+    d->indexCount = indexCount;
     d->isValid = true;
   }
 
+  void Sphere::triangles( std::vector<Vector3f> &vertices,
+      std::vector<unsigned int> &indices ) const
+  {
+    vertices.clear();
+    indices.clear();
+    if( d->detail == 0 )
+    {
+      // the octahedron
+      const float octahedron[6][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 },
+        { 0, -1, 0 }, { 0, 0, -1 }, { -1, 0, 0 } };
+      const unsigned int faces[8][3] = { { 0, 1, 2 }, { 0, 2, 3 },
+        { 0, 3, 4 }, { 0, 4, 1 }, { 5, 4, 3 }, { 5, 3, 2 }, { 5, 2, 1 },
+        { 5, 1, 4 } };
+      for( int i = 0; i < 6; i++ )
+        vertices.push_back( Vector3f( octahedron[i][0], octahedron[i][1],
+              octahedron[i][2] ) );
+      for( int i = 0; i < 8; i++ )
+        for( int j = 0; j < 3; j++ )
+          indices.push_back( faces[i][j] );
+      return;
+    }
+
+    vertices.assign( d->vertexBuffer, d->vertexBuffer + d->vertexCount );
+    // unroll the triangle strip, flipping every other triangle to keep the
+    // winding and skipping the degenerate triangles joining the strips
+    for( int i = 2; i < d->indexCount; i++ )
+    {
+      unsigned int a = d->indexBuffer[i - 2];
+      unsigned int b = d->indexBuffer[i - 1];
+      unsigned int c = d->indexBuffer[i];
+      if( a == b || b == c || a == c ) continue;
+      if( i % 2 ) std::swap( a, b );
+      indices.push_back( a );
+      indices.push_back( b );
+      indices.push_back( c );
+    }
+  }
+
   unsigned short Sphere::indexOfVertex( int strip, int column, int row)
   {
     return ( row + ( 3 * d->detail + 1 ) * ( column + d->detail * strip ) );
@@ -31,6 +31,8 @@
 
 #include <Eigen/Core>
 
+#include <vector>
+
 namespace Avogadro {
 
   /**
@@ -81,6 +83,13 @@ namespace Avogadro {
       /** draws the sphere at specified position and with
        * specified radius */
       void draw( const Eigen::Vector3d &center, double radius ) const;
+
+      /** gets the unit sphere as a list of triangles, used to draw
+       * many spheres at once. The vertices are also the normals.
+       @param vertices the vertices of the sphere
+       @param indices three indices into vertices for each triangle */
+      void triangles( std::vector<Eigen::Vector3f> &vertices,
+          std::vector<unsigned int> &indices ) const;
   };
 
 }
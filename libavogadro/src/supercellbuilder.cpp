@@ -0,0 +1,251 @@
+/**********************************************************************
+  SuperCellBuilder - replicates a unit cell and its bonds into a supercell
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "supercellbuilder.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include <Eigen/LU>
+
+#include <QHash>
+#include <QList>
+
+#include <cmath>
+
+using Eigen::Vector3d;
+using Eigen::Vector3i;
+
+namespace Avogadro {
+
+  SuperCellBuilder::SuperCellBuilder(Molecule *molecule,
+                                     const Eigen::Matrix3d &cellVectors)
+    : m_molecule(molecule), m_cell(cellVectors)
+  {
+    foreach (Bond *bond, m_molecule->bonds()) {
+      const Atom *begin = bond->beginAtom();
+      const Atom *end = bond->endAtom();
+      if (!begin || !end)
+        continue;
+      CellBond cellBond;
+      cellBond.begin = begin->index();
+      cellBond.end = end->index();
+      cellBond.image = Vector3i::Zero();
+      cellBond.order = bond->order();
+      m_bonds.push_back(cellBond);
+    }
+  }
+
+  SuperCellBuilder::~SuperCellBuilder()
+  {
+  }
+
+  void SuperCellBuilder::perceiveBonds(double cutoff)
+  {
+    // Remove the last bond first, so the others are not reindexed
+    QList<Bond *> bonds = m_molecule->bonds();
+    for (int i = bonds.size() - 1; i >= 0; --i)
+      m_molecule->removeBond(bonds[i]);
+    m_bonds.clear();
+
+    const QList<Atom *> atoms = m_molecule->atoms();
+    const int n = atoms.size();
+    if (n == 0 || cutoff <= 0.0)
+      return;
+
+    const std::vector<Vector3d> &positions = m_molecule->atomPositions();
+    const std::vector<double> &radii = m_molecule->covalentRadii();
+    const std::vector<int> &elements = m_molecule->atomicNumbers();
+    std::vector<unsigned long> ids(n);
+    for (int i = 0; i < n; ++i)
+      ids[i] = atoms[i]->id();
+
+    // Grid of cubes as wide as the cutoff over the atoms of the cell
+    Vector3d min = positions[ids[0]], max = min;
+    for (int i = 1; i < n; ++i)
+      for (int axis = 0; axis < 3; ++axis) {
+        const double x = positions[ids[i]][axis];
+        if (x < min[axis]) min[axis] = x;
+        if (x > max[axis]) max[axis] = x;
+      }
+    int dim[3];
+    for (int axis = 0; axis < 3; ++axis)
+      dim[axis] = static_cast<int>((max[axis] - min[axis]) / cutoff) + 1;
+    QHash<int, QList<int> > grid;
+    for (int i = 0; i < n; ++i) {
+      const Vector3d cube = (positions[ids[i]] - min) / cutoff;
+      grid[(static_cast<int>(cube.x()) * dim[1] + static_cast<int>(cube.y()))
+           * dim[2] + static_cast<int>(cube.z())].append(i);
+    }
+
+    // The images an atom can bond to. Along each axis a bond spans at most
+    // the cutoff times the length of the reciprocal vector in fractional
+    // units, plus the spread of the atoms in the cell.
+    const Eigen::Matrix3d inverse = m_cell.inverse();
+    Vector3d fmin = inverse * positions[ids[0]], fmax = fmin;
+    for (int i = 1; i < n; ++i) {
+      const Vector3d f = inverse * positions[ids[i]];
+      for (int axis = 0; axis < 3; ++axis) {
+        if (f[axis] < fmin[axis]) fmin[axis] = f[axis];
+        if (f[axis] > fmax[axis]) fmax[axis] = f[axis];
+      }
+    }
+    int range[3];
+    for (int axis = 0; axis < 3; ++axis)
+      range[axis] = static_cast<int>(std::floor(fmax[axis] - fmin[axis]
+                                     + cutoff * inverse.row(axis).norm()));
+
+    const double cutoffSquared = cutoff * cutoff;
+    Vector3i image;
+    for (image.x() = -range[0]; image.x() <= range[0]; ++image.x())
+      for (image.y() = -range[1]; image.y() <= range[1]; ++image.y())
+        for (image.z() = -range[2]; image.z() <= range[2]; ++image.z()) {
+          const Vector3d shift = m_cell * image.cast<double>();
+          // Images after the origin, to find the bonds of an atom to its own
+          // images once
+          const bool after = image.x() > 0
+            || (image.x() == 0 && (image.y() > 0
+                                   || (image.y() == 0 && image.z() > 0)));
+
+          for (int i = 0; i < n; ++i) {
+            // Atoms j in the image are near point - shift in the cell
+            const Vector3d point = positions[ids[i]] - shift;
+            const Vector3d cube = (point - min) / cutoff;
+            int c[3];
+            bool outside = false;
+            for (int axis = 0; axis < 3; ++axis) {
+              c[axis] = static_cast<int>(std::floor(cube[axis]));
+              outside = outside || c[axis] < -1 || c[axis] > dim[axis];
+            }
+            if (outside)
+              continue;
+
+            for (int ci = c[0] - 1; ci <= c[0] + 1; ++ci) {
+              if (ci < 0 || ci >= dim[0])
+                continue;
+              for (int cj = c[1] - 1; cj <= c[1] + 1; ++cj) {
+                if (cj < 0 || cj >= dim[1])
+                  continue;
+                for (int ck = c[2] - 1; ck <= c[2] + 1; ++ck) {
+                  if (ck < 0 || ck >= dim[2])
+                    continue;
+                  QHash<int, QList<int> >::const_iterator it =
+                    grid.constFind((ci * dim[1] + cj) * dim[2] + ck);
+                  if (it == grid.constEnd())
+                    continue;
+                  foreach (int j, it.value()) {
+                    // Each bond once, from the atom with the lower index
+                    if (j < i || (j == i && !after))
+                      continue;
+                    const unsigned long a = ids[i], b = ids[j];
+                    if (elements[a] == 1 && elements[b] == 1)
+                      continue;
+                    const double d2 = (positions[b] - point).squaredNorm();
+                    const double bondCutoff = radii[a] + radii[b] + 0.45;
+                    // Closer than 0.63 A is not bonded, e.g. disorder
+                    if (d2 > cutoffSquared || d2 > bondCutoff * bondCutoff
+                        || d2 < 0.40)
+                      continue;
+
+                    CellBond cellBond;
+                    cellBond.begin = i;
+                    cellBond.end = j;
+                    cellBond.image = image;
+                    cellBond.order = 1;
+                    m_bonds.push_back(cellBond);
+                  }
+                }
+              }
+            }
+          }
+        }
+
+    // Add the bonds within the cell in one bulk insertion
+    int cellBonds = 0;
+    for (std::vector<CellBond>::const_iterator it = m_bonds.begin();
+         it != m_bonds.end(); ++it)
+      if (it->image == Vector3i::Zero())
+        ++cellBonds;
+    m_molecule->beginBulkInsert(0, cellBonds);
+    for (std::vector<CellBond>::const_iterator it = m_bonds.begin();
+         it != m_bonds.end(); ++it)
+      if (it->image == Vector3i::Zero())
+        m_molecule->addBond(ids[it->begin], ids[it->end], it->order);
+    m_molecule->endBulkInsert();
+  }
+
+  void SuperCellBuilder::build(int a, int b, int c)
+  {
+    const QList<Atom *> atoms = m_molecule->atoms();
+    const int n = atoms.size();
+    const int images = a * b * c;
+    if (a < 1 || b < 1 || c < 1 || images == 1 || n == 0)
+      return;
+
+    // The unique id of each atom in each image
+    std::vector<unsigned long> ids(n * images);
+    for (int i = 0; i < n; ++i)
+      ids[i] = atoms[i]->id();
+
+    m_molecule->beginBulkInsert(n * (images - 1), numBonds() * images);
+
+    for (int i = 0; i < a; ++i)
+      for (int j = 0; j < b; ++j)
+        for (int k = 0; k < c; ++k) {
+          const int image = (i * b + j) * c + k;
+          // Do not copy the unit cell onto itself
+          if (image == 0)
+            continue;
+          const Vector3d displacement = m_cell * Vector3d(i, j, k);
+          for (int l = 0; l < n; ++l) {
+            Atom *newAtom = m_molecule->addAtom();
+            *newAtom = *atoms[l];
+            newAtom->setPos(*atoms[l]->pos() + displacement);
+            ids[image * n + l] = newAtom->id();
+          }
+        }
+
+    for (int i = 0; i < a; ++i)
+      for (int j = 0; j < b; ++j)
+        for (int k = 0; k < c; ++k) {
+          const int image = (i * b + j) * c + k;
+          for (std::vector<CellBond>::const_iterator it = m_bonds.begin();
+               it != m_bonds.end(); ++it) {
+            // Bonds within the unit cell are already there
+            if (image == 0 && it->image == Vector3i::Zero())
+              continue;
+            const int ei = i + it->image.x();
+            const int ej = j + it->image.y();
+            const int ek = k + it->image.z();
+            if (ei < 0 || ei >= a || ej < 0 || ej >= b || ek < 0 || ek >= c)
+              continue;
+            const int endImage = (ei * b + ej) * c + ek;
+            m_molecule->addBond(ids[image * n + it->begin],
+                                ids[endImage * n + it->end], it->order);
+          }
+        }
+
+    m_molecule->endBulkInsert();
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,104 @@
+/**********************************************************************
+  SuperCellBuilder - replicates a unit cell and its bonds into a supercell
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef SUPERCELLBUILDER_H
+#define SUPERCELLBUILDER_H
+
+#include <avogadro/global.h>
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace Avogadro {
+
+  class Molecule;
+
+  /**
+   * @class SuperCellBuilder supercellbuilder.h <avogadro/supercellbuilder.h>
+   * @brief Replicates a unit cell and its bonds into a supercell.
+   *
+   * The builder keeps the bond graph of the unit cell, where each bond joins
+   * an atom to an atom in the same cell or in one of its periodic images.
+   * Building a supercell copies the atoms into each image in one bulk
+   * insertion and the bonds between the copies from the graph, so the bonds
+   * of a large supercell do not have to be perceived again.
+   *
+   * The atoms of the Molecule must not change between constructing the
+   * builder and calling build().
+   */
+  class A_EXPORT SuperCellBuilder
+  {
+    public:
+      /**
+       * Constructor. The bonds of the Molecule are kept as the bond graph
+       * of the unit cell, joining atoms in the same cell.
+       * @param molecule The Molecule holding the unit cell.
+       * @param cellVectors The cell vectors in Angstrom, one per column.
+       */
+      SuperCellBuilder(Molecule *molecule, const Eigen::Matrix3d &cellVectors);
+      ~SuperCellBuilder();
+
+      /**
+       * Replace the bonds of the unit cell with single bonds between atoms
+       * closer than the sum of their covalent radii plus 0.45 Angstrom,
+       * including bonds to atoms in the periodic images. Hydrogens are not
+       * bonded to each other, and atoms closer than about 0.63 Angstrom are
+       * not bonded (e.g. disorder). The bonds within the cell are added to
+       * the Molecule in one bulk insertion.
+       * @param cutoff The longest bond in Angstrom.
+       */
+      void perceiveBonds(double cutoff = 2.5);
+
+      /**
+       * @return The number of bonds in the graph, including those to the
+       * periodic images.
+       */
+      int numBonds() const { return static_cast<int>(m_bonds.size()); }
+
+      /**
+       * Copy the unit cell into each cell of an @p a by @p b by @p c
+       * supercell, the unit cell is the cell at the origin. Bonds that would
+       * leave the supercell are not added. The cell of the Molecule is not
+       * changed.
+       */
+      void build(int a, int b, int c);
+
+    private:
+      struct CellBond
+      {
+        int begin, end;         // Indices of the atoms in the unit cell
+        Eigen::Vector3i image;  // Cell of the end atom relative to the begin
+        short order;
+      };
+
+      Molecule *m_molecule;
+      Eigen::Matrix3d m_cell;
+      std::vector<CellBond> m_bonds;
+
+      SuperCellBuilder(const SuperCellBuilder &);
+      SuperCellBuilder & operator=(const SuperCellBuilder &);
+  };
+
+} // End namespace Avogadro
+
+#endif
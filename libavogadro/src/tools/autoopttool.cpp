@@ -399,6 +399,16 @@ namespace Avogadro {
       m_leftButtonPressed = false;
       m_midButtonPressed = false;
       m_rightButtonPressed = false;
+
+      // The command pushed by enable() is on top unless something was done
+      // while the optimization was running
+      QUndoStack *stack = m_glwidget->undoStack();
+      if (stack && stack->index() > 0) {
+        AutoOptCommand *cmd = dynamic_cast<AutoOptCommand *>
+          (const_cast<QUndoCommand *>(stack->command(stack->index() - 1)));
+        if (cmd)
+          cmd->finish();
+      }
     }
   }
 
@@ -444,22 +454,20 @@ namespace Avogadro {
           }
         }
       }
-      // coordinates
-      double *coordPtr = mol.GetCoordinates();
-      foreach(Atom* atom, atoms) {
-        atom->setPos(Eigen::Vector3d(coordPtr));
-        coordPtr += 3;
-      }
+      // coordinates, this signals the update of the molecule
+      m_glwidget->molecule()->setAtomPositions(mol.GetCoordinates());
 
       if(m_clickedAtom && m_leftButtonPressed) {
         Vector3d begin = m_glwidget->camera()->project(*m_clickedAtom->pos());
         QPoint point = QPoint(begin.x(), begin.y());
         translate(m_glwidget, *m_clickedAtom->pos(), point,
                   m_lastDraggingPosition);
+        m_glwidget->molecule()->update();
       }
     }
+    else
+      m_glwidget->molecule()->update();
 
-    m_glwidget->molecule()->update();
     m_glwidget->update();
     m_block = false;
   }
@@ -518,15 +526,16 @@ namespace Avogadro {
     m_forceField->SetLogFile(NULL);
     m_forceField->SetLogLevel(OBFF_LOGLVL_NONE);
 
-    OBMol mol = m_molecule->OBMol();
-
     // Ignore all atoms with atomic # less than 1
     foreach(const Atom *atom, m_molecule->atoms()) {
       if (atom->atomicNumber() < 1)
         m_forceField->GetConstraints().AddIgnore(atom->index() + 1);
     }
 
-    if (!m_forceField->Setup(mol)) {
+    // The force field copies the molecule, so it is set up from the cache
+    OBMol *mol = m_molecule->lockOBMol();
+    if (!m_forceField->Setup(*mol)) {
+      m_molecule->unlockOBMol();
       m_stop = true;
       emit setupFailed();
       emit finished(false);
@@ -536,7 +545,8 @@ namespace Avogadro {
     else
       emit setupSucces();
 
-    m_forceField->SetConformers(mol);
+    m_forceField->SetConformers(*mol);
+    m_molecule->unlockOBMol();
 
     switch(m_algorithm) {
       case 0:
@@ -568,33 +578,42 @@ namespace Avogadro {
 
   AutoOptCommand::AutoOptCommand(Molecule *molecule, AutoOptTool *tool,
                                  QUndoCommand *parent)
-    : QUndoCommand(parent), m_molecule(0)
+    : MoleculeDeltaCommand(molecule, parent), m_tool(tool)
   {
-    // Store the original molecule before any modifications are made
+    // Record the original molecule before any modifications are made
     setText(QObject::tr("AutoOpt Molecule"));
-    m_moleculeCopy = *molecule;
-    m_molecule = molecule;
-    m_tool = tool;
+    delta().begin(molecule);
   }
 
   void AutoOptCommand::redo()
   {
-    m_moleculeCopy = *m_molecule;
+    // The optimization is still running when the command is pushed
+    if (!delta().isOpen())
+      MoleculeDeltaCommand::redo();
   }
 
   void AutoOptCommand::undo()
   {
     if(m_tool)
       m_tool->disable();
-    *m_molecule = m_moleculeCopy;
+    MoleculeDeltaCommand::undo();
   }
 
-  bool AutoOptCommand::mergeWith (const QUndoCommand *)
+  bool AutoOptCommand::mergeWith (const QUndoCommand *command)
   {
-    // Just return true to repeated calls - we have stored the original molecule
+    // Repeated optimizations are undone together
+    const AutoOptCommand *other = dynamic_cast<const AutoOptCommand *>(command);
+    if (!other)
+      return false;
+    delta().merge(other->delta());
     return true;
   }
 
+  void AutoOptCommand::finish()
+  {
+    delta().end(molecule());
+  }
+
   int AutoOptCommand::id() const
   {
     return 1311387;
@@ -28,6 +28,7 @@
 #include <avogadro/glwidget.h>
 #include <avogadro/tool.h>
 #include <avogadro/molecule.h>
+#include <avogadro/moleculedelta.h>
 
 #include <openbabel/mol.h>
 #include <openbabel/forcefield.h>
@@ -171,7 +172,7 @@ namespace Avogadro {
       void settingsWidgetDestroyed();
   };
 
-  class AutoOptCommand : public QUndoCommand
+  class AutoOptCommand : public MoleculeDeltaCommand
   {
     public:
       AutoOptCommand(Molecule *molecule, AutoOptTool *tool, QUndoCommand *parent = 0);
@@ -181,11 +182,13 @@ namespace Avogadro {
       bool mergeWith ( const QUndoCommand * command );
       int id() const;
 
+      /**
+       * Keep only the atoms moved by the optimization, called when it stops.
+       */
+      void finish();
+
     private:
-      Molecule m_moleculeCopy;
-      Molecule *m_molecule;
       AutoOptTool *m_tool;
-      bool undone;
   };
 
   class AutoOptToolFactory : public QObject, public PluginFactory
@@ -1652,14 +1652,12 @@ namespace Avogadro {
 
   BondCentricMoveCommand::BondCentricMoveCommand(Molecule *molecule,
       QUndoCommand *parent)
-    : QUndoCommand(parent), m_molecule(0)
+    : MoleculeDeltaCommand(molecule, parent)
   {
-    // Store the molecule - this call won't actually move an atom
+    // Record the molecule - this call won't actually move an atom
     setText(QObject::tr("Bond Centric Manipulation"));
-    m_moleculeCopy = *molecule;
-    m_molecule = molecule;
+    delta().begin(molecule);
     m_atomIndex = 0;
-    undone = false;
   }
 
   // ##########  Constructor  ##########
@@ -1667,33 +1665,31 @@ namespace Avogadro {
   BondCentricMoveCommand::BondCentricMoveCommand(Molecule *molecule,
       Atom *atom, Vector3d pos,
       QUndoCommand *parent)
-    : QUndoCommand(parent), m_molecule(0)
+    : MoleculeDeltaCommand(molecule, parent)
   {
-    // Store the original molecule before any modifications are made
+    // Record the original molecule before any modifications are made
     setText(QObject::tr("Bond Centric Manipulation"));
-    m_moleculeCopy = *molecule;
-    m_molecule = molecule;
+    delta().begin(molecule);
     m_atomIndex = atom->index();
     m_pos = pos;
-    undone = false;
   }
 
   // ##########  redo  ##########
 
   void BondCentricMoveCommand::redo()
   {
-    // Move the specified atom to the location given
-    if (undone) {
-      Molecule newMolecule = *m_molecule;
-      *m_molecule = m_moleculeCopy;
-      m_moleculeCopy = newMolecule;
-    }
-    else if (m_atomIndex) {
-      Atom *atom = m_molecule->atom(m_atomIndex);
-      atom->setPos(m_pos);
-      atom->update();
-    }
-    QUndoCommand::redo();
+    if (delta().isOpen()) {
+      // Move the specified atom to the location given
+      if (m_atomIndex) {
+        Atom *atom = molecule()->atom(m_atomIndex);
+        atom->setPos(m_pos);
+        atom->update();
+      }
+      // Keep only the atoms moved since the command was created
+      delta().end(molecule());
+    }
+    else
+      MoleculeDeltaCommand::redo();
   }
 
   // ##########  undo  ##########
@@ -1701,10 +1697,7 @@ namespace Avogadro {
   void BondCentricMoveCommand::undo()
   {
     // Restore our original molecule
-    Molecule newMolecule = *m_molecule;
-    *m_molecule = m_moleculeCopy;
-    m_moleculeCopy = newMolecule;
-    undone = true;
+    MoleculeDeltaCommand::undo();
   }
 
   // ##########  mergeWith  ##########
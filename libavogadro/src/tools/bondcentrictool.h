@@ -39,6 +39,7 @@
 #include <Eigen/Core>
 
 #include <avogadro/molecule.h>
+#include <avogadro/moleculedelta.h>
 
 #include <QGLWidget>
 #include <QImage>
@@ -356,7 +357,7 @@ namespace Avogadro {
    *  - Adjusting bond length.
    *  - Adjusting bond angles.
    */
-  class BondCentricMoveCommand : public QUndoCommand
+  class BondCentricMoveCommand : public MoleculeDeltaCommand
   {
     public:
       //!Constructor
@@ -407,11 +408,8 @@ namespace Avogadro {
       int id() const;
 
     private:
-      Molecule m_moleculeCopy;
-      Molecule *m_molecule;
       int m_atomIndex;
       Eigen::Vector3d m_pos;
-      bool undone;
   };
 
 
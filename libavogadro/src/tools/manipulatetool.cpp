@@ -57,6 +57,7 @@ namespace Avogadro {
 
   ManipulateTool::ManipulateTool(QObject *parent) : Tool(parent),
                                                     m_clickedAtom(0),
+                                                    m_undo(0),
                                                     m_leftButtonPressed(false),
                                                     m_midButtonPressed(false),
                                                     m_rightButtonPressed(false),
@@ -76,6 +77,7 @@ namespace Avogadro {
 
   ManipulateTool::~ManipulateTool()
   {
+    delete m_undo;
     delete m_eyecandy;
   }
 
@@ -100,13 +102,10 @@ namespace Avogadro {
     if (!m_settingsWidget)
       return;
 
-    // Before doing anything, save an undo state
+    // Before doing anything, record an undo state
     // Get the current GLWidget for the manipulation
     GLWidget *widget = GLWidget::current();
-    QUndoStack *stack = widget->undoStack();
     QUndoCommand* undo = new MoveAtomCommand(widget->molecule());
-    if(stack && undo)
-        stack->push(undo);
 
     // Get translations and rotations
     double x = m_settingsWidget->xTranslateSpinBox->value();
@@ -162,6 +161,13 @@ namespace Avogadro {
     }
 
     widget->molecule()->update();
+
+    // Pushing the command keeps the atoms that moved
+    QUndoStack *stack = widget->undoStack();
+    if (stack)
+      stack->push(undo);
+    else
+      delete undo;
   }
 
   void ManipulateTool::buttonClicked(QAbstractButton *button)
@@ -336,8 +342,10 @@ namespace Avogadro {
 
     widget->update();
 
-    QUndoCommand* undo = new MoveAtomCommand(widget->molecule());
-    return undo;
+    // The command is pushed when the mouse is released, with the atoms moved
+    delete m_undo;
+    m_undo = new MoveAtomCommand(widget->molecule());
+    return 0;
   }
 
   QUndoCommand* ManipulateTool::mouseReleaseEvent(GLWidget *widget, QMouseEvent *event)
@@ -352,7 +360,8 @@ namespace Avogadro {
     widget->setCursor(Qt::ArrowCursor);
 
     widget->update();
-    QUndoCommand* undo = new MoveAtomCommand(widget->molecule());
+    QUndoCommand* undo = m_undo;
+    m_undo = 0;
     return undo;
   }
 
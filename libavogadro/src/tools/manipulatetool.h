@@ -80,6 +80,7 @@ namespace Avogadro {
 
     protected:
       Atom *              m_clickedAtom;
+      QUndoCommand *      m_undo; // The command of the current drag
       bool                m_leftButtonPressed;  // rotation
       bool                m_midButtonPressed;   // scale / zoom
       bool                m_rightButtonPressed; // translation
@@ -28,51 +28,43 @@
 
 namespace Avogadro {
 
-  MoveAtomCommand::MoveAtomCommand(Molecule *molecule, QUndoCommand *parent) : QUndoCommand(parent), m_molecule(0)
+  MoveAtomCommand::MoveAtomCommand(Molecule *molecule, QUndoCommand *parent)
+    : MoleculeDeltaCommand(molecule, parent), m_type(0)
   {
-    // Store the molecule - this call won't actually move an atom
+    // Record the molecule - this call won't actually move an atom
     setText(QObject::tr("Manipulate Atom"));
-    m_moleculeCopy = *molecule;
-    m_molecule = molecule;
-    undone = false;
+    delta().begin(molecule);
   }
 
-  MoveAtomCommand::MoveAtomCommand(Molecule *molecule, int type, QUndoCommand *parent) : QUndoCommand(parent), m_molecule(0)
+  MoveAtomCommand::MoveAtomCommand(Molecule *molecule, int type, QUndoCommand *parent)
+    : MoleculeDeltaCommand(molecule, parent), m_type(type)
   {
-    // Store the original molecule before any modifications are made
+    // Record the original molecule before any modifications are made
     setText(QObject::tr("Manipulate Atom"));
-    m_moleculeCopy = *molecule;
-    m_molecule = molecule;
-    m_type = type;
-    undone = false;
+    delta().begin(molecule);
   }
 
   void MoveAtomCommand::redo()
   {
-    // Move the specified atom to the location given
-    if (undone)
-    {
-      Molecule newMolecule = *m_molecule;
-      *m_molecule = m_moleculeCopy;
-      m_moleculeCopy = newMolecule;
-      m_molecule->updateMolecule();
-    }
-    QUndoCommand::redo();
+    // The atoms have been moved when the command is pushed, keep only those
+    if (delta().isOpen())
+      delta().end(molecule());
+    else
+      MoleculeDeltaCommand::redo();
   }
 
   void MoveAtomCommand::undo()
   {
-    // Restore our original molecule
-    Molecule newMolecule = *m_molecule;
-    *m_molecule = m_moleculeCopy;
-    m_moleculeCopy = newMolecule;
-    undone = true;
-    m_molecule->updateMolecule();
+    MoleculeDeltaCommand::undo();
   }
 
-  bool MoveAtomCommand::mergeWith (const QUndoCommand *)
+  bool MoveAtomCommand::mergeWith (const QUndoCommand *command)
   {
-    // Just return true to repeated calls - we have stored the original molecule
+    // Repeated moves are undone together
+    const MoveAtomCommand *other = dynamic_cast<const MoveAtomCommand *>(command);
+    if (!other)
+      return false;
+    delta().merge(other->delta());
     return true;
   }
 
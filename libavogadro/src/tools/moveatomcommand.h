@@ -27,12 +27,15 @@
 #ifndef MOVEATOMCOMMAND_H
 #define MOVEATOMCOMMAND_H
 
-#include <QUndoCommand>
-#include <avogadro/molecule.h>
+#include <avogadro/moleculedelta.h>
 
 namespace Avogadro {
 
- class MoveAtomCommand : public QUndoCommand
+ /**
+  * Undoes the atoms moved between the construction of the command and its
+  * first redo(), which happens when it is pushed on the undo stack.
+  */
+ class MoveAtomCommand : public MoleculeDeltaCommand
   {
     public:
       explicit MoveAtomCommand(Molecule *molecule, QUndoCommand *parent = 0);
@@ -44,10 +47,7 @@ namespace Avogadro {
       int id() const;
 
     private:
-      Molecule m_moleculeCopy;
-      Molecule *m_molecule;
       int m_type;
-      bool undone;
   };
 
 
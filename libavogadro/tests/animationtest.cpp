@@ -0,0 +1,174 @@
+/**********************************************************************
+  AnimationTest - unit testing for the bonds found by the Animation class
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/animation.h>
+#include <avogadro/moleculefile.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include <openbabel/mol.h>
+#include <openbabel/obiter.h>
+
+using Avogadro::Animation;
+using Avogadro::MoleculeFile;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Bond;
+using Eigen::Vector3d;
+
+typedef QList< QPair<int, int> > BondList;
+
+class AnimationTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    Molecule *m_molecule;
+
+    /**
+     * The bonds of the molecule as sorted pairs of atom indices.
+     */
+    BondList bonds(const Molecule *molecule);
+
+    /**
+     * The bonds perceived by OBMol::ConnectTheDots() for the current
+     * positions of the molecule.
+     */
+    BondList openBabelBonds(const Molecule *molecule);
+
+  private slots:
+    /**
+     * Read ethanol and add frames stretched about its center, so that the
+     * longer bonds break in the later frames.
+     */
+    void initTestCase();
+    void cleanupTestCase();
+
+    /**
+     * The bonds found for each frame when it is shown match Open Babel.
+     */
+    void dynamicBonds();
+
+    /**
+     * The bonds found in the background when the animation starts match
+     * Open Babel.
+     */
+    void precomputeBonds();
+};
+
+BondList AnimationTest::bonds(const Molecule *molecule)
+{
+  BondList list;
+  foreach (Bond *bond, molecule->bonds()) {
+    int a = bond->beginAtom()->index();
+    int b = bond->endAtom()->index();
+    list.append(qMakePair(qMin(a, b), qMax(a, b)));
+  }
+  qSort(list);
+  return list;
+}
+
+BondList AnimationTest::openBabelBonds(const Molecule *molecule)
+{
+  OpenBabel::OBMol obmol;
+  foreach (Atom *atom, molecule->atoms()) {
+    OpenBabel::OBAtom *obatom = obmol.NewAtom();
+    obatom->SetAtomicNum(atom->atomicNumber());
+    const Vector3d *pos = atom->pos();
+    obatom->SetVector(pos->x(), pos->y(), pos->z());
+  }
+  obmol.ConnectTheDots();
+
+  BondList list;
+  FOR_BONDS_OF_MOL(bond, obmol) {
+    int a = bond->GetBeginAtomIdx() - 1;
+    int b = bond->GetEndAtomIdx() - 1;
+    list.append(qMakePair(qMin(a, b), qMax(a, b)));
+  }
+  qSort(list);
+  return list;
+}
+
+void AnimationTest::initTestCase()
+{
+  m_molecule = MoleculeFile::readMolecule(QString(TESTDATADIR) + "ethanol.cml");
+  QVERIFY(m_molecule);
+  QCOMPARE(m_molecule->numBonds(), 8u);
+
+  Vector3d center = m_molecule->center();
+  const double scales[] = { 0.9, 1.1, 1.2, 1.3, 1.5 };
+  for (int s = 0; s < 5; ++s) {
+    std::vector<Vector3d> conformer(m_molecule->atomPositions());
+    foreach (Atom *atom, m_molecule->atoms())
+      conformer[atom->id()] = center + scales[s] * (*atom->pos() - center);
+    QVERIFY(m_molecule->addConformer(conformer, m_molecule->numConformers()));
+  }
+}
+
+void AnimationTest::cleanupTestCase()
+{
+  delete m_molecule;
+}
+
+void AnimationTest::dynamicBonds()
+{
+  Animation animation;
+  animation.setMolecule(m_molecule);
+  animation.setDynamicBonds(true);
+  QCOMPARE(animation.numFrames(), 6);
+
+  for (int i = 1; i <= animation.numFrames(); ++i) {
+    animation.setFrame(i);
+    QCOMPARE(bonds(m_molecule), openBabelBonds(m_molecule));
+  }
+  // the stretched frames lose their longer bonds
+  QVERIFY(m_molecule->numBonds() < 8);
+
+  animation.setFrame(1);
+  QCOMPARE(m_molecule->numBonds(), 8u);
+}
+
+void AnimationTest::precomputeBonds()
+{
+  Animation animation;
+  animation.setMolecule(m_molecule);
+  animation.setDynamicBonds(true);
+  animation.setPrecomputeBonds(true);
+  animation.start();
+  animation.pause();
+  // give the background thread time to find the bonds for the frames
+  QTest::qWait(200);
+
+  for (int i = 1; i <= animation.numFrames(); ++i) {
+    animation.setFrame(i);
+    QCOMPARE(bonds(m_molecule), openBabelBonds(m_molecule));
+  }
+  animation.stop();
+}
+
+QTEST_MAIN(AnimationTest)
+
+#include "moc_animationtest.cxx"
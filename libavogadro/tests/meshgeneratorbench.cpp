@@ -0,0 +1,152 @@
+/**********************************************************************
+  MeshGeneratorBench - benchmarking for the MeshGenerator class
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+
+#include <avogadro/cube.h>
+#include <avogadro/mesh.h>
+#include <avogadro/meshgenerator.h>
+
+#include <Eigen/Core>
+
+#include <cmath>
+
+using Avogadro::Cube;
+using Avogadro::Mesh;
+using Avogadro::MeshGenerator;
+
+using Eigen::Vector3d;
+using Eigen::Vector3f;
+using Eigen::Vector3i;
+
+class MeshGeneratorBench : public QObject
+{
+  Q_OBJECT
+
+private:
+  /**
+   * Fill a cube of the given size with the sum of a few Gaussians, giving
+   * closed and merging lobes similar to an orbital.
+   */
+  Cube * syntheticCube(int size);
+
+private slots:
+  /**
+   * Check the parallel and serial paths produce the same mesh.
+   */
+  void identicalMeshes();
+
+  /**
+   * Timing of the serial and parallel paths for cubes of 64^3 to 512^3.
+   */
+  void generate_data();
+  void generate();
+};
+
+Cube * MeshGeneratorBench::syntheticCube(int size)
+{
+  Cube *cube = new Cube;
+  cube->setSinglePrecision(true);
+  double spacing = 10.0 / (size - 1);
+  cube->setLimits(Vector3d(-5.0, -5.0, -5.0), Vector3i(size, size, size),
+                  spacing);
+
+  const Vector3d centers[3] = { Vector3d(-1.5, 0.0, 0.0),
+                                Vector3d(1.5, 0.0, 0.0),
+                                Vector3d(0.0, 2.0, 0.5) };
+  const double signs[3] = { 1.0, -1.0, 1.0 };
+  std::vector<double> row(size);
+  for (int i = 0; i < size; ++i) {
+    for (int j = 0; j < size; ++j) {
+      for (int k = 0; k < size; ++k) {
+        Vector3d pos(-5.0 + i * spacing, -5.0 + j * spacing,
+                     -5.0 + k * spacing);
+        double value = 0.0;
+        for (int c = 0; c < 3; ++c)
+          value += signs[c] * exp(-(pos - centers[c]).squaredNorm());
+        row[k] = value;
+      }
+      cube->setValues((i * size + j) * size, size, &row[0]);
+    }
+  }
+  cube->updateMinMax();
+  return cube;
+}
+
+void MeshGeneratorBench::identicalMeshes()
+{
+  Cube *cube = syntheticCube(64);
+  Mesh serial, parallel;
+
+  MeshGenerator generator;
+  generator.initialize(cube, &serial, 0.1f);
+  generator.setParallel(false);
+  generator.run();
+  generator.initialize(cube, &parallel, 0.1f);
+  generator.setParallel(true);
+  generator.run();
+
+  QVERIFY(serial.numVertices() > 0);
+  QCOMPARE(parallel.numVertices(), serial.numVertices());
+  QVERIFY(parallel.indices() == serial.indices());
+  QVERIFY(parallel.vertices() == serial.vertices());
+  QVERIFY(parallel.normals() == serial.normals());
+
+  delete cube;
+}
+
+void MeshGeneratorBench::generate_data()
+{
+  QTest::addColumn<int>("size");
+  QTest::addColumn<bool>("parallel");
+
+  for (int size = 64; size <= 512; size *= 2) {
+    QTest::newRow(qPrintable(QString("%1^3 serial").arg(size))) << size << false;
+    QTest::newRow(qPrintable(QString("%1^3 parallel").arg(size))) << size << true;
+  }
+}
+
+void MeshGeneratorBench::generate()
+{
+  QFETCH(int, size);
+  QFETCH(bool, parallel);
+
+  Cube *cube = syntheticCube(size);
+  Mesh mesh;
+  MeshGenerator generator;
+  generator.initialize(cube, &mesh, 0.1f);
+  generator.setParallel(parallel);
+
+  QBENCHMARK_ONCE {
+    generator.run();
+  }
+
+  qDebug() << "Vertices:" << mesh.numVertices()
+           << "triangles:" << mesh.numIndices() / 3;
+  delete cube;
+}
+
+QTEST_MAIN(MeshGeneratorBench)
+
+#include "moc_meshgeneratorbench.cxx"
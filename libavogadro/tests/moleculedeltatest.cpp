@@ -0,0 +1,211 @@
+/**********************************************************************
+  MoleculeDeltaTest - unit testing for the MoleculeDelta class
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <QUndoStack>
+#include <avogadro/moleculedelta.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+using Avogadro::MoleculeDelta;
+using Avogadro::MoleculeDeltaCommand;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Bond;
+using Eigen::Vector3d;
+
+class MoleculeDeltaTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * A chain of carbon atoms along the x axis.
+     */
+    void prepareMolecule(Molecule &molecule, int atoms);
+
+  private slots:
+    /**
+     * Only the moved atoms are kept, and undo and redo move them back.
+     */
+    void moveAtoms();
+
+    /**
+     * Removed atoms and bonds come back with the same ids.
+     */
+    void removeAtoms();
+
+    /**
+     * Merged deltas undo both edits.
+     */
+    void merge();
+
+    /**
+     * The history is dropped once the stack uses too much memory.
+     */
+    void limitMemory();
+};
+
+void MoleculeDeltaTest::prepareMolecule(Molecule &molecule, int atoms)
+{
+  for (int i = 0; i < atoms; ++i) {
+    molecule.addAtom(6, Vector3d(1.5 * i, 0.0, 0.0));
+    if (i)
+      molecule.addBond(i - 1, i);
+  }
+}
+
+void MoleculeDeltaTest::moveAtoms()
+{
+  Molecule molecule;
+  prepareMolecule(molecule, 100);
+
+  MoleculeDelta delta;
+  delta.begin(&molecule);
+  QVERIFY(delta.isOpen());
+  molecule.atomById(10)->setPos(Vector3d(0.0, 5.0, 0.0));
+  molecule.atomById(20)->setPos(Vector3d(0.0, 6.0, 0.0));
+  delta.end(&molecule);
+  QVERIFY(!delta.isOpen());
+  QCOMPARE(delta.numAtoms(), 2);
+  QCOMPARE(delta.numBonds(), 0);
+
+  delta.undo(&molecule);
+  QVERIFY(*molecule.atomById(10)->pos() == Vector3d(15.0, 0.0, 0.0));
+  QVERIFY(*molecule.atomById(20)->pos() == Vector3d(30.0, 0.0, 0.0));
+  delta.redo(&molecule);
+  QVERIFY(*molecule.atomById(10)->pos() == Vector3d(0.0, 5.0, 0.0));
+  QVERIFY(*molecule.atomById(20)->pos() == Vector3d(0.0, 6.0, 0.0));
+}
+
+void MoleculeDeltaTest::removeAtoms()
+{
+  Molecule molecule;
+  prepareMolecule(molecule, 5);
+
+  MoleculeDelta delta;
+  delta.begin(&molecule);
+  molecule.removeAtom(2);
+  Atom *atom = molecule.addAtom(8, Vector3d(0.0, 1.0, 0.0));
+  unsigned long newId = atom->id();
+  molecule.addBond(newId, 0);
+  delta.end(&molecule);
+  // Two atoms and three bonds changed
+  QCOMPARE(delta.numAtoms(), 2);
+  QCOMPARE(delta.numBonds(), 3);
+
+  delta.undo(&molecule);
+  QCOMPARE(molecule.numAtoms(), 5u);
+  QCOMPARE(molecule.numBonds(), 4u);
+  QVERIFY(!molecule.atomById(newId));
+  QCOMPARE(molecule.atomById(2)->atomicNumber(), 6);
+  QVERIFY(molecule.bond(1, 2));
+  QVERIFY(molecule.bond(2, 3));
+
+  delta.redo(&molecule);
+  QCOMPARE(molecule.numAtoms(), 5u);
+  QVERIFY(!molecule.atomById(2));
+  QCOMPARE(molecule.atomById(newId)->atomicNumber(), 8);
+  QVERIFY(molecule.bond(newId, 0));
+}
+
+void MoleculeDeltaTest::merge()
+{
+  Molecule molecule;
+  prepareMolecule(molecule, 10);
+
+  MoleculeDelta first, second;
+  first.begin(&molecule);
+  molecule.atomById(1)->setPos(Vector3d(0.0, 1.0, 0.0));
+  first.end(&molecule);
+  second.begin(&molecule);
+  molecule.atomById(1)->setPos(Vector3d(0.0, 2.0, 0.0));
+  molecule.atomById(2)->setPos(Vector3d(0.0, 3.0, 0.0));
+  second.end(&molecule);
+
+  first.merge(second);
+  QCOMPARE(first.numAtoms(), 2);
+  first.undo(&molecule);
+  QVERIFY(*molecule.atomById(1)->pos() == Vector3d(1.5, 0.0, 0.0));
+  QVERIFY(*molecule.atomById(2)->pos() == Vector3d(3.0, 0.0, 0.0));
+  first.redo(&molecule);
+  QVERIFY(*molecule.atomById(1)->pos() == Vector3d(0.0, 2.0, 0.0));
+  QVERIFY(*molecule.atomById(2)->pos() == Vector3d(0.0, 3.0, 0.0));
+}
+
+void MoleculeDeltaTest::limitMemory()
+{
+  Molecule molecule;
+  prepareMolecule(molecule, 1000);
+
+  QUndoStack stack;
+  for (int i = 0; i < 8; ++i) {
+    MoleculeDeltaCommand *command = new MoleculeDeltaCommand(&molecule);
+    command->delta().begin(&molecule);
+    foreach (Atom *atom, molecule.atoms())
+      atom->setPos(*atom->pos() + Vector3d(0.0, 0.0, 1.0));
+    command->delta().end(&molecule);
+    stack.push(command);
+
+    if (i == 4) {
+      stack.setClean();
+      qint64 bytes = MoleculeDeltaCommand::memoryUsage(&stack);
+      QVERIFY(bytes > 5 * 1000 * 2 * static_cast<qint64>(sizeof(Vector3d)));
+      QCOMPARE(MoleculeDeltaCommand::limitMemory(&stack, bytes), 0);
+
+      // An open delta is not counted, and nothing is dropped while it is
+      MoleculeDeltaCommand *running = new MoleculeDeltaCommand(&molecule);
+      running->delta().begin(&molecule);
+      stack.push(running);
+      QVERIFY(MoleculeDeltaCommand::isRunning(&stack));
+      QCOMPARE(MoleculeDeltaCommand::memoryUsage(&stack), bytes);
+      QCOMPARE(MoleculeDeltaCommand::limitMemory(&stack, bytes / 5), 0);
+      stack.undo();
+      QVERIFY(!MoleculeDeltaCommand::isRunning(&stack));
+      QCOMPARE(stack.count(), 6);
+
+      // The two most recent steps fit in half of the limit, the undone
+      // step is dropped too
+      QCOMPARE(MoleculeDeltaCommand::limitMemory(&stack, bytes * 4 / 5), 4);
+      QCOMPARE(stack.count(), 2);
+      QCOMPARE(stack.index(), 2);
+      QVERIFY(stack.isClean());
+      QCOMPARE(stack.undoLimit(), 0);
+      QCOMPARE(molecule.atomById(0)->pos()->z(), 5.0);
+    }
+  }
+
+  // The copies undo as the original steps did
+  QCOMPARE(stack.count(), 5);
+  QCOMPARE(molecule.atomById(0)->pos()->z(), 8.0);
+  for (int i = 0; i < 5; ++i)
+    stack.undo();
+  QCOMPARE(molecule.atomById(0)->pos()->z(), 3.0);
+  QVERIFY(!stack.canUndo());
+}
+
+QTEST_MAIN(MoleculeDeltaTest)
+
+#include "moc_moleculedeltatest.cxx"
@@ -75,7 +75,11 @@ class MoleculeFileTest : public QObject
     void readWriteMolecule();
     void readFile();
     void readWriteConformers();
+    void readXYZConformers();
+    void readTrajectory();
+    void indexFile();
     void replaceMolecule();
+    void replaceConformer();
     void appendMolecule();
 
 };
@@ -217,6 +221,158 @@ void MoleculeFileTest::readWriteConformers()
       static_cast<std::vector<int>::size_type>(4) );
 }
 
+void MoleculeFileTest::readXYZConformers()
+{
+  QString filename = "moleculefiletest_tmp_conformers.xyz";
+  QFile::remove(MoleculeFile::indexFileName(filename));
+  std::ofstream ofs(filename.toAscii().data());
+  QVERIFY( ofs );
+  // more frames than decoded in a single batch
+  const int numFrames = 600;
+  for (int i = 0; i < numFrames; ++i) {
+    ofs << "2" << std::endl << std::endl;
+    ofs << "H " << i << " 0.0 0.0" << std::endl;
+    ofs << "H " << i << " 0.0 0.74" << std::endl;
+  }
+  ofs.close();
+
+  MoleculeFile* moleculeFile = MoleculeFile::readFile(filename);
+  QVERIFY( moleculeFile );
+  QVERIFY( moleculeFile->errors().isEmpty() );
+  QCOMPARE( moleculeFile->isConformerFile(), true );
+  QCOMPARE( moleculeFile->conformers().size(),
+      static_cast<std::vector<int>::size_type>(numFrames) );
+  // decoded frames are committed in order
+  for (int i = 0; i < numFrames; ++i) {
+    QCOMPARE( moleculeFile->conformers().at(i)->size(),
+        static_cast<std::vector<int>::size_type>(2) );
+    QCOMPARE( moleculeFile->conformers().at(i)->at(1).x(), double(i) );
+  }
+  delete moleculeFile;
+  QFile::remove(MoleculeFile::indexFileName(filename));
+
+  // same atom counts, but different elements
+  ofs.open(filename.toAscii().data());
+  QVERIFY( ofs );
+  ofs << "2" << std::endl << std::endl;
+  ofs << "H 0.0 0.0 0.0" << std::endl << "H 0.0 0.0 0.74" << std::endl;
+  ofs << "2" << std::endl << std::endl;
+  ofs << "C 0.0 0.0 0.0" << std::endl << "O 0.0 0.0 1.13" << std::endl;
+  ofs.close();
+
+  moleculeFile = MoleculeFile::readFile(filename);
+  QVERIFY( moleculeFile );
+  QCOMPARE( moleculeFile->isConformerFile(), false );
+  QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(2) );
+  QCOMPARE( moleculeFile->conformers().size(),
+      static_cast<std::vector<int>::size_type>(0) );
+  delete moleculeFile;
+
+  QFile::remove(MoleculeFile::indexFileName(filename));
+}
+
+void MoleculeFileTest::readTrajectory()
+{
+  QString filename = "moleculefiletest_tmp.xyz";
+  std::ofstream ofs(filename.toAscii().data());
+  QVERIFY( ofs );
+  // 5 frames, frame i is translated by i along x
+  for (int i = 0; i < 5; ++i) {
+    ofs << "3" << std::endl << "frame " << i << std::endl;
+    ofs << "C " << 1. + i << " 2.0 3.0" << std::endl;
+    ofs << "N " << 4. + i << " 5.0 6.0" << std::endl;
+    ofs << "O " << 7. + i << " 8.0 9.0" << std::endl;
+  }
+  ofs.close();
+
+  MoleculeFile* moleculeFile = MoleculeFile::readTrajectory(filename);
+  QVERIFY( moleculeFile );
+  QVERIFY( moleculeFile->errors().isEmpty() );
+  QCOMPARE( moleculeFile->isStreaming(), true );
+  QCOMPARE( moleculeFile->isConformerFile(), true );
+  QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(1) );
+  QCOMPARE( moleculeFile->numConformers(), static_cast<unsigned int>(5) );
+  // conformers are not stored
+  QCOMPARE( moleculeFile->conformers().size(),
+      static_cast<std::vector<int>::size_type>(0) );
+  QCOMPARE( moleculeFile->titles().at(3), QString("frame 3") );
+
+  // random access, with a cache smaller than the number of frames
+  moleculeFile->setConformerCacheSize(2);
+  std::vector<Eigen::Vector3d> coords;
+  int frames[] = { 3, 0, 4, 3, 1, 2 };
+  for (int i = 0; i < 6; ++i) {
+    QVERIFY( moleculeFile->conformer(frames[i], coords) );
+    QCOMPARE( coords.size(), static_cast<std::vector<int>::size_type>(3) );
+    QCOMPARE( coords[0].x(), 1. + frames[i] );
+    QCOMPARE( coords[2].x(), 7. + frames[i] );
+    QCOMPARE( coords[2].z(), 9. );
+  }
+  QVERIFY( !moleculeFile->conformer(5, coords) );
+
+  // the topology is still read using Open Babel
+  Molecule *molecule = moleculeFile->molecule(0);
+  QVERIFY( molecule );
+  QCOMPARE( molecule->numAtoms(), static_cast<unsigned int>(3) );
+  delete molecule;
+
+  delete moleculeFile;
+}
+
+void MoleculeFileTest::indexFile()
+{
+  QString filename = "moleculefiletest_tmp_index.smi";
+  QFile::remove(MoleculeFile::indexFileName(filename));
+  std::ofstream ofs(filename.toAscii().data());
+  ofs << "c1ccccc1  phenyl" << std::endl;
+  ofs << "c1ccccc1N  aniline" << std::endl;
+  ofs << "c1ccccc1C  toluene" << std::endl;
+  ofs.close();
+
+  // first read writes the index
+  MoleculeFile* moleculeFile = MoleculeFile::readFile(filename);
+  QVERIFY( moleculeFile );
+  QVERIFY( moleculeFile->errors().isEmpty() );
+  QVERIFY( QFile::exists(MoleculeFile::indexFileName(filename)) );
+  QStringList titles = moleculeFile->titles();
+  delete moleculeFile;
+
+  // second read uses the index
+  moleculeFile = MoleculeFile::readFile(filename);
+  QVERIFY( moleculeFile );
+  QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(3) );
+  QCOMPARE( moleculeFile->titles(), titles );
+  QCOMPARE( moleculeFile->numAtoms(1), static_cast<unsigned int>(7) );
+  Molecule *toluene = moleculeFile->molecule(2);
+  QVERIFY( toluene );
+  QCOMPARE( toluene->numAtoms(), static_cast<unsigned int>(7) );
+  delete toluene;
+
+  // replacing a molecule updates the index
+  Molecule *aniline = moleculeFile->molecule(1);
+  aniline->addAtom();
+  QVERIFY( moleculeFile->replaceMolecule(1, aniline, filename) );
+  delete aniline;
+  delete moleculeFile;
+  moleculeFile = MoleculeFile::readFile(filename);
+  QCOMPARE( moleculeFile->numAtoms(1), static_cast<unsigned int>(8) );
+  toluene = moleculeFile->molecule(2);
+  QVERIFY( toluene );
+  QCOMPARE( toluene->numAtoms(), static_cast<unsigned int>(7) );
+  delete toluene;
+  delete moleculeFile;
+
+  // changing the file invalidates the index
+  ofs.open(filename.toAscii().data(), std::ios::app);
+  ofs << "c1ccccc1O  phenol" << std::endl;
+  ofs.close();
+  moleculeFile = MoleculeFile::readFile(filename);
+  QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(4) );
+  delete moleculeFile;
+
+  QFile::remove(MoleculeFile::indexFileName(filename));
+}
+
 void MoleculeFileTest::replaceMolecule()
 {
   QString filename = "moleculefiletest_tmp.smi";
@@ -284,6 +440,49 @@ void MoleculeFileTest::replaceMolecule()
   delete moleculeFile;
 }
 
+void MoleculeFileTest::replaceConformer()
+{
+  QString filename = "moleculefiletest_tmp_replace.xyz";
+  QFile::remove(MoleculeFile::indexFileName(filename));
+  std::ofstream ofs(filename.toAscii().data());
+  QVERIFY( ofs );
+  for (int i = 0; i < 3; ++i) {
+    ofs << "2" << std::endl << std::endl;
+    ofs << "H " << i << " 0.0 0.0" << std::endl;
+    ofs << "H " << i << " 0.0 0.74" << std::endl;
+  }
+  ofs.close();
+
+  MoleculeFile* moleculeFile = MoleculeFile::readFile(filename);
+  QVERIFY( moleculeFile );
+  QCOMPARE( moleculeFile->isConformerFile(), true );
+  QCOMPARE( moleculeFile->conformers().size(),
+      static_cast<std::vector<int>::size_type>(3) );
+
+  // the cached conformer follows the replaced molecule
+  Molecule *molecule = moleculeFile->molecule(1);
+  QVERIFY( molecule );
+  molecule->atom(0)->setPos(Eigen::Vector3d(5.0, 0.0, 0.0));
+  QVERIFY( moleculeFile->replaceMolecule(1, molecule, filename) );
+  QCOMPARE( moleculeFile->isConformerFile(), true );
+  QCOMPARE( moleculeFile->conformers().size(),
+      static_cast<std::vector<int>::size_type>(3) );
+  QCOMPARE( moleculeFile->conformers().at(1)->at(0).x(), 5.0 );
+
+  // a different number of atoms is no longer a conformer
+  molecule->addAtom();
+  QVERIFY( moleculeFile->replaceMolecule(1, molecule, filename) );
+  delete molecule;
+  QCOMPARE( moleculeFile->isConformerFile(), false );
+  QCOMPARE( moleculeFile->conformers().size(),
+      static_cast<std::vector<int>::size_type>(0) );
+  QVERIFY( !QFile::exists(filename + ".new") );
+
+  delete moleculeFile;
+  QFile::remove(filename);
+  QFile::remove(MoleculeFile::indexFileName(filename));
+}
+
 void MoleculeFileTest::appendMolecule()
 {
   QString filename = "moleculefiletest_tmp.smi";
@@ -298,6 +497,35 @@ void MoleculeFileTest::appendMolecule()
   QVERIFY( moleculeFile->errors().isEmpty() );
   QCOMPARE( moleculeFile->isConformerFile(), false );
   QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(3) );
+
+  // append a copy of the 2nd molecule
+  Molecule *aniline = moleculeFile->molecule(1);
+  QVERIFY( moleculeFile->appendMolecule(aniline, filename) );
+  QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(4) );
+  Molecule *appended = moleculeFile->molecule(3);
+  QVERIFY( appended );
+  QCOMPARE( appended->numAtoms(), static_cast<unsigned int>(7) );
+  QCOMPARE( appended->atom(6)->atomicNumber(), 7 );
+  delete appended;
+
+  // insert it again before the 1st molecule
+  QVERIFY( moleculeFile->insertMolecule(0, aniline, filename) );
+  delete aniline;
+  QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(5) );
+  Molecule *inserted = moleculeFile->molecule(0);
+  QVERIFY( inserted );
+  QCOMPARE( inserted->atom(6)->atomicNumber(), 7 );
+  delete inserted;
+  Molecule *phenyl = moleculeFile->molecule(1);
+  QVERIFY( phenyl );
+  QCOMPARE( phenyl->numAtoms(), static_cast<unsigned int>(6) );
+  delete phenyl;
+  Molecule *toluene = moleculeFile->molecule(3);
+  QVERIFY( toluene );
+  QCOMPARE( toluene->atom(6)->atomicNumber(), 6 );
+  delete toluene;
+
+  delete moleculeFile;
 }
 
 QTEST_MAIN(MoleculeFileTest)
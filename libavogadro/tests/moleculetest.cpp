@@ -31,6 +31,8 @@
 
 #include <Eigen/Core>
 
+#include <openbabel/mol.h>
+
 using Avogadro::Molecule;
 using Avogadro::Atom;
 using Avogadro::Bond;
@@ -144,6 +146,26 @@ private slots:
    * Tests conformer support.
    */ 
   void conformers();
+
+  /**
+   * Tests the cached OpenBabel::OBMol is synced rather than rebuilt.
+   */
+  void obmolCache();
+
+  /**
+   * Tests the contiguous atom data is kept in sync with the atoms.
+   */
+  void atomArrays();
+
+  /**
+   * Tests setting or swapping the positions of many atoms with one signal.
+   */
+  void setAtomPositions();
+
+  /**
+   * Tests adding many atoms and bonds with one signal.
+   */
+  void bulkInsert();
 };
 
 void MoleculeTest::prepareMolecule()
@@ -388,6 +410,157 @@ void MoleculeTest::conformers()
 
 }
 
+void MoleculeTest::obmolCache()
+{
+  Molecule mol;
+  Atom *a1 = mol.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  Atom *a2 = mol.addAtom(8, Vector3d(1.2, 0.0, 0.0));
+  mol.addBond(a1, a2, 2);
+
+  OpenBabel::OBMol obmol = mol.OBMol();
+  QCOMPARE(obmol.NumAtoms(), 2u);
+  QCOMPARE(obmol.NumBonds(), 1u);
+  QCOMPARE(mol.numOBMolRebuilds(), 1ul);
+
+  // Moving atoms only syncs the changed positions
+  a2->setPos(Vector3d(1.3, 0.0, 0.0));
+  obmol = mol.OBMol();
+  QCOMPARE(mol.numOBMolRebuilds(), 1ul);
+  QCOMPARE(obmol.GetAtom(2)->x(), 1.3);
+  mol.translate(Vector3d(1.0, 0.0, 0.0));
+  obmol = mol.OBMol();
+  QCOMPARE(mol.numOBMolRebuilds(), 1ul);
+  QCOMPARE(obmol.GetAtom(1)->x(), 1.0);
+
+  // Changing the element or the topology causes a rebuild
+  a1->setAtomicNumber(7);
+  obmol = mol.OBMol();
+  QCOMPARE(mol.numOBMolRebuilds(), 2ul);
+  QCOMPARE(obmol.GetAtom(1)->GetAtomicNum(), 7u);
+  mol.addAtom(1, Vector3d(-1.0, 0.0, 0.0));
+  obmol = mol.OBMol();
+  QCOMPARE(mol.numOBMolRebuilds(), 3ul);
+  QCOMPARE(obmol.NumAtoms(), 3u);
+
+  // The locked OBMol is the synced cache, not a copy
+  a2->setPos(Vector3d(2.5, 0.0, 0.0));
+  OpenBabel::OBMol *cached = mol.lockOBMol();
+  QCOMPARE(cached->NumAtoms(), 3u);
+  QCOMPARE(cached->GetAtom(2)->x(), 2.5);
+  mol.unlockOBMol();
+  QVERIFY(mol.lockOBMol() == cached);
+  mol.unlockOBMol();
+  QCOMPARE(mol.numOBMolRebuilds(), 3ul);
+}
+
+void MoleculeTest::atomArrays()
+{
+  Molecule mol;
+  Atom *a1 = mol.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  Atom *a2 = mol.addAtom(1, Vector3d(1.1, 0.0, 0.0));
+  QCOMPARE(mol.atomicNumbers().size(), static_cast<size_t>(2));
+  QCOMPARE(mol.atomicNumbers()[a1->id()], 6);
+  QCOMPARE(mol.atomicNumbers()[a2->id()], 1);
+  QCOMPARE(mol.atomPositions()[a2->id()].x(), 1.1);
+  QCOMPARE(mol.vdwRadii()[a1->id()], OpenBabel::etab.GetVdwRad(6));
+
+  a2->setAtomicNumber(8);
+  a2->setCustomRadius(0.5);
+  a1->setPartialCharge(0.25);
+  QCOMPARE(mol.atomicNumbers()[a2->id()], 8);
+  QCOMPARE(mol.covalentRadii()[a2->id()], OpenBabel::etab.GetCovalentRad(8));
+  QCOMPARE(mol.customRadii()[a2->id()], 0.5);
+  QCOMPARE(mol.partialCharges()[a1->id()], 0.25);
+}
+
+void MoleculeTest::setAtomPositions()
+{
+  Molecule mol;
+  mol.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  mol.addAtom(8, Vector3d(1.2, 0.0, 0.0));
+  mol.addAtom(1, Vector3d(-1.0, 0.0, 0.0));
+  OpenBabel::OBMol obmol = mol.OBMol();
+
+  QSignalSpy geometrySpy(&mol, SIGNAL(geometryChanged(int, int)));
+  QSignalSpy updatedSpy(&mol, SIGNAL(updated()));
+
+  const double coordinates[] = { 0.0, 1.0, 0.0, 0.0, 0.0, 2.0 };
+  QVERIFY(mol.setAtomPositions(coordinates, 1, 2));
+  QCOMPARE(*mol.atom(0)->pos(), Vector3d(0.0, 0.0, 0.0));
+  QCOMPARE(*mol.atom(1)->pos(), Vector3d(0.0, 1.0, 0.0));
+  QCOMPARE(*mol.atom(2)->pos(), Vector3d(0.0, 0.0, 2.0));
+  QCOMPARE(geometrySpy.count(), 1);
+  QCOMPARE(geometrySpy.at(0).at(0).toInt(), 1);
+  QCOMPARE(geometrySpy.at(0).at(1).toInt(), 2);
+  QCOMPARE(updatedSpy.count(), 1);
+
+  // The cached OBMol is synced rather than rebuilt
+  obmol = mol.OBMol();
+  QCOMPARE(mol.numOBMolRebuilds(), 1ul);
+  QCOMPARE(obmol.GetAtom(3)->z(), 2.0);
+
+  // Nothing changes while the lock is held elsewhere
+  mol.lock()->lockForRead();
+  QVERIFY(!mol.setAtomPositions(coordinates, 0, 2, false));
+  mol.lock()->unlock();
+  QCOMPARE(*mol.atom(0)->pos(), Vector3d(0.0, 0.0, 0.0));
+
+  // Swapping a buffer of positions leaves the old ones in the buffer
+  std::vector<Vector3d> buffer(3, Vector3d(1.0, 1.0, 1.0));
+  QVERIFY(mol.swapAtomPositions(buffer));
+  QCOMPARE(*mol.atom(2)->pos(), Vector3d(1.0, 1.0, 1.0));
+  QCOMPARE(buffer[2], Vector3d(0.0, 0.0, 2.0));
+  QCOMPARE(geometrySpy.count(), 2);
+  QCOMPARE(geometrySpy.at(1).at(1).toInt(), 3);
+
+  // The forces are set along with the positions
+  std::vector<Vector3d> forces(3, Vector3d(0.0, 0.0, -1.0));
+  buffer.assign(3, Vector3d(2.0, 2.0, 2.0));
+  QVERIFY(mol.swapAtomPositions(buffer, forces));
+  QCOMPARE(*mol.atom(2)->pos(), Vector3d(2.0, 2.0, 2.0));
+  QCOMPARE(mol.atom(2)->forceVector(), Vector3d(0.0, 0.0, -1.0));
+  forces.resize(2);
+  QVERIFY(!mol.swapAtomPositions(buffer, forces));
+  QCOMPARE(*mol.atom(2)->pos(), Vector3d(2.0, 2.0, 2.0));
+
+  buffer.resize(2);
+  QVERIFY(!mol.swapAtomPositions(buffer));
+}
+
+void MoleculeTest::bulkInsert()
+{
+  Molecule mol;
+  mol.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+
+  QSignalSpy atomSpy(&mol, SIGNAL(atomAdded(Atom*)));
+  QSignalSpy bondSpy(&mol, SIGNAL(bondAdded(Bond*)));
+  QSignalSpy changedSpy(&mol, SIGNAL(moleculeChanged()));
+
+  mol.beginBulkInsert(100, 100);
+  for (int i = 1; i <= 100; ++i) {
+    mol.addAtom(6, Vector3d(1.5 * i, 0.0, 0.0));
+    mol.addBond(i - 1, i);
+  }
+  // Nested insertions notify once, at the end of the outer one
+  mol.beginBulkInsert(0);
+  mol.endBulkInsert();
+  QCOMPARE(changedSpy.count(), 0);
+  mol.endBulkInsert();
+
+  QCOMPARE(atomSpy.count(), 0);
+  QCOMPARE(bondSpy.count(), 0);
+  QCOMPARE(changedSpy.count(), 1);
+  QCOMPARE(mol.numAtoms(), 101u);
+  QCOMPARE(mol.numBonds(), 100u);
+  QCOMPARE(mol.atomicNumbers()[100], 6);
+  QCOMPARE(mol.atom(100)->bonds().size(), 1);
+  QCOMPARE(mol.OBMol().NumBonds(), 100u);
+
+  // Atoms added afterwards are signalled again
+  mol.addAtom(8, Vector3d(0.0, 1.0, 0.0));
+  QCOMPARE(atomSpy.count(), 1);
+}
+
 QTEST_MAIN(MoleculeTest)
 
 #include "moc_moleculetest.cxx"
@@ -78,6 +78,11 @@ class NeighborListTest : public QObject
     void test10A_2n();
     void test10A_3n();
 
+    /**
+     * Move atoms and update their cells rather than building a new list.
+     */
+    void updateMoved();
+
 };
 
 void NeighborListTest::initTestCase()
@@ -179,6 +184,32 @@ void NeighborListTest::test10A_3n()
   QCOMPARE(m_correct10, count);
 }
 
+void NeighborListTest::updateMoved()
+{
+  NeighborList nbrList(m_molecule, 2.0, false, 1);
+  Atom *atom = m_molecule->atom(0);
+  QList<Atom*> moved;
+  moved << atom;
+
+  // Move the corner atom into the middle of the grid
+  Vector3d pos(5.5, 5.0, 5.0);
+  atom->setPos(pos);
+  nbrList.update(moved);
+  unsigned int correct = 0;
+  foreach (Atom *other, m_molecule->atoms())
+    if (other != atom && (*other->pos() - pos).squaredNorm() <= 4.0)
+      ++correct;
+  QCOMPARE(static_cast<unsigned int>(nbrList.nbrs(atom, false).size()), correct);
+
+  // Move it off the grid, the cells are rebuilt
+  atom->setPos(Vector3d(20.0, 20.0, 20.0));
+  nbrList.update(moved);
+  QVERIFY(nbrList.nbrs(atom, false).isEmpty());
+  QVERIFY(!nbrList.nbrs(m_molecule->atom(1), false).isEmpty());
+
+  atom->setPos(Vector3d(0.0, 0.0, 0.0));
+}
+
 QTEST_MAIN(NeighborListTest)
 
 #include "moc_neighborlisttest.cxx"
@@ -0,0 +1,101 @@
+/**********************************************************************
+  PeriodicHashTest - unit testing for the PeriodicHash class
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/periodichash.h>
+
+#include <cmath>
+#include <cstdlib>
+
+using Avogadro::PeriodicHash;
+using Eigen::Vector3d;
+
+class PeriodicHashTest : public QObject
+{
+  Q_OBJECT
+
+  private slots:
+    /**
+     * Coordinates within the tolerance are duplicates, including across the
+     * faces of the unit cell.
+     */
+    void duplicates();
+
+    /**
+     * The hash finds the same duplicates as comparing every pair.
+     */
+    void bruteForce();
+};
+
+void PeriodicHashTest::duplicates()
+{
+  PeriodicHash hash(0.01);
+  QVERIFY(hash.insertUnique(Vector3d(0.5, 0.5, 0.5)));
+  QVERIFY(!hash.insertUnique(Vector3d(0.505, 0.5, 0.5)));
+  QVERIFY(hash.insertUnique(Vector3d(0.515, 0.5, 0.5)));
+  QCOMPARE(hash.size(), 2);
+
+  // Across a face and in another image of the cell
+  QVERIFY(hash.insertUnique(Vector3d(0.9995, 0.0, 0.5)));
+  QCOMPARE(hash.find(Vector3d(0.0003, 0.0, 0.5)), 2);
+  QCOMPARE(hash.find(Vector3d(-2.0003, 3.0, 1.5)), 2);
+  QCOMPARE(hash.find(Vector3d(0.5, 0.5, 0.7)), -1);
+  QCOMPARE(hash.findAll(Vector3d(0.508, 0.5, 0.5)).size(), 2);
+
+  // Large tolerances use a single cell
+  PeriodicHash coarse(0.5);
+  QVERIFY(coarse.insertUnique(Vector3d(0.1, 0.1, 0.1)));
+  QVERIFY(!coarse.insertUnique(Vector3d(0.9, 0.9, 0.9)));
+}
+
+void PeriodicHashTest::bruteForce()
+{
+  const double tolerance = 0.05;
+  PeriodicHash hash(tolerance);
+  QList<Vector3d> unique;
+  std::srand(1);
+  for (int n = 0; n < 2000; ++n) {
+    Vector3d fcoord(std::rand() * 3.0 / RAND_MAX - 1.0,
+                    std::rand() * 1.0 / RAND_MAX,
+                    std::rand() * 1.0 / RAND_MAX);
+    bool duplicate = false;
+    foreach (const Vector3d &other, unique) {
+      Vector3d d = PeriodicHash::wrap(fcoord) - other;
+      for (int axis = 0; axis < 3; ++axis)
+        d[axis] -= std::floor(d[axis] + 0.5);
+      if (d.squaredNorm() < tolerance * tolerance) {
+        duplicate = true;
+        break;
+      }
+    }
+    QCOMPARE(hash.insertUnique(fcoord), !duplicate);
+    if (!duplicate)
+      unique.append(PeriodicHash::wrap(fcoord));
+  }
+  QCOMPARE(hash.size(), unique.size());
+}
+
+QTEST_MAIN(PeriodicHashTest)
+
+#include "moc_periodichashtest.cxx"
@@ -0,0 +1,164 @@
+/**********************************************************************
+  PickTreeTest - unit testing for the PickTree class
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/picktree.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+
+using Avogadro::PickTree;
+using Avogadro::Molecule;
+using Avogadro::Primitive;
+using Avogadro::GLHit;
+using Eigen::Vector3d;
+
+class PickTreeTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * The planes of the box from (xMin, -1, -1) to (xMax, 1, 1), the near
+     * plane is at z = 1.
+     */
+    std::vector<PickTree::Plane> box(double xMin, double xMax);
+
+  private slots:
+    /**
+     * Spheres are found inside the box, and again after they move.
+     */
+    void spheres();
+
+    /**
+     * Capsules crossing the box are found, nearest first.
+     */
+    void capsules();
+
+    /**
+     * Moving the atoms of a molecule moves their spheres and bonds.
+     */
+    void moveMolecule();
+};
+
+std::vector<PickTree::Plane> PickTreeTest::box(double xMin, double xMax)
+{
+  const double normals[6][3] = { { 0, 0, -1 }, { 0, 0, 1 },
+                                 { 1, 0, 0 }, { -1, 0, 0 },
+                                 { 0, 1, 0 }, { 0, -1, 0 } };
+  const double distances[6] = { 1, 1, -xMin, xMax, 1, 1 };
+  std::vector<PickTree::Plane> planes(6);
+  for (int i = 0; i < 6; ++i) {
+    planes[i].normal = Vector3d(normals[i][0], normals[i][1], normals[i][2]);
+    planes[i].distance = distances[i];
+  }
+  return planes;
+}
+
+void PickTreeTest::spheres()
+{
+  PickTree tree;
+  for (int i = 0; i < 100; ++i)
+    tree.add(Primitive::AtomType, i, Vector3d(i, 0, 0), Vector3d(i, 0, 0), 0.4);
+  tree.update();
+  QCOMPARE(tree.size(), 100);
+
+  QList<GLHit> hits = tree.hits(box(9.5, 12.5), 2.0);
+  QCOMPARE(hits.size(), 3);
+  QList<unsigned int> names;
+  foreach (const GLHit &hit, hits) {
+    QCOMPARE(hit.type(), static_cast<GLuint>(Primitive::AtomType));
+    names.append(hit.name());
+  }
+  qSort(names);
+  QCOMPARE(names, QList<unsigned int>() << 10 << 11 << 12);
+
+  // Moving the same atoms refits the tree
+  tree.clear();
+  for (int i = 0; i < 100; ++i)
+    tree.add(Primitive::AtomType, i, Vector3d(i + 5, 0, 0),
+             Vector3d(i + 5, 0, 0), 0.4);
+  tree.update();
+  names.clear();
+  foreach (const GLHit &hit, tree.hits(box(9.5, 12.5), 2.0))
+    names.append(hit.name());
+  qSort(names);
+  QCOMPARE(names, QList<unsigned int>() << 5 << 6 << 7);
+}
+
+void PickTreeTest::capsules()
+{
+  PickTree tree;
+  // A bond crossing the box, deeper than the atom in front of it
+  tree.add(Primitive::BondType, 0, Vector3d(-5, 0, -0.5), Vector3d(5, 0, -0.5),
+           0.1);
+  tree.add(Primitive::AtomType, 1, Vector3d(0, 0, 0.5), Vector3d(0, 0, 0.5),
+           0.2);
+  // A bond next to the box
+  tree.add(Primitive::BondType, 2, Vector3d(-5, 1.5, 0), Vector3d(5, 1.5, 0),
+           0.1);
+  tree.update();
+
+  QList<GLHit> hits = tree.hits(box(-0.5, 0.5), 2.0);
+  QCOMPARE(hits.size(), 2);
+  QCOMPARE(hits.at(0).type(), static_cast<GLuint>(Primitive::AtomType));
+  QCOMPARE(hits.at(0).name(), 1u);
+  QCOMPARE(hits.at(1).type(), static_cast<GLuint>(Primitive::BondType));
+  QCOMPARE(hits.at(1).name(), 0u);
+  QVERIFY(hits.at(0).minZ() < hits.at(1).minZ());
+}
+
+void PickTreeTest::moveMolecule()
+{
+  Molecule molecule;
+  for (int i = 0; i < 20; ++i) {
+    molecule.addAtom(6, Vector3d(i, 0, 0));
+    if (i)
+      molecule.addBond(i - 1, i);
+  }
+  PickTree tree;
+  foreach (Avogadro::Atom *atom, molecule.atoms())
+    tree.add(Primitive::AtomType, atom->index(), *atom->pos(), *atom->pos(),
+             0.4);
+  tree.update();
+
+  // Shift every atom by 5 along x, as a force field step would
+  std::vector<double> coordinates;
+  for (int i = 0; i < 20; ++i) {
+    coordinates.push_back(i + 5);
+    coordinates.push_back(0.0);
+    coordinates.push_back(0.0);
+  }
+  QVERIFY(molecule.setAtomPositions(&coordinates[0]));
+  tree.move(&molecule);
+
+  QList<unsigned int> names;
+  foreach (const GLHit &hit, tree.hits(box(9.5, 12.5), 2.0))
+    names.append(hit.name());
+  qSort(names);
+  QCOMPARE(names, QList<unsigned int>() << 5 << 6 << 7);
+}
+
+QTEST_MAIN(PickTreeTest)
+
+#include "moc_picktreetest.cxx"
@@ -0,0 +1,162 @@
+/**********************************************************************
+  PrimitiveListTest - unit testing for the PrimitiveList class
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/primitivelist.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+using Avogadro::PrimitiveList;
+using Avogadro::Primitive;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Bond;
+
+class PrimitiveListTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    Molecule *m_molecule; /// Molecule object for use by the test class.
+
+  private slots:
+    /**
+     * Called before each test function is executed.
+     */
+    void init();
+
+    /**
+     * Called after every test function.
+     */
+    void cleanup();
+
+    /**
+     * Primitives are kept in the order they were added, by type.
+     */
+    void order();
+
+    /**
+     * Removing primitives updates the lookups, sizes and lists.
+     */
+    void removeAll();
+
+    /**
+     * Removing a primitive and adding it again puts it at the end.
+     */
+    void readd();
+};
+
+void PrimitiveListTest::init()
+{
+  m_molecule = new Molecule;
+  for (int i = 0; i < 10; ++i)
+    m_molecule->addAtom();
+  for (int i = 0; i < 9; ++i)
+    m_molecule->addBond(i, i + 1);
+}
+
+void PrimitiveListTest::cleanup()
+{
+  delete m_molecule;
+  m_molecule = 0;
+}
+
+void PrimitiveListTest::order()
+{
+  PrimitiveList list;
+  for (int i = 9; i >= 0; --i) {
+    list.append(m_molecule->atom(i));
+    if (i < 9)
+      list.append(m_molecule->bond(i));
+  }
+  QCOMPARE(list.size(), 19);
+  QCOMPARE(list.count(Primitive::AtomType), 10);
+  QCOMPARE(list.count(Primitive::BondType), 9);
+
+  QList<Primitive *> atoms = list.subList(Primitive::AtomType);
+  for (int i = 0; i < 10; ++i)
+    QCOMPARE(atoms.at(i), static_cast<Primitive *>(m_molecule->atom(9 - i)));
+  QVERIFY(list.contains(m_molecule->atom(3)));
+  QVERIFY(list.contains(m_molecule->bond(3)));
+}
+
+void PrimitiveListTest::removeAll()
+{
+  PrimitiveList list;
+  foreach (Atom *atom, m_molecule->atoms())
+    list.append(atom);
+  foreach (Bond *bond, m_molecule->bonds())
+    list.append(bond);
+
+  for (int i = 0; i < 10; i += 2)
+    list.removeAll(m_molecule->atom(i));
+  // Removing a primitive not in the list does nothing
+  list.removeAll(m_molecule->atom(0));
+
+  QCOMPARE(list.size(), 14);
+  QCOMPARE(list.count(Primitive::AtomType), 5);
+  QVERIFY(!list.contains(m_molecule->atom(4)));
+  QVERIFY(list.contains(m_molecule->atom(5)));
+
+  QList<Primitive *> atoms = list.subList(Primitive::AtomType);
+  QCOMPARE(atoms.size(), 5);
+  for (int i = 0; i < 5; ++i)
+    QCOMPARE(atoms.at(i), static_cast<Primitive *>(m_molecule->atom(2 * i + 1)));
+
+  int n = 0;
+  foreach (Primitive *p, list) {
+    QVERIFY(list.contains(p));
+    ++n;
+  }
+  QCOMPARE(n, 14);
+
+  // Copies keep the removals
+  PrimitiveList copy(list);
+  QCOMPARE(copy.list().size(), 14);
+  QVERIFY(!copy.contains(m_molecule->atom(2)));
+}
+
+void PrimitiveListTest::readd()
+{
+  PrimitiveList list;
+  foreach (Atom *atom, m_molecule->atoms())
+    list.append(atom);
+
+  list.removeAll(m_molecule->atom(0));
+  list.append(m_molecule->atom(0));
+
+  QList<Primitive *> atoms = list.subList(Primitive::AtomType);
+  QCOMPARE(atoms.size(), 10);
+  QCOMPARE(atoms.first(), static_cast<Primitive *>(m_molecule->atom(1)));
+  QCOMPARE(atoms.last(), static_cast<Primitive *>(m_molecule->atom(0)));
+
+  list.clear();
+  QVERIFY(list.isEmpty());
+  QVERIFY(!list.contains(m_molecule->atom(1)));
+}
+
+QTEST_MAIN(PrimitiveListTest)
+
+#include "moc_primitivelisttest.cxx"
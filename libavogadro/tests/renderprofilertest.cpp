@@ -0,0 +1,198 @@
+/**********************************************************************
+  RenderProfilerTest - unit testing for the RenderProfiler class
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/renderprofiler.h>
+
+using Avogadro::RenderProfiler;
+
+class RenderProfilerTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * Record a frame with the given times for two sections.
+     */
+    void addFrame(RenderProfiler &profiler, double opaque, double overlay);
+
+  private slots:
+    /**
+     * Nothing is recorded while the profiler is disabled.
+     */
+    void disabled();
+
+    /**
+     * Sections are listed in the order they are first timed, and times
+     * added to a section in one frame are summed.
+     */
+    void sections();
+
+    /**
+     * Only the last frames are kept, oldest first.
+     */
+    void ring();
+
+    /**
+     * Average, maximum and histogram of the kept times.
+     */
+    void statistics();
+
+    /**
+     * One row per frame and one quoted column per section.
+     */
+    void csv();
+
+    /**
+     * Failing to write the file is reported.
+     */
+    void writeCsv();
+};
+
+void RenderProfilerTest::addFrame(RenderProfiler &profiler, double opaque,
+                                  double overlay)
+{
+  profiler.beginFrame();
+  profiler.addTime("Opaque", opaque);
+  profiler.addTime("Text overlay", overlay);
+  profiler.endFrame();
+}
+
+void RenderProfilerTest::disabled()
+{
+  RenderProfiler profiler;
+  QVERIFY(!profiler.isEnabled());
+  addFrame(profiler, 1.0, 2.0);
+  QCOMPARE(profiler.frames(), 0);
+  QCOMPARE(profiler.sections(), QStringList() << RenderProfiler::frameSection());
+
+  profiler.setEnabled(true);
+  addFrame(profiler, 1.0, 2.0);
+  QCOMPARE(profiler.frames(), 1);
+
+  // the recorded times are kept
+  profiler.setEnabled(false);
+  QCOMPARE(profiler.frames(), 1);
+}
+
+void RenderProfilerTest::sections()
+{
+  RenderProfiler profiler;
+  profiler.setEnabled(true);
+  profiler.beginFrame();
+  profiler.addTime("Opaque", 1.5);
+  profiler.addTime("Text overlay", 0.5);
+  profiler.addTime("Opaque", 2.0);
+  profiler.endFrame();
+
+  QCOMPARE(profiler.sections(), QStringList() << RenderProfiler::frameSection()
+           << "Opaque" << "Text overlay");
+  QCOMPARE(profiler.times("Opaque"), QVector<double>() << 3.5);
+  QCOMPARE(profiler.times("Text overlay"), QVector<double>() << 0.5);
+  QVERIFY(profiler.times("Unknown").isEmpty());
+
+  // sections that are not drawn in a frame take no time
+  profiler.beginFrame();
+  profiler.addTime("Opaque", 1.0);
+  profiler.endFrame();
+  QCOMPARE(profiler.times("Text overlay"), QVector<double>() << 0.5 << 0.0);
+
+  profiler.clear();
+  QCOMPARE(profiler.frames(), 0);
+  QCOMPARE(profiler.sections(), QStringList() << RenderProfiler::frameSection());
+}
+
+void RenderProfilerTest::ring()
+{
+  RenderProfiler profiler(3);
+  profiler.setEnabled(true);
+  for (int i = 1; i <= 5; ++i)
+    addFrame(profiler, i, 0.0);
+
+  QCOMPARE(profiler.frames(), 3);
+  QCOMPARE(profiler.times("Opaque"), QVector<double>() << 3.0 << 4.0 << 5.0);
+  QCOMPARE(profiler.times(RenderProfiler::frameSection()).size(), 3);
+}
+
+void RenderProfilerTest::statistics()
+{
+  RenderProfiler profiler;
+  profiler.setEnabled(true);
+  addFrame(profiler, 1.0, 0.0);
+  addFrame(profiler, 2.5, 0.0);
+  addFrame(profiler, 4.5, 0.0);
+  addFrame(profiler, 12.0, 0.0);
+
+  QCOMPARE(profiler.average("Opaque"), 5.0);
+  QCOMPARE(profiler.maximum("Opaque"), 12.0);
+  QCOMPARE(profiler.average("Unknown"), 0.0);
+
+  // the last bin also counts the longer times
+  QCOMPARE(profiler.histogram("Opaque", 3, 2.0),
+           QVector<int>() << 1 << 1 << 2);
+  QVERIFY(profiler.histogram("Opaque", 0, 2.0).isEmpty());
+  QCOMPARE(profiler.histogram("Opaque", 2, 0.0), QVector<int>() << 0 << 0);
+}
+
+void RenderProfilerTest::csv()
+{
+  RenderProfiler profiler;
+  profiler.setEnabled(true);
+  profiler.beginFrame();
+  profiler.addTime("Ball, \"and\" Stick", 1.25);
+  profiler.endFrame();
+
+  QStringList lines = profiler.toCsv().split('\n', QString::SkipEmptyParts);
+  QCOMPARE(lines.size(), 2);
+  QCOMPARE(lines.at(0), QString("\"Frame number\",\"Frame\","
+                                "\"Ball, \"\"and\"\" Stick\""));
+  QVERIFY(lines.at(1).startsWith("0,"));
+  QVERIFY(lines.at(1).endsWith(",1.250"));
+}
+
+void RenderProfilerTest::writeCsv()
+{
+  RenderProfiler profiler;
+  profiler.setEnabled(true);
+  addFrame(profiler, 1.0, 2.0);
+
+  QString fileName = "renderprofilertest_tmp.csv";
+  QString error;
+  QVERIFY(profiler.writeCsv(fileName, &error));
+  QVERIFY(error.isEmpty());
+  QFile file(fileName);
+  QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+  QCOMPARE(QString(file.readAll()), profiler.toCsv());
+  file.close();
+  QFile::remove(fileName);
+
+  QVERIFY(!profiler.writeCsv("no_such_directory/profile.csv", &error));
+  QVERIFY(error.contains("no_such_directory/profile.csv"));
+  // the error is optional
+  QVERIFY(!profiler.writeCsv("no_such_directory/profile.csv"));
+}
+
+QTEST_MAIN(RenderProfilerTest)
+
+#include "moc_renderprofilertest.cxx"
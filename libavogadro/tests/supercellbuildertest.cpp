@@ -0,0 +1,114 @@
+/**********************************************************************
+  SuperCellBuilderTest - unit testing for the SuperCellBuilder class
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/supercellbuilder.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+using Avogadro::SuperCellBuilder;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Bond;
+using Eigen::Vector3d;
+
+class SuperCellBuilderTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * The bonds perceived by distance over the whole molecule.
+     */
+    int perceivedBonds(const Molecule &molecule);
+
+  private slots:
+    /**
+     * Bonds across the faces of the unit cell are replicated into the
+     * supercell like the ones within it.
+     */
+    void perceiveBonds();
+
+    /**
+     * The bonds of the Molecule are replicated as they are.
+     */
+    void replicateBonds();
+};
+
+int SuperCellBuilderTest::perceivedBonds(const Molecule &molecule)
+{
+  int bonds = 0;
+  const QList<Atom *> atoms = molecule.atoms();
+  for (int i = 0; i < atoms.size(); ++i)
+    for (int j = i + 1; j < atoms.size(); ++j)
+      if ((*atoms[i]->pos() - *atoms[j]->pos()).norm() < 1.6)
+        ++bonds;
+  return bonds;
+}
+
+void SuperCellBuilderTest::perceiveBonds()
+{
+  // A chain of carbon atoms 1.5 A apart through a 3 A cubic cell
+  Molecule molecule;
+  molecule.addAtom(6, Vector3d(0.5, 0.5, 0.5));
+  molecule.addAtom(6, Vector3d(2.0, 0.5, 0.5));
+  Eigen::Matrix3d cell = 3.0 * Eigen::Matrix3d::Identity();
+
+  SuperCellBuilder builder(&molecule, cell);
+  builder.perceiveBonds();
+  // One bond within the cell and one to the next cell along a
+  QCOMPARE(builder.numBonds(), 2);
+  QCOMPARE(molecule.numBonds(), 1u);
+
+  builder.build(4, 2, 1);
+  QCOMPARE(molecule.numAtoms(), 16u);
+  // Each of the two chains has 7 bonds
+  QCOMPARE(molecule.numBonds(), 14u);
+  QCOMPARE(static_cast<int>(molecule.numBonds()), perceivedBonds(molecule));
+  QVERIFY(*molecule.atom(15)->pos() == Vector3d(11.0, 3.5, 0.5));
+}
+
+void SuperCellBuilderTest::replicateBonds()
+{
+  Molecule molecule;
+  Atom *a = molecule.addAtom(8, Vector3d(0.0, 0.0, 0.0));
+  Atom *b = molecule.addAtom(1, Vector3d(0.96, 0.0, 0.0));
+  molecule.addBond(a, b, 2);
+  Eigen::Matrix3d cell = 5.0 * Eigen::Matrix3d::Identity();
+
+  SuperCellBuilder builder(&molecule, cell);
+  builder.build(2, 2, 2);
+  QCOMPARE(molecule.numAtoms(), 16u);
+  QCOMPARE(molecule.numBonds(), 8u);
+  foreach (Bond *bond, molecule.bonds()) {
+    QCOMPARE(bond->order(), static_cast<short>(2));
+    QVERIFY(bond->beginAtom()->atomicNumber() == 8);
+    QVERIFY(bond->endAtom()->atomicNumber() == 1);
+  }
+}
+
+QTEST_MAIN(SuperCellBuilderTest)
+
+#include "moc_supercellbuildertest.cxx"